@@ -18,6 +18,32 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <math.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+#ifdef __x86_64__
+  #include <immintrin.h>
+#endif
+
+#include "wtjl.h"
 
 /* end includes */
 
@@ -46,106 +72,424 @@
 #define TEST_RESULT_REST CLR_YEL "\"%s\"" CLR_NRM "\n", __func__);
 #define TEST_PASS printf(CLR_GRN "✓ " TEST_RESULT_REST
 #define TEST_FAIL glbl_tests_result = false; printf(CLR_RED "✗ " TEST_RESULT_REST
+#define BENCHES_PRELUDE printf(CLR(CYN, "Running benchmarks.\n"));
+#define BENCH_SUITE printf("\n" CLR(CYN, "B ") CLR_YEL "\"%s\"\n" CLR_NRM, __func__);
+#define BENCH_RESULT(label, seconds) printf("%-40s " CLR_GRN "%12.3f us" CLR_NRM "\n", label, (seconds) * 1e6);
 #define TESTS_RESULTS glbl_tests_result ? printf("\n" CLR_GRN "All tests passed!\n" CLR_NRM) : printf("\n" CLR_RED "One or more tests failed!\n" CLR_NRM);
 
 /* end macros */
 
 /* ``begin memory tracking */
 
-int j_mem_offset = 0;
-
-size_t j_mem_total_alloc = 0;
-size_t j_mem_total_free = 0;
-
+// every allocation is preceded by its record, so freeing one costs the same
+// wherever it sits in the list
 typedef struct _mem_node_t {
-  void *ptr;
+  void *ptr; // the allocation just past this record, for spotting foreign pointers
+  struct j_mem_t *mem;
   size_t size;
-  struct _mem_node_t *next;
-} _mem_node_t;
+  struct _mem_node_t *next; // also links a free pool block to the next one
+  struct _mem_node_t *prev;
+  uint32_t account; // what it is charged to, see j_mem_t.accounts
+} __attribute__((aligned(16))) _mem_node_t;
+
+// allocations of up to J_MEM_POOL_MAX bytes, list items, tokens, frames,
+// small strings and closures among them, come with their record from pools
+// of fixed size blocks, one per multiple of 16 bytes; the pools carve their
+// blocks from slabs the tracker owns and drops wholesale when it is reset
+#define J_MEM_POOL_MAX 256
+#define J_MEM_POOL_CLASSES (J_MEM_POOL_MAX / 16 + 1)
+#define J_MEM_SLAB_SIZE 16384
+#define J_MEM_ACCOUNTS 16
+
+typedef struct j_pool_t {
+  _mem_node_t *free_list;
+  size_t allocs;
+  size_t frees;
+  size_t carved; // blocks taken fresh from a slab rather than the free list
+  size_t in_use;
+  size_t peak;
+} j_pool_t;
+
+typedef struct j_mem_t {
+  int offset;
+  size_t total_alloc;
+  size_t total_free;
+  _mem_node_t *list_head;
+  _mem_node_t *list_tail;
+  j_pool_t pools [J_MEM_POOL_CLASSES];
+  void *slabs; // each starts with a pointer to the one before
+  char *slab_next;
+  char *slab_end;
+  size_t num_slabs;
+  // live bytes are total_alloc - total_free; allocating past `threshold`
+  // takes the slow path through _j_mem_over, which keeps it at the nearer of
+  // the limits still ahead
+  size_t threshold;
+  size_t peak;
+  size_t trigger; // past this `pressure` is set, 0 for never; starts at the soft limit
+  size_t soft_limit; // 0 for none
+  size_t hard_limit; // 0 for none
+  bool pressure; // the owner should collect when it next can
+  void (*exhausted) (struct j_mem_t *mem, size_t live); // past the hard limit; raises rather than returns
+  uint32_t account; // what new allocations are charged to
+  size_t accounts [J_MEM_ACCOUNTS]; // live bytes by what they were charged to
+} j_mem_t;
+
+// allocations are recorded against the tracker bound to the calling thread;
+// contexts bind their own tracker, anything else falls back to a per-thread one
+__thread j_mem_t _j_mem_thread;
+__thread j_mem_t *_j_mem_bound = NULL;
+
+j_mem_t *j_mem_current () {
+  return _j_mem_bound ? _j_mem_bound : &_j_mem_thread;
+}
+
+j_mem_t *j_mem_bind (j_mem_t *mem) {
+  j_mem_t *previous = _j_mem_bound;
+  _j_mem_bound = mem;
+  return previous;
+}
+
+static inline size_t _j_mem_class (size_t size) {
+  return (size + 15) / 16;
+}
+
+static inline size_t _j_mem_block_size (size_t class) {
+  return sizeof(_mem_node_t) + class * 16;
+}
+
+_mem_node_t *_j_mem_pool_take (j_mem_t *mem, size_t class) {
+  j_pool_t *pool = &mem->pools[class];
+  _mem_node_t *node = pool->free_list;
+  if (node) {
+    pool->free_list = node->next;
+  } else {
+    size_t block_size = _j_mem_block_size(class);
+    if ((size_t) (mem->slab_end - mem->slab_next) < block_size) {
+      // whatever is left of the old slab is too small for this class and
+      // is given up rather than tracked
+      void **slab = malloc(J_MEM_SLAB_SIZE);
+      if (!slab) {
+        return NULL;
+      }
+      *slab = mem->slabs;
+      mem->slabs = slab;
+      mem->num_slabs++;
+      mem->slab_next = (char *) slab + sizeof(_mem_node_t);
+      mem->slab_end = (char *) slab + J_MEM_SLAB_SIZE;
+    }
+    node = (_mem_node_t *) mem->slab_next;
+    mem->slab_next += block_size;
+    pool->carved++;
+  }
+  pool->allocs++;
+  pool->in_use++;
+  pool->peak = MAX(pool->peak, pool->in_use);
+  return node;
+}
+
+void _j_mem_pool_give (j_mem_t *mem, _mem_node_t *node) {
+  j_pool_t *pool = &mem->pools[_j_mem_class(node->size)];
+  node->next = pool->free_list;
+  pool->free_list = node;
+  pool->frees++;
+  pool->in_use--;
+}
+
+// the record, unlinked, for an allocation of `size` bytes against `mem`,
+// NULL when there is no memory for one that size
+_mem_node_t *_j_mem_node_new (j_mem_t *mem, size_t size) {
+  _mem_node_t *node;
+  if (size <= J_MEM_POOL_MAX) {
+    node = _j_mem_pool_take(mem, _j_mem_class(size));
+  } else {
+    node = size <= SIZE_MAX - sizeof(_mem_node_t) ? malloc(sizeof(_mem_node_t) + size) : NULL;
+  }
+  if (!node) {
+    return NULL;
+  }
+  node->ptr = node + 1;
+  node->mem = mem;
+  node->size = size;
+  node->account = mem->account;
+  return node;
+}
+
+void _j_mem_node_free (j_mem_t *mem, _mem_node_t *node) {
+  node->ptr = NULL;
+  if (node->size <= J_MEM_POOL_MAX) {
+    _j_mem_pool_give(mem, node);
+  } else {
+    free(node);
+  }
+}
+
+static inline void _j_mem_arm (j_mem_t *mem) {
+  size_t hard = mem->hard_limit ? mem->hard_limit : SIZE_MAX;
+  mem->threshold = mem->trigger && !mem->pressure ? MIN(mem->trigger, hard) : hard;
+}
+
+// soft and hard limits on the live bytes of `mem`, 0 for none
+void j_mem_limit (j_mem_t *mem, size_t soft_limit, size_t hard_limit) {
+  mem->soft_limit = soft_limit;
+  mem->hard_limit = hard_limit;
+  mem->trigger = soft_limit;
+  mem->pressure = false;
+  _j_mem_arm(mem);
+}
+
+// after a collection, sets pressure again once live bytes pass `trigger`
+void j_mem_collected (j_mem_t *mem, size_t trigger) {
+  mem->trigger = trigger;
+  mem->pressure = false;
+  _j_mem_arm(mem);
+}
+
+// the slow path of an allocation that would take `mem` to `live` bytes,
+// which is also where a tracker nobody has limited, still zeroed, finds out
+// it has no threshold
+void _j_mem_over (j_mem_t *mem, size_t live) {
+  if (mem->hard_limit && live > mem->hard_limit) {
+    if (mem->exhausted) {
+      mem->exhausted(mem, live);
+    }
+  } else if (mem->trigger && live > mem->trigger) {
+    mem->pressure = true;
+  }
+  _j_mem_arm(mem);
+}
 
-_mem_node_t *_mem_list_head = NULL;
-_mem_node_t *_mem_list_tail = NULL;
+// counts `size` more bytes against `mem`; the one compare is all that limits
+// cost an allocation
+static inline void _j_mem_count (j_mem_t *mem, size_t size) {
+  size_t live = mem->total_alloc - mem->total_free + size;
+  if (live > mem->threshold) {
+    _j_mem_over(mem, live);
+  }
+  mem->total_alloc += size;
+  mem->peak = MAX(mem->peak, live);
+}
 
 void *_jmalloc (size_t size) {
+  j_mem_t *mem = j_mem_current();
   if (J_MEM_DEBUG) {
     printf("(malloc) " CLR_YEL "%d\n" CLR_NRM, (int) size);
   }
-  j_mem_total_alloc += size;
-  if (_mem_list_tail == NULL) {
-    _mem_list_head = calloc(1, sizeof(_mem_node_t));
-    _mem_list_tail = _mem_list_head;
+  _j_mem_count(mem, size);
+  mem->accounts[mem->account] += size;
+  _mem_node_t *node = _j_mem_node_new(mem, size);
+  if (!node) {
+    // nothing was made, so nothing stays counted
+    mem->total_alloc -= size;
+    mem->accounts[mem->account] -= size;
+    return NULL;
+  }
+  node->next = NULL;
+  node->prev = mem->list_tail;
+  if (mem->list_tail == NULL) {
+    mem->list_head = node;
+  } else {
+    mem->list_tail->next = node;
+  }
+  mem->list_tail = node;
+  return node->ptr;
+}
+
+// the record for `ptr` if `mem` made it, NULL otherwise
+_mem_node_t *_j_mem_node (j_mem_t *mem, void *ptr) {
+  _mem_node_t *node = (_mem_node_t *) ptr - 1;
+  if (node->ptr != ptr || node->mem != mem) {
+    return NULL;
+  }
+  return node;
+}
+
+void _j_mem_unlink (j_mem_t *mem, _mem_node_t *node) {
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    mem->list_head = node->next;
+  }
+  if (node->next) {
+    node->next->prev = node->prev;
+  } else {
+    mem->list_tail = node->prev;
+  }
+}
+
+// points the neighbours of a record that moved at it again
+void _j_mem_relink (j_mem_t *mem, _mem_node_t *node) {
+  if (node->prev) {
+    node->prev->next = node;
+  } else {
+    mem->list_head = node;
+  }
+  if (node->next) {
+    node->next->prev = node;
   } else {
-    _mem_list_tail->next = calloc(1, sizeof(_mem_node_t));
-    _mem_list_tail = _mem_list_tail->next;
+    mem->list_tail = node;
   }
-  _mem_list_tail->size = size;
-  _mem_list_tail->ptr = malloc(size);
-  return _mem_list_tail->ptr;
 }
 
 void _jfree (void *ptr) {
+  j_mem_t *mem = j_mem_current();
   if (!ptr) {
     return;
   }
-  _mem_node_t *node = _mem_list_head;
-  _mem_node_t *prev_node = node;
+  _mem_node_t *node = _j_mem_node(mem, ptr);
   if (!node) {
-    goto finish;
-  }
-  while (node->next) {
-    if (node->ptr == ptr) {
-      break;
-    }
-    prev_node = node;
-    node = node->next;
-  }
-  if (node) {
-    if (prev_node) {
-      prev_node->next = node->next;
-    }
-    if (J_MEM_DEBUG) {
-      printf("free %d\n", (int) node->size);
-    }
-    j_mem_total_free += node->size;
-    if (_mem_list_head == node) {
-      _mem_list_head = prev_node;
-    }
-    if (_mem_list_tail == node) {
-      _mem_list_tail = prev_node;
-    }
-    free(node->ptr);
-    free(node);
+    // not ours to release; leaking it beats corrupting another tracker
+    printf(CLR(RED, "Warning: free non malloc'd ptr.\n"));
     return;
   }
-  finish:
-  printf(CLR(RED, "Warning: free non malloc'd ptr.\n"));
-  free(ptr);
+  _j_mem_unlink(mem, node);
+  if (J_MEM_DEBUG) {
+    printf("free %d\n", (int) node->size);
+  }
+  mem->total_free += node->size;
+  mem->accounts[node->account] -= node->size;
+  _j_mem_node_free(mem, node);
 }
 
-size_t j_mem_size () {
+size_t j_mem_size (j_mem_t *mem) {
   size_t size = 0;
-  _mem_node_t *node = _mem_list_head;
+  _mem_node_t *node = mem->list_head;
   while (node) {
     size += node->size;
     node = node->next;
   }
-  return (size_t) (size + j_mem_offset);
+  return (size_t) (size + mem->offset);
 }
 
-void j_mem_reset () {
-  /*_mem_node_t *node = _mem_list_head;
+// releases everything still recorded against `mem`
+void j_mem_reset (j_mem_t *mem) {
+  _mem_node_t *node = mem->list_head;
   _mem_node_t *temp;
   while (node) {
     temp = node->next;
-    free(node);
+    mem->total_free += node->size;
+    if (node->size > J_MEM_POOL_MAX) {
+      free(node);
+    } else {
+      mem->pools[_j_mem_class(node->size)].frees++;
+    }
     node = temp;
   }
-  _mem_list_head = NULL;
-  _mem_list_tail = NULL;*/
+  mem->list_head = NULL;
+  mem->list_tail = NULL;
+  memset(mem->accounts, 0, sizeof(mem->accounts));
+  // pool blocks, free or not, go with their slabs
+  while (mem->slabs) {
+    void *slab = mem->slabs;
+    mem->slabs = *(void **) slab;
+    free(slab);
+  }
+  mem->slab_next = NULL;
+  mem->slab_end = NULL;
+  for (size_t class = 0; class < J_MEM_POOL_CLASSES; class++) {
+    mem->pools[class].free_list = NULL;
+    mem->pools[class].in_use = 0;
+  }
+}
+
+// the newest allocation recorded against `mem`, to hand to j_mem_release_since
+_mem_node_t *j_mem_mark (j_mem_t *mem) {
+  return mem->list_tail;
+}
+
+// frees everything recorded against `mem` after `mark`
+void j_mem_release_since (j_mem_t *mem, _mem_node_t *mark) {
+  while (mem->list_tail != mark) {
+    _mem_node_t *node = mem->list_tail;
+    _j_mem_unlink(mem, node);
+    mem->total_free += node->size;
+    mem->accounts[node->account] -= node->size;
+    _j_mem_node_free(mem, node);
+  }
+}
+
+// one line per pool that has served anything, and the slabs behind them
+void j_mem_report (j_mem_t *mem) {
+  for (size_t class = 0; class < J_MEM_POOL_CLASSES; class++) {
+    j_pool_t *pool = &mem->pools[class];
+    if (pool->allocs) {
+      printf("pool %3d bytes: %d allocs, %d frees, %d carved, %d in use, %d peak\n", (int) _j_mem_block_size(class), (int) pool->allocs, (int) pool->frees, (int) pool->carved, (int) pool->in_use, (int) pool->peak);
+    }
+  }
+  printf("%d slabs of %d bytes\n", (int) mem->num_slabs, J_MEM_SLAB_SIZE);
+}
+
+char *_jstrdup (const char *string) {
+  size_t size = strlen(string) + 1;
+  char *copy = _jmalloc(size);
+  memcpy(copy, string, size);
+  return copy;
+}
+
+// takes back what a reallocation of `node` to `size` bytes counted, for
+// when there was no memory for it; `node` stays as it was
+void *_j_mem_realloc_failed (j_mem_t *mem, _mem_node_t *node, size_t size) {
+  mem->total_alloc -= size;
+  mem->total_free -= node->size;
+  mem->accounts[node->account] -= size - node->size;
+  return NULL;
+}
+
+void *_jrealloc (void *ptr, size_t size) {
+  j_mem_t *mem = j_mem_current();
+  if (!ptr) {
+    return _jmalloc(size);
+  }
+  _mem_node_t *node = _j_mem_node(mem, ptr);
+  if (!node) {
+    printf(CLR(RED, "Warning: realloc non malloc'd ptr.\n"));
+    return NULL;
+  }
+  // counted as growing by the difference, so a limit is not tripped by
+  // the block being counted twice
+  if (size > node->size) {
+    _j_mem_count(mem, size - node->size);
+    mem->total_free += node->size;
+    mem->total_alloc += node->size;
+  } else {
+    mem->total_free += node->size;
+    mem->total_alloc += size;
+  }
+  mem->accounts[node->account] += size - node->size;
+  if (node->size > J_MEM_POOL_MAX && size > J_MEM_POOL_MAX) {
+    _mem_node_t *grown = size <= SIZE_MAX - sizeof(_mem_node_t) ? realloc(node, sizeof(_mem_node_t) + size) : NULL;
+    if (!grown) {
+      return _j_mem_realloc_failed(mem, node, size);
+    }
+    node = grown;
+    node->ptr = node + 1;
+    node->size = size;
+    _j_mem_relink(mem, node);
+    return node->ptr;
+  }
+  if (node->size <= J_MEM_POOL_MAX && size <= J_MEM_POOL_MAX && _j_mem_class(node->size) == _j_mem_class(size)) {
+    node->size = size;
+    return node->ptr;
+  }
+  // across pools, or between a pool and the system allocator, the record
+  // moves to a new block that keeps its place in the list
+  _mem_node_t *moved = _j_mem_node_new(mem, size);
+  if (!moved) {
+    return _j_mem_realloc_failed(mem, node, size);
+  }
+  moved->account = node->account;
+  memcpy(moved + 1, ptr, MIN(node->size, size));
+  moved->next = node->next;
+  moved->prev = node->prev;
+  _j_mem_relink(mem, moved);
+  _j_mem_node_free(mem, node);
+  return moved->ptr;
 }
 
 #ifdef TRACK_MEM
   #define malloc(size) _jmalloc(size)
+  #define realloc(ptr, size) _jrealloc(ptr, size)
+  #define strdup(string) _jstrdup(string)
   #define free(ptr) _jfree(ptr)
 #endif
 
@@ -154,6 +498,7 @@ void j_mem_reset () {
 /* ``begin forward declarations */
 
 void begin ();
+double bench_now ();
 
 typedef struct _ll_item_t _ll_item_t;
 typedef struct ll_t ll_t;
@@ -162,11 +507,23 @@ typedef struct ll_t ll_t;
 
 /* ``begin module system */
 
+// with STATIC_DISPATCH defined, hot paths call module members by name rather
+// than through the module tables, so they can be inlined; the tables are
+// filled in either way for callers that need a member they can swap out
+#ifdef STATIC_DISPATCH
+  #define CALL(module, member) module##_##member
+  #define MODULE_INLINE static inline
+#else
+  #define CALL(module, member) module.member
+  #define MODULE_INLINE
+#endif
+
 #define module_start(name) typedef struct module_##name##_t { void (*initialize) (); void (*cleanup) ();
 #define module_end(name) } module_##name##_t; module_##name##_t name;
 #define MODULE(name, members) module_start(name) members module_end(name)
 //#define SETUP_MODULE(name) push_module_setup_fp(setup_##name); push_module_initialize_fp(name.initialize);
-#define SETUP_MODULE(name) setup_##name(); name.initialize();
+#define SETUP_MODULE(name) setup_##name();
+#define INITIALIZE_MODULE(name, ctx) name.initialize(ctx);
 //#define SETUP_MODULES() setup_modules();
 
 void (**module_setup_fps) () = NULL;
@@ -216,10 +573,19 @@ typedef enum token_type_secondary_t {
   KEYWORD_ITERATE,
   KEYWORD_AS,
   KEYWORD_VAR,
+  KEYWORD_RETURN,
+  KEYWORD_ELSE,
+  KEYWORD_REPEAT,
+  KEYWORD_OVER,
+  KEYWORD_IN,
+  KEYWORD_NEW,
+  KEYWORD_YIELD,
+  KEYWORD_IMPORT,
   LITERAL_QUOTE_D,
   LITERAL_QUOTE_S,
   LITERAL_QUOTE_B,
   LITERAL_INTEGER,
+  LITERAL_BIG_INTEGER, // decimal, hex or binary, too large for an int64, left for the compiler to convert
   LITERAL_DOUBLE,
   LITERAL_BOOLEAN,
   OPERATOR_STAR,
@@ -231,6 +597,9 @@ typedef enum token_type_secondary_t {
   OPERATOR_COLONCOLON,
   OPERATOR_ARROW_R,
   OPERATOR_ARROW_L,
+  OPERATOR_LESS,
+  OPERATOR_GREATER,
+  OPERATOR_EQUAL,
   GROUPING_BRACE_L,
   GROUPING_BRACKET_L,
   GROUPING_PAREN_L,
@@ -245,36 +614,374 @@ typedef enum token_type_secondary_t {
 typedef struct token_t {
   token_type_primary_t token_type_primary;
   token_type_secondary_t token_type_secondary;
-  char *representation;
-  char *file;
-  size_t line;
-  size_t column;
-  size_t index;
+  char *representation; // NULL when the token is a slice of the source, see tokenizer.text
+  uint32_t offset; // into the source; see tokenizer.location for line and column
+  uint32_t length; // bytes of source the token spans
+  union {
+    int64_t integer;
+    double number;
+  } as; // numeric literals, converted once by the tokenizer
 } token_t;
 
 /* end tokenizer declarations */
 
 /* ``begin parser declarations */
 
+typedef enum node_type_t {
+  NODE_PROGRAM,
+  NODE_BLOCK,
+  NODE_DECLARATION,
+  NODE_ASSIGNMENT,
+  NODE_RETURN,
+  NODE_EXPRESSION,
+  NODE_LITERAL,
+  NODE_IDENTIFIER,
+  NODE_UNARY,
+  NODE_BINARY,
+  NODE_CALL,
+  NODE_FUNCTION,
+  NODE_IF,
+  NODE_CONSTANT,
+  NODE_REPEAT,
+  NODE_ITERATE,
+  NODE_YIELD,
+  NODE_REDUCE,
+  NODE_NEW,
+  NODE_MEMBER,
+  NODE_SET_MEMBER,
+  NODE_INDEX,
+  NODE_SET_INDEX,
+  NODE_IMPORT
+} node_type_t;
+
+// children by type:
+//   program, block: statements
+//   declaration: [initializer] (token is the name, annotation the `as` type)
+//   assignment: value (token is the name)
+//   return: [value]
+//   expression: expression
+//   unary: operand, binary: left, right (token is the operator)
+//   call: callee, arguments...
+//   function: parameters..., body (body is a block or an expression; parameters
+//     are identifiers, annotation the `as` type)
+//   if: condition, block, [alternative] (alternative is a block or an if)
+//   constant: none (made by the optimizer, `constant` holds the value)
+//   repeat: block
+//   iterate: generator, block (token is the name each yielded value is bound to)
+//   yield: value
+//   reduce: start, end, function or array, function (token is the reduction;
+//     the function takes one parameter and its body is an expression)
+//   new: none
+//   member: object (token is the member's name)
+//   set member: object, value (token is the member's name)
+//   index: array, index
+//   set index: array, index, value
+//   import: none (token is the path, a string literal)
+// what the compiler's capture analysis found out about a node, see
+// _compiler_analyze; bindings are declarations, parameters and iterates
+typedef enum node_analysis_t {
+  ANALYSIS_LOCAL = 1, // a declaration of a local rather than a global
+  ANALYSIS_ASSIGNED = 2, // a binding something assigns to
+  ANALYSIS_CAPTURED = 4, // a binding a closure that escapes carries
+  ANALYSIS_ESCAPES = 8, // a binding used other than by calling it, in the function that declares it
+  ANALYSIS_DIRECT = 16 // a function literal only ever called from where it is declared
+} node_analysis_t;
+
 typedef struct node_t {
-  char *type;
+  node_type_t type;
   size_t num_children;
-  struct node_t *children;
+  struct node_t **children;
   struct node_t *parent;
-  char *info_type;
-  void *info;
-} node_t;
-
-typedef struct literal_info_t {
-  token_t *token;
-} integer_literal_info_t;
-
-typedef struct operator_info_t {
   token_t *token;
-} operator_info_t;
+  token_t *annotation;
+  struct value_t *constant;
+  uint8_t analysis; // node_analysis_t flags
+} node_t;
 
 /* end parser declarations */
 
+/* ``begin compiler declarations */
+
+// one byte, so that small strings have room in a value
+typedef enum __attribute__((packed)) value_type_t {
+  VALUE_UNDEFINED,
+  VALUE_VOID,
+  VALUE_INTEGER,
+  VALUE_FUNCTION,
+  VALUE_STRING,
+  VALUE_DOUBLE,
+  VALUE_BOOLEAN,
+  VALUE_GENERATOR,
+  VALUE_OBJECT,
+  VALUE_ARRAY,
+  VALUE_BIGNUM, // an integer too large for an int64; shares no bit pattern with VALUE_INTEGER, see OP_ADD_INTEGER
+  VALUE_BOX // a captured local something assigns to; only ever in a slot or a closure, never seen by a program
+} value_type_t;
+
+#define VALUE_SMALL_STRING 14
+#define VALUE_LARGE_STRING UINT8_MAX
+
+// a string of up to VALUE_SMALL_STRING bytes sits in the value itself, in the
+// bytes after the type, and needs no string_t
+typedef struct value_t {
+  union {
+    struct {
+      value_type_t type;
+      uint8_t small_length; // VALUE_LARGE_STRING when the string is as.string instead
+      char small [VALUE_SMALL_STRING];
+    };
+    struct {
+      uint8_t _header [8];
+      union {
+        int64_t integer;
+        double number;
+        bool boolean;
+        struct function_t *function;
+        struct string_t *string;
+        struct generator_t *generator;
+        struct object_t *object;
+        struct array_t *array;
+        struct bignum_t *bignum;
+        struct box_t *box;
+      } as;
+    };
+  };
+} value_t;
+
+// immutable once built. A flat string's chars follow it; literals keep their
+// escapes until vm.string_chars first reads them, which decodes them in place.
+// A rope is followed instead by the two string values it joins, and has no
+// chars until it is first read and flattened.
+typedef struct string_t {
+  size_t length;
+  uint64_t hash; // 0 until first compared
+  bool escaped;
+  bool rope;
+  bool marked; // reached by the collection under way, see heap
+  bool pinned; // kept by every collection, for literals, which compiled code holds
+  char *chars; // NUL terminated, NULL while a rope is unflattened
+} string_t;
+
+// sign and magnitude, the magnitude in limbs least significant first with
+// no zero limbs at the top; a value only holds one when no int64 can, so
+// equal integers always have the same representation
+typedef struct bignum_t {
+  bool negative;
+  bool marked; // like a string's, once the bignum belongs to a context
+  bool pinned;
+  size_t length;
+  uint64_t limbs [];
+} bignum_t;
+
+#define BIGNUM_VIEW_SIZE 3 // uint64s in the buffer bignums.integer views an int64 through
+
+// superinstructions, runs of instructions the vm dispatches once for the
+// whole run: the fused opcode, then the instructions it stands for. They are
+// the runs `make profile-dispatch` ranked highest over the benchmarks, see
+// vm_profile_report; the compiler matches triples before pairs
+#define VM_PAIRS(X) \
+  X(OP_GET_LOCAL_GET_LOCAL, GET_LOCAL, GET_LOCAL) \
+  X(OP_GET_LOCAL_CONSTANT, GET_LOCAL, CONSTANT) \
+  X(OP_CONSTANT_ADD, CONSTANT, ADD) \
+  X(OP_GET_LOCAL_MULTIPLY, GET_LOCAL, MULTIPLY) \
+  X(OP_GET_GLOBAL_GET_LOCAL, GET_GLOBAL, GET_LOCAL) \
+  X(OP_ADD_SET_LOCAL, ADD, SET_LOCAL) \
+  X(OP_EQUAL_JUMP_IF_FALSE, EQUAL, JUMP_IF_FALSE) \
+  X(OP_SET_LOCAL_LOOP, SET_LOCAL, LOOP) \
+  X(OP_SET_LOCAL_GET_LOCAL, SET_LOCAL, GET_LOCAL) \
+  X(OP_SUBTRACT_CONSTANT, SUBTRACT, CONSTANT) \
+  X(OP_GET_LOCAL_ADD, GET_LOCAL, ADD) \
+  X(OP_GET_LOCAL_SUBTRACT, GET_LOCAL, SUBTRACT)
+#define VM_TRIPLES(X) \
+  X(OP_GET_LOCAL_EQUAL_JUMP_IF_FALSE, GET_LOCAL, EQUAL, JUMP_IF_FALSE) \
+  X(OP_GET_LOCAL_CONSTANT_ADD, GET_LOCAL, CONSTANT, ADD) \
+  X(OP_GET_LOCAL_GET_LOCAL_MULTIPLY, GET_LOCAL, GET_LOCAL, MULTIPLY) \
+  X(OP_GET_LOCAL_CONSTANT_MULTIPLY, GET_LOCAL, CONSTANT, MULTIPLY) \
+  X(OP_ADD_SET_LOCAL_LOOP, ADD, SET_LOCAL, LOOP)
+
+#define VM_FUSED_OPCODE(name, ...) name,
+
+// operands follow the opcode: u16 for constant, slot and global indices and
+// forward jump distances, u8 for call argument counts
+typedef enum opcode_t {
+  OP_CONSTANT,
+  OP_VOID,
+  OP_POP,
+  OP_GET_LOCAL,
+  OP_SET_LOCAL,
+  OP_GET_GLOBAL,
+  OP_SET_GLOBAL,
+  OP_DEFINE_GLOBAL,
+  OP_NEGATE,
+  OP_ADD,
+  OP_SUBTRACT,
+  OP_MULTIPLY,
+  OP_DIVIDE,
+  OP_POWER,
+  OP_CALL,
+  OP_TAIL_CALL, // like OP_CALL, in place of the calling frame; an OP_RETURN follows
+  OP_RETURN,
+  OP_JUMP,
+  OP_JUMP_IF_FALSE,
+  OP_LOOP, // jumps back by its operand
+  OP_LESS,
+  OP_GREATER,
+  OP_EQUAL,
+  OP_NEXT, // resumes the generator on the stack, or jumps by its operand once it has finished
+  OP_YIELD,
+  // chosen where the compiler has proven the operands' types, so they skip the tag checks
+  OP_NEGATE_INTEGER,
+  OP_ADD_INTEGER,
+  OP_SUBTRACT_INTEGER,
+  OP_MULTIPLY_INTEGER,
+  OP_DIVIDE_INTEGER,
+  OP_NEGATE_DOUBLE,
+  OP_ADD_DOUBLE,
+  OP_SUBTRACT_DOUBLE,
+  OP_MULTIPLY_DOUBLE,
+  OP_DIVIDE_DOUBLE,
+  OP_CONCATENATE,
+  OP_CHECK, // fails unless the top of the stack has the type in its operand
+  OP_REDUCE, // runs the function on top over the range below it, combined by the reduction in its operand
+  OP_NEW,
+  OP_GET_MEMBER, // u16 member cache index, like OP_SET_MEMBER
+  OP_SET_MEMBER,
+  OP_GET_INDEX,
+  OP_SET_INDEX,
+  OP_CLOSURE, // u16 constant index of the function, whose captures are on the stack
+  OP_GET_CAPTURE, // u8 frames out, u16 capture index
+  OP_GET_ENCLOSING, // u8 frames out, u16 slot; like OP_SET_ENCLOSING
+  OP_SET_ENCLOSING,
+  OP_BOX,
+  OP_GET_BOX,
+  OP_SET_BOX,
+  // the operands of a superinstruction are its first instruction's, and the
+  // rest of its run follows in the code unchanged, see _compiler_fuse
+  VM_PAIRS(VM_FUSED_OPCODE)
+  VM_TRIPLES(VM_FUSED_OPCODE)
+  VM_OPCODES
+} opcode_t;
+
+#define VM_FUSED (OP_SET_BOX + 1) // the first superinstruction
+
+typedef enum reduction_t {
+  REDUCE_SUM,
+  REDUCE_MIN,
+  REDUCE_MAX
+} reduction_t;
+
+// objects with the same members, added in the same order, share a shape; a
+// context's shapes form a tree rooted at the shape of `new`, each adding one
+// member to its parent's
+typedef struct shape_t {
+  struct shape_t *parent;
+  char *name; // the member it adds, NULL for the root
+  size_t num_members; // the member it adds is in the slot before this
+  struct shape_t **children;
+  size_t num_children;
+} shape_t;
+
+typedef struct object_t {
+  shape_t *shape;
+  wtjl_context_t *context; // the one that made it, the only one that may change it
+  bool marked; // like a string's
+  value_t *slots; // one per member of its shape
+  size_t slots_capacity;
+} object_t;
+
+typedef enum array_kind_t {
+  ARRAY_VALUES,
+  ARRAY_INTEGERS,
+  ARRAY_BYTES
+} array_kind_t;
+
+// elements are packed when their type is known, int64_t for integers(n) and
+// uint8_t for bytes(n); array(n) holds any values, a value_t each
+typedef struct array_t {
+  array_kind_t kind;
+  wtjl_context_t *context; // the one that made it, the only one that may change it
+  bool marked; // like a string's
+  size_t length;
+  union {
+    value_t *values;
+    int64_t *integers;
+    uint8_t *bytes;
+  } as;
+} array_t;
+
+#define MEMBER_CACHE_SHAPES 4
+
+// the inline cache of one `::` site: the shapes it has seen, up to
+// MEMBER_CACHE_SHAPES, and where their member is; a site that has seen more
+// looks members up by name every time
+typedef struct member_cache_t {
+  char *name;
+  size_t num_shapes;
+  struct {
+    shape_t *shape;
+    shape_t *next; // the shape after setting the member, the same one if it was already there
+    uint32_t slot;
+  } entries [MEMBER_CACHE_SHAPES];
+} member_cache_t;
+
+typedef struct chunk_t {
+  uint8_t *code;
+  size_t code_length;
+  size_t code_capacity;
+  value_t *constants;
+  size_t constants_length;
+  size_t constants_capacity;
+  member_cache_t *caches;
+  size_t num_caches;
+  size_t caches_capacity;
+} chunk_t;
+
+typedef struct function_t {
+  char *name;
+  size_t arity;
+  value_t (*native) (wtjl_context_t *ctx, value_t *arguments); // builtins, which have no code, run this instead
+  size_t max_stack; // parameters, locals and temporaries, excluding the callee
+  bool generator; // calling it makes a generator instead of running it
+  bool closure; // it is the copy in a closure_t, which may be collected
+  bool released; // the script it is nested in was freed, so the heap frees it once nothing reaches it
+  bool marked; // like a string's, for a released function
+  size_t num_captures; // values each closure of it carries
+  chunk_t chunk;
+} function_t;
+
+// a function literal that captures locals and may escape; `function` is a
+// copy of the literal's, sharing its code, so a closure is called like any
+// other function and finds its captures through the callee slot
+typedef struct closure_t {
+  function_t function;
+  function_t *literal; // the one it copies, kept while the closure is
+  bool marked; // like a string's
+  value_t captures [];
+} closure_t;
+
+// a captured local something assigns to, shared by its slot and the
+// closures that carry it
+typedef struct box_t {
+  wtjl_context_t *context; // the one that made it, the only one that may change it
+  bool marked; // like a string's
+  value_t value;
+} box_t;
+
+// a suspended call; between resumptions its stack slots, callee included,
+// live here rather than on the vm's stack
+typedef struct generator_t {
+  function_t *function;
+  wtjl_context_t *context; // the one that made it, the only one that may resume it
+  uint8_t *ip;
+  bool running;
+  bool done;
+  bool marked; // like a string's
+  size_t num_saved;
+  value_t saved []; // room for function->max_stack + 1
+} generator_t;
+
+/* end compiler declarations */
+
 /* ``begin modules */
 
 MODULE(ll,
@@ -291,26 +998,120 @@ MODULE(ll,
 
 MODULE(scanner,
   void (*scan) ();
+  void (*scan_file) ();
+  void (*scan_buffer) ();
   bool (*done) ();
   char (*peek) ();
   char (*next) ();
   char *(*next_ptr) ();
   char *(*consume) ();
+  void (*advance) ();
   char done_char;
 )
 
 MODULE(tokenizer,
+  void (*tokenize) ();
   token_t *(*next) ();
   token_t *(*peek) ();
   token_t **(*consume) ();
   bool (*done) ();
   char *(*token_as_string) ();
+  const char *(*text) ();
+  int (*escape) ();
+  bool (*location) ();
 )
 
 MODULE(parser,
   void (*parse) ();
 )
 
+MODULE(optimizer,
+  void (*optimize) ();
+)
+
+MODULE(compiler,
+  function_t *(*compile) ();
+  void (*free_function) ();
+  void (*discard) ();
+  value_t (*literal) ();
+  const char *(*type_name) ();
+)
+
+MODULE(vm,
+  void (*execute) ();
+  value_t (*call) ();
+  size_t (*global_slot) ();
+  int (*find_global) ();
+  string_t *(*new_string) ();
+  const char *(*string_chars) ();
+  value_t (*string) ();
+  const char *(*string_read) ();
+  size_t (*string_length) ();
+  value_t (*concatenate) ();
+  value_t (*substring) ();
+  void (*define_natives) ();
+  void (*unwind) ();
+  array_t *(*new_array) ();
+  value_t (*array_get) ();
+  const char *(*array_check) ();
+  void (*array_set) ();
+  value_t (*bignum) ();
+  value_t (*arithmetic) ();
+  int (*compare) ();
+)
+
+MODULE(arrays,
+  void (*define) ();
+)
+
+MODULE(strings,
+  void (*define) ();
+)
+
+MODULE(evals,
+  void (*define) ();
+  void (*report) ();
+)
+
+MODULE(output,
+  void (*define) ();
+  void (*write) ();
+  void (*value) ();
+  void (*flush) ();
+  void (*redirect) ();
+)
+
+MODULE(loader,
+  void (*run) ();
+)
+
+MODULE(heap,
+  void (*collect) ();
+  void (*hand) ();
+  string_t *(*copy) ();
+  void (*release) ();
+)
+
+MODULE(image,
+  void (*save) ();
+  void (*load) ();
+  void (*load_file) ();
+)
+
+MODULE(bignums,
+  bignum_t *(*integer) ();
+  bignum_t *(*add) ();
+  bignum_t *(*subtract) ();
+  bignum_t *(*multiply) ();
+  bignum_t *(*divide) ();
+  int (*compare) ();
+  bool (*to_integer) ();
+  double (*to_double) ();
+  char *(*to_decimal) ();
+  bignum_t *(*from_decimal) ();
+  bignum_t *(*from_radix) ();
+)
+
 /* end modules */
 
 /* ``begin ll structs */
@@ -340,6 +1141,17 @@ typedef struct arguments_t {
   char *program_name;
   char *file_name;
   bool test;
+  bool bench;
+  bool serve;
+  bool load;
+  bool lsp;
+  bool optimize;
+  bool superinstructions; // the peephole pass that fuses runs of instructions, off with --no-superinstructions
+  int output_fd; // where print writes, --output-fd <fd>
+  size_t memory_limit; // the hard limit of every context, --memory-limit <bytes>, 0 for none
+  char *image_name; // the image the program starts from, --image <file>
+  char *save_image_name; // where to write an image once the program has run, --save-image <file>
+  char *socket_name;
 } arguments_t;
 
 const int ARGUMENT_COUNT = 2;
@@ -351,6 +1163,22 @@ void *arguments_t_new () {
   arguments->program_name = NULL;
   arguments->file_name = NULL;
   arguments->test = false;
+  arguments->bench = false;
+  arguments->serve = false;
+  arguments->load = false;
+  arguments->lsp = false;
+  arguments->optimize = false;
+#ifdef VM_PROFILE
+  // the profile is of the instructions as the compiler emits them
+  arguments->superinstructions = false;
+#else
+  arguments->superinstructions = true;
+#endif
+  arguments->output_fd = STDOUT_FILENO;
+  arguments->memory_limit = 0;
+  arguments->image_name = NULL;
+  arguments->save_image_name = NULL;
+  arguments->socket_name = NULL;
   return arguments;
 }
 
@@ -374,62 +1202,505 @@ void arguments_t_destroy (arguments_t *arguments) {
   }
   free(arguments->program_name);
   free(arguments->file_name);
+  free(arguments->image_name);
+  free(arguments->save_image_name);
+  free(arguments->socket_name);
   free(arguments);
 }
 
 arguments_t *arguments_t_parse_arguments (int argc, char **argv) {
   arguments_t *arguments = arguments_t_new();
+  // --memory-limit <bytes> applies to programs and servers alike, so it may
+  // come anywhere
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc) {
+      char *end;
+      unsigned long long limit = strtoull(argv[++i], &end, 10);
+      if (*end || end == argv[i] || limit == 0 || argv[i][0] == '-') {
+        fprintf(stderr, "Not a number of bytes: %s\n", argv[i]);
+        arguments->valid = false;
+        return arguments;
+      }
+      arguments->memory_limit = (size_t) limit;
+    }
+  }
   for (int i = 0; i < argc; i++) {
     if (strcmp(argv[i], "--test") == 0) {
       arguments->valid = true;
       arguments->test = true;
       return arguments;
     }
+    if (strcmp(argv[i], "--bench") == 0) {
+      arguments->valid = true;
+      arguments->bench = true;
+      return arguments;
+    }
+    if (strcmp(argv[i], "--lsp") == 0) {
+      arguments->valid = true;
+      arguments->lsp = true;
+      return arguments;
+    }
+    if ((strcmp(argv[i], "--serve") == 0 || strcmp(argv[i], "--load") == 0) && i + 1 < argc) {
+      arguments->valid = true;
+      arguments->serve = strcmp(argv[i], "--serve") == 0;
+      arguments->load = !arguments->serve;
+      arguments->socket_name = strdup(argv[i + 1]);
+      return arguments;
+    }
+  }
+  // -O, --no-superinstructions, --output-fd <fd>, --image <file> and
+  // --save-image <file> may come anywhere and are not positional arguments
+  int positional = 0;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "-O") == 0) {
+      arguments->optimize = true;
+    } else if (strcmp(argv[i], "--no-superinstructions") == 0) {
+      arguments->superinstructions = false;
+    } else if (strcmp(argv[i], "--output-fd") == 0 && i + 1 < argc) {
+      char *end;
+      long fd = strtol(argv[++i], &end, 10);
+      if (*end || end == argv[i] || fd < 0 || fd > INT32_MAX || fcntl((int) fd, F_GETFD) < 0) {
+        fprintf(stderr, "Not an open file descriptor: %s\n", argv[i]);
+        arguments->valid = false;
+        return arguments;
+      }
+      arguments->output_fd = (int) fd;
+    } else if ((strcmp(argv[i], "--image") == 0 || strcmp(argv[i], "--save-image") == 0) && i + 1 < argc) {
+      char **name = strcmp(argv[i], "--image") == 0 ? &arguments->image_name : &arguments->save_image_name;
+      free(*name);
+      *name = strdup(argv[++i]);
+    } else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc) {
+      i++;
+    } else {
+      positional++;
+    }
   }
-  arguments->difference_from_correct = argc - ARGUMENT_COUNT;
+  arguments->difference_from_correct = positional - ARGUMENT_COUNT;
   if (arguments->difference_from_correct != 0) {
     arguments->valid = false;
     return arguments;
   }
   arguments->valid = true;
+  positional = 0;
   for (int i = 0; i < argc; i++) {
-    if (i == 0) {
+    if (strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "--no-superinstructions") == 0) {
+      continue;
+    }
+    if (strcmp(argv[i], "--output-fd") == 0 || strcmp(argv[i], "--memory-limit") == 0 || strcmp(argv[i], "--image") == 0 || strcmp(argv[i], "--save-image") == 0) {
+      i++;
+      continue;
+    }
+    if (positional == 0) {
       arguments->program_name = malloc(strlen(argv[i]) + 1);
       arguments_t_set_program_name(arguments, argv[i]);
-    } else if (i == 1) {
+    } else if (positional == 1) {
       arguments->file_name = malloc(strlen(argv[i]) + 1);
       arguments_t_set_file_name(arguments, argv[i]);
     } else {
       break;
     }
+    positional++;
   }
   return arguments;
 }
 
 /* end arguments_t */
 
-/* ``begin globals */
+/* ``begin context */
 
-arguments_t *glbl_arguments = NULL;
+typedef struct scanner_state_t {
+  char *input;
+  size_t input_length;
+  size_t index;
+  bool owns_input;
+  const char *file_name; // borrowed, NULL for buffers
+} scanner_state_t;
+
+typedef struct tokenizer_state_t {
+  token_t **tokens;
+  size_t tokens_size;
+  size_t tokens_capacity;
+  size_t tokens_index;
+  const char *file_name; // borrowed from the scanner
+  size_t input_length;
+  uint32_t *line_starts; // offset of every line, the first always 0
+  size_t num_lines;
+  size_t lines_capacity;
+  bool recover; // unknown characters become unknown tokens instead of failing
+  bool slices; // the input outlives the tokens, so literals need not be copied out of it
+} tokenizer_state_t;
+
+typedef struct parser_state_t {
+  node_t *ast;
+} parser_state_t;
+
+typedef struct optimizer_state_t {
+  char **locals; // names in scope while walking, innermost last
+  size_t num_locals;
+  size_t locals_capacity;
+  size_t eliminated; // nodes the last optimize removed
+} optimizer_state_t;
+
+typedef struct _compiler_local_t {
+  char *name;
+  size_t depth;
+  value_type_t type; // VALUE_UNDEFINED unless it is known to always hold one type
+  bool boxed; // its slot holds a box, see ANALYSIS_CAPTURED
+  bool direct; // it holds a direct function, see ANALYSIS_DIRECT
+} _compiler_local_t;
+
+typedef enum _compiler_access_kind_t {
+  ACCESS_LOCAL,
+  ACCESS_ENCLOSING, // a slot of a frame further out, reached by a direct function
+  ACCESS_CAPTURE, // a value a closure carries
+  ACCESS_GLOBAL
+} _compiler_access_kind_t;
+
+// how the function being compiled reaches a variable
+typedef struct _compiler_access_t {
+  _compiler_access_kind_t kind;
+  size_t depth; // frames out from the running one, for enclosing and capture
+  size_t index; // the slot or the capture
+  char *name;
+  bool boxed;
+  value_type_t type;
+} _compiler_access_t;
+
+// one per function being compiled, innermost first
+typedef struct _compiler_frame_t {
+  function_t *function;
+  _compiler_local_t *locals;
+  size_t num_locals;
+  size_t locals_capacity;
+  size_t depth;
+  size_t stack_depth;
+  bool direct; // only called from the frame it is declared in, see ANALYSIS_DIRECT
+  _compiler_access_t *captures; // how the enclosing function reaches each one
+  size_t captures_capacity;
+  struct _compiler_frame_t *enclosing;
+} _compiler_frame_t;
+
+// a name in scope while the capture analysis walks a program
+typedef struct _compiler_binding_t {
+  char *name;
+  node_t *node;
+  size_t level; // how many function literals it is declared in
+} _compiler_binding_t;
+
+typedef struct compiler_state_t {
+  _compiler_frame_t *frame;
+  _compiler_binding_t *bindings; // innermost last
+  size_t num_bindings;
+  size_t bindings_capacity;
+  node_t **functions; // the function literals the analysis is in, outermost first
+  size_t num_functions;
+  size_t functions_capacity;
+} compiler_state_t;
+
+typedef struct call_frame_t {
+  function_t *function;
+  uint8_t *ip;
+  value_t *base; // first parameter, the callee sits just below it
+  generator_t *generator; // the generator being resumed, NULL for a call
+} call_frame_t;
+
+typedef struct vm_state_t {
+  value_t *stack;
+  value_t *stack_top;
+  size_t stack_capacity;
+  call_frame_t *frames;
+  size_t num_frames;
+  size_t frames_capacity;
+  value_t *globals;
+  char **global_names;
+  size_t num_globals;
+  size_t globals_capacity;
+  function_t **functions; // every function compiled in this context
+  size_t num_functions;
+  size_t functions_capacity;
+  string_t **strings; // every string built in this context
+  size_t num_strings;
+  size_t strings_capacity;
+  generator_t **generators; // every generator made in this context
+  size_t num_generators;
+  size_t generators_capacity;
+  size_t num_escaped; // strings whose escapes vm_string_chars has yet to decode
+  bool lane; // runs part of a parallel iterate, sharing its caller's globals read only
+  shape_t *root_shape;
+  object_t **objects; // every object made in this context
+  size_t num_objects;
+  size_t objects_capacity;
+  array_t **arrays; // every array made in this context
+  size_t num_arrays;
+  size_t arrays_capacity;
+  bignum_t **bignums; // every bignum held by a value in this context
+  size_t num_bignums;
+  size_t bignums_capacity;
+  closure_t **closures; // every closure made in this context
+  size_t num_closures;
+  size_t closures_capacity;
+  box_t **boxes; // every box made in this context
+  size_t num_boxes;
+  size_t boxes_capacity;
+} vm_state_t;
+
+#define EVALS_BUDGET (1 << 20)
+#define EVALS_BUCKETS 256
+#define EVALS_STRINGS 64
+
+// a source eval has compiled, kept for when the same text comes again
+typedef struct evals_entry_t {
+  uint64_t hash;
+  char *source;
+  size_t length;
+  size_t size; // bytes counted against the budget
+  function_t *script;
+  string_t *string; // the large string last evaluated as this source, if any
+  struct evals_entry_t *chain; // next in its bucket
+  struct evals_entry_t *newer;
+  struct evals_entry_t *older;
+} evals_entry_t;
+
+typedef struct evals_state_t {
+  evals_entry_t *buckets [EVALS_BUCKETS]; // by hash of the source
+  evals_entry_t *strings [EVALS_STRINGS]; // by large string, checked before hashing
+  evals_entry_t *newest;
+  evals_entry_t *oldest;
+  size_t size;
+  size_t budget;
+  size_t num_entries;
+  size_t running; // evals in progress, whose scripts may not be freed yet
+  char *compiling; // the copy of the source being compiled
+  function_t **retired; // scripts evicted while running, or never kept
+  size_t num_retired;
+  size_t retired_capacity;
+  size_t hits;
+  size_t string_hits; // hits found by string, without hashing
+  size_t misses;
+  size_t evictions;
+} evals_state_t;
+
+#define OUTPUT_BUFFER_SIZE (64 << 10)
+#define OUTPUT_IOVECS 64
+#define OUTPUT_IN_PLACE 256 // large strings at least this long are written from where they lie
+
+typedef struct output_state_t {
+  int fd;
+  bool terminal; // flushed after every record
+  bool failed; // the fd stopped taking writes, so output is dropped
+  char *buffer;
+  size_t length;
+  struct iovec iovecs [OUTPUT_IOVECS]; // pieces of the buffer and strings written in place, in order
+  size_t num_iovecs;
+  size_t records;
+  size_t bytes;
+  size_t writes;
+} output_state_t;
+
+#define LOADER_RING_ENTRIES 256
+#define LOADER_READERS 8
+
+typedef enum loader_mode_t {
+  LOADER_BATCHED, // io_uring, or reader threads without it
+  LOADER_THREADED, // reader threads even with io_uring
+  LOADER_SEQUENTIAL // one file after another, blocking
+} loader_mode_t;
+
+typedef struct loader_module_t {
+  char *path; // resolved, so each file is one module however it is named
+  char *source;
+  size_t length;
+  tokenizer_state_t tokens; // set aside between reading and compiling
+  bool tokenized;
+  bool visited;
+  function_t *script;
+  size_t *imports;
+  size_t num_imports;
+  size_t imports_capacity;
+} loader_module_t;
+
+typedef struct loader_state_t {
+  loader_module_t *modules; // the program first
+  size_t num_modules;
+  size_t modules_capacity;
+  loader_mode_t mode;
+  bool compiling; // imports compile to nothing only while the loader compiles
+  size_t *order; // modules by when they run
+  size_t num_compiled;
+  wtjl_status_t status; // the first error while a batch was in flight
+  bool uring; // the last batch went through io_uring
+  size_t batches;
+  size_t submissions;
+} loader_state_t;
+
+// values reached by a collection whose own references are still to be followed
+typedef struct _heap_range_t {
+  value_t *values;
+  size_t count;
+} _heap_range_t;
+
+#define HEAP_COPIES 64
+
+// a string made to give the host a small string's chars or a bignum's digits
+typedef struct _heap_copy_t {
+  value_t of;
+  string_t *string;
+} _heap_copy_t;
+
+typedef struct heap_state_t {
+  _heap_range_t *gray;
+  size_t num_gray;
+  size_t gray_capacity;
+  value_t *handed; // given to the host since it last called in
+  size_t num_handed;
+  size_t handed_capacity;
+  _heap_copy_t copies [HEAP_COPIES]; // emptied by every collection, which may free them
+  bool exhausted; // went past the hard limit, after which every call fails
+  size_t collections;
+  size_t collected; // bytes freed by collections
+} heap_state_t;
+
+typedef struct image_state_t {
+  void *mapping; // the image file loaded, whose strings are read where they lie
+  size_t mapping_length;
+  bool loaded;
+} image_state_t;
+
+// everything one interpreter instance owns; contexts share nothing but the
+// module function tables, so independent contexts may run on separate threads
+typedef struct wtjl_context_t {
+  arguments_t *arguments;
+  j_mem_t mem;
+  j_mem_t *_previous_mem; // private
+  jmp_buf *_error_jmp; // private
+  wtjl_status_t status;
+  char error [256];
+  scanner_state_t scanner;
+  tokenizer_state_t tokenizer;
+  parser_state_t parser;
+  optimizer_state_t optimizer;
+  compiler_state_t compiler;
+  vm_state_t vm;
+  evals_state_t evals;
+  output_state_t output;
+  loader_state_t loader;
+  heap_state_t heap;
+  image_state_t image;
+} wtjl_context_t;
+
+pthread_once_t _wtjl_modules_once = PTHREAD_ONCE_INIT;
+
+void _wtjl_setup_modules ();
+
+void wtjl_setup_modules () {
+  pthread_once(&_wtjl_modules_once, _wtjl_setup_modules);
+}
 
-size_t glbl_tests_mem_start;
+void wtjl_context_t_enter (wtjl_context_t *ctx) {
+  ctx->_previous_mem = j_mem_bind(&ctx->mem);
+}
 
-bool glbl_tests_result = true;
+void wtjl_context_t_leave (wtjl_context_t *ctx) {
+  j_mem_bind(ctx->_previous_mem);
+  ctx->_previous_mem = NULL;
+}
 
-/* end globals */
+// charges what `ctx` allocates from here on to `module`, see wtjl_memory;
+// returns the module charged until now, to go back to
+wtjl_module_t wtjl_context_t_charge (wtjl_context_t *ctx, wtjl_module_t module) {
+  wtjl_module_t previous = (wtjl_module_t) ctx->mem.account;
+  ctx->mem.account = module;
+  return previous;
+}
+
+// records the error and unwinds to the innermost wtjl_* entry point; with no
+// entry point on the stack (the command line) it reports and exits instead
+void _wtjl_context_t_raise (wtjl_context_t *ctx, wtjl_status_t status) {
+  ctx->status = status;
+  // what a program printed before failing comes out before the error
+  output.flush(ctx);
+  if (ctx->_error_jmp) {
+    longjmp(*ctx->_error_jmp, 1);
+  }
+  fprintf(stderr, "%s\n", ctx->error);
+  exit(1);
+}
+
+void wtjl_context_t_fail (wtjl_context_t *ctx, wtjl_status_t status, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(ctx->error, sizeof(ctx->error), format, args);
+  va_end(args);
+  _wtjl_context_t_raise(ctx, status);
+}
+
+// as wtjl_context_t_fail, prefixed with the file, line and column of `offset`
+// in the source being compiled
+void wtjl_context_t_fail_at (wtjl_context_t *ctx, wtjl_status_t status, size_t offset, const char *format, ...) {
+  size_t line;
+  size_t column;
+  int length = 0;
+  if (tokenizer.location(ctx, offset, &line, &column)) {
+    length = snprintf(ctx->error, sizeof(ctx->error), "%s%s%d:%d: ", ctx->tokenizer.file_name ? ctx->tokenizer.file_name : "", ctx->tokenizer.file_name ? ":" : "", (int) line, (int) column);
+    length = MIN(length, (int) sizeof(ctx->error) - 1);
+  }
+  va_list args;
+  va_start(args, format);
+  vsnprintf(ctx->error + length, sizeof(ctx->error) - length, format, args);
+  va_end(args);
+  _wtjl_context_t_raise(ctx, status);
+}
 
-/* ``begin cleanup */
+// an allocation would take `mem` past its hard limit. The limits are lifted
+// so that reporting and unwinding can still allocate, and as the failure may
+// have come halfway through changing anything, the context is spent: every
+// call after this fails with the same error
+void _wtjl_context_t_exhausted (j_mem_t *mem, size_t live) {
+  wtjl_context_t *ctx = (wtjl_context_t *) ((char *) mem - offsetof(wtjl_context_t, mem));
+  size_t hard_limit = mem->hard_limit;
+  j_mem_limit(mem, 0, 0);
+  ctx->heap.exhausted = true;
+  wtjl_context_t_fail(ctx, WTJL_ERROR_MEMORY, "Memory error; %lld bytes would pass the limit of %lld.", (long long) live, (long long) hard_limit);
+}
 
-void cleanup () {
-  arguments_t_destroy(glbl_arguments);
-  glbl_arguments = NULL;
+void wtjl_context_t_initialize_modules (wtjl_context_t *ctx);
+void wtjl_context_t_cleanup_modules (wtjl_context_t *ctx);
+
+// argv may be NULL for contexts that are not driven from a command line
+wtjl_context_t *wtjl_context_t_new (int argc, char **argv) {
+  wtjl_setup_modules();
+  wtjl_context_t *ctx = calloc(1, sizeof(wtjl_context_t));
+  ctx->mem.exhausted = _wtjl_context_t_exhausted;
+  wtjl_context_t_enter(ctx);
+  ctx->arguments = argv ? arguments_t_parse_arguments(argc, argv) : arguments_t_new();
+  wtjl_context_t_initialize_modules(ctx);
+  wtjl_context_t_leave(ctx);
+  return ctx;
+}
 
-  // cleanup each module
-  scanner.cleanup();
-  tokenizer.cleanup();
+void wtjl_context_t_destroy (wtjl_context_t *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  wtjl_context_t_enter(ctx);
+  wtjl_context_t_cleanup_modules(ctx);
+  arguments_t_destroy(ctx->arguments);
+  ctx->arguments = NULL;
+  j_mem_reset(&ctx->mem);
+  wtjl_context_t_leave(ctx);
+  // calloc'd directly, never recorded against a tracker
+  (free)(ctx);
 }
 
-/* end cleanup */
+/* end context */
+
+/* ``begin globals */
+
+size_t glbl_tests_mem_start;
+
+bool glbl_tests_result = true;
+
+/* end globals */
 
 /* ``begin ll */
 
@@ -615,17 +1886,13 @@ void setup_ll () {
 
 /* ``begin scanner */
 
-char *_scanner_input;
-size_t _scanner_input_length;
-size_t _scanner_index = 0;
 const char _scanner_done_char = (char) 3;
 
-void _scanner_read_file () {
+void _scanner_read_file (wtjl_context_t *ctx, const char *file_name) {
   FILE *file;
-  file = fopen(glbl_arguments->file_name, "r");
+  file = fopen(file_name, "r");
   if (file == NULL) {
-    fprintf(stderr, "Failed to open file.\n");
-    exit(1);
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Failed to open file.");
   }
 
   size_t file_size;
@@ -633,78 +1900,115 @@ void _scanner_read_file () {
   file_size = (size_t) ftell(file);
   rewind(file);
 
-  _scanner_input_length = file_size + 1;
-  _scanner_input = malloc(_scanner_input_length);
-  _scanner_input[_scanner_input_length - 1] = '\0';
+  ctx->scanner.input_length = file_size;
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_SCANNER);
+  ctx->scanner.input = malloc(file_size + 1);
+  wtjl_context_t_charge(ctx, charged);
+  ctx->scanner.input[file_size] = '\0';
+  ctx->scanner.index = 0;
+  ctx->scanner.owns_input = true;
 
-  size_t bytes_read = fread(_scanner_input, 1, file_size, file);
+  size_t bytes_read = fread(ctx->scanner.input, 1, file_size, file);
+  fclose(file);
   if (bytes_read != file_size) {
-    fprintf(stderr, "Failed to read file.\n");
-    exit(1);
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Failed to read file.");
   }
-
-  fclose(file);
 }
 
-void scanner_initialize () {
+void scanner_initialize (wtjl_context_t *ctx) {
+  ctx->scanner.input = NULL;
+  ctx->scanner.input_length = 0;
+  ctx->scanner.index = 0;
+  ctx->scanner.owns_input = false;
+  ctx->scanner.file_name = NULL;
 }
 
-bool scanner_done () {
-  return _scanner_index == _scanner_input_length;
+MODULE_INLINE bool scanner_done (wtjl_context_t *ctx) {
+  return ctx->scanner.index == ctx->scanner.input_length;
 }
 
-char scanner_next () {
-  if (scanner_done()) {
+MODULE_INLINE char scanner_next (wtjl_context_t *ctx) {
+  if (scanner_done(ctx)) {
     return _scanner_done_char;
   }
-  return _scanner_input[_scanner_index];
+  return ctx->scanner.input[ctx->scanner.index];
 }
 
-char *scanner_next_ptr () {
-  if (scanner_done()) {
+MODULE_INLINE char *scanner_next_ptr (wtjl_context_t *ctx) {
+  if (scanner_done(ctx)) {
     return NULL;
   }
-  return (char *) (_scanner_input + _scanner_index);
+  return (char *) (ctx->scanner.input + ctx->scanner.index);
 }
 
-char scanner_peek (size_t ahead) {
-  size_t index = _scanner_index + ahead;
-  if (index >= _scanner_input_length) {
+MODULE_INLINE char scanner_peek (wtjl_context_t *ctx, size_t ahead) {
+  size_t index = ctx->scanner.index + ahead;
+  if (index >= ctx->scanner.input_length) {
     return _scanner_done_char;
   }
-  return _scanner_input[index];
+  return ctx->scanner.input[index];
 }
 
-char *scanner_consume (size_t num_chars) {
+MODULE_INLINE char *scanner_consume (wtjl_context_t *ctx, size_t num_chars) {
   if (num_chars == 0) {
     return NULL;
   }
-  if (_scanner_index + num_chars >= _scanner_input_length) {
-    num_chars = _scanner_input_length - _scanner_index;
+  if (ctx->scanner.index + num_chars >= ctx->scanner.input_length) {
+    num_chars = ctx->scanner.input_length - ctx->scanner.index;
   }
   char *representation = malloc(num_chars + 1);
   representation[num_chars] = '\0';
-  strncpy(representation, _scanner_input + _scanner_index, num_chars);
-  _scanner_index = _scanner_index + num_chars;
+  strncpy(representation, ctx->scanner.input + ctx->scanner.index, num_chars);
+  ctx->scanner.index = ctx->scanner.index + num_chars;
   return representation;
 }
 
-void scanner_scan () {
-  _scanner_read_file();
+// moves past `num_chars` without copying them
+MODULE_INLINE void scanner_advance (wtjl_context_t *ctx, size_t num_chars) {
+  ctx->scanner.index = MIN(ctx->scanner.index + num_chars, ctx->scanner.input_length);
+}
+
+void scanner_scan (wtjl_context_t *ctx) {
+  _scanner_read_file(ctx, ctx->arguments->file_name);
+  ctx->scanner.file_name = ctx->arguments->file_name;
+}
+
+void scanner_scan_file (wtjl_context_t *ctx, const char *file_name) {
+  _scanner_read_file(ctx, file_name);
+  ctx->scanner.file_name = file_name;
+}
+
+// scans the caller's buffer in place; it is never copied and must outlive the scan
+void scanner_scan_buffer (wtjl_context_t *ctx, const char *input, size_t input_length) {
+  ctx->scanner.input = (char *) input;
+  ctx->scanner.input_length = input_length;
+  ctx->scanner.index = 0;
+  ctx->scanner.owns_input = false;
+  ctx->scanner.file_name = NULL;
 }
 
-void scanner_cleanup () {
-  free(_scanner_input);
+void scanner_cleanup (wtjl_context_t *ctx) {
+  if (ctx->scanner.owns_input) {
+    free(ctx->scanner.input);
+  }
+  ctx->scanner.input = NULL;
+  ctx->scanner.input_length = 0;
+  ctx->scanner.index = 0;
+  ctx->scanner.owns_input = false;
+  ctx->scanner.file_name = NULL;
 }
 
 void setup_scanner () {
   scanner.initialize = scanner_initialize;
   scanner.scan = scanner_scan;
+  scanner.scan_file = scanner_scan_file;
+  scanner.scan_buffer = scanner_scan_buffer;
   scanner.done = scanner_done;
   scanner.next = scanner_next;
   scanner.next_ptr = scanner_next_ptr;
   scanner.peek = scanner_peek;
   scanner.consume = scanner_consume;
+  scanner.advance = scanner_advance;
   scanner.cleanup = scanner_cleanup;
   scanner.done_char = _scanner_done_char;
 }
@@ -713,147 +2017,411 @@ void setup_scanner () {
 
 /* ``begin tokenizer */
 
-token_t **_tokenizer_tokens = NULL;
-size_t _tokenizer_tokens_size = 0;
-size_t _tokenizer_tokens_index = 0;
-size_t _tokenizer_line = 0;
-size_t _tokenizer_col = 0;
+char *_tokenizer_keywords [] = {"if", "else", "iterate", "over", "in", "new", "as", "var", "return", "repeat", "yield", "import", "true", "false", NULL};
 
-size_t _tokenizer_tokenize_whitespace () {
+// longest first, so `**` is not lexed as two `*`
+char *_tokenizer_operators [] = {"**", "++", "--", "<-", "->", "::", "+", "-", "*", "/", ":", "<", ">", "=", NULL};
+
+char *_tokenizer_groupings [] = {"{", "[", "(", "}", "]", ")", NULL};
+
+char *_tokenizer_delimiters [] = {";", ",", NULL};
+
+size_t _tokenizer_tokenize_whitespace (wtjl_context_t *ctx) {
   size_t length = 0;
-  while (scanner.next() == ' ' || scanner.next() == '\n') {
-    if (scanner.next() == '\n') {
-      _tokenizer_line++;
-      _tokenizer_col = 0;
-    } else {
-      _tokenizer_col++;
-    }
+  while (isspace(CALL(scanner, peek)(ctx, length))) {
     length++;
-    free(scanner.consume(1));
   }
+  CALL(scanner, advance)(ctx, length);
   return length;
 }
 
-char *_tokenizer_tokenize_comment_single () {
-  return NULL; // TODO
+// the first of `a`, `b` or `c` in `input` at or after `from`, `length` when
+// there is none; sixteen bytes are compared at a time where SSE2 is available
+size_t _tokenizer_find (const char *input, size_t from, size_t length, char a, char b, char c) {
+#ifdef __SSE2__
+  __m128i all_a = _mm_set1_epi8(a);
+  __m128i all_b = _mm_set1_epi8(b);
+  __m128i all_c = _mm_set1_epi8(c);
+  while (from + 16 <= length) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) (input + from));
+    __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, all_a), _mm_cmpeq_epi8(chunk, all_b)), _mm_cmpeq_epi8(chunk, all_c));
+    int mask = _mm_movemask_epi8(matches);
+    if (mask) {
+      return from + __builtin_ctz(mask);
+    }
+    from += 16;
+  }
+#endif
+  for (; from < length; from++) {
+    if (input[from] == a || input[from] == b || input[from] == c) {
+      return from;
+    }
+  }
+  return length;
 }
 
-char *_tokenizer_tokenize_comment_multi () {
-  return NULL; // TODO
+size_t _tokenizer_tokenize_comment_single (wtjl_context_t *ctx) {
+  if (CALL(scanner, peek)(ctx, 0) != '/' || CALL(scanner, peek)(ctx, 1) != '/') {
+    return 0;
+  }
+  const char *start = ctx->scanner.input + ctx->scanner.index;
+  const char *newline = memchr(start, '\n', ctx->scanner.input_length - ctx->scanner.index);
+  size_t length = newline ? (size_t) (newline - start) : ctx->scanner.input_length - ctx->scanner.index;
+  CALL(scanner, advance)(ctx, length);
+  return length;
 }
 
-char *_tokenizer_tokenize_keyword () {
-  char *keywords [2] = {"if", "repeat"};
-  char *representation = NULL;
-  size_t length = 0;
-
-  while (isalpha(scanner.peek(length))) {
-    length++;
-  }
-  if (!length || isdigit(scanner.peek(length))) {
-    goto _return;
+// the length of the comment the input starts with, through its `*/`; 0 when
+// there is none, or when it is never closed and the tokenizer is recovering,
+// in which case _tokenizer_next turns the rest of the input into one token
+size_t _tokenizer_tokenize_comment_multi (wtjl_context_t *ctx) {
+  if (CALL(scanner, peek)(ctx, 0) != '/' || CALL(scanner, peek)(ctx, 1) != '*') {
+    return 0;
   }
-  if (strncmp("if", scanner.next_ptr(), length) == 0) {
-    goto consume;
+  const char *input = ctx->scanner.input;
+  size_t start = ctx->scanner.index;
+  size_t end = start + 2;
+  const char *star;
+  while ((star = memchr(input + end, '*', ctx->scanner.input_length - end))) {
+    end = star - input + 1;
+    if (end < ctx->scanner.input_length && input[end] == '/') {
+      CALL(scanner, advance)(ctx, end + 1 - start);
+      return end + 1 - start;
+    }
   }
-  if (strncmp("repeat", scanner.next_ptr(), length) == 0) {
-    goto consume;
+  if (ctx->tokenizer.recover) {
+    return 0;
   }
+  wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, start, "Tokenizing error; unterminated comment.");
+  return 0;
+}
 
-  goto _return;
-
-  consume:
-    representation = scanner.consume(length);
-
-  _return:
-    return representation;
+// the character `\<c>` stands for, -1 if it is not an escape
+int tokenizer_escape (int c) {
+  switch (c) {
+    case ('n'):
+      return '\n';
+    case ('t'):
+      return '\t';
+    case ('r'):
+      return '\r';
+    case ('0'):
+      return '\0';
+    case ('\\'):
+    case ('"'):
+    case ('\''):
+    case ('`'):
+      return c;
+    default:
+      return -1;
+  }
 }
 
-char *_tokenizer_tokenize_identifier () {
-  char *representation = NULL;
-  size_t length = 0;
-  while(isalpha(scanner.peek(length))) {
-    length++;
+// the length of the quoted literal the input starts with, 0 if it does not
+// start with one; double and single quotes end at the line, backticks may
+// span lines. Nothing is copied or decoded here, escapes are only checked
+size_t _tokenizer_literal_length (wtjl_context_t *ctx, size_t *num_chars, bool *closed) {
+  char quote = CALL(scanner, peek)(ctx, 0);
+  if (quote != '"' && quote != '\'' && quote != '`') {
+    return 0;
   }
-  if (length) {
-    representation = scanner.consume(length);
+  const char *input = ctx->scanner.input;
+  size_t length = ctx->scanner.input_length;
+  size_t start = ctx->scanner.index;
+  size_t end = start + 1;
+  *num_chars = 0;
+  *closed = false;
+  for (; ; ) {
+    size_t found = _tokenizer_find(input, end, length, quote, '\\', quote == '`' ? '`' : '\n');
+    *num_chars += found - end;
+    if (found == length || input[found] == '\n') {
+      if (ctx->tokenizer.recover) {
+        return found - start;
+      }
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, start, "Tokenizing error; unterminated literal.");
+    }
+    if (input[found] == quote) {
+      *closed = true;
+      return found + 1 - start;
+    }
+    if (found + 1 == length || tokenizer_escape(input[found + 1]) < 0) {
+      if (ctx->tokenizer.recover) {
+        return found + 1 - start;
+      }
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, found, "Tokenizing error; unknown escape.");
+    }
+    (*num_chars)++;
+    end = found + 2;
   }
-  return representation;
 }
 
-char *_tokenizer_tokenize_integer_literal () {
-  char *representation = NULL;
-  size_t length = 0;
-  while (isdigit(scanner.peek(length))) {
+// string literals stay slices of the input when it outlives the tokens
+token_t *_tokenizer_tokenize_literal (wtjl_context_t *ctx) {
+  size_t num_chars;
+  bool closed;
+  size_t length = _tokenizer_literal_length(ctx, &num_chars, &closed);
+  if (!length) {
+    return NULL;
+  }
+  char quote = CALL(scanner, peek)(ctx, 0);
+  token_t *token = malloc(sizeof(token_t));
+  token->token_type_primary = LITERAL;
+  token->token_type_secondary = quote == '"' ? LITERAL_QUOTE_D : quote == '`' ? LITERAL_QUOTE_B : LITERAL_QUOTE_S;
+  // recovery hands back a broken literal as unknown
+  if (!closed || (quote == '\'' && num_chars != 1)) {
+    if (!ctx->tokenizer.recover) {
+      free(token);
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, ctx->scanner.index, "Tokenizing error; character literals hold one character.");
+    }
+    token->token_type_primary = UNKNOWN_PRIMARY;
+    token->token_type_secondary = UNKNOWN_SECONDARY;
+    token->representation = CALL(scanner, consume)(ctx, length);
+    return token;
+  }
+  if (ctx->tokenizer.slices) {
+    token->representation = NULL;
+    CALL(scanner, advance)(ctx, length);
+  } else {
+    token->representation = CALL(scanner, consume)(ctx, length);
+  }
+  return token;
+}
+
+size_t _tokenizer_word_length (wtjl_context_t *ctx) {
+  size_t length = 0;
+  if (!isalpha(CALL(scanner, peek)(ctx, 0)) && CALL(scanner, peek)(ctx, 0) != '_') {
+    return 0;
+  }
+  while (isalnum(CALL(scanner, peek)(ctx, length)) || CALL(scanner, peek)(ctx, length) == '_') {
     length++;
   }
+  return length;
+}
+
+// consumes the first of `candidates` the input starts with
+char *_tokenizer_tokenize_one_of (wtjl_context_t *ctx, char **candidates) {
+  for (char **candidate = candidates; *candidate; candidate++) {
+    size_t length = strlen(*candidate);
+    size_t i = 0;
+    while (i < length && CALL(scanner, peek)(ctx, i) == (*candidate)[i]) {
+      i++;
+    }
+    if (i == length) {
+      return CALL(scanner, consume)(ctx, length);
+    }
+  }
+  return NULL;
+}
+
+char *_tokenizer_tokenize_keyword (wtjl_context_t *ctx) {
+  size_t length = _tokenizer_word_length(ctx);
+  if (!length) {
+    return NULL;
+  }
+  for (char **keyword = _tokenizer_keywords; *keyword; keyword++) {
+    if (strlen(*keyword) == length && strncmp(*keyword, CALL(scanner, next_ptr)(ctx), length) == 0) {
+      return CALL(scanner, consume)(ctx, length);
+    }
+  }
+  return NULL;
+}
+
+char *_tokenizer_tokenize_identifier (wtjl_context_t *ctx) {
+  char *representation = NULL;
+  size_t length = _tokenizer_word_length(ctx);
   if (length) {
-    representation = scanner.consume(length);
+    representation = CALL(scanner, consume)(ctx, length);
   }
   return representation;
 }
 
-char *_tokenizer_tokenize_operator () {
-  char *representation = NULL;
-  size_t length = 0;
-  if (strncmp("++", scanner.next_ptr(), strlen("++")) == 0) {
-    representation = scanner.consume(2);
-    goto _return;
+// the value of eight ASCII digits, reduced pairwise in one register; false
+// if any of them is not a digit
+bool _tokenizer_eight_digits (const char *chars, uint64_t *value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t word;
+  memcpy(&word, chars, sizeof(word));
+  if ((((word & 0xF0F0F0F0F0F0F0F0ULL) | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))) != 0x3333333333333333ULL) {
+    return false;
   }
-  if (strncmp("+", scanner.next_ptr(), strlen("+")) == 0) {
-    representation = scanner.consume(1);
-    goto _return;
+  word -= 0x3030303030303030ULL;
+  word = word * 10 + (word >> 8);
+  word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  *value = (uint32_t) word;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// appends the decimal digits at `chars` to `*value`, eight at a time while
+// there are eight; returns how many there were
+size_t _tokenizer_decimal_digits (const char *chars, size_t available, uint64_t *value, bool *overflow) {
+  size_t i = 0;
+  uint64_t eight;
+  while (i + 8 <= available && _tokenizer_eight_digits(chars + i, &eight)) {
+    *overflow |= __builtin_mul_overflow(*value, 100000000, value) || __builtin_add_overflow(*value, eight, value);
+    i += 8;
   }
-  if (strncmp("--", scanner.next_ptr(), strlen("--")) == 0) {
-    representation = scanner.consume(2);
-    goto _return;
+  for (; i < available && isdigit(chars[i]); i++) {
+    *overflow |= __builtin_mul_overflow(*value, 10, value) || __builtin_add_overflow(*value, chars[i] - '0', value);
   }
-  if (strncmp("-", scanner.next_ptr(), strlen("-")) == 0) {
-    representation = scanner.consume(1);
-    goto _return;
+  return i;
+}
+
+// hex digits when `bits` is 4, binary when it is 1
+size_t _tokenizer_radix_digits (const char *chars, size_t available, int bits, uint64_t *value, bool *overflow) {
+  size_t i = 0;
+  for (; i < available; i++) {
+    int digit;
+    if (bits == 4 && isxdigit(chars[i])) {
+      digit = isdigit(chars[i]) ? chars[i] - '0' : (chars[i] | 0x20) - 'a' + 10;
+    } else if (bits == 1 && (chars[i] == '0' || chars[i] == '1')) {
+      digit = chars[i] - '0';
+    } else {
+      break;
+    }
+    *overflow |= (*value >> (64 - bits)) != 0;
+    *value = (*value << bits) | digit;
   }
-  if (strncmp("/", scanner.next_ptr(), strlen("/")) == 0) {
-    representation = scanner.consume(1);
-    goto _return;
+  return i;
+}
+
+const double _tokenizer_powers_of_ten [] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// `mantissa` * 10^`exponent`, correctly rounded. When both are exactly
+// representable one multiply or divide rounds once and is exact (Clinger's
+// fast path), which covers nearly every literal written by hand; anything
+// else goes through strtod on the literal's text
+double _tokenizer_decimal_to_double (const char *chars, size_t length, uint64_t mantissa, bool exact, int64_t exponent) {
+  if (exact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22 + 15) {
+    if (exponent < 0) {
+      return (double) mantissa / _tokenizer_powers_of_ten[-exponent];
+    }
+    // a large exponent can move into the mantissa while it stays exact
+    if (exponent > 22) {
+      uint64_t scaled;
+      if (__builtin_mul_overflow(mantissa, (uint64_t) _tokenizer_powers_of_ten[exponent - 22], &scaled) || scaled > (1ULL << 53)) {
+        goto slow;
+      }
+      mantissa = scaled;
+      exponent = 22;
+    }
+    return (double) mantissa * _tokenizer_powers_of_ten[exponent];
   }
-  if (strncmp("**", scanner.next_ptr(), strlen("**")) == 0) {
-    representation = scanner.consume(2);
-    goto _return;
+  slow:;
+  char buffer [64];
+  char *text = length < sizeof(buffer) ? buffer : malloc(length + 1);
+  memcpy(text, chars, length);
+  text[length] = '\0';
+  double number = strtod(text, NULL);
+  if (text != buffer) {
+    free(text);
   }
-  if (strncmp("*", scanner.next_ptr(), strlen("*")) == 0) {
-    representation = scanner.consume(1);
-    goto _return;
+  return number;
+}
+
+// integer, 0x hex, 0b binary and double literals, converted here so nothing
+// later has to parse them again
+token_t *_tokenizer_tokenize_number (wtjl_context_t *ctx) {
+  const char *chars = ctx->scanner.input + ctx->scanner.index;
+  size_t available = ctx->scanner.input_length - ctx->scanner.index;
+  if (!available || !isdigit(chars[0])) {
+    return NULL;
   }
-  _return:
-    return representation;
+  token_t *token = malloc(sizeof(token_t));
+  token->token_type_primary = LITERAL;
+  token->token_type_secondary = LITERAL_INTEGER;
+  uint64_t value = 0;
+  bool overflow = false;
+  size_t length;
+  int bits = available > 2 && chars[0] == '0' ? ((chars[1] | 0x20) == 'x' ? 4 : (chars[1] | 0x20) == 'b' ? 1 : 0) : 0;
+  if (bits && (length = _tokenizer_radix_digits(chars + 2, available - 2, bits, &value, &overflow))) {
+    length += 2;
+  } else {
+    length = _tokenizer_decimal_digits(chars, available, &value, &overflow);
+    int64_t exponent = 0;
+    bool is_double = false;
+    if (length + 1 < available && chars[length] == '.' && isdigit(chars[length + 1])) {
+      size_t fraction = _tokenizer_decimal_digits(chars + length + 1, available - length - 1, &value, &overflow);
+      exponent -= fraction;
+      length += 1 + fraction;
+      is_double = true;
+    }
+    if (length < available && (chars[length] | 0x20) == 'e') {
+      size_t sign = length + 1 < available && (chars[length + 1] == '-' || chars[length + 1] == '+');
+      if (length + 1 + sign < available && isdigit(chars[length + 1 + sign])) {
+        int64_t power = 0;
+        size_t i = length + 1 + sign;
+        // past a few hundred the result is 0 or infinite either way
+        for (; i < available && isdigit(chars[i]); i++) {
+          power = MIN(power * 10 + chars[i] - '0', 100000);
+        }
+        exponent += chars[length + 1] == '-' ? -power : power;
+        length = i;
+        is_double = true;
+      }
+    }
+    if (is_double) {
+      token->token_type_secondary = LITERAL_DOUBLE;
+      token->as.number = _tokenizer_decimal_to_double(chars, length, value, !overflow, exponent);
+      overflow = isinf(token->as.number);
+    }
+  }
+  if (token->token_type_secondary == LITERAL_INTEGER) {
+    overflow |= value > INT64_MAX;
+    token->as.integer = (int64_t) value;
+    if (overflow) {
+      token->token_type_secondary = LITERAL_BIG_INTEGER;
+      overflow = false;
+    }
+  }
+  if (overflow) {
+    if (!ctx->tokenizer.recover) {
+      free(token);
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, ctx->scanner.index, "Tokenizing error; number literal \"%.*s\" is out of range.", (int) MIN(length, 32), chars);
+    }
+    token->token_type_primary = UNKNOWN_PRIMARY;
+    token->token_type_secondary = UNKNOWN_SECONDARY;
+  }
+  if (ctx->tokenizer.slices) {
+    token->representation = NULL;
+    CALL(scanner, advance)(ctx, length);
+  } else {
+    token->representation = CALL(scanner, consume)(ctx, length);
+  }
+  return token;
+}
+
+char *_tokenizer_tokenize_operator (wtjl_context_t *ctx) {
+  return _tokenizer_tokenize_one_of(ctx, _tokenizer_operators);
+}
+
+char *_tokenizer_tokenize_grouping (wtjl_context_t *ctx) {
+  return _tokenizer_tokenize_one_of(ctx, _tokenizer_groupings);
 }
 
-bool tokenizer_done () {
-  return scanner.done();
+char *_tokenizer_tokenize_delimiter (wtjl_context_t *ctx) {
+  return _tokenizer_tokenize_one_of(ctx, _tokenizer_delimiters);
 }
 
-void _tokenizer_skip_extras () {
-  char *representation;
+MODULE_INLINE bool tokenizer_done (wtjl_context_t *ctx) {
+  return ctx->tokenizer.tokens_index >= ctx->tokenizer.tokens_size;
+}
+
+void _tokenizer_skip_extras (wtjl_context_t *ctx) {
   for (; ; ) {
-    _tokenizer_tokenize_whitespace(scanner.next());
-    if (representation = _tokenizer_tokenize_comment_single()) {
-      free(representation);
-      continue;
-    }
-    if (representation = _tokenizer_tokenize_comment_multi()) {
-      free(representation);
+    _tokenizer_tokenize_whitespace(ctx);
+    if (_tokenizer_tokenize_comment_single(ctx) || _tokenizer_tokenize_comment_multi(ctx)) {
       continue;
     }
     break;
   }
 }
 
-bool _tokenizer_is_digit_string (char *string) {
-  size_t length = 0;
-  while (isdigit(string[length])) length++;
-  return length == strlen(string);
-}
-
 token_type_secondary_t _tokenizer_representation_to_secondary (char *representation) {
   if (strcmp("if", representation) == 0) {
     return KEYWORD_IF;
@@ -867,268 +2435,514 @@ token_type_secondary_t _tokenizer_representation_to_secondary (char *representat
   if (strcmp("var", representation) == 0) {
     return KEYWORD_VAR;
   }
+  if (strcmp("return", representation) == 0) {
+    return KEYWORD_RETURN;
+  }
+  if (strcmp("else", representation) == 0) {
+    return KEYWORD_ELSE;
+  }
+  if (strcmp("repeat", representation) == 0) {
+    return KEYWORD_REPEAT;
+  }
+  if (strcmp("over", representation) == 0) {
+    return KEYWORD_OVER;
+  }
+  if (strcmp("yield", representation) == 0) {
+    return KEYWORD_YIELD;
+  }
+  if (strcmp("import", representation) == 0) {
+    return KEYWORD_IMPORT;
+  }
+  if (strcmp("in", representation) == 0) {
+    return KEYWORD_IN;
+  }
+  if (strcmp("new", representation) == 0) {
+    return KEYWORD_NEW;
+  }
+  if (strcmp("true", representation) == 0 || strcmp("false", representation) == 0) {
+    return LITERAL_BOOLEAN;
+  }
+  if (strcmp("**", representation) == 0) {
+    return OPERATOR_STARSTAR;
+  }
+  if (strcmp("*", representation) == 0) {
+    return OPERATOR_STAR;
+  }
   if (strcmp("+", representation) == 0) {
     return OPERATOR_PLUS;
   }
-  if (_tokenizer_is_digit_string(representation)) {
-    return LITERAL_INTEGER;
+  if (strcmp("-", representation) == 0) {
+    return OPERATOR_MINUS;
+  }
+  if (strcmp("/", representation) == 0) {
+    return OPERATOR_FSLASH;
+  }
+  if (strcmp("::", representation) == 0) {
+    return OPERATOR_COLONCOLON;
+  }
+  if (strcmp(":", representation) == 0) {
+    return OPERATOR_COLON;
+  }
+  if (strcmp("->", representation) == 0) {
+    return OPERATOR_ARROW_R;
+  }
+  if (strcmp("<-", representation) == 0) {
+    return OPERATOR_ARROW_L;
+  }
+  if (strcmp("<", representation) == 0) {
+    return OPERATOR_LESS;
+  }
+  if (strcmp(">", representation) == 0) {
+    return OPERATOR_GREATER;
+  }
+  if (strcmp("=", representation) == 0) {
+    return OPERATOR_EQUAL;
+  }
+  if (strcmp("{", representation) == 0) {
+    return GROUPING_BRACE_L;
+  }
+  if (strcmp("[", representation) == 0) {
+    return GROUPING_BRACKET_L;
+  }
+  if (strcmp("(", representation) == 0) {
+    return GROUPING_PAREN_L;
+  }
+  if (strcmp("}", representation) == 0) {
+    return GROUPING_BRACE_R;
+  }
+  if (strcmp("]", representation) == 0) {
+    return GROUPING_BRACKET_R;
+  }
+  if (strcmp(")", representation) == 0) {
+    return GROUPING_PAREN_R;
+  }
+  if (strcmp(";", representation) == 0) {
+    return DELIMITER_SEMI;
+  }
+  if (strcmp(",", representation) == 0) {
+    return DELIMITER_COMMA;
   }
   return UNKNOWN_SECONDARY;
 }
 
-token_t *tokenizer_peek (size_t ahead) {
-  size_t index = _tokenizer_tokens_index + ahead;
-  if (index >= _tokenizer_tokens_size) {
+MODULE_INLINE token_t *tokenizer_peek (wtjl_context_t *ctx, size_t ahead) {
+  size_t index = ctx->tokenizer.tokens_index + ahead;
+  if (index >= ctx->tokenizer.tokens_size) {
     return NULL;
   } 
-  return _tokenizer_tokens[index];
+  return ctx->tokenizer.tokens[index];
 }
 
-token_t **tokenizer_consume (size_t num_tokens) {
-  if (num_tokens == 0 || _tokenizer_tokens_index >= _tokenizer_tokens_size) {
+// the returned tokens are a view into the token stream, not copies
+MODULE_INLINE token_t **tokenizer_consume (wtjl_context_t *ctx, size_t num_tokens) {
+  if (num_tokens == 0 || ctx->tokenizer.tokens_index >= ctx->tokenizer.tokens_size) {
     return NULL;
   }
-  if (_tokenizer_tokens_index + num_tokens >= _tokenizer_tokens_size) {
-    num_tokens = _tokenizer_tokens_size - _tokenizer_tokens_index;
+  if (ctx->tokenizer.tokens_index + num_tokens >= ctx->tokenizer.tokens_size) {
+    num_tokens = ctx->tokenizer.tokens_size - ctx->tokenizer.tokens_index;
   }
-  token_t **tokens = malloc(num_tokens * sizeof(token_t *));
-  for (int i = 0; i < num_tokens; i++) {
-    token_t *token = malloc(sizeof(token_t));
-    memcpy(token, _tokenizer_tokens[_tokenizer_tokens_index + i], sizeof(token_t));
-    tokens[i] = token;
-  }
-  _tokenizer_tokens_index += num_tokens;
+  token_t **tokens = ctx->tokenizer.tokens + ctx->tokenizer.tokens_index;
+  ctx->tokenizer.tokens_index += num_tokens;
   return tokens;
 }
 
-token_t *_tokenizer_next () {
+token_t *_tokenizer_token_new (char *representation, token_type_primary_t type_primary) {
+  token_t *token = malloc(sizeof(token_t));
+  token->representation = representation;
+  token->token_type_primary = type_primary;
+  token->token_type_secondary = _tokenizer_representation_to_secondary(representation);
+  token->offset = 0;
+  return token;
+}
+
+token_t *_tokenizer_next (wtjl_context_t *ctx) {
   char *representation = 0;
   token_t *token = NULL;
 
-  _tokenizer_skip_extras();
+  _tokenizer_skip_extras(ctx);
+  size_t index = ctx->scanner.index;
 
-  if ((representation = _tokenizer_tokenize_keyword()) != NULL) {
-    token = malloc(sizeof(token_t));
-    token->representation = representation;
-    token->token_type_primary = KEYWORD;
-    token->token_type_secondary = _tokenizer_representation_to_secondary(representation);
+  if (CALL(scanner, done)(ctx)) {
+    goto _return;
+  }
+  if ((token = _tokenizer_tokenize_literal(ctx)) != NULL) {
     goto _return;
   }
-  if ((representation = _tokenizer_tokenize_identifier()) != NULL) {
-    token = malloc(sizeof(token_t));
-    token->representation = representation;
-    token->token_type_primary = IDENTIFIER;
-    token->token_type_secondary = _tokenizer_representation_to_secondary(representation);
+  // only a comment that is never closed gets past _tokenizer_skip_extras
+  if (ctx->tokenizer.recover && CALL(scanner, peek)(ctx, 0) == '/' && CALL(scanner, peek)(ctx, 1) == '*') {
+    token = _tokenizer_token_new(CALL(scanner, consume)(ctx, ctx->scanner.input_length - index), UNKNOWN_PRIMARY);
     goto _return;
   }
-  if ((representation = _tokenizer_tokenize_integer_literal()) != NULL) {
-    token = malloc(sizeof(token_t));
-    token->representation = representation;
-    token->token_type_primary = LITERAL;
-    token->token_type_secondary = _tokenizer_representation_to_secondary(representation);
+  if ((representation = _tokenizer_tokenize_keyword(ctx)) != NULL) {
+    token = _tokenizer_token_new(representation, KEYWORD);
+    if (token->token_type_secondary == LITERAL_BOOLEAN) {
+      token->token_type_primary = LITERAL;
+      token->as.integer = representation[0] == 't';
+    }
+    goto _return;
+  }
+  if ((representation = _tokenizer_tokenize_identifier(ctx)) != NULL) {
+    token = _tokenizer_token_new(representation, IDENTIFIER);
+    goto _return;
+  }
+  if ((token = _tokenizer_tokenize_number(ctx)) != NULL) {
+    goto _return;
+  }
+  if ((representation = _tokenizer_tokenize_operator(ctx)) != NULL) {
+    token = _tokenizer_token_new(representation, OPERATOR);
+    goto _return;
+  }
+  if ((representation = _tokenizer_tokenize_grouping(ctx)) != NULL) {
+    token = _tokenizer_token_new(representation, GROUPING);
+    goto _return;
+  }
+  if ((representation = _tokenizer_tokenize_delimiter(ctx)) != NULL) {
+    token = _tokenizer_token_new(representation, DELIMITER);
     goto _return;
   }
-  if ((representation = _tokenizer_tokenize_operator()) != NULL) {
-    token = malloc(sizeof(token_t));
-    token->representation = representation;
-    token->token_type_primary = OPERATOR;
-    token->token_type_secondary = _tokenizer_representation_to_secondary(representation);
+  if (ctx->tokenizer.recover) {
+    token = _tokenizer_token_new(CALL(scanner, consume)(ctx, 1), UNKNOWN_PRIMARY);
     goto _return;
   }
+  wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, index, "Tokenizing error; unexpected character '%c'.", CALL(scanner, next)(ctx));
 
   _return:
+  if (token) {
+    token->offset = index;
+    token->length = ctx->scanner.index - index;
+  }
   return token;
 }
 
-char *tokenizer_token_as_string (token_t *token) {
+// the token's source text, `token->length` bytes long; slices are not terminated
+MODULE_INLINE const char *tokenizer_text (wtjl_context_t *ctx, token_t *token) {
+  return token->representation ? token->representation : ctx->scanner.input + token->offset;
+}
+
+char *tokenizer_token_as_string (wtjl_context_t *ctx, token_t *token) {
   char *string = malloc(64);
-  char *representation = token->representation;
+  const char *representation = tokenizer_text(ctx, token);
   char *type_primary = malloc(64);
   char *type_secondary = malloc(64);
   switch (token->token_type_primary) {
     case (KEYWORD):
       strncpy(type_primary, "keyword", strlen("keyword"));
-      type_primary[strlen("keyword") + 1] = '\0';
+      type_primary[strlen("keyword")] = '\0';
       break;
     case (IDENTIFIER):
       strncpy(type_primary, "identifier", strlen("identifier"));
-      type_primary[strlen("identifier") + 1] = '\0';
+      type_primary[strlen("identifier")] = '\0';
       break;
     case (LITERAL):
       strncpy(type_primary, "literal", strlen("literal"));
-      type_primary[strlen("literal") + 1] = '\0';
+      type_primary[strlen("literal")] = '\0';
       break;
     case (OPERATOR):
       strncpy(type_primary, "operator", strlen("operator"));
-      type_primary[strlen("operator") + 1] = '\0';
+      type_primary[strlen("operator")] = '\0';
       break;
     case (GROUPING):
       strncpy(type_primary, "grouping", strlen("grouping"));
-      type_primary[strlen("grouping") + 1] = '\0';
+      type_primary[strlen("grouping")] = '\0';
       break;
     case (DELIMITER):
       strncpy(type_primary, "delimiter", strlen("delimiter"));
-      type_primary[strlen("delimiter") + 1] = '\0';
+      type_primary[strlen("delimiter")] = '\0';
       break;
     default:
       strncpy(type_primary, "unknown", strlen("unknown"));
-      type_primary[strlen("unknown") + 1] = '\0';
+      type_primary[strlen("unknown")] = '\0';
   }
   switch (token->token_type_secondary) {
     case (KEYWORD_IF):
       strncpy(type_secondary, "keyword_if", strlen("keyword_if"));
-      type_secondary[strlen("keyword_if") + 1] = '\0';
+      type_secondary[strlen("keyword_if")] = '\0';
       break;
     case (KEYWORD_ITERATE):
       strncpy(type_secondary, "keyword_iterate", strlen("keyword_iterate"));
-      type_secondary[strlen("keyword_iterate") + 1] = '\0';
+      type_secondary[strlen("keyword_iterate")] = '\0';
       break;
     case (KEYWORD_AS):
       strncpy(type_secondary, "keyword_as", strlen("keyword_as"));
-      type_secondary[strlen("keyword_as") + 1] = '\0';
+      type_secondary[strlen("keyword_as")] = '\0';
       break;
     case (KEYWORD_VAR):
       strncpy(type_secondary, "keyword_var", strlen("keyword_var"));
-      type_secondary[strlen("keyword_var") + 1] = '\0';
+      type_secondary[strlen("keyword_var")] = '\0';
+      break;
+    case (KEYWORD_RETURN):
+      strncpy(type_secondary, "keyword_return", strlen("keyword_return"));
+      type_secondary[strlen("keyword_return")] = '\0';
+      break;
+    case (KEYWORD_ELSE):
+      strncpy(type_secondary, "keyword_else", strlen("keyword_else"));
+      type_secondary[strlen("keyword_else")] = '\0';
+      break;
+    case (KEYWORD_REPEAT):
+      strncpy(type_secondary, "keyword_repeat", strlen("keyword_repeat"));
+      type_secondary[strlen("keyword_repeat")] = '\0';
+      break;
+    case (KEYWORD_OVER):
+      strncpy(type_secondary, "keyword_over", strlen("keyword_over"));
+      type_secondary[strlen("keyword_over")] = '\0';
+      break;
+    case (KEYWORD_YIELD):
+      strncpy(type_secondary, "keyword_yield", strlen("keyword_yield"));
+      type_secondary[strlen("keyword_yield")] = '\0';
+      break;
+    case (KEYWORD_IMPORT):
+      strncpy(type_secondary, "keyword_import", strlen("keyword_import"));
+      type_secondary[strlen("keyword_import")] = '\0';
+      break;
+    case (KEYWORD_IN):
+      strncpy(type_secondary, "keyword_in", strlen("keyword_in"));
+      type_secondary[strlen("keyword_in")] = '\0';
+      break;
+    case (KEYWORD_NEW):
+      strncpy(type_secondary, "keyword_new", strlen("keyword_new"));
+      type_secondary[strlen("keyword_new")] = '\0';
       break;
     case (LITERAL_QUOTE_D):
       strncpy(type_secondary, "literal_quote_d", strlen("literal_quote_d"));
-      type_secondary[strlen("literal_quote_d") + 1] = '\0';
+      type_secondary[strlen("literal_quote_d")] = '\0';
       break;
     case (LITERAL_QUOTE_S):
       strncpy(type_secondary, "literal_quote_s", strlen("literal_quote_s"));
-      type_secondary[strlen("literal_quote_s") + 1] = '\0';
+      type_secondary[strlen("literal_quote_s")] = '\0';
       break;
     case (LITERAL_QUOTE_B):
       strncpy(type_secondary, "literal_quote_b", strlen("literal_quote_b"));
-      type_secondary[strlen("literal_quote_b") + 1] = '\0';
+      type_secondary[strlen("literal_quote_b")] = '\0';
       break;
     case (LITERAL_INTEGER):
       strncpy(type_secondary, "literal_integer", strlen("literal_integer"));
-      type_secondary[strlen("literal_integer") + 1] = '\0';
+      type_secondary[strlen("literal_integer")] = '\0';
+      break;
+    case (LITERAL_BIG_INTEGER):
+      strncpy(type_secondary, "literal_big_integer", strlen("literal_big_integer"));
+      type_secondary[strlen("literal_big_integer")] = '\0';
       break;
     case (LITERAL_DOUBLE):
       strncpy(type_secondary, "literal_double", strlen("literal_double"));
-      type_secondary[strlen("literal_double") + 1] = '\0';
+      type_secondary[strlen("literal_double")] = '\0';
       break;
     case (LITERAL_BOOLEAN):
       strncpy(type_secondary, "literal_boolean", strlen("literal_boolean"));
-      type_secondary[strlen("literal_boolean") + 1] = '\0';
+      type_secondary[strlen("literal_boolean")] = '\0';
       break;
     case (OPERATOR_STAR):
       strncpy(type_secondary, "operator_star", strlen("operator_star"));
-      type_secondary[strlen("operator_star") + 1] = '\0';
+      type_secondary[strlen("operator_star")] = '\0';
       break;
     case (OPERATOR_STARSTAR):
       strncpy(type_secondary, "operator_starstar", strlen("operator_starstar"));
-      type_secondary[strlen("operator_starstar") + 1] = '\0';
+      type_secondary[strlen("operator_starstar")] = '\0';
       break;
     case (OPERATOR_PLUS):
       strncpy(type_secondary, "operator_plus", strlen("operator_plus"));
-      type_secondary[strlen("operator_plus") + 1] = '\0';
+      type_secondary[strlen("operator_plus")] = '\0';
       break;
     case (OPERATOR_MINUS):
       strncpy(type_secondary, "operator_minus", strlen("operator_minus"));
-      type_secondary[strlen("operator_minus") + 1] = '\0';
+      type_secondary[strlen("operator_minus")] = '\0';
       break;
     case (OPERATOR_FSLASH):
       strncpy(type_secondary, "operator_fslash", strlen("operator_fslash"));
-      type_secondary[strlen("operator_fslash") + 1] = '\0';
+      type_secondary[strlen("operator_fslash")] = '\0';
       break;
     case (OPERATOR_COLON):
       strncpy(type_secondary, "operator_colon", strlen("operator_colon"));
-      type_secondary[strlen("operator_colon") + 1] = '\0';
+      type_secondary[strlen("operator_colon")] = '\0';
       break;
     case (OPERATOR_COLONCOLON):
       strncpy(type_secondary, "operator_coloncolon", strlen("operator_coloncolon"));
-      type_secondary[strlen("operator_coloncolon") + 1] = '\0';
+      type_secondary[strlen("operator_coloncolon")] = '\0';
       break;
     case (OPERATOR_ARROW_R):
       strncpy(type_secondary, "operator_arrow_r", strlen("operator_arrow_r"));
-      type_secondary[strlen("operator_arrow_r") + 1] = '\0';
+      type_secondary[strlen("operator_arrow_r")] = '\0';
       break;
     case (OPERATOR_ARROW_L):
       strncpy(type_secondary, "operator_arrow_l", strlen("operator_arrow_l"));
-      type_secondary[strlen("operator_arrow_l") + 1] = '\0';
+      type_secondary[strlen("operator_arrow_l")] = '\0';
+      break;
+    case (OPERATOR_LESS):
+      strncpy(type_secondary, "operator_less", strlen("operator_less"));
+      type_secondary[strlen("operator_less")] = '\0';
+      break;
+    case (OPERATOR_GREATER):
+      strncpy(type_secondary, "operator_greater", strlen("operator_greater"));
+      type_secondary[strlen("operator_greater")] = '\0';
+      break;
+    case (OPERATOR_EQUAL):
+      strncpy(type_secondary, "operator_equal", strlen("operator_equal"));
+      type_secondary[strlen("operator_equal")] = '\0';
       break;
     case (GROUPING_BRACE_L):
       strncpy(type_secondary, "grouping_brace_l", strlen("grouping_brace_l"));
-      type_secondary[strlen("grouping_brace_l") + 1] = '\0';
+      type_secondary[strlen("grouping_brace_l")] = '\0';
       break;
     case (GROUPING_BRACKET_L):
       strncpy(type_secondary, "grouping_bracket_l", strlen("grouping_bracket_l"));
-      type_secondary[strlen("grouping_bracket_l") + 1] = '\0';
+      type_secondary[strlen("grouping_bracket_l")] = '\0';
       break;
     case (GROUPING_PAREN_L):
       strncpy(type_secondary, "grouping_paren_l", strlen("grouping_paren_l"));
-      type_secondary[strlen("grouping_paren_l") + 1] = '\0';
+      type_secondary[strlen("grouping_paren_l")] = '\0';
       break;
     case (GROUPING_BRACE_R):
       strncpy(type_secondary, "grouping_brace_r", strlen("grouping_brace_r"));
-      type_secondary[strlen("grouping_brace_r") + 1] = '\0';
+      type_secondary[strlen("grouping_brace_r")] = '\0';
       break;
     case (GROUPING_BRACKET_R):
       strncpy(type_secondary, "grouping_bracket_r", strlen("grouping_bracket_r"));
-      type_secondary[strlen("grouping_bracket_r") + 1] = '\0';
+      type_secondary[strlen("grouping_bracket_r")] = '\0';
       break;
     case (GROUPING_PAREN_R):
       strncpy(type_secondary, "grouping_paren_r", strlen("grouping_paren_r"));
-      type_secondary[strlen("grouping_paren_r") + 1] = '\0';
+      type_secondary[strlen("grouping_paren_r")] = '\0';
       break;
     case (DELIMITER_SEMI):
       strncpy(type_secondary, "delimiter_semi", strlen("delimiter_semi"));
-      type_secondary[strlen("delimiter_semi") + 1] = '\0';
+      type_secondary[strlen("delimiter_semi")] = '\0';
+      break;
     case (DELIMITER_COMMA):
       strncpy(type_secondary, "delimiter_comma", strlen("delimiter_comma"));
-      type_secondary[strlen("delimiter_comma") + 1] = '\0';
+      type_secondary[strlen("delimiter_comma")] = '\0';
       break;
     default:
       strncpy(type_secondary, "unknown", strlen("unknown"));
-      type_secondary[strlen("unknown") + 1] = '\0';
+      type_secondary[strlen("unknown")] = '\0';
       break;
   }
-  sprintf(string, "(token %s/%s \"%s\")", type_primary, type_secondary, representation);
+  snprintf(string, 64, "(token %s/%s \"%.*s\")", type_primary, type_secondary, (int) token->length, representation);
+  free(type_primary);
+  free(type_secondary);
   return string;
 }
 
-void tokenizer_cleanup () {
+void tokenizer_cleanup (wtjl_context_t *ctx) {
+  for (size_t i = 0; i < ctx->tokenizer.tokens_size; i++) {
+    free(ctx->tokenizer.tokens[i]->representation);
+    free(ctx->tokenizer.tokens[i]);
+  }
+  free(ctx->tokenizer.tokens);
+  ctx->tokenizer.tokens = NULL;
+  ctx->tokenizer.tokens_size = 0;
+  ctx->tokenizer.tokens_capacity = 0;
+  ctx->tokenizer.tokens_index = 0;
+  ctx->tokenizer.file_name = NULL;
+  ctx->tokenizer.input_length = 0;
+  free(ctx->tokenizer.line_starts);
+  ctx->tokenizer.line_starts = NULL;
+  ctx->tokenizer.num_lines = 0;
+  ctx->tokenizer.lines_capacity = 0;
+  ctx->tokenizer.slices = false;
+}
+
+// finds where every line of the input starts, once, so tokens need only
+// their offset and a location is a binary search away
+void _tokenizer_index_lines (wtjl_context_t *ctx) {
+  const char *input = ctx->scanner.input;
+  size_t length = ctx->scanner.input_length;
+  ctx->tokenizer.lines_capacity = 64;
+  ctx->tokenizer.line_starts = malloc(ctx->tokenizer.lines_capacity * sizeof(uint32_t));
+  ctx->tokenizer.line_starts[0] = 0;
+  ctx->tokenizer.num_lines = 1;
+  const char *newline = input;
+  while (length && (newline = memchr(newline, '\n', input + length - newline))) {
+    newline++;
+    if (ctx->tokenizer.num_lines == ctx->tokenizer.lines_capacity) {
+      ctx->tokenizer.lines_capacity *= 2;
+      ctx->tokenizer.line_starts = realloc(ctx->tokenizer.line_starts, ctx->tokenizer.lines_capacity * sizeof(uint32_t));
+    }
+    ctx->tokenizer.line_starts[ctx->tokenizer.num_lines++] = newline - input;
+  }
+}
+
+// how many of `line_starts` are at or before `offset`
+size_t _tokenizer_lines_through (const uint32_t *line_starts, size_t num_lines, size_t offset) {
+  size_t low = 0;
+  size_t high = num_lines;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (line_starts[middle] <= offset) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
 
+// 1-based line and column of `offset`; false when there is no source to look in
+bool tokenizer_location (wtjl_context_t *ctx, size_t offset, size_t *line, size_t *column) {
+  if (!ctx->tokenizer.num_lines) {
+    return false;
+  }
+  *line = _tokenizer_lines_through(ctx->tokenizer.line_starts, ctx->tokenizer.num_lines, offset);
+  *column = offset - ctx->tokenizer.line_starts[*line - 1] + 1;
+  return true;
 }
 
-token_t *tokenizer_next () {
-  return _tokenizer_tokens[_tokenizer_tokens_index];
+MODULE_INLINE token_t *tokenizer_next (wtjl_context_t *ctx) {
+  if (ctx->tokenizer.tokens_index >= ctx->tokenizer.tokens_size) {
+    return NULL;
+  }
+  return ctx->tokenizer.tokens[ctx->tokenizer.tokens_index];
 }
 
-void _tokenizer_tokenize () {
-  scanner.scan();
-  token_t **tokens = malloc(sizeof(token_t *));
-  size_t tokens_size = 1;
-  size_t tokens_index = 0;
+// tokenizes everything the scanner holds; tokens are appended to the context
+// as they are produced so a failure part way through can still be cleaned up.
+// String literals are left as slices, so the scanner must not be cleaned up
+// before the tokens are
+void tokenizer_tokenize (wtjl_context_t *ctx) {
+  tokenizer.cleanup(ctx);
+  if (ctx->scanner.input_length > UINT32_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Tokenizing error; input is larger than 4 GB.");
+  }
+  ctx->tokenizer.file_name = ctx->scanner.file_name;
+  ctx->tokenizer.input_length = ctx->scanner.input_length;
+  ctx->tokenizer.slices = true;
+  _tokenizer_index_lines(ctx);
+  ctx->tokenizer.tokens_capacity = 1;
+  ctx->tokenizer.tokens = malloc(sizeof(token_t *));
   token_t *token;
-  while (token = _tokenizer_next()) {
-    if (tokens_index == tokens_size) {
-      tokens_size = tokens_size * 2;
-      tokens = realloc(tokens, tokens_size * sizeof(token_t *));
+  while ((token = _tokenizer_next(ctx))) {
+    if (ctx->tokenizer.tokens_size == ctx->tokenizer.tokens_capacity) {
+      ctx->tokenizer.tokens_capacity = ctx->tokenizer.tokens_capacity * 2;
+      ctx->tokenizer.tokens = realloc(ctx->tokenizer.tokens, ctx->tokenizer.tokens_capacity * sizeof(token_t *));
     }
-    tokens[tokens_index] = token;
-    tokens_index++;
+    ctx->tokenizer.tokens[ctx->tokenizer.tokens_size] = token;
+    ctx->tokenizer.tokens_size++;
   }
-  _tokenizer_tokens = tokens;
-  _tokenizer_tokens_size = tokens_index;
-  scanner.cleanup();
 }
 
-void tokenizer_initialize () {
-  _tokenizer_tokenize();
+void tokenizer_initialize (wtjl_context_t *ctx) {
+  ctx->tokenizer.tokens = NULL;
+  ctx->tokenizer.tokens_size = 0;
+  ctx->tokenizer.tokens_capacity = 0;
+  ctx->tokenizer.tokens_index = 0;
+  ctx->tokenizer.file_name = NULL;
+  ctx->tokenizer.input_length = 0;
+  ctx->tokenizer.line_starts = NULL;
+  ctx->tokenizer.num_lines = 0;
+  ctx->tokenizer.lines_capacity = 0;
+  ctx->tokenizer.recover = false;
+  ctx->tokenizer.slices = false;
 }
 
 void setup_tokenizer () {
   tokenizer.initialize = tokenizer_initialize;
+  tokenizer.tokenize = tokenizer_tokenize;
   tokenizer.next = tokenizer_next;
   tokenizer.peek = tokenizer_peek;
   tokenizer.consume = tokenizer_consume;
   tokenizer.done = tokenizer_done;
   tokenizer.token_as_string = tokenizer_token_as_string;
+  tokenizer.text = tokenizer_text;
+  tokenizer.escape = tokenizer_escape;
+  tokenizer.location = tokenizer_location;
   tokenizer.cleanup = tokenizer_cleanup;
 }
 
@@ -1136,192 +2950,11419 @@ void setup_tokenizer () {
 
 /* ``begin parser */
 
-node_t *_parser_ast = NULL;
+node_t *_parser_node_new (node_type_t type, token_t *token) {
+  node_t *node = malloc(sizeof(node_t));
+  node->type = type;
+  node->num_children = 0;
+  node->children = NULL;
+  node->parent = NULL;
+  node->token = token;
+  node->annotation = NULL;
+  node->constant = NULL;
+  node->analysis = 0;
+  return node;
+}
 
-void _parser_expect_secondary (token_type_secondary_t type) {
-  token_t *token;
-  token = tokenizer.next();
-  if (!token) {
-    return;
-  }
-  if (token->token_type_secondary != type) {
-    fprintf(stderr, "Parsing error; unexpected \"%s\".\n", tokenizer.token_as_string(token));
-    exit(1);
+void _parser_node_add (node_t *node, node_t *child) {
+  node->num_children++;
+  node->children = realloc(node->children, node->num_children * sizeof(node_t *));
+  node->children[node->num_children - 1] = child;
+  if (child) {
+    child->parent = node;
   }
 }
 
-void _parser_expect_primary (token_type_primary_t type) {
-  token_t *token;
-  token = tokenizer.next();
-  if (!token) {
+void _parser_node_free (node_t *node) {
+  if (!node) {
     return;
   }
-  if (token->token_type_primary != type) {
-    fprintf(stderr, "Parsing error; unexpected \"%s\".\n", tokenizer.token_as_string(token));
-    exit(1);
+  for (size_t i = 0; i < node->num_children; i++) {
+    _parser_node_free(node->children[i]);
   }
+  free(node->children);
+  free(node->constant);
+  free(node);
 }
 
-
-node_t *_parser_try_declaration () {
-  node_t *node = NULL;
-  if (tokenizer.next()->token_type_secondary == KEYWORD_VAR) {
-    tokenizer.consume(1); // TODO
-    _parser_expect_primary(IDENTIFIER);
-    tokenizer.consume(1); // TODO
-    _parser_expect_secondary(DELIMITER_SEMI);
-    tokenizer.consume(1); // TODO
-    node = malloc(sizeof(node_t));
-    node->type = strdup("declaration");
-    node->num_children = 0;
-    node->children = NULL;
-    node->parent = NULL;
-    node->info_type = NULL;
-    node->info = NULL;
-    return node;
+void _parser_unexpected (wtjl_context_t *ctx, token_t *token) {
+  if (!token) {
+    wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, ctx->tokenizer.input_length, "Parsing error; unexpected end of input.");
   }
-  return NULL;
+  wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, token->offset, "Parsing error; unexpected \"%s\".", tokenizer.token_as_string(ctx, token));
 }
 
-void parser_parse () {
-  node_t *node = NULL;
-  if (node = _parser_try_declaration()) {
-    _parser_ast = node;
-    printf("node->type = \"%s\"\n", node->type);
-    return;
+token_t *_parser_expect_secondary (wtjl_context_t *ctx, token_type_secondary_t type) {
+  token_t *token;
+  token = CALL(tokenizer, next)(ctx);
+  if (!token || token->token_type_secondary != type) {
+    _parser_unexpected(ctx, token);
   }
-  fprintf(stderr, "Parsing error\n");
-  exit(1);
+  CALL(tokenizer, consume)(ctx, 1);
+  return token;
 }
 
-void parser_cleanup () {
-
+token_t *_parser_expect_primary (wtjl_context_t *ctx, token_type_primary_t type) {
+  token_t *token;
+  token = CALL(tokenizer, next)(ctx);
+  if (!token || token->token_type_primary != type) {
+    _parser_unexpected(ctx, token);
+  }
+  CALL(tokenizer, consume)(ctx, 1);
+  return token;
 }
 
-void parser_initialize () {
-
+bool _parser_next_is (wtjl_context_t *ctx, size_t ahead, token_type_secondary_t type) {
+  token_t *token = CALL(tokenizer, peek)(ctx, ahead);
+  return token && token->token_type_secondary == type;
 }
 
-void setup_parser () {
-  parser.parse = parser_parse;
-  parser.cleanup = parser_cleanup;
-  parser.initialize = parser_initialize;
+token_t *_parser_accept_secondary (wtjl_context_t *ctx, token_type_secondary_t type) {
+  if (_parser_next_is(ctx, 0, type)) {
+    return CALL(tokenizer, consume)(ctx, 1)[0];
+  }
+  return NULL;
 }
 
-/* end parser */
-
-/* ``begin begin */
+node_t *_parser_expression (wtjl_context_t *ctx);
+node_t *_parser_statement (wtjl_context_t *ctx);
 
-void begin () {
-  printf("Interpretting `%s`.\n", glbl_arguments->file_name);
-  parser.parse();
-  /*token_t **tokens;
-  while (tokens = tokenizer.consume(1)) {
-    printf("%s\n", tokenizer.token_as_string(tokens[0]));
-  }*/
+// `(` starts a function when its matching `)` is followed by `->`; parameter
+// lists never hold `;` or braces, so the scan stops at those instead of
+// running on to the end of an unbalanced input, and never looks past the
+// statement it is in
+bool _parser_is_function (wtjl_context_t *ctx) {
+  size_t depth = 0;
+  size_t ahead = 0;
+  token_t *token;
+  while ((token = CALL(tokenizer, peek)(ctx, ahead))) {
+    if (token->token_type_secondary == DELIMITER_SEMI || token->token_type_secondary == GROUPING_BRACE_L || token->token_type_secondary == GROUPING_BRACE_R) {
+      return false;
+    }
+    if (token->token_type_secondary == GROUPING_PAREN_L) {
+      depth++;
+    } else if (token->token_type_secondary == GROUPING_PAREN_R) {
+      depth--;
+      if (!depth) {
+        return _parser_next_is(ctx, ahead + 1, OPERATOR_ARROW_R);
+      }
+    }
+    ahead++;
+  }
+  return false;
 }
 
-/* end begin */
-
-/* ``begin test ll */
-
-void test_ll_iterate () {
-  ll_t *list = ll.new();
-  for (int i = 0; i < 100; i++) {
-    ll.add(list, "hello, world");
+node_t *_parser_try_block (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, GROUPING_BRACE_L);
+  if (!token) {
+    return NULL;
   }
-  for (int i = 0; i < 100; i++) {
-    if (strcmp(ll.get(list, i), "hello, world") != 0) {
-      printf("bad str cmp\n");
-      TEST_FAIL;
-      return;
+  node_t *node = _parser_node_new(NODE_BLOCK, token);
+  while (!_parser_accept_secondary(ctx, GROUPING_BRACE_R)) {
+    if (CALL(tokenizer, done)(ctx)) {
+      _parser_unexpected(ctx, NULL);
     }
+    _parser_node_add(node, _parser_statement(ctx));
   }
-  for (int i = 0; i < 100; i++) {
-    ll.remove(list, ll.size(list) - 1);
-  }
-  if (ll.get(list, 0)) {
-    printf("bad first\n");
-    TEST_FAIL;
-    return;
+  return node;
+}
+
+node_t *_parser_function (wtjl_context_t *ctx) {
+  node_t *node = _parser_node_new(NODE_FUNCTION, _parser_expect_secondary(ctx, GROUPING_PAREN_L));
+  if (!_parser_accept_secondary(ctx, GROUPING_PAREN_R)) {
+    do {
+      node_t *parameter = _parser_node_new(NODE_IDENTIFIER, _parser_expect_primary(ctx, IDENTIFIER));
+      if (_parser_accept_secondary(ctx, KEYWORD_AS)) {
+        parameter->annotation = _parser_expect_primary(ctx, IDENTIFIER);
+      }
+      _parser_node_add(node, parameter);
+    } while (_parser_accept_secondary(ctx, DELIMITER_COMMA));
+    _parser_expect_secondary(ctx, GROUPING_PAREN_R);
   }
-  if (ll.size(list)) {
-    printf("bad size\n");
-    TEST_FAIL;
-    return;
+  _parser_expect_secondary(ctx, OPERATOR_ARROW_R);
+  node_t *body = _parser_try_block(ctx);
+  _parser_node_add(node, body ? body : _parser_expression(ctx));
+  return node;
+}
+
+// `iterate sum x in start, end -> expression`; the expression becomes a
+// function of x, run for every integer from start up to, not including, end,
+// or with `in array` for every element of an array
+node_t *_parser_reduce (wtjl_context_t *ctx) {
+  _parser_expect_secondary(ctx, KEYWORD_ITERATE);
+  node_t *node = _parser_node_new(NODE_REDUCE, _parser_expect_primary(ctx, IDENTIFIER));
+  node_t *parameter = _parser_node_new(NODE_IDENTIFIER, _parser_expect_primary(ctx, IDENTIFIER));
+  _parser_expect_secondary(ctx, KEYWORD_IN);
+  _parser_node_add(node, _parser_expression(ctx));
+  if (_parser_accept_secondary(ctx, DELIMITER_COMMA)) {
+    _parser_node_add(node, _parser_expression(ctx));
   }
-  ll.delete(list);
-  TEST_PASS;
+  node_t *function = _parser_node_new(NODE_FUNCTION, _parser_expect_secondary(ctx, OPERATOR_ARROW_R));
+  _parser_node_add(function, parameter);
+  _parser_node_add(function, _parser_expression(ctx));
+  _parser_node_add(node, function);
+  return node;
 }
 
-void test_ll_basic () {
-  ll_t *list = ll.new();
-  if (!list) {
-    TEST_FAIL;
-    return;
+node_t *_parser_primary (wtjl_context_t *ctx) {
+  token_t *token = CALL(tokenizer, next)(ctx);
+  if (!token) {
+    _parser_unexpected(ctx, NULL);
   }
-  char *foo = "foo";
-  char *bar = "bar";
-  ll.add(list, foo);
-  ll.add(list, bar);
-  if (((char *) ll.get(list, 0)) != foo) {
-    TEST_FAIL;
-    return;
+  if (token->token_type_primary == LITERAL) {
+    CALL(tokenizer, consume)(ctx, 1);
+    return _parser_node_new(NODE_LITERAL, token);
   }
-  if (((char *) ll.get(list, 1)) != bar) {
-    TEST_FAIL;
-    return;
+  if (token->token_type_primary == IDENTIFIER) {
+    CALL(tokenizer, consume)(ctx, 1);
+    return _parser_node_new(NODE_IDENTIFIER, token);
   }
-  ll.remove(list, 0);
-  if (((char *) ll.get(list, 0)) != bar) {
-    printf("not bar %s\n", (char *) ll.get(list, 0));
-    TEST_FAIL;
-    return;
+  if (token->token_type_secondary == KEYWORD_ITERATE) {
+    return _parser_reduce(ctx);
   }
-  ll.remove(list, 0);
-  if (((char *) ll.get(list, 0)) != NULL) {
-    TEST_FAIL;
-    return;
+  if (token->token_type_secondary == KEYWORD_NEW) {
+    CALL(tokenizer, consume)(ctx, 1);
+    return _parser_node_new(NODE_NEW, token);
   }
-  ll.remove(list, 0);
+  if (token->token_type_secondary == GROUPING_PAREN_L) {
+    if (_parser_is_function(ctx)) {
+      return _parser_function(ctx);
+    }
+    CALL(tokenizer, consume)(ctx, 1);
+    node_t *node = _parser_expression(ctx);
+    _parser_expect_secondary(ctx, GROUPING_PAREN_R);
+    return node;
+  }
+  _parser_unexpected(ctx, token);
+  return NULL;
+}
+
+// calls, `::` member reads and indexing, in any order: `a::b(c)[d]`
+node_t *_parser_call (wtjl_context_t *ctx) {
+  node_t *node = _parser_primary(ctx);
+  token_t *token;
+  for (; ; ) {
+    if ((token = _parser_accept_secondary(ctx, GROUPING_BRACKET_L))) {
+      node_t *index = _parser_node_new(NODE_INDEX, token);
+      _parser_node_add(index, node);
+      _parser_node_add(index, _parser_expression(ctx));
+      _parser_expect_secondary(ctx, GROUPING_BRACKET_R);
+      node = index;
+      continue;
+    }
+    if (_parser_accept_secondary(ctx, OPERATOR_COLONCOLON)) {
+      node_t *member = _parser_node_new(NODE_MEMBER, _parser_expect_primary(ctx, IDENTIFIER));
+      _parser_node_add(member, node);
+      node = member;
+      continue;
+    }
+    if (!(token = _parser_accept_secondary(ctx, GROUPING_PAREN_L))) {
+      break;
+    }
+    node_t *call = _parser_node_new(NODE_CALL, token);
+    _parser_node_add(call, node);
+    if (!_parser_accept_secondary(ctx, GROUPING_PAREN_R)) {
+      do {
+        _parser_node_add(call, _parser_expression(ctx));
+      } while (_parser_accept_secondary(ctx, DELIMITER_COMMA));
+      _parser_expect_secondary(ctx, GROUPING_PAREN_R);
+    }
+    node = call;
+  }
+  return node;
+}
+
+node_t *_parser_unary (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, OPERATOR_MINUS);
+  if (token) {
+    node_t *node = _parser_node_new(NODE_UNARY, token);
+    _parser_node_add(node, _parser_unary(ctx));
+    return node;
+  }
+  return _parser_call(ctx);
+}
+
+node_t *_parser_binary_node (token_t *token, node_t *left, node_t *right) {
+  node_t *node = _parser_node_new(NODE_BINARY, token);
+  _parser_node_add(node, left);
+  _parser_node_add(node, right);
+  return node;
+}
+
+// right associative
+node_t *_parser_power (wtjl_context_t *ctx) {
+  node_t *node = _parser_unary(ctx);
+  token_t *token = _parser_accept_secondary(ctx, OPERATOR_STARSTAR);
+  if (token) {
+    return _parser_binary_node(token, node, _parser_power(ctx));
+  }
+  return node;
+}
+
+node_t *_parser_multiplicative (wtjl_context_t *ctx) {
+  node_t *node = _parser_power(ctx);
+  token_t *token;
+  while ((token = _parser_accept_secondary(ctx, OPERATOR_STAR)) || (token = _parser_accept_secondary(ctx, OPERATOR_FSLASH))) {
+    node = _parser_binary_node(token, node, _parser_power(ctx));
+  }
+  return node;
+}
+
+node_t *_parser_additive (wtjl_context_t *ctx) {
+  node_t *node = _parser_multiplicative(ctx);
+  token_t *token;
+  while ((token = _parser_accept_secondary(ctx, OPERATOR_PLUS)) || (token = _parser_accept_secondary(ctx, OPERATOR_MINUS))) {
+    node = _parser_binary_node(token, node, _parser_multiplicative(ctx));
+  }
+  return node;
+}
+
+// comparisons do not chain, `a < b < c` is an error
+node_t *_parser_comparison (wtjl_context_t *ctx) {
+  node_t *node = _parser_additive(ctx);
+  token_t *token;
+  if ((token = _parser_accept_secondary(ctx, OPERATOR_LESS)) || (token = _parser_accept_secondary(ctx, OPERATOR_GREATER)) || (token = _parser_accept_secondary(ctx, OPERATOR_EQUAL))) {
+    node = _parser_binary_node(token, node, _parser_additive(ctx));
+  }
+  return node;
+}
+
+node_t *_parser_expression (wtjl_context_t *ctx) {
+  return _parser_comparison(ctx);
+}
+
+node_t *_parser_try_declaration (wtjl_context_t *ctx) {
+  node_t *node = NULL;
+  if (_parser_accept_secondary(ctx, KEYWORD_VAR)) {
+    node = _parser_node_new(NODE_DECLARATION, _parser_expect_primary(ctx, IDENTIFIER));
+    if (_parser_accept_secondary(ctx, KEYWORD_AS)) {
+      node->annotation = _parser_expect_primary(ctx, IDENTIFIER);
+    }
+    if (_parser_accept_secondary(ctx, OPERATOR_ARROW_L)) {
+      _parser_node_add(node, _parser_expression(ctx));
+    }
+    _parser_expect_secondary(ctx, DELIMITER_SEMI);
+    return node;
+  }
+  return NULL;
+}
+
+node_t *_parser_try_assignment (wtjl_context_t *ctx) {
+  token_t *token = CALL(tokenizer, next)(ctx);
+  if (token && token->token_type_primary == IDENTIFIER && _parser_next_is(ctx, 1, OPERATOR_ARROW_L)) {
+    CALL(tokenizer, consume)(ctx, 2);
+    node_t *node = _parser_node_new(NODE_ASSIGNMENT, token);
+    _parser_node_add(node, _parser_expression(ctx));
+    _parser_expect_secondary(ctx, DELIMITER_SEMI);
+    return node;
+  }
+  return NULL;
+}
+
+node_t *_parser_expect_block (wtjl_context_t *ctx) {
+  node_t *node = _parser_try_block(ctx);
+  if (!node) {
+    _parser_unexpected(ctx, CALL(tokenizer, next)(ctx));
+  }
+  return node;
+}
+
+// if <condition> { ... } [else { ... } | else if ...]
+node_t *_parser_try_if (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, KEYWORD_IF);
+  if (!token) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_IF, token);
+  _parser_node_add(node, _parser_expression(ctx));
+  _parser_node_add(node, _parser_expect_block(ctx));
+  if (_parser_accept_secondary(ctx, KEYWORD_ELSE)) {
+    node_t *alternative = _parser_try_if(ctx);
+    _parser_node_add(node, alternative ? alternative : _parser_expect_block(ctx));
+  }
+  return node;
+}
+
+// `repeat { ... }` runs until something in it returns
+node_t *_parser_try_repeat (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, KEYWORD_REPEAT);
+  if (!token) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_REPEAT, token);
+  _parser_node_add(node, _parser_expect_block(ctx));
+  return node;
+}
+
+// `iterate <name> over <generator> { ... }`
+// `iterate sum x in` starts a reduction, which is an expression
+node_t *_parser_try_iterate (wtjl_context_t *ctx) {
+  if (_parser_next_is(ctx, 3, KEYWORD_IN) || !_parser_accept_secondary(ctx, KEYWORD_ITERATE)) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_ITERATE, _parser_expect_primary(ctx, IDENTIFIER));
+  _parser_expect_secondary(ctx, KEYWORD_OVER);
+  _parser_node_add(node, _parser_expression(ctx));
+  _parser_node_add(node, _parser_expect_block(ctx));
+  return node;
+}
+
+node_t *_parser_try_yield (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, KEYWORD_YIELD);
+  if (!token) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_YIELD, token);
+  _parser_node_add(node, _parser_expression(ctx));
+  _parser_expect_secondary(ctx, DELIMITER_SEMI);
+  return node;
+}
+
+node_t *_parser_try_import (wtjl_context_t *ctx) {
+  if (!_parser_accept_secondary(ctx, KEYWORD_IMPORT)) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_IMPORT, _parser_expect_secondary(ctx, LITERAL_QUOTE_D));
+  _parser_expect_secondary(ctx, DELIMITER_SEMI);
+  return node;
+}
+
+node_t *_parser_try_return (wtjl_context_t *ctx) {
+  token_t *token = _parser_accept_secondary(ctx, KEYWORD_RETURN);
+  if (!token) {
+    return NULL;
+  }
+  node_t *node = _parser_node_new(NODE_RETURN, token);
+  if (!_parser_accept_secondary(ctx, DELIMITER_SEMI)) {
+    _parser_node_add(node, _parser_expression(ctx));
+    _parser_expect_secondary(ctx, DELIMITER_SEMI);
+  }
+  return node;
+}
+
+node_t *_parser_statement (wtjl_context_t *ctx) {
+  node_t *node = NULL;
+  if ((node = _parser_try_declaration(ctx)) || (node = _parser_try_assignment(ctx)) || (node = _parser_try_return(ctx)) || (node = _parser_try_if(ctx)) ||
+      (node = _parser_try_repeat(ctx)) || (node = _parser_try_iterate(ctx)) || (node = _parser_try_yield(ctx)) || (node = _parser_try_import(ctx)) || (node = _parser_try_block(ctx))) {
+    return node;
+  }
+  node = _parser_node_new(NODE_EXPRESSION, CALL(tokenizer, next)(ctx));
+  _parser_node_add(node, _parser_expression(ctx));
+  // `object::name <- value;` reads as a member until its arrow, and
+  // `array[index] <- value;` as an index
+  node_type_t target = node->children[0]->type;
+  if ((target == NODE_MEMBER || target == NODE_INDEX) && _parser_accept_secondary(ctx, OPERATOR_ARROW_L)) {
+    node_t *member = node->children[0];
+    node->num_children = 0;
+    _parser_node_free(node);
+    node = member;
+    node->type = target == NODE_MEMBER ? NODE_SET_MEMBER : NODE_SET_INDEX;
+    node->parent = NULL;
+    _parser_node_add(node, _parser_expression(ctx));
+  }
+  _parser_expect_secondary(ctx, DELIMITER_SEMI);
+  return node;
+}
+
+void parser_parse (wtjl_context_t *ctx) {
+  parser.cleanup(ctx);
+  // attached before parsing so a partial tree is still released on failure
+  ctx->parser.ast = _parser_node_new(NODE_PROGRAM, NULL);
+  while (!CALL(tokenizer, done)(ctx)) {
+    _parser_node_add(ctx->parser.ast, _parser_statement(ctx));
+  }
+}
+
+void parser_cleanup (wtjl_context_t *ctx) {
+  _parser_node_free(ctx->parser.ast);
+  ctx->parser.ast = NULL;
+}
+
+void parser_initialize (wtjl_context_t *ctx) {
+  ctx->parser.ast = NULL;
+}
+
+void setup_parser () {
+  parser.parse = parser_parse;
+  parser.cleanup = parser_cleanup;
+  parser.initialize = parser_initialize;
+}
+
+/* end parser */
+
+/* ``begin optimizer */
+
+size_t _optimizer_count (node_t *node) {
+  if (!node) {
+    return 0;
+  }
+  size_t count = 1;
+  for (size_t i = 0; i < node->num_children; i++) {
+    count += _optimizer_count(node->children[i]);
+  }
+  return count;
+}
+
+void _optimizer_push_local (wtjl_context_t *ctx, char *name) {
+  optimizer_state_t *state = &ctx->optimizer;
+  if (state->num_locals == state->locals_capacity) {
+    state->locals_capacity = state->locals_capacity ? state->locals_capacity * 2 : 16;
+    state->locals = realloc(state->locals, state->locals_capacity * sizeof(char *));
+  }
+  state->locals[state->num_locals++] = name;
+}
+
+bool _optimizer_is_local (wtjl_context_t *ctx, char *name) {
+  optimizer_state_t *state = &ctx->optimizer;
+  for (size_t i = state->num_locals; i > 0; i--) {
+    if (strcmp(state->locals[i - 1], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// the type of the constant `node` is, VALUE_UNDEFINED when it is not one
+value_type_t _optimizer_constant_type (node_t *node) {
+  if (node->type == NODE_CONSTANT) {
+    return node->constant->type;
+  }
+  if (node->type != NODE_LITERAL) {
+    return VALUE_UNDEFINED;
+  }
+  switch (node->token->token_type_secondary) {
+    case (LITERAL_QUOTE_D):
+    case (LITERAL_QUOTE_B):
+      return VALUE_STRING;
+    case (LITERAL_DOUBLE):
+      return VALUE_DOUBLE;
+    case (LITERAL_BOOLEAN):
+      return VALUE_BOOLEAN;
+    case (LITERAL_BIG_INTEGER):
+      return VALUE_BIGNUM;
+    default:
+      return VALUE_INTEGER;
+  }
+}
+
+value_t _optimizer_constant (wtjl_context_t *ctx, node_t *node) {
+  return node->type == NODE_CONSTANT ? *node->constant : compiler.literal(ctx, node->token);
+}
+
+// evaluating `node` can neither fail nor be observed, so it may be dropped
+bool _optimizer_is_pure (wtjl_context_t *ctx, node_t *node) {
+  switch (node->type) {
+    case (NODE_LITERAL):
+    case (NODE_CONSTANT):
+    case (NODE_FUNCTION):
+      return true;
+    case (NODE_IDENTIFIER):
+      // globals may be undefined, reading one can fail
+      return _optimizer_is_local(ctx, node->token->representation);
+    default:
+      return false;
+  }
+}
+
+// control never reaches past `node`
+bool _optimizer_terminates (node_t *node) {
+  switch (node->type) {
+    case (NODE_RETURN):
+      return true;
+    case (NODE_REPEAT):
+      // there is no way out of one but returning
+      return true;
+    case (NODE_BLOCK):
+      return node->num_children && _optimizer_terminates(node->children[node->num_children - 1]);
+    case (NODE_IF):
+      return node->num_children == 3 && _optimizer_terminates(node->children[1]) && _optimizer_terminates(node->children[2]);
+    default:
+      return false;
+  }
+}
+
+// releases `node` but not `keep`, one of its children
+void _optimizer_free_except (node_t *node, node_t *keep) {
+  for (size_t i = 0; i < node->num_children; i++) {
+    if (node->children[i] == keep) {
+      node->children[i] = NULL;
+    }
+  }
+  _parser_node_free(node);
+}
+
+node_t *_optimizer_replace_with_constant (node_t *node, value_t value) {
+  node_t *constant = _parser_node_new(NODE_CONSTANT, node->token);
+  constant->constant = malloc(sizeof(value_t));
+  *constant->constant = value;
+  _parser_node_free(node);
+  return constant;
+}
+
+bool _optimizer_power (int64_t base, int64_t exponent, int64_t *result) {
+  *result = 1;
+  if (exponent < 0) {
+    return false;
+  }
+  while (exponent) {
+    if (exponent & 1 && __builtin_mul_overflow(*result, base, result)) {
+      return false;
+    }
+    exponent >>= 1;
+    if (exponent && __builtin_mul_overflow(base, base, &base)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// folds the operation the way the vm would run it; anything that would fail
+// at run time is left for the run time to report
+node_t *_optimizer_fold_binary (wtjl_context_t *ctx, node_t *node) {
+  value_type_t left = _optimizer_constant_type(node->children[0]);
+  value_type_t right = _optimizer_constant_type(node->children[1]);
+  token_type_secondary_t operator = node->token->token_type_secondary;
+  value_t value;
+  if (left == VALUE_STRING && right == VALUE_STRING && operator == OPERATOR_PLUS) {
+    value_t a = _optimizer_constant(ctx, node->children[0]);
+    value_t b = _optimizer_constant(ctx, node->children[1]);
+    return _optimizer_replace_with_constant(node, vm.concatenate(ctx, &a, &b));
+  }
+  if ((left != VALUE_INTEGER && left != VALUE_DOUBLE) || (right != VALUE_INTEGER && right != VALUE_DOUBLE)) {
+    return node;
+  }
+  value_t a = _optimizer_constant(ctx, node->children[0]);
+  value_t b = _optimizer_constant(ctx, node->children[1]);
+  if (left == VALUE_DOUBLE || right == VALUE_DOUBLE) {
+    double x = left == VALUE_DOUBLE ? a.as.number : (double) a.as.integer;
+    double y = right == VALUE_DOUBLE ? b.as.number : (double) b.as.integer;
+    value.type = VALUE_DOUBLE;
+    switch (operator) {
+      case (OPERATOR_PLUS):
+        value.as.number = x + y;
+        break;
+      case (OPERATOR_MINUS):
+        value.as.number = x - y;
+        break;
+      case (OPERATOR_STAR):
+        value.as.number = x * y;
+        break;
+      case (OPERATOR_FSLASH):
+        value.as.number = x / y;
+        break;
+      case (OPERATOR_STARSTAR):
+        value.as.number = pow(x, y);
+        break;
+      default:
+        return node;
+    }
+    return _optimizer_replace_with_constant(node, value);
+  }
+  int64_t x = a.as.integer;
+  int64_t y = b.as.integer;
+  bool failed;
+  value.type = VALUE_INTEGER;
+  switch (operator) {
+    case (OPERATOR_PLUS):
+      failed = __builtin_add_overflow(x, y, &value.as.integer);
+      break;
+    case (OPERATOR_MINUS):
+      failed = __builtin_sub_overflow(x, y, &value.as.integer);
+      break;
+    case (OPERATOR_STAR):
+      failed = __builtin_mul_overflow(x, y, &value.as.integer);
+      break;
+    case (OPERATOR_FSLASH):
+      failed = y == 0 || (x == INT64_MIN && y == -1);
+      value.as.integer = failed ? 0 : x / y;
+      break;
+    case (OPERATOR_STARSTAR):
+      failed = !_optimizer_power(x, y, &value.as.integer);
+      break;
+    default:
+      return node;
+  }
+  return failed ? node : _optimizer_replace_with_constant(node, value);
+}
+
+node_t *_optimizer_fold_unary (wtjl_context_t *ctx, node_t *node) {
+  value_type_t type = _optimizer_constant_type(node->children[0]);
+  if (type != VALUE_INTEGER && type != VALUE_DOUBLE) {
+    return node;
+  }
+  value_t value = _optimizer_constant(ctx, node->children[0]);
+  if (type == VALUE_DOUBLE) {
+    value.as.number = -value.as.number;
+  } else if (value.as.integer == INT64_MIN) {
+    return node;
+  } else {
+    value.as.integer = -value.as.integer;
+  }
+  return _optimizer_replace_with_constant(node, value);
+}
+
+// how `name` is used in `node`; `shadowed` if something in it declares the
+// name again, after which its mentions cannot be told apart
+void _optimizer_uses (node_t *node, char *name, size_t *reads, size_t *writes, bool *shadowed) {
+  if (!node) {
+    return;
+  }
+  bool named = node->token && node->token->token_type_primary == IDENTIFIER && strcmp(node->token->representation, name) == 0;
+  if (named && node->type == NODE_IDENTIFIER) {
+    // function parameters are identifiers too
+    if (node->parent && node->parent->type == NODE_FUNCTION && node != node->parent->children[node->parent->num_children - 1]) {
+      *shadowed = true;
+    } else {
+      (*reads)++;
+    }
+  } else if (named && node->type == NODE_ASSIGNMENT) {
+    (*writes)++;
+  } else if (named && (node->type == NODE_DECLARATION || node->type == NODE_ITERATE)) {
+    *shadowed = true;
+  }
+  for (size_t i = 0; i < node->num_children; i++) {
+    _optimizer_uses(node->children[i], name, reads, writes, shadowed);
+  }
+}
+
+// assignments to a removed local keep only the work of their value
+void _optimizer_drop_writes (node_t *node, char *name) {
+  if (!node) {
+    return;
+  }
+  if (node->type == NODE_ASSIGNMENT && strcmp(node->token->representation, name) == 0) {
+    node->type = NODE_EXPRESSION;
+  }
+  for (size_t i = 0; i < node->num_children; i++) {
+    _optimizer_drop_writes(node->children[i], name);
+  }
+}
+
+node_t *_optimizer_node (wtjl_context_t *ctx, node_t *node);
+
+// optimizes a block's statements in order, dropping those that do nothing,
+// locals nothing reads, and everything after a return
+void _optimizer_block (wtjl_context_t *ctx, node_t *node) {
+  optimizer_state_t *state = &ctx->optimizer;
+  size_t num_locals = state->num_locals;
+  size_t kept = 0;
+  size_t i = 0;
+  for (; i < node->num_children; i++) {
+    node_t *child = _optimizer_node(ctx, node->children[i]);
+    node->children[i] = NULL;
+    if (!child) {
+      continue;
+    }
+    child->parent = node;
+    // top level declarations are globals, which outlive the program
+    if (child->type == NODE_DECLARATION && node->type != NODE_PROGRAM) {
+      char *name = child->token->representation;
+      size_t reads = 0;
+      size_t writes = 0;
+      bool shadowed = false;
+      for (size_t j = i + 1; j < node->num_children; j++) {
+        _optimizer_uses(node->children[j], name, &reads, &writes, &shadowed);
+      }
+      if (!reads && !shadowed && (!child->num_children || _optimizer_is_pure(ctx, child->children[0]))) {
+        for (size_t j = i + 1; j < node->num_children; j++) {
+          _optimizer_drop_writes(node->children[j], name);
+        }
+        _parser_node_free(child);
+        continue;
+      }
+      _optimizer_push_local(ctx, name);
+    }
+    node->children[kept++] = child;
+    if (_optimizer_terminates(child)) {
+      i++;
+      break;
+    }
+  }
+  for (; i < node->num_children; i++) {
+    _parser_node_free(node->children[i]);
+  }
+  node->num_children = kept;
+  state->num_locals = num_locals;
+}
+
+// the optimized `node`, which may be a different node or NULL when nothing
+// is left of it; `node` itself is released if it is not returned
+node_t *_optimizer_node (wtjl_context_t *ctx, node_t *node) {
+  optimizer_state_t *state = &ctx->optimizer;
+  switch (node->type) {
+    case (NODE_PROGRAM):
+    case (NODE_BLOCK):
+      _optimizer_block(ctx, node);
+      return node;
+    case (NODE_EXPRESSION):
+      node->children[0] = _optimizer_node(ctx, node->children[0]);
+      node->children[0]->parent = node;
+      if (_optimizer_is_pure(ctx, node->children[0])) {
+        _parser_node_free(node);
+        return NULL;
+      }
+      return node;
+    case (NODE_UNARY):
+      node->children[0] = _optimizer_node(ctx, node->children[0]);
+      node->children[0]->parent = node;
+      return _optimizer_fold_unary(ctx, node);
+    case (NODE_BINARY):
+      for (size_t i = 0; i < node->num_children; i++) {
+        node->children[i] = _optimizer_node(ctx, node->children[i]);
+        node->children[i]->parent = node;
+      }
+      return _optimizer_fold_binary(ctx, node);
+    case (NODE_FUNCTION): {
+      size_t num_locals = state->num_locals;
+      size_t arity = node->num_children - 1;
+      for (size_t i = 0; i < arity; i++) {
+        _optimizer_push_local(ctx, node->children[i]->token->representation);
+      }
+      node->children[arity] = _optimizer_node(ctx, node->children[arity]);
+      node->children[arity]->parent = node;
+      state->num_locals = num_locals;
+      return node;
+    }
+    case (NODE_IF): {
+      node->children[0] = _optimizer_node(ctx, node->children[0]);
+      node->children[0]->parent = node;
+      if (_optimizer_constant_type(node->children[0]) == VALUE_BOOLEAN) {
+        node_t *taken = _optimizer_constant(ctx, node->children[0]).as.boolean ? node->children[1] : node->num_children == 3 ? node->children[2] : NULL;
+        _optimizer_free_except(node, taken);
+        return taken ? _optimizer_node(ctx, taken) : NULL;
+      }
+      for (size_t i = 1; i < node->num_children; i++) {
+        node->children[i] = _optimizer_node(ctx, node->children[i]);
+        node->children[i]->parent = node;
+      }
+      return node;
+    }
+    case (NODE_ITERATE): {
+      node->children[0] = _optimizer_node(ctx, node->children[0]);
+      node->children[0]->parent = node;
+      size_t num_locals = state->num_locals;
+      _optimizer_push_local(ctx, node->token->representation);
+      node->children[1] = _optimizer_node(ctx, node->children[1]);
+      node->children[1]->parent = node;
+      state->num_locals = num_locals;
+      return node;
+    }
+    case (NODE_DECLARATION):
+    case (NODE_ASSIGNMENT):
+    case (NODE_RETURN):
+    case (NODE_CALL):
+    case (NODE_REPEAT):
+    case (NODE_YIELD):
+    case (NODE_REDUCE):
+    case (NODE_MEMBER):
+    case (NODE_SET_MEMBER):
+    case (NODE_INDEX):
+    case (NODE_SET_INDEX):
+      for (size_t i = 0; i < node->num_children; i++) {
+        node->children[i] = _optimizer_node(ctx, node->children[i]);
+        node->children[i]->parent = node;
+      }
+      return node;
+    default:
+      return node;
+  }
+}
+
+// folds constants and removes code that cannot run or has no effect, in place
+void optimizer_optimize (wtjl_context_t *ctx, node_t *ast) {
+  size_t before = _optimizer_count(ast);
+  ctx->optimizer.num_locals = 0;
+  _optimizer_node(ctx, ast);
+  ctx->optimizer.eliminated = before - _optimizer_count(ast);
+}
+
+void optimizer_initialize (wtjl_context_t *ctx) {
+  ctx->optimizer.locals = NULL;
+  ctx->optimizer.num_locals = 0;
+  ctx->optimizer.locals_capacity = 0;
+  ctx->optimizer.eliminated = 0;
+}
+
+void optimizer_cleanup (wtjl_context_t *ctx) {
+  free(ctx->optimizer.locals);
+  ctx->optimizer.locals = NULL;
+  ctx->optimizer.num_locals = 0;
+  ctx->optimizer.locals_capacity = 0;
+}
+
+void setup_optimizer () {
+  optimizer.initialize = optimizer_initialize;
+  optimizer.cleanup = optimizer_cleanup;
+  optimizer.optimize = optimizer_optimize;
+}
+
+/* end optimizer */
+
+/* ``begin compiler */
+
+void _compiler_emit_byte (wtjl_context_t *ctx, uint8_t byte) {
+  chunk_t *chunk = &ctx->compiler.frame->function->chunk;
+  if (chunk->code_length == chunk->code_capacity) {
+    chunk->code_capacity = chunk->code_capacity ? chunk->code_capacity * 2 : 64;
+    chunk->code = realloc(chunk->code, chunk->code_capacity);
+  }
+  chunk->code[chunk->code_length++] = byte;
+}
+
+void _compiler_emit_short (wtjl_context_t *ctx, size_t operand) {
+  if (operand > UINT16_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Compiling error; too many constants, slots or globals.");
+  }
+  _compiler_emit_byte(ctx, operand & 0xff);
+  _compiler_emit_byte(ctx, (operand >> 8) & 0xff);
+}
+
+// `stack_effect` is how many values the instruction leaves on the stack
+// minus how many it takes; it is used to size each function's frame
+void _compiler_emit_op (wtjl_context_t *ctx, opcode_t op, int stack_effect) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  _compiler_emit_byte(ctx, op);
+  frame->stack_depth += stack_effect;
+  if (frame->stack_depth > frame->function->max_stack) {
+    frame->function->max_stack = frame->stack_depth;
+  }
+}
+
+// strings and bignums are pinned while the chunk holds them, where no
+// collection looks, and let go by compiler_free_function
+size_t _compiler_add_constant (wtjl_context_t *ctx, value_t value) {
+  chunk_t *chunk = &ctx->compiler.frame->function->chunk;
+  if (value.type == VALUE_STRING && value.small_length == VALUE_LARGE_STRING) {
+    // a folded rope is flattened first, so it no longer needs its halves
+    if (!value.as.string->chars) {
+      vm.string_chars(ctx, value.as.string);
+    }
+    value.as.string->pinned = true;
+  } else if (value.type == VALUE_BIGNUM) {
+    value.as.bignum->pinned = true;
+  }
+  if (chunk->constants_length == chunk->constants_capacity) {
+    chunk->constants_capacity = chunk->constants_capacity ? chunk->constants_capacity * 2 : 8;
+    chunk->constants = realloc(chunk->constants, chunk->constants_capacity * sizeof(value_t));
+  }
+  chunk->constants[chunk->constants_length] = value;
+  return chunk->constants_length++;
+}
+
+#define COMPILER_FUSED_FIRST(name, first, ...) case (name): return OP_##first;
+
+// the instruction a superinstruction's run starts with, `op` itself for any
+// other instruction
+opcode_t _compiler_unfused (opcode_t op) {
+  switch (op) {
+    VM_PAIRS(COMPILER_FUSED_FIRST)
+    VM_TRIPLES(COMPILER_FUSED_FIRST)
+    default:
+      return op;
+  }
+}
+
+// how many bytes of operands follow `op`
+size_t _compiler_operand_bytes (opcode_t op) {
+  switch (_compiler_unfused(op)) {
+    case (OP_CONSTANT):
+    case (OP_GET_LOCAL):
+    case (OP_SET_LOCAL):
+    case (OP_GET_GLOBAL):
+    case (OP_SET_GLOBAL):
+    case (OP_DEFINE_GLOBAL):
+    case (OP_JUMP):
+    case (OP_JUMP_IF_FALSE):
+    case (OP_LOOP):
+    case (OP_NEXT):
+    case (OP_GET_MEMBER):
+    case (OP_SET_MEMBER):
+    case (OP_CLOSURE):
+      return 2;
+    case (OP_GET_CAPTURE):
+    case (OP_GET_ENCLOSING):
+    case (OP_SET_ENCLOSING):
+      return 3;
+    case (OP_CALL):
+    case (OP_TAIL_CALL):
+    case (OP_CHECK):
+    case (OP_REDUCE):
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+#define COMPILER_FUSED_NAME(name, ...) [name] = #name + 3,
+
+const char *_compiler_opcode_names [VM_OPCODES] = {
+  [OP_CONSTANT] = "CONSTANT",
+  [OP_VOID] = "VOID",
+  [OP_POP] = "POP",
+  [OP_GET_LOCAL] = "GET_LOCAL",
+  [OP_SET_LOCAL] = "SET_LOCAL",
+  [OP_GET_GLOBAL] = "GET_GLOBAL",
+  [OP_SET_GLOBAL] = "SET_GLOBAL",
+  [OP_DEFINE_GLOBAL] = "DEFINE_GLOBAL",
+  [OP_NEGATE] = "NEGATE",
+  [OP_ADD] = "ADD",
+  [OP_SUBTRACT] = "SUBTRACT",
+  [OP_MULTIPLY] = "MULTIPLY",
+  [OP_DIVIDE] = "DIVIDE",
+  [OP_POWER] = "POWER",
+  [OP_CALL] = "CALL",
+  [OP_TAIL_CALL] = "TAIL_CALL",
+  [OP_RETURN] = "RETURN",
+  [OP_JUMP] = "JUMP",
+  [OP_JUMP_IF_FALSE] = "JUMP_IF_FALSE",
+  [OP_LOOP] = "LOOP",
+  [OP_LESS] = "LESS",
+  [OP_GREATER] = "GREATER",
+  [OP_EQUAL] = "EQUAL",
+  [OP_NEXT] = "NEXT",
+  [OP_YIELD] = "YIELD",
+  [OP_NEGATE_INTEGER] = "NEGATE_INTEGER",
+  [OP_ADD_INTEGER] = "ADD_INTEGER",
+  [OP_SUBTRACT_INTEGER] = "SUBTRACT_INTEGER",
+  [OP_MULTIPLY_INTEGER] = "MULTIPLY_INTEGER",
+  [OP_DIVIDE_INTEGER] = "DIVIDE_INTEGER",
+  [OP_NEGATE_DOUBLE] = "NEGATE_DOUBLE",
+  [OP_ADD_DOUBLE] = "ADD_DOUBLE",
+  [OP_SUBTRACT_DOUBLE] = "SUBTRACT_DOUBLE",
+  [OP_MULTIPLY_DOUBLE] = "MULTIPLY_DOUBLE",
+  [OP_DIVIDE_DOUBLE] = "DIVIDE_DOUBLE",
+  [OP_CONCATENATE] = "CONCATENATE",
+  [OP_CHECK] = "CHECK",
+  [OP_REDUCE] = "REDUCE",
+  [OP_NEW] = "NEW",
+  [OP_GET_MEMBER] = "GET_MEMBER",
+  [OP_SET_MEMBER] = "SET_MEMBER",
+  [OP_GET_INDEX] = "GET_INDEX",
+  [OP_SET_INDEX] = "SET_INDEX",
+  [OP_CLOSURE] = "CLOSURE",
+  [OP_GET_CAPTURE] = "GET_CAPTURE",
+  [OP_GET_ENCLOSING] = "GET_ENCLOSING",
+  [OP_SET_ENCLOSING] = "SET_ENCLOSING",
+  [OP_BOX] = "BOX",
+  [OP_GET_BOX] = "GET_BOX",
+  [OP_SET_BOX] = "SET_BOX",
+  VM_PAIRS(COMPILER_FUSED_NAME)
+  VM_TRIPLES(COMPILER_FUSED_NAME)
+};
+
+#define COMPILER_FUSED_PAIR(name, first, second) {name, 2, {OP_##first, OP_##second}},
+#define COMPILER_FUSED_TRIPLE(name, first, second, third) {name, 3, {OP_##first, OP_##second, OP_##third}},
+
+const struct {
+  opcode_t fused;
+  size_t length;
+  opcode_t run [3];
+} _compiler_superinstructions [] = {
+  VM_TRIPLES(COMPILER_FUSED_TRIPLE)
+  VM_PAIRS(COMPILER_FUSED_PAIR)
+};
+
+// bytes from the instruction at `code` to the next one the vm dispatches,
+// past the whole run of a superinstruction
+size_t _compiler_instruction_length (uint8_t *code) {
+  size_t run = 1;
+  for (size_t i = 0; i < sizeof(_compiler_superinstructions) / sizeof(_compiler_superinstructions[0]); i++) {
+    if (_compiler_superinstructions[i].fused == *code) {
+      run = _compiler_superinstructions[i].length;
+    }
+  }
+  size_t length = 0;
+  for (size_t i = 0; i < run; i++) {
+    length += 1 + _compiler_operand_bytes(code[length]);
+  }
+  return length;
+}
+
+// whether `op` may be part of a superinstruction, and as its `last`
+// instruction; calls, returns and generators change frames, and after a
+// jump the next instruction is somewhere else
+bool _compiler_fusible (opcode_t op, bool last) {
+  switch (op) {
+    case (OP_CALL):
+    case (OP_TAIL_CALL):
+    case (OP_RETURN):
+    case (OP_NEXT):
+    case (OP_YIELD):
+    case (OP_REDUCE):
+      return false;
+    case (OP_JUMP):
+    case (OP_JUMP_IF_FALSE):
+    case (OP_LOOP):
+      return last;
+    default:
+      return op < VM_FUSED;
+  }
+}
+
+// the peephole pass: rewrites the first instruction of every run in
+// `function` that is a superinstruction to its fused opcode, the earliest
+// and longest first. Only that byte changes, so the code keeps its length
+// and its jumps, and a jump into the middle of a run still finds the rest
+// of the run's instructions where they were
+void _compiler_fuse (wtjl_context_t *ctx, function_t *function) {
+  if (!ctx->arguments->superinstructions) {
+    return;
+  }
+  chunk_t *chunk = &function->chunk;
+  size_t i = 0;
+  while (i < chunk->code_length) {
+    size_t length = 1;
+    for (size_t j = 0; j < sizeof(_compiler_superinstructions) / sizeof(_compiler_superinstructions[0]) && length == 1; j++) {
+      size_t at = i;
+      size_t k = 0;
+      while (k < _compiler_superinstructions[j].length && at < chunk->code_length && chunk->code[at] == _compiler_superinstructions[j].run[k]) {
+        at += 1 + _compiler_operand_bytes(chunk->code[at]);
+        k++;
+      }
+      if (k == _compiler_superinstructions[j].length) {
+        chunk->code[i] = _compiler_superinstructions[j].fused;
+        length = k;
+      }
+    }
+    while (length--) {
+      i += 1 + _compiler_operand_bytes(chunk->code[i]);
+    }
+  }
+}
+
+void _compiler_emit_constant (wtjl_context_t *ctx, value_t value) {
+  _compiler_emit_op(ctx, OP_CONSTANT, 1);
+  _compiler_emit_short(ctx, _compiler_add_constant(ctx, value));
+}
+
+function_t *_compiler_function_new (wtjl_context_t *ctx, char *name) {
+  function_t *function = malloc(sizeof(function_t));
+  function->name = strdup(name);
+  function->arity = 0;
+  function->max_stack = 0;
+  function->generator = false;
+  function->closure = false;
+  function->released = false;
+  function->marked = false;
+  function->native = NULL;
+  function->num_captures = 0;
+  function->chunk.code = NULL;
+  function->chunk.code_length = 0;
+  function->chunk.code_capacity = 0;
+  function->chunk.constants = NULL;
+  function->chunk.constants_length = 0;
+  function->chunk.constants_capacity = 0;
+  function->chunk.caches = NULL;
+  function->chunk.num_caches = 0;
+  function->chunk.caches_capacity = 0;
+  return function;
+}
+
+void compiler_free_function (wtjl_context_t *ctx, function_t *function) {
+  if (!function) {
+    return;
+  }
+  // what the program still holds of its literals, the collector keeps
+  for (size_t i = 0; i < function->chunk.constants_length; i++) {
+    value_t *constant = &function->chunk.constants[i];
+    if (constant->type == VALUE_STRING && constant->small_length == VALUE_LARGE_STRING) {
+      constant->as.string->pinned = false;
+    } else if (constant->type == VALUE_BIGNUM) {
+      constant->as.bignum->pinned = false;
+    }
+  }
+  free(function->name);
+  free(function->chunk.code);
+  free(function->chunk.constants);
+  for (size_t i = 0; i < function->chunk.num_caches; i++) {
+    free(function->chunk.caches[i].name);
+  }
+  free(function->chunk.caches);
+  free(function);
+}
+
+void _compiler_release (function_t *function) {
+  for (size_t i = 0; i < function->chunk.constants_length; i++) {
+    if (function->chunk.constants[i].type == VALUE_FUNCTION) {
+      function->chunk.constants[i].as.function->released = true;
+      _compiler_release(function->chunk.constants[i].as.function);
+    }
+  }
+}
+
+// frees `script` and releases the functions nested in it, which the heap
+// frees too once nothing the program holds reaches them
+void compiler_discard (wtjl_context_t *ctx, function_t *script) {
+  _compiler_release(script);
+  compiler_free_function(ctx, script);
+}
+
+void _compiler_frame_push (wtjl_context_t *ctx, _compiler_frame_t *frame, function_t *function) {
+  frame->function = function;
+  frame->locals = NULL;
+  frame->num_locals = 0;
+  frame->locals_capacity = 0;
+  frame->depth = 0;
+  frame->stack_depth = 0;
+  frame->direct = false;
+  frame->captures = NULL;
+  frame->captures_capacity = 0;
+  frame->enclosing = ctx->compiler.frame;
+  ctx->compiler.frame = frame;
+}
+
+void _compiler_frame_pop (wtjl_context_t *ctx) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  free(frame->locals);
+  ctx->compiler.frame = frame->enclosing;
+}
+
+int _compiler_resolve_local (_compiler_frame_t *frame, char *name) {
+  for (int i = (int) frame->num_locals - 1; i >= 0; i--) {
+    if (strcmp(frame->locals[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void _compiler_push_local (_compiler_frame_t *frame, char *name, value_type_t type) {
+  if (frame->num_locals == frame->locals_capacity) {
+    frame->locals_capacity = frame->locals_capacity ? frame->locals_capacity * 2 : 8;
+    frame->locals = realloc(frame->locals, frame->locals_capacity * sizeof(_compiler_local_t));
+  }
+  frame->locals[frame->num_locals].name = name;
+  frame->locals[frame->num_locals].depth = frame->depth;
+  frame->locals[frame->num_locals].type = type;
+  frame->locals[frame->num_locals].boxed = false;
+  frame->locals[frame->num_locals].direct = false;
+  frame->num_locals++;
+}
+
+// whether the analysis found `binding` assigned to and carried by a closure
+// that escapes, so that its slot must hold a box the closure can share
+bool _compiler_boxed (node_t *binding) {
+  return (binding->analysis & (ANALYSIS_ASSIGNED | ANALYSIS_CAPTURED)) == (ANALYSIS_ASSIGNED | ANALYSIS_CAPTURED);
+}
+
+// `binding` is the declaration, parameter or iterate naming the local
+void _compiler_add_local (wtjl_context_t *ctx, node_t *binding, value_type_t type) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  token_t *token = binding->token;
+  for (int i = (int) frame->num_locals - 1; i >= 0 && frame->locals[i].depth == frame->depth; i--) {
+    if (strcmp(frame->locals[i].name, token->representation) == 0) {
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, token->offset, "Compiling error; \"%s\" is already declared.", token->representation);
+    }
+  }
+  _compiler_push_local(frame, token->representation, type);
+  frame->locals[frame->num_locals - 1].boxed = _compiler_boxed(binding);
+  frame->locals[frame->num_locals - 1].direct = binding->type == NODE_DECLARATION && binding->num_children && (binding->children[0]->analysis & ANALYSIS_DIRECT);
+}
+
+bool _compiler_at_global_scope (wtjl_context_t *ctx) {
+  return !ctx->compiler.frame->enclosing && ctx->compiler.frame->depth == 0;
+}
+
+value_type_t _compiler_node (wtjl_context_t *ctx, node_t *node);
+
+// how a type reads in messages, "an integer"; `type` is a value_type_t,
+// passed as an int because members are called without prototypes
+const char *compiler_type_name (int type) {
+  switch (type) {
+    case (VALUE_VOID):
+      return "void";
+    case (VALUE_INTEGER):
+    case (VALUE_BIGNUM):
+      return "an integer";
+    case (VALUE_FUNCTION):
+      return "a function";
+    case (VALUE_STRING):
+      return "a string";
+    case (VALUE_DOUBLE):
+      return "a double";
+    case (VALUE_BOOLEAN):
+      return "a boolean";
+    case (VALUE_GENERATOR):
+      return "a generator";
+    case (VALUE_OBJECT):
+      return "an object";
+    case (VALUE_ARRAY):
+      return "an array";
+    default:
+      return "undefined";
+  }
+}
+
+// the type an `as` annotation names
+value_type_t _compiler_annotation_type (wtjl_context_t *ctx, token_t *annotation) {
+  char *names [] = {"integer", "double", "boolean", "string", "function", "generator", "object", "array"};
+  value_type_t types [] = {VALUE_INTEGER, VALUE_DOUBLE, VALUE_BOOLEAN, VALUE_STRING, VALUE_FUNCTION, VALUE_GENERATOR, VALUE_OBJECT, VALUE_ARRAY};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (strcmp(annotation->representation, names[i]) == 0) {
+      return types[i];
+    }
+  }
+  wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, annotation->offset, "Compiling error; unknown type \"%s\".", annotation->representation);
+  return VALUE_UNDEFINED;
+}
+
+// makes sure the value on the stack, of type `have` so far as is known, is
+// of type `want`; when it is not known the check is left for run time
+void _compiler_check (wtjl_context_t *ctx, token_t *token, value_type_t have, value_type_t want) {
+  if (want == VALUE_UNDEFINED || have == want) {
+    return;
+  }
+  if (have != VALUE_UNDEFINED) {
+    wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, token->offset, "Compiling error; \"%s\" holds %s, not %s.", token->representation, compiler_type_name(want), compiler_type_name(have));
+  }
+  _compiler_emit_op(ctx, OP_CHECK, 0);
+  _compiler_emit_byte(ctx, want);
+}
+
+// whether anything in `node` assigns to `name`; a local nothing assigns to
+// keeps the type of its initializer
+bool _compiler_is_assigned (node_t *node, char *name) {
+  if (node->type == NODE_ASSIGNMENT && strcmp(node->token->representation, name) == 0) {
+    return true;
+  }
+  for (size_t i = 0; i < node->num_children; i++) {
+    if (_compiler_is_assigned(node->children[i], name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// how the function compiled in `frame` reaches `name`: a slot of its own, a
+// slot further out when it is direct and so runs just above the frame that
+// declared it, or a value its closure carries, which the enclosing function
+// supplies when it makes the closure
+_compiler_access_t _compiler_resolve (wtjl_context_t *ctx, _compiler_frame_t *frame, char *name) {
+  _compiler_access_t access;
+  int slot = _compiler_resolve_local(frame, name);
+  if (slot >= 0) {
+    access.kind = ACCESS_LOCAL;
+    access.depth = 0;
+    access.index = slot;
+    access.name = name;
+    access.boxed = frame->locals[slot].boxed;
+    access.type = frame->locals[slot].type;
+    return access;
+  }
+  if (!frame->enclosing) {
+    access.kind = ACCESS_GLOBAL;
+    return access;
+  }
+  access = _compiler_resolve(ctx, frame->enclosing, name);
+  if (access.kind == ACCESS_GLOBAL) {
+    return access;
+  }
+  if (frame->direct) {
+    access.kind = access.kind == ACCESS_LOCAL ? ACCESS_ENCLOSING : access.kind;
+    access.depth++;
+    if (access.depth > UINT8_MAX) {
+      wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Compiling error; functions nest too deeply.");
+    }
+    return access;
+  }
+  size_t index = 0;
+  while (index < frame->function->num_captures && strcmp(frame->captures[index].name, name) != 0) {
+    index++;
+  }
+  if (index == frame->function->num_captures) {
+    if (index == frame->captures_capacity) {
+      frame->captures_capacity = frame->captures_capacity ? frame->captures_capacity * 2 : 4;
+      frame->captures = realloc(frame->captures, frame->captures_capacity * sizeof(_compiler_access_t));
+    }
+    frame->captures[frame->function->num_captures++] = access;
+  }
+  access.kind = ACCESS_CAPTURE;
+  access.depth = 0;
+  access.index = index;
+  return access;
+}
+
+// pushes what `access` reaches, a box itself rather than what it holds
+void _compiler_emit_access (wtjl_context_t *ctx, _compiler_access_t access) {
+  switch (access.kind) {
+    case (ACCESS_LOCAL):
+      _compiler_emit_op(ctx, OP_GET_LOCAL, 1);
+      break;
+    case (ACCESS_ENCLOSING):
+      _compiler_emit_op(ctx, OP_GET_ENCLOSING, 1);
+      _compiler_emit_byte(ctx, access.depth);
+      break;
+    default:
+      _compiler_emit_op(ctx, OP_GET_CAPTURE, 1);
+      _compiler_emit_byte(ctx, access.depth);
+  }
+  _compiler_emit_short(ctx, access.index);
+}
+
+value_type_t _compiler_get_variable (wtjl_context_t *ctx, token_t *token) {
+  _compiler_access_t access = _compiler_resolve(ctx, ctx->compiler.frame, token->representation);
+  if (access.kind == ACCESS_GLOBAL) {
+    _compiler_emit_op(ctx, OP_GET_GLOBAL, 1);
+    _compiler_emit_short(ctx, vm.global_slot(ctx, token->representation));
+    // globals can be redefined by any later evaluation
+    return VALUE_UNDEFINED;
+  }
+  _compiler_emit_access(ctx, access);
+  if (access.boxed) {
+    _compiler_emit_op(ctx, OP_GET_BOX, 0);
+  }
+  return access.type;
+}
+
+void _compiler_set_variable (wtjl_context_t *ctx, token_t *token, value_type_t type) {
+  _compiler_access_t access = _compiler_resolve(ctx, ctx->compiler.frame, token->representation);
+  if (access.kind == ACCESS_GLOBAL) {
+    _compiler_emit_op(ctx, OP_SET_GLOBAL, -1);
+    _compiler_emit_short(ctx, vm.global_slot(ctx, token->representation));
+    return;
+  }
+  // only annotated locals have a type and are assigned to
+  _compiler_check(ctx, token, type, access.type);
+  if (access.boxed) {
+    _compiler_emit_access(ctx, access);
+    _compiler_emit_op(ctx, OP_SET_BOX, -2);
+    return;
+  }
+  // the analysis boxes whatever a closure carries and something assigns to
+  if (access.kind == ACCESS_CAPTURE) {
+    wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, token->offset, "Compiling error; cannot assign the captured local \"%s\".", token->representation);
+  }
+  if (access.kind == ACCESS_LOCAL) {
+    _compiler_emit_op(ctx, OP_SET_LOCAL, -1);
+  } else {
+    _compiler_emit_op(ctx, OP_SET_ENCLOSING, -1);
+    _compiler_emit_byte(ctx, access.depth);
+  }
+  _compiler_emit_short(ctx, access.index);
+}
+
+void _compiler_block (wtjl_context_t *ctx, node_t *node) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  frame->depth++;
+  for (size_t i = 0; i < node->num_children; i++) {
+    _compiler_node(ctx, node->children[i]);
+  }
+  while (frame->num_locals && frame->locals[frame->num_locals - 1].depth == frame->depth) {
+    _compiler_emit_op(ctx, OP_POP, -1);
+    frame->num_locals--;
+  }
+  frame->depth--;
+}
+
+void _compiler_declaration (wtjl_context_t *ctx, node_t *node) {
+  value_type_t type = VALUE_VOID;
+  if (node->num_children) {
+    type = _compiler_node(ctx, node->children[0]);
+  } else {
+    _compiler_emit_op(ctx, OP_VOID, 1);
+  }
+  if (node->annotation) {
+    value_type_t annotated = _compiler_annotation_type(ctx, node->annotation);
+    _compiler_check(ctx, node->token, type, annotated);
+    type = annotated;
+  } else if (_compiler_is_assigned(node->parent, node->token->representation)) {
+    type = VALUE_UNDEFINED;
+  }
+  if (_compiler_at_global_scope(ctx)) {
+    _compiler_emit_op(ctx, OP_DEFINE_GLOBAL, -1);
+    _compiler_emit_short(ctx, vm.global_slot(ctx, node->token->representation));
+    return;
+  }
+  // the initializer's value stays on the stack as the local's slot
+  _compiler_add_local(ctx, node, type);
+  if (ctx->compiler.frame->locals[ctx->compiler.frame->num_locals - 1].boxed) {
+    _compiler_emit_op(ctx, OP_BOX, 0);
+  }
+}
+
+// the value a literal token stands for; strings are built in the context
+value_t compiler_literal (wtjl_context_t *ctx, token_t *token) {
+  value_t value;
+  switch (token->token_type_secondary) {
+    case (LITERAL_QUOTE_D):
+    case (LITERAL_QUOTE_B): {
+      // copied once, as the source does not outlive compilation; a small
+      // string is decoded into the value, a large one keeps its escapes
+      const char *chars = tokenizer.text(ctx, token) + 1;
+      size_t length = token->length - 2;
+      value.type = VALUE_STRING;
+      if (length <= VALUE_SMALL_STRING) {
+        value.small_length = 0;
+        for (size_t i = 0; i < length; i++) {
+          value.small[value.small_length++] = chars[i] == '\\' ? tokenizer.escape(chars[++i]) : chars[i];
+        }
+        break;
+      }
+      value.small_length = VALUE_LARGE_STRING;
+      value.as.string = vm.new_string(ctx, chars, length);
+      value.as.string->escaped = memchr(chars, '\\', length) != NULL;
+      ctx->vm.num_escaped += value.as.string->escaped;
+      break;
+    }
+    case (LITERAL_QUOTE_S): {
+      // the tokenizer has checked it holds exactly one character
+      const char *chars = tokenizer.text(ctx, token) + 1;
+      value.type = VALUE_INTEGER;
+      value.as.integer = (unsigned char) (chars[0] == '\\' ? tokenizer.escape(chars[1]) : chars[0]);
+      break;
+    }
+    case (LITERAL_BIG_INTEGER): {
+      const char *chars = tokenizer.text(ctx, token);
+      int bits = chars[0] == '0' && token->length > 2 ? ((chars[1] | 0x20) == 'x' ? 4 : (chars[1] | 0x20) == 'b' ? 1 : 0) : 0;
+      value = vm.bignum(ctx, bits ? bignums.from_radix(chars + 2, (size_t) token->length - 2, bits) : bignums.from_decimal(chars, (size_t) token->length));
+      break;
+    }
+    case (LITERAL_DOUBLE):
+      value.type = VALUE_DOUBLE;
+      value.as.number = token->as.number;
+      break;
+    case (LITERAL_BOOLEAN):
+      value.type = VALUE_BOOLEAN;
+      value.as.boolean = token->as.integer;
+      break;
+    default:
+      value.type = VALUE_INTEGER;
+      value.as.integer = token->as.integer;
+  }
+  return value;
+}
+
+// jumps are emitted with a placeholder distance, patched once the target is known
+size_t _compiler_emit_jump (wtjl_context_t *ctx, opcode_t op, int stack_effect) {
+  _compiler_emit_op(ctx, op, stack_effect);
+  _compiler_emit_short(ctx, 0);
+  return ctx->compiler.frame->function->chunk.code_length - 2;
+}
+
+void _compiler_patch_jump (wtjl_context_t *ctx, size_t at) {
+  chunk_t *chunk = &ctx->compiler.frame->function->chunk;
+  size_t distance = chunk->code_length - (at + 2);
+  if (distance > UINT16_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Compiling error; too much code to jump over.");
+  }
+  chunk->code[at] = distance & 0xff;
+  chunk->code[at + 1] = (distance >> 8) & 0xff;
+}
+
+void _compiler_emit_loop (wtjl_context_t *ctx, size_t start) {
+  _compiler_emit_op(ctx, OP_LOOP, 0);
+  size_t distance = ctx->compiler.frame->function->chunk.code_length + 2 - start;
+  if (distance > UINT16_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Compiling error; too much code to jump over.");
+  }
+  _compiler_emit_short(ctx, distance);
+}
+
+void _compiler_repeat (wtjl_context_t *ctx, node_t *node) {
+  size_t start = ctx->compiler.frame->function->chunk.code_length;
+  _compiler_block(ctx, node->children[0]);
+  _compiler_emit_loop(ctx, start);
+}
+
+// the generator stays on the stack in a local no name can reach, and each
+// value it yields is pushed into the slot above it for the block to read
+void _compiler_iterate (wtjl_context_t *ctx, node_t *node) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  frame->depth++;
+  _compiler_node(ctx, node->children[0]);
+  _compiler_push_local(frame, "", VALUE_GENERATOR);
+  size_t start = frame->function->chunk.code_length;
+  size_t exit = _compiler_emit_jump(ctx, OP_NEXT, 1);
+  _compiler_add_local(ctx, node, VALUE_UNDEFINED);
+  if (frame->locals[frame->num_locals - 1].boxed) {
+    _compiler_emit_op(ctx, OP_BOX, 0);
+  }
+  _compiler_block(ctx, node->children[1]);
+  _compiler_emit_op(ctx, OP_POP, -1);
+  frame->num_locals--;
+  _compiler_emit_loop(ctx, start);
+  // where a finished generator leaves the loop, with nothing pushed
+  _compiler_patch_jump(ctx, exit);
+  _compiler_emit_op(ctx, OP_POP, -1);
+  frame->num_locals--;
+  frame->depth--;
+}
+
+// whether `node` yields; functions in it yield for themselves
+bool _compiler_yields (node_t *node) {
+  if (node->type == NODE_YIELD) {
+    return true;
+  }
+  if (node->type == NODE_FUNCTION) {
+    return false;
+  }
+  for (size_t i = 0; i < node->num_children; i++) {
+    if (_compiler_yields(node->children[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void _compiler_if (wtjl_context_t *ctx, node_t *node) {
+  _compiler_node(ctx, node->children[0]);
+  size_t skip_block = _compiler_emit_jump(ctx, OP_JUMP_IF_FALSE, -1);
+  _compiler_block(ctx, node->children[1]);
+  if (node->num_children < 3) {
+    _compiler_patch_jump(ctx, skip_block);
+    return;
+  }
+  size_t skip_alternative = _compiler_emit_jump(ctx, OP_JUMP, 0);
+  _compiler_patch_jump(ctx, skip_block);
+  _compiler_node(ctx, node->children[2]);
+  _compiler_patch_jump(ctx, skip_alternative);
+}
+
+value_type_t _compiler_unary (wtjl_context_t *ctx, node_t *node) {
+  value_type_t type = _compiler_node(ctx, node->children[0]);
+  if (type == VALUE_INTEGER) {
+    _compiler_emit_op(ctx, OP_NEGATE_INTEGER, 0);
+  } else if (type == VALUE_DOUBLE) {
+    _compiler_emit_op(ctx, OP_NEGATE_DOUBLE, 0);
+  } else {
+    _compiler_emit_op(ctx, OP_NEGATE, 0);
+    return VALUE_UNDEFINED;
+  }
+  return type;
+}
+
+// operators come in a generic form and, for +, -, * and /, one for two
+// integers and one for two doubles; operands of other types, or of types not
+// known until run time, take the generic one
+value_type_t _compiler_binary (wtjl_context_t *ctx, node_t *node) {
+  value_type_t left = _compiler_node(ctx, node->children[0]);
+  value_type_t right = _compiler_node(ctx, node->children[1]);
+  bool integers = left == VALUE_INTEGER && right == VALUE_INTEGER;
+  bool doubles = left == VALUE_DOUBLE && right == VALUE_DOUBLE;
+  bool numbers = (left == VALUE_INTEGER || left == VALUE_DOUBLE) && (right == VALUE_INTEGER || right == VALUE_DOUBLE);
+  opcode_t op;
+  switch (node->token->token_type_secondary) {
+    case (OPERATOR_LESS):
+      _compiler_emit_op(ctx, OP_LESS, -1);
+      return VALUE_BOOLEAN;
+    case (OPERATOR_GREATER):
+      _compiler_emit_op(ctx, OP_GREATER, -1);
+      return VALUE_BOOLEAN;
+    case (OPERATOR_EQUAL):
+      _compiler_emit_op(ctx, OP_EQUAL, -1);
+      return VALUE_BOOLEAN;
+    case (OPERATOR_PLUS):
+      if (left == VALUE_STRING && right == VALUE_STRING) {
+        _compiler_emit_op(ctx, OP_CONCATENATE, -1);
+        return VALUE_STRING;
+      }
+      op = integers ? OP_ADD_INTEGER : doubles ? OP_ADD_DOUBLE : OP_ADD;
+      break;
+    case (OPERATOR_MINUS):
+      op = integers ? OP_SUBTRACT_INTEGER : doubles ? OP_SUBTRACT_DOUBLE : OP_SUBTRACT;
+      break;
+    case (OPERATOR_STAR):
+      op = integers ? OP_MULTIPLY_INTEGER : doubles ? OP_MULTIPLY_DOUBLE : OP_MULTIPLY;
+      break;
+    case (OPERATOR_FSLASH):
+      op = integers ? OP_DIVIDE_INTEGER : doubles ? OP_DIVIDE_DOUBLE : OP_DIVIDE;
+      break;
+    case (OPERATOR_STARSTAR):
+      op = OP_POWER;
+      break;
+    default:
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, node->token->offset, "Compiling error; unknown operator \"%s\".", node->token->representation);
+      return VALUE_UNDEFINED;
+  }
+  _compiler_emit_op(ctx, op, -1);
+  if (integers) {
+    return VALUE_INTEGER;
+  }
+  // integers widen when either side is a double
+  return numbers ? VALUE_DOUBLE : VALUE_UNDEFINED;
+}
+
+// whether a call in tail position in the function being compiled may
+// replace its frame: not in a generator, whose frame has to finish it, and
+// not of a direct function, which needs the frame below to be this one
+bool _compiler_tail_call (wtjl_context_t *ctx, node_t *call) {
+  _compiler_frame_t *frame = ctx->compiler.frame;
+  if (call->type != NODE_CALL || !frame->enclosing || frame->function->generator) {
+    return false;
+  }
+  node_t *callee = call->children[0];
+  if (callee->type == NODE_IDENTIFIER) {
+    int slot = _compiler_resolve_local(frame, callee->token->representation);
+    return slot < 0 || !frame->locals[slot].direct;
+  }
+  return true;
+}
+
+void _compiler_call (wtjl_context_t *ctx, node_t *node, bool tail) {
+  size_t num_arguments = node->num_children - 1;
+  if (num_arguments > UINT8_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_COMPILE, "Compiling error; too many arguments.");
+  }
+  for (size_t i = 0; i < node->num_children; i++) {
+    _compiler_node(ctx, node->children[i]);
+  }
+  _compiler_emit_op(ctx, tail ? OP_TAIL_CALL : OP_CALL, -(int) num_arguments);
+  _compiler_emit_byte(ctx, num_arguments);
+}
+
+// compiles the value a function returns, as a tail call where it is one
+void _compiler_returned (wtjl_context_t *ctx, node_t *node) {
+  if (_compiler_tail_call(ctx, node)) {
+    _compiler_call(ctx, node, true);
+    return;
+  }
+  _compiler_node(ctx, node);
+}
+
+void _compiler_register_function (wtjl_context_t *ctx, function_t *function) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_functions == state->functions_capacity) {
+    state->functions_capacity = state->functions_capacity ? state->functions_capacity * 2 : 8;
+    state->functions = realloc(state->functions, state->functions_capacity * sizeof(function_t *));
+  }
+  state->functions[state->num_functions++] = function;
+}
+
+void _compiler_function (wtjl_context_t *ctx, node_t *node) {
+  char *name = "<function>";
+  if (node->parent && node->parent->type == NODE_DECLARATION) {
+    name = node->parent->token->representation;
+  } else if (node->parent && node->parent->type == NODE_REDUCE) {
+    name = "<iterate>";
+  }
+  function_t *function = _compiler_function_new(ctx, name);
+  _compiler_register_function(ctx, function);
+  _compiler_frame_t frame;
+  _compiler_frame_push(ctx, &frame, function);
+  frame.direct = node->analysis & ANALYSIS_DIRECT;
+  function->arity = node->num_children - 1;
+  function->generator = _compiler_yields(node->children[function->arity]);
+  for (size_t i = 0; i < function->arity; i++) {
+    token_t *annotation = node->children[i]->annotation;
+    _compiler_add_local(ctx, node->children[i], annotation ? _compiler_annotation_type(ctx, annotation) : VALUE_UNDEFINED);
+  }
+  frame.stack_depth = function->arity;
+  function->max_stack = function->arity;
+  // annotated parameters are checked once, on entry, so the body can rely on them
+  for (size_t i = 0; i < function->arity; i++) {
+    if (frame.locals[i].type != VALUE_UNDEFINED) {
+      _compiler_emit_op(ctx, OP_GET_LOCAL, 1);
+      _compiler_emit_short(ctx, i);
+      _compiler_check(ctx, node->children[i]->token, VALUE_UNDEFINED, frame.locals[i].type);
+      _compiler_emit_op(ctx, OP_POP, -1);
+    }
+  }
+  for (size_t i = 0; i < function->arity; i++) {
+    if (frame.locals[i].boxed) {
+      _compiler_emit_op(ctx, OP_GET_LOCAL, 1);
+      _compiler_emit_short(ctx, i);
+      _compiler_emit_op(ctx, OP_BOX, 0);
+      _compiler_emit_op(ctx, OP_SET_LOCAL, -1);
+      _compiler_emit_short(ctx, i);
+    }
+  }
+  node_t *body = node->children[function->arity];
+  if (body->type == NODE_BLOCK) {
+    _compiler_block(ctx, body);
+    _compiler_emit_op(ctx, OP_VOID, 1);
+  } else {
+    _compiler_returned(ctx, body);
+  }
+  _compiler_emit_op(ctx, OP_RETURN, -1);
+  _compiler_fuse(ctx, function);
+  _compiler_frame_pop(ctx);
+  value_t value;
+  value.type = VALUE_FUNCTION;
+  value.as.function = function;
+  if (!function->num_captures) {
+    _compiler_emit_constant(ctx, value);
+    return;
+  }
+  // a closure carries its captures flat, copied or boxed, so a call never
+  // has to walk out to find them
+  for (size_t i = 0; i < function->num_captures; i++) {
+    _compiler_emit_access(ctx, frame.captures[i]);
+  }
+  free(frame.captures);
+  _compiler_emit_op(ctx, OP_CLOSURE, 1 - (int) function->num_captures);
+  _compiler_emit_short(ctx, _compiler_add_constant(ctx, value));
+}
+
+// a new, empty cache for a `::` site of the function being compiled
+void _compiler_emit_member (wtjl_context_t *ctx, opcode_t op, int stack_effect, token_t *name) {
+  chunk_t *chunk = &ctx->compiler.frame->function->chunk;
+  if (chunk->num_caches == chunk->caches_capacity) {
+    chunk->caches_capacity = chunk->caches_capacity ? chunk->caches_capacity * 2 : 4;
+    chunk->caches = realloc(chunk->caches, chunk->caches_capacity * sizeof(member_cache_t));
+  }
+  member_cache_t *cache = &chunk->caches[chunk->num_caches];
+  cache->name = strdup(name->representation);
+  cache->num_shapes = 0;
+  _compiler_emit_op(ctx, op, stack_effect);
+  _compiler_emit_short(ctx, chunk->num_caches++);
+}
+
+// the bounds and the function are left on the stack for OP_REDUCE, or an
+// array and void in place of the bounds; a sum is 0 when the range is empty,
+// so only its type is not known
+void _compiler_reduce (wtjl_context_t *ctx, node_t *node) {
+  char *names [] = {"sum", "min", "max"};
+  reduction_t reduction = 0;
+  while (strcmp(names[reduction], node->token->representation) != 0) {
+    if (++reduction == sizeof(names) / sizeof(names[0])) {
+      wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, node->token->offset, "Compiling error; unknown reduction \"%s\".", node->token->representation);
+    }
+  }
+  _compiler_node(ctx, node->children[0]);
+  if (node->num_children == 2) {
+    _compiler_emit_op(ctx, OP_VOID, 1);
+  }
+  for (size_t i = 1; i < node->num_children; i++) {
+    _compiler_node(ctx, node->children[i]);
+  }
+  _compiler_emit_op(ctx, OP_REDUCE, -2);
+  _compiler_emit_byte(ctx, reduction);
+}
+
+// compiles `node`, returning the type of the value it leaves when that is
+// known, VALUE_UNDEFINED otherwise
+value_type_t _compiler_node (wtjl_context_t *ctx, node_t *node) {
+  switch (node->type) {
+    case (NODE_PROGRAM):
+    case (NODE_BLOCK):
+      _compiler_block(ctx, node);
+      break;
+    case (NODE_DECLARATION):
+      _compiler_declaration(ctx, node);
+      break;
+    case (NODE_ASSIGNMENT):
+      _compiler_set_variable(ctx, node->token, _compiler_node(ctx, node->children[0]));
+      break;
+    case (NODE_RETURN):
+      // at the top level it ends the script, which is how a top level
+      // repeat stops; what it returns is thrown away, so it is no tail call
+      if (node->num_children && !ctx->compiler.frame->enclosing) {
+        _compiler_node(ctx, node->children[0]);
+      } else if (node->num_children) {
+        _compiler_returned(ctx, node->children[0]);
+      } else {
+        _compiler_emit_op(ctx, OP_VOID, 1);
+      }
+      _compiler_emit_op(ctx, OP_RETURN, -1);
+      break;
+    case (NODE_IMPORT):
+      // the loader has already run the file by the time this one compiles
+      if (!_compiler_at_global_scope(ctx)) {
+        wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, node->token->offset, "Compiling error; imports belong at the top level.");
+      }
+      if (!ctx->loader.compiling) {
+        wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, node->token->offset, "Compiling error; imports are only resolved in programs run from a file.");
+      }
+      break;
+    case (NODE_YIELD):
+      if (!ctx->compiler.frame->enclosing) {
+        wtjl_context_t_fail_at(ctx, WTJL_ERROR_COMPILE, node->token->offset, "Compiling error; yield outside of a function.");
+      }
+      _compiler_node(ctx, node->children[0]);
+      _compiler_emit_op(ctx, OP_YIELD, -1);
+      break;
+    case (NODE_REPEAT):
+      _compiler_repeat(ctx, node);
+      break;
+    case (NODE_ITERATE):
+      _compiler_iterate(ctx, node);
+      break;
+    case (NODE_EXPRESSION):
+      _compiler_node(ctx, node->children[0]);
+      _compiler_emit_op(ctx, OP_POP, -1);
+      break;
+    case (NODE_LITERAL): {
+      value_t value = compiler_literal(ctx, node->token);
+      _compiler_emit_constant(ctx, value);
+      return value.type;
+    }
+    case (NODE_CONSTANT):
+      _compiler_emit_constant(ctx, *node->constant);
+      return node->constant->type;
+    case (NODE_IF):
+      _compiler_if(ctx, node);
+      break;
+    case (NODE_IDENTIFIER):
+      return _compiler_get_variable(ctx, node->token);
+    case (NODE_UNARY):
+      return _compiler_unary(ctx, node);
+    case (NODE_BINARY):
+      return _compiler_binary(ctx, node);
+    case (NODE_CALL):
+      _compiler_call(ctx, node, false);
+      break;
+    case (NODE_FUNCTION):
+      _compiler_function(ctx, node);
+      return VALUE_FUNCTION;
+    case (NODE_REDUCE):
+      _compiler_reduce(ctx, node);
+      break;
+    case (NODE_NEW):
+      _compiler_emit_op(ctx, OP_NEW, 1);
+      return VALUE_OBJECT;
+    case (NODE_MEMBER):
+      _compiler_node(ctx, node->children[0]);
+      _compiler_emit_member(ctx, OP_GET_MEMBER, 0, node->token);
+      break;
+    case (NODE_SET_MEMBER):
+      _compiler_node(ctx, node->children[0]);
+      _compiler_node(ctx, node->children[1]);
+      _compiler_emit_member(ctx, OP_SET_MEMBER, -2, node->token);
+      break;
+    case (NODE_INDEX):
+      _compiler_node(ctx, node->children[0]);
+      _compiler_node(ctx, node->children[1]);
+      _compiler_emit_op(ctx, OP_GET_INDEX, -1);
+      break;
+    case (NODE_SET_INDEX):
+      for (size_t i = 0; i < node->num_children; i++) {
+        _compiler_node(ctx, node->children[i]);
+      }
+      _compiler_emit_op(ctx, OP_SET_INDEX, -3);
+      break;
+  }
+  return VALUE_UNDEFINED;
+}
+
+void _compiler_bind (wtjl_context_t *ctx, char *name, node_t *node) {
+  compiler_state_t *state = &ctx->compiler;
+  if (state->num_bindings == state->bindings_capacity) {
+    state->bindings_capacity = state->bindings_capacity ? state->bindings_capacity * 2 : 16;
+    state->bindings = realloc(state->bindings, state->bindings_capacity * sizeof(_compiler_binding_t));
+  }
+  _compiler_binding_t *binding = &state->bindings[state->num_bindings++];
+  binding->name = name;
+  binding->node = node;
+  binding->level = state->num_functions;
+}
+
+// records a read of, or with `assigned` an assignment to, the name `node`
+// holds; the first pass finds what is assigned and what escapes, the second,
+// knowing which functions are direct, what closures carry
+void _compiler_analyze_use (wtjl_context_t *ctx, node_t *node, int pass, bool assigned) {
+  compiler_state_t *state = &ctx->compiler;
+  _compiler_binding_t *binding = NULL;
+  for (size_t i = state->num_bindings; i > 0 && !binding; i--) {
+    if (strcmp(state->bindings[i - 1].name, node->token->representation) == 0) {
+      binding = &state->bindings[i - 1];
+    }
+  }
+  if (!binding) {
+    return;
+  }
+  if (pass == 1) {
+    bool called = !assigned && node->parent->type == NODE_CALL && node->parent->children[0] == node;
+    binding->node->analysis |= assigned ? ANALYSIS_ASSIGNED : 0;
+    binding->node->analysis |= binding->level != state->num_functions || !called ? ANALYSIS_ESCAPES : 0;
+    return;
+  }
+  // reached through a function that escapes, the value is carried by its closure
+  for (size_t i = binding->level; i < state->num_functions; i++) {
+    if (!(state->functions[i]->analysis & ANALYSIS_DIRECT)) {
+      binding->node->analysis |= ANALYSIS_CAPTURED;
+    }
+  }
+}
+
+// walks `node` with the scopes the compiler will see, `depth` blocks into
+// the innermost function, or into the program where depth 0 holds globals
+void _compiler_analyze (wtjl_context_t *ctx, node_t *node, int pass, size_t depth) {
+  compiler_state_t *state = &ctx->compiler;
+  size_t num_bindings = state->num_bindings;
+  switch (node->type) {
+    case (NODE_BLOCK):
+      for (size_t i = 0; i < node->num_children; i++) {
+        _compiler_analyze(ctx, node->children[i], pass, depth + 1);
+      }
+      state->num_bindings = num_bindings;
+      return;
+    case (NODE_DECLARATION):
+      node->analysis = pass == 1 ? 0 : node->analysis;
+      if (node->num_children) {
+        _compiler_analyze(ctx, node->children[0], pass, depth);
+      }
+      if (state->num_functions || depth) {
+        node->analysis |= ANALYSIS_LOCAL;
+        _compiler_bind(ctx, node->token->representation, node);
+      }
+      return;
+    case (NODE_IDENTIFIER):
+      _compiler_analyze_use(ctx, node, pass, false);
+      return;
+    case (NODE_ASSIGNMENT):
+      _compiler_analyze(ctx, node->children[0], pass, depth);
+      _compiler_analyze_use(ctx, node, pass, true);
+      return;
+    case (NODE_ITERATE):
+      node->analysis = pass == 1 ? 0 : node->analysis;
+      _compiler_analyze(ctx, node->children[0], pass, depth + 1);
+      _compiler_bind(ctx, node->token->representation, node);
+      _compiler_analyze(ctx, node->children[1], pass, depth + 1);
+      state->num_bindings = num_bindings;
+      return;
+    case (NODE_FUNCTION): {
+      size_t arity = node->num_children - 1;
+      node_t *parent = node->parent;
+      if (pass == 1) {
+        node->analysis = 0;
+      } else if (parent && parent->type == NODE_DECLARATION && (parent->analysis & ANALYSIS_LOCAL) && !(parent->analysis & ANALYSIS_ESCAPES) && !_compiler_yields(node->children[arity])) {
+        // called only where its local is in scope, by the function that
+        // declared it, so that function's frame is always just below its own
+        node->analysis |= ANALYSIS_DIRECT;
+      }
+      if (state->num_functions == state->functions_capacity) {
+        state->functions_capacity = state->functions_capacity ? state->functions_capacity * 2 : 8;
+        state->functions = realloc(state->functions, state->functions_capacity * sizeof(node_t *));
+      }
+      state->functions[state->num_functions++] = node;
+      for (size_t i = 0; i < arity; i++) {
+        node->children[i]->analysis = pass == 1 ? 0 : node->children[i]->analysis;
+        _compiler_bind(ctx, node->children[i]->token->representation, node->children[i]);
+      }
+      _compiler_analyze(ctx, node->children[arity], pass, 0);
+      state->num_functions--;
+      state->num_bindings = num_bindings;
+      return;
+    }
+    default:
+      for (size_t i = 0; i < node->num_children; i++) {
+        _compiler_analyze(ctx, node->children[i], pass, depth);
+      }
+  }
+}
+
+// compiles a program into a function of no arguments; the caller owns it
+function_t *compiler_compile (wtjl_context_t *ctx, node_t *ast) {
+  // which locals closures capture, and which functions never escape, is
+  // settled for the whole program before any of it is compiled
+  for (int pass = 1; pass <= 2; pass++) {
+    ctx->compiler.num_bindings = 0;
+    ctx->compiler.num_functions = 0;
+    for (size_t i = 0; i < ast->num_children; i++) {
+      _compiler_analyze(ctx, ast->children[i], pass, 0);
+    }
+  }
+  function_t *script = _compiler_function_new(ctx, "<script>");
+  _compiler_frame_t frame;
+  ctx->compiler.frame = NULL;
+  _compiler_frame_push(ctx, &frame, script);
+  // top level statements are compiled at depth 0 so their declarations are globals
+  for (size_t i = 0; i < ast->num_children; i++) {
+    _compiler_node(ctx, ast->children[i]);
+  }
+  _compiler_emit_op(ctx, OP_VOID, 1);
+  _compiler_emit_op(ctx, OP_RETURN, -1);
+  _compiler_fuse(ctx, script);
+  _compiler_frame_pop(ctx);
+  return script;
+}
+
+void compiler_initialize (wtjl_context_t *ctx) {
+  ctx->compiler.frame = NULL;
+  ctx->compiler.bindings = NULL;
+  ctx->compiler.num_bindings = 0;
+  ctx->compiler.bindings_capacity = 0;
+  ctx->compiler.functions = NULL;
+  ctx->compiler.num_functions = 0;
+  ctx->compiler.functions_capacity = 0;
+}
+
+void compiler_cleanup (wtjl_context_t *ctx) {
+  ctx->compiler.frame = NULL;
+  free(ctx->compiler.bindings);
+  free(ctx->compiler.functions);
+  ctx->compiler.bindings = NULL;
+  ctx->compiler.functions = NULL;
+  ctx->compiler.bindings_capacity = 0;
+  ctx->compiler.functions_capacity = 0;
+}
+
+void setup_compiler () {
+  compiler.initialize = compiler_initialize;
+  compiler.cleanup = compiler_cleanup;
+  compiler.compile = compiler_compile;
+  compiler.free_function = compiler_free_function;
+  compiler.discard = compiler_discard;
+  compiler.literal = compiler_literal;
+  compiler.type_name = compiler_type_name;
+}
+
+/* end compiler */
+
+/* ``begin vm */
+
+// the stack and the frames start small and double as calls nest deeper,
+// up to the limits past which a call is a stack overflow
+#define VM_STACK_CAPACITY 256
+#define VM_STACK_MAX (1 << 22)
+#define VM_FRAMES_CAPACITY 64
+#define VM_FRAMES_MAX (1 << 20)
+#define VM_BIGNUM_MAX_BITS ((uint64_t) 1 << 30)
+
+#define VM_READ_BYTE() (*ip++)
+#define VM_READ_SHORT() (ip += 2, (uint16_t) (ip[-2] | (ip[-1] << 8)))
+
+int vm_find_global (wtjl_context_t *ctx, const char *name) {
+  for (size_t i = 0; i < ctx->vm.num_globals; i++) {
+    if (strcmp(ctx->vm.global_names[i], name) == 0) {
+      return (int) i;
+    }
+  }
+  return -1;
+}
+
+// globals are resolved to slots at compile time; a slot exists from its first
+// mention and is undefined until its declaration runs
+size_t vm_global_slot (wtjl_context_t *ctx, const char *name) {
+  int slot = vm_find_global(ctx, name);
+  if (slot >= 0) {
+    return (size_t) slot;
+  }
+  vm_state_t *state = &ctx->vm;
+  if (state->num_globals == state->globals_capacity) {
+    state->globals_capacity = state->globals_capacity ? state->globals_capacity * 2 : 16;
+    state->globals = realloc(state->globals, state->globals_capacity * sizeof(value_t));
+    state->global_names = realloc(state->global_names, state->globals_capacity * sizeof(char *));
+  }
+  state->globals[state->num_globals].type = VALUE_UNDEFINED;
+  state->global_names[state->num_globals] = strdup(name);
+  return state->num_globals++;
+}
+
+#define STRING_ROPE_MIN 64 // shorter concatenations are copied rather than joined
+
+string_t *_vm_track_string (wtjl_context_t *ctx, string_t *string) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_strings == state->strings_capacity) {
+    state->strings_capacity = state->strings_capacity ? state->strings_capacity * 2 : 8;
+    state->strings = realloc(state->strings, state->strings_capacity * sizeof(string_t *));
+  }
+  state->strings[state->num_strings++] = string;
+  string->marked = false;
+  string->pinned = false;
+  return string;
+}
+
+// strings live as long as the context, like functions; without `chars` the
+// caller fills them in
+string_t *vm_new_string (wtjl_context_t *ctx, const char *chars, size_t length) {
+  string_t *string = _vm_track_string(ctx, malloc(sizeof(string_t) + length + 1));
+  string->length = length;
+  string->hash = 0;
+  string->escaped = false;
+  string->rope = false;
+  string->chars = (char *) (string + 1);
+  if (chars) {
+    memcpy(string->chars, chars, length);
+  }
+  string->chars[length] = '\0';
+  return string;
+}
+
+value_t *_vm_rope_halves (string_t *rope) {
+  return (value_t *) (rope + 1);
+}
+
+// the chars a rope joins, written from the right, so that the long chains of
+// appends a loop makes, which lean left, are walked with no stack to speak of
+char *_vm_flatten (string_t *rope) {
+  char *chars = malloc(rope->length + 1);
+  chars[rope->length] = '\0';
+  size_t end = rope->length;
+  size_t capacity = 8;
+  size_t num_pending = 2;
+  value_t **pending = malloc(capacity * sizeof(value_t *));
+  pending[0] = &_vm_rope_halves(rope)[0];
+  pending[1] = &_vm_rope_halves(rope)[1];
+  while (num_pending) {
+    value_t *value = pending[--num_pending];
+    if (value->small_length != VALUE_LARGE_STRING) {
+      end -= value->small_length;
+      memcpy(chars + end, value->small, value->small_length);
+    } else if (value->as.string->chars) {
+      end -= value->as.string->length;
+      memcpy(chars + end, value->as.string->chars, value->as.string->length);
+    } else {
+      if (num_pending + 2 > capacity) {
+        capacity *= 2;
+        pending = realloc(pending, capacity * sizeof(value_t *));
+      }
+      pending[num_pending++] = &_vm_rope_halves(value->as.string)[0];
+      pending[num_pending++] = &_vm_rope_halves(value->as.string)[1];
+    }
+  }
+  free(pending);
+  return chars;
+}
+
+// decodes a literal's escapes the first time it is read, in place as decoding
+// only ever shortens it, and flattens a rope the first time it is read; a
+// lane flattens into chars of its own, as the rope may be shared
+const char *vm_string_chars (wtjl_context_t *ctx, string_t *string) {
+  if (string->escaped) {
+    size_t length = 0;
+    for (size_t i = 0; i < string->length; i++) {
+      string->chars[length++] = string->chars[i] == '\\' ? tokenizer.escape(string->chars[++i]) : string->chars[i];
+    }
+    string->chars[length] = '\0';
+    string->length = length;
+    string->escaped = false;
+    ctx->vm.num_escaped--;
+  }
+  if (!string->chars) {
+    char *chars = _vm_flatten(string);
+    if (ctx->vm.lane) {
+      return chars;
+    }
+    string->chars = chars;
+  }
+  return string->chars;
+}
+
+// builtins are ordinary globals, so a program may replace them
+void vm_define_natives (wtjl_context_t *ctx, function_t *natives, size_t num_natives) {
+  for (size_t i = 0; i < num_natives; i++) {
+    size_t slot = vm_global_slot(ctx, natives[i].name);
+    ctx->vm.globals[slot].type = VALUE_FUNCTION;
+    ctx->vm.globals[slot].as.function = &natives[i];
+  }
+}
+
+// a string value, in the value itself when it is short enough
+value_t vm_string (wtjl_context_t *ctx, const char *chars, size_t length) {
+  value_t value;
+  value.type = VALUE_STRING;
+  if (length <= VALUE_SMALL_STRING) {
+    value.small_length = (uint8_t) length;
+    memcpy(value.small, chars, length);
+    return value;
+  }
+  value.small_length = VALUE_LARGE_STRING;
+  value.as.string = vm_new_string(ctx, chars, length);
+  return value;
+}
+
+// a string's length, without flattening it
+size_t vm_string_length (wtjl_context_t *ctx, value_t *value) {
+  if (value->small_length != VALUE_LARGE_STRING) {
+    return value->small_length;
+  }
+  if (value->as.string->escaped) {
+    vm_string_chars(ctx, value->as.string);
+  }
+  return value->as.string->length;
+}
+
+// the chars of a string value, `length` of them; a small string's are in the
+// value, so they are not NUL terminated and last only as long as it does
+const char *vm_string_read (wtjl_context_t *ctx, value_t *value, size_t *length) {
+  if (value->small_length != VALUE_LARGE_STRING) {
+    *length = value->small_length;
+    return value->small;
+  }
+  const char *chars = vm_string_chars(ctx, value->as.string);
+  *length = value->as.string->length;
+  return chars;
+}
+
+// short results are copied, into the value when they fit; longer ones join
+// their operands in a rope, so a loop appending to a string copies it once,
+// when it is next read, rather than on every append
+value_t vm_concatenate (wtjl_context_t *ctx, value_t *a, value_t *b) {
+  size_t length = vm_string_length(ctx, a) + vm_string_length(ctx, b);
+  value_t value;
+  if (length < STRING_ROPE_MIN) {
+    size_t a_length;
+    size_t b_length;
+    const char *a_chars = vm_string_read(ctx, a, &a_length);
+    const char *b_chars = vm_string_read(ctx, b, &b_length);
+    char chars [STRING_ROPE_MIN];
+    memcpy(chars, a_chars, a_length);
+    memcpy(chars + a_length, b_chars, b_length);
+    return vm_string(ctx, chars, length);
+  }
+  string_t *rope = _vm_track_string(ctx, malloc(sizeof(string_t) + 2 * sizeof(value_t)));
+  rope->length = length;
+  rope->hash = 0;
+  rope->escaped = false;
+  rope->rope = true;
+  rope->chars = NULL;
+  _vm_rope_halves(rope)[0] = *a;
+  _vm_rope_halves(rope)[1] = *b;
+  value.type = VALUE_STRING;
+  value.small_length = VALUE_LARGE_STRING;
+  value.as.string = rope;
+  return value;
+}
+
+// [from, to) of a string, which must be in range; a part of a rope that lies
+// in one of its halves is taken from that half, so the head or tail of a long
+// concatenation can be had without flattening all of it
+value_t vm_substring (wtjl_context_t *ctx, value_t *value, size_t from, size_t to) {
+  while (value->small_length == VALUE_LARGE_STRING && !value->as.string->chars) {
+    value_t *halves = _vm_rope_halves(value->as.string);
+    size_t middle = vm_string_length(ctx, &halves[0]);
+    if (to <= middle) {
+      value = &halves[0];
+    } else if (from >= middle) {
+      value = &halves[1];
+      from -= middle;
+      to -= middle;
+    } else {
+      break;
+    }
+  }
+  size_t length;
+  const char *chars = vm_string_read(ctx, value, &length);
+  return vm_string(ctx, chars + from, to - from);
+}
+
+// FNV-1a; large strings keep theirs, except in lanes, which may share them
+uint64_t _vm_string_hash (wtjl_context_t *ctx, value_t *value) {
+  if (value->small_length == VALUE_LARGE_STRING && value->as.string->hash) {
+    return value->as.string->hash;
+  }
+  size_t length;
+  const char *chars = vm_string_read(ctx, value, &length);
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t) chars[i]) * 1099511628211ULL;
+  }
+  hash += !hash;
+  if (value->small_length == VALUE_LARGE_STRING && !ctx->vm.lane) {
+    value->as.string->hash = hash;
+  }
+  return hash;
+}
+
+// two large strings of one length are told apart by their hashes before
+// their chars, so comparing the same strings again and again is cheap
+bool _vm_string_equal (wtjl_context_t *ctx, value_t *a, value_t *b) {
+  bool large = a->small_length == VALUE_LARGE_STRING && b->small_length == VALUE_LARGE_STRING;
+  if (large && a->as.string == b->as.string) {
+    return true;
+  }
+  if (vm_string_length(ctx, a) != vm_string_length(ctx, b)) {
+    return false;
+  }
+  if (large && !ctx->vm.lane && _vm_string_hash(ctx, a) != _vm_string_hash(ctx, b)) {
+    return false;
+  }
+  size_t a_length;
+  size_t b_length;
+  const char *a_chars = vm_string_read(ctx, a, &a_length);
+  const char *b_chars = vm_string_read(ctx, b, &b_length);
+  return memcmp(a_chars, b_chars, a_length) == 0;
+}
+
+// makes room for `count` values from `from` on, doubling the stack as often
+// as it takes; the frames and the stack top move with it, and so does
+// `from`, which is returned
+value_t *_vm_reserve (wtjl_context_t *ctx, value_t *from, size_t count, const char *name) {
+  vm_state_t *state = &ctx->vm;
+  size_t offset = from - state->stack;
+  if (offset + count <= state->stack_capacity) {
+    return from;
+  }
+  size_t capacity = state->stack_capacity;
+  while (offset + count > capacity) {
+    capacity *= 2;
+  }
+  if (capacity > VM_STACK_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; stack overflow.", name);
+  }
+  value_t *stack = realloc(state->stack, capacity * sizeof(value_t));
+  for (size_t i = 0; i < state->num_frames; i++) {
+    state->frames[i].base = stack + (state->frames[i].base - state->stack);
+  }
+  state->stack_top = stack + (state->stack_top - state->stack);
+  state->stack = stack;
+  state->stack_capacity = capacity;
+  return stack + offset;
+}
+
+// the stack may move to make room, so callers read the new frame's base
+// back rather than keep pointers into the stack across this
+void _vm_push_frame (wtjl_context_t *ctx, function_t *function, value_t *base) {
+  vm_state_t *state = &ctx->vm;
+  base = _vm_reserve(ctx, base, function->max_stack, function->name);
+  if (state->num_frames == state->frames_capacity) {
+    if (state->frames_capacity == VM_FRAMES_MAX) {
+      wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; stack overflow.", function->name);
+    }
+    state->frames_capacity *= 2;
+    state->frames = realloc(state->frames, state->frames_capacity * sizeof(call_frame_t));
+  }
+  call_frame_t *frame = &state->frames[state->num_frames++];
+  frame->function = function;
+  frame->ip = function->chunk.code;
+  frame->base = base;
+  frame->generator = NULL;
+}
+
+bool _vm_double_operands (value_t *a, value_t *b, double *x, double *y);
+value_t parallel_reduce (wtjl_context_t *ctx, reduction_t reduction, value_t start, value_t end, value_t function);
+
+// calling a generator function only captures its arguments; `callee` is
+// followed by them on the stack
+generator_t *_vm_new_generator (wtjl_context_t *ctx, function_t *function, value_t *callee) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_generators == state->generators_capacity) {
+    state->generators_capacity = state->generators_capacity ? state->generators_capacity * 2 : 8;
+    state->generators = realloc(state->generators, state->generators_capacity * sizeof(generator_t *));
+  }
+  generator_t *generator = malloc(sizeof(generator_t) + (function->max_stack + 1) * sizeof(value_t));
+  generator->function = function;
+  generator->context = ctx;
+  generator->ip = function->chunk.code;
+  generator->running = false;
+  generator->done = false;
+  generator->marked = false;
+  generator->num_saved = function->arity + 1;
+  memcpy(generator->saved, callee, generator->num_saved * sizeof(value_t));
+  state->generators[state->num_generators++] = generator;
+  return generator;
+}
+
+shape_t *_vm_new_shape (shape_t *parent, const char *name) {
+  shape_t *shape = malloc(sizeof(shape_t));
+  shape->parent = parent;
+  shape->name = name ? strdup(name) : NULL;
+  shape->num_members = parent ? parent->num_members + 1 : 0;
+  shape->children = NULL;
+  shape->num_children = 0;
+  return shape;
+}
+
+// NULL once the vm has been cleaned up, which may happen twice
+void _vm_free_shape (shape_t *shape) {
+  if (!shape) {
+    return;
+  }
+  for (size_t i = shape->num_children; i > 0; i--) {
+    _vm_free_shape(shape->children[i - 1]);
+  }
+  free(shape->children);
+  free(shape->name);
+  free(shape);
+}
+
+// the slot of `name` in objects of `shape`, -1 if they have no such member
+long _vm_shape_slot (shape_t *shape, const char *name) {
+  for (; shape->parent; shape = shape->parent) {
+    if (strcmp(shape->name, name) == 0) {
+      return (long) shape->num_members - 1;
+    }
+  }
+  return -1;
+}
+
+// the shape objects of `shape` move to when `name` is added to them
+shape_t *_vm_shape_add (wtjl_context_t *ctx, shape_t *shape, const char *name) {
+  for (size_t i = 0; i < shape->num_children; i++) {
+    if (strcmp(shape->children[i]->name, name) == 0) {
+      return shape->children[i];
+    }
+  }
+  shape->children = realloc(shape->children, (shape->num_children + 1) * sizeof(shape_t *));
+  return shape->children[shape->num_children++] = _vm_new_shape(shape, name);
+}
+
+object_t *_vm_new_object (wtjl_context_t *ctx) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_objects == state->objects_capacity) {
+    state->objects_capacity = state->objects_capacity ? state->objects_capacity * 2 : 8;
+    state->objects = realloc(state->objects, state->objects_capacity * sizeof(object_t *));
+  }
+  object_t *object = malloc(sizeof(object_t));
+  object->shape = state->root_shape;
+  object->context = ctx;
+  object->marked = false;
+  object->slots = NULL;
+  object->slots_capacity = 0;
+  state->objects[state->num_objects++] = object;
+  return object;
+}
+
+closure_t *_vm_new_closure (wtjl_context_t *ctx, function_t *function, value_t *captures) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_closures == state->closures_capacity) {
+    state->closures_capacity = state->closures_capacity ? state->closures_capacity * 2 : 8;
+    state->closures = realloc(state->closures, state->closures_capacity * sizeof(closure_t *));
+  }
+  closure_t *closure = malloc(sizeof(closure_t) + function->num_captures * sizeof(value_t));
+  closure->function = *function;
+  closure->function.closure = true;
+  closure->literal = function;
+  closure->marked = false;
+  memcpy(closure->captures, captures, function->num_captures * sizeof(value_t));
+  state->closures[state->num_closures++] = closure;
+  return closure;
+}
+
+box_t *_vm_new_box (wtjl_context_t *ctx, value_t value) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_boxes == state->boxes_capacity) {
+    state->boxes_capacity = state->boxes_capacity ? state->boxes_capacity * 2 : 8;
+    state->boxes = realloc(state->boxes, state->boxes_capacity * sizeof(box_t *));
+  }
+  box_t *box = malloc(sizeof(box_t));
+  box->context = ctx;
+  box->marked = false;
+  box->value = value;
+  state->boxes[state->num_boxes++] = box;
+  return box;
+}
+
+// elements start as 0, or the integer 0 in an array of values
+array_t *vm_new_array (wtjl_context_t *ctx, array_kind_t kind, size_t length) {
+  vm_state_t *state = &ctx->vm;
+  if (state->num_arrays == state->arrays_capacity) {
+    state->arrays_capacity = state->arrays_capacity ? state->arrays_capacity * 2 : 8;
+    state->arrays = realloc(state->arrays, state->arrays_capacity * sizeof(array_t *));
+  }
+  size_t sizes [] = {sizeof(value_t), sizeof(int64_t), sizeof(uint8_t)};
+  array_t *array = malloc(sizeof(array_t));
+  array->kind = kind;
+  array->context = ctx;
+  array->marked = false;
+  array->length = length;
+  array->as.bytes = malloc(MAX(length, 1) * sizes[kind]);
+  memset(array->as.bytes, 0, length * sizes[kind]);
+  for (size_t i = 0; kind == ARRAY_VALUES && i < length; i++) {
+    array->as.values[i].type = VALUE_INTEGER;
+  }
+  state->arrays[state->num_arrays++] = array;
+  return array;
+}
+
+value_t vm_array_get (array_t *array, size_t index) {
+  value_t value;
+  switch (array->kind) {
+    case (ARRAY_INTEGERS):
+      value.type = VALUE_INTEGER;
+      value.as.integer = array->as.integers[index];
+      return value;
+    case (ARRAY_BYTES):
+      value.type = VALUE_INTEGER;
+      value.as.integer = array->as.bytes[index];
+      return value;
+    default:
+      return array->as.values[index];
+  }
+}
+
+// what is wrong with `value` as an element of `array`, NULL if nothing is
+const char *vm_array_check (array_t *array, value_t value) {
+  if (array->kind != ARRAY_VALUES && value.type != VALUE_INTEGER && value.type != VALUE_BIGNUM) {
+    return "the array holds only integers";
+  }
+  if (array->kind == ARRAY_BYTES && (value.type == VALUE_BIGNUM || value.as.integer < 0 || value.as.integer > UINT8_MAX)) {
+    return "bytes hold integers from 0 to 255";
+  }
+  if (array->kind == ARRAY_INTEGERS && value.type == VALUE_BIGNUM) {
+    return "the integer does not fit in 64 bits";
+  }
+  return NULL;
+}
+
+// `value` must have passed vm_array_check
+void vm_array_set (array_t *array, size_t index, value_t value) {
+  switch (array->kind) {
+    case (ARRAY_INTEGERS):
+      array->as.integers[index] = value.as.integer;
+      break;
+    case (ARRAY_BYTES):
+      array->as.bytes[index] = (uint8_t) value.as.integer;
+      break;
+    default:
+      array->as.values[index] = value;
+  }
+}
+
+// remembers where a site found its member in objects of `shape`; lanes only
+// read caches, as they run the same code at once and their shapes die with them
+void _vm_cache_add (wtjl_context_t *ctx, member_cache_t *cache, shape_t *shape, shape_t *next, size_t slot) {
+  if (ctx->vm.lane || cache->num_shapes == MEMBER_CACHE_SHAPES) {
+    return;
+  }
+  cache->entries[cache->num_shapes].shape = shape;
+  cache->entries[cache->num_shapes].next = next;
+  cache->entries[cache->num_shapes].slot = slot;
+  cache->num_shapes++;
+}
+
+// both numbers or both of one other type, and the same
+bool _vm_equal (wtjl_context_t *ctx, value_t *a, value_t *b) {
+  double x;
+  double y;
+  if (_vm_double_operands(a, b, &x, &y)) {
+    return x == y;
+  }
+  if (a->type != b->type) {
+    return false;
+  }
+  switch (a->type) {
+    case (VALUE_INTEGER):
+      return a->as.integer == b->as.integer;
+    case (VALUE_BOOLEAN):
+      return a->as.boolean == b->as.boolean;
+    case (VALUE_STRING):
+      return _vm_string_equal(ctx, a, b);
+    case (VALUE_FUNCTION):
+      return a->as.function == b->as.function;
+    case (VALUE_GENERATOR):
+      return a->as.generator == b->as.generator;
+    case (VALUE_OBJECT):
+      return a->as.object == b->as.object;
+    case (VALUE_ARRAY):
+      return a->as.array == b->as.array;
+    case (VALUE_BIGNUM):
+      return bignums.compare(a->as.bignum, b->as.bignum) == 0;
+    default:
+      return true;
+  }
+}
+
+// false when the result does not fit an int64
+bool _vm_power (wtjl_context_t *ctx, function_t *function, int64_t base, int64_t exponent, int64_t *result) {
+  *result = 1;
+  if (exponent < 0) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; negative exponent.", function->name);
+  }
+  while (exponent) {
+    if (exponent & 1 && __builtin_mul_overflow(*result, base, result)) {
+      return false;
+    }
+    exponent >>= 1;
+    if (exponent && __builtin_mul_overflow(base, base, &base)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool _vm_is_integer (value_t *value) {
+  return value->type == VALUE_INTEGER || value->type == VALUE_BIGNUM;
+}
+
+// both operands widened to doubles, when one of them is a double and the
+// other a number
+bool _vm_double_operands (value_t *a, value_t *b, double *x, double *y) {
+  if (a->type != VALUE_DOUBLE && b->type != VALUE_DOUBLE) {
+    return false;
+  }
+  if ((a->type != VALUE_DOUBLE && !_vm_is_integer(a)) || (b->type != VALUE_DOUBLE && !_vm_is_integer(b))) {
+    return false;
+  }
+  *x = a->type == VALUE_DOUBLE ? a->as.number : a->type == VALUE_BIGNUM ? bignums.to_double(a->as.bignum) : (double) a->as.integer;
+  *y = b->type == VALUE_DOUBLE ? b->as.number : b->type == VALUE_BIGNUM ? bignums.to_double(b->as.bignum) : (double) b->as.integer;
+  return true;
+}
+
+// an integer value as a bignum, through `buffer` when it is an int64
+bignum_t *_vm_bignum_operand (value_t *value, uint64_t *buffer) {
+  return value->type == VALUE_BIGNUM ? value->as.bignum : bignums.integer(value->as.integer, buffer);
+}
+
+// the value of a bignum just made: an integer when it fits, otherwise the
+// bignum, which from then on lives as long as the context
+value_t vm_bignum (wtjl_context_t *ctx, bignum_t *bignum) {
+  vm_state_t *state = &ctx->vm;
+  value_t value;
+  if (bignums.to_integer(bignum, &value.as.integer)) {
+    free(bignum);
+    value.type = VALUE_INTEGER;
+    return value;
+  }
+  if (state->num_bignums == state->bignums_capacity) {
+    state->bignums_capacity = state->bignums_capacity ? state->bignums_capacity * 2 : 8;
+    state->bignums = realloc(state->bignums, state->bignums_capacity * sizeof(bignum_t *));
+  }
+  state->bignums[state->num_bignums++] = bignum;
+  bignum->marked = false;
+  bignum->pinned = false;
+  value.type = VALUE_BIGNUM;
+  value.as.bignum = bignum;
+  return value;
+}
+
+// x ** exponent, for a result that may not fit an int64; results over
+// VM_BIGNUM_MAX_BITS fail rather than exhaust memory
+value_t _vm_bignum_power (wtjl_context_t *ctx, const char *name, bignum_t *x, value_t *exponent) {
+  uint64_t one_view [BIGNUM_VIEW_SIZE];
+  bignum_t *one = bignums.integer(1, one_view);
+  if (exponent->type == VALUE_BIGNUM ? exponent->as.bignum->negative : exponent->as.integer < 0) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; negative exponent.", name);
+  }
+  uint64_t bits = x->length ? x->length * 64 - __builtin_clzll(x->limbs[x->length - 1]) : 0;
+  if (bits <= 1 && exponent->type == VALUE_BIGNUM) {
+    // 0, 1 and -1 are the only bases that survive such an exponent
+    bool odd = exponent->as.bignum->limbs[0] & 1;
+    return vm_bignum(ctx, bignums.multiply(x, odd ? one : x));
+  }
+  if (exponent->type == VALUE_BIGNUM || (bits > 1 && (uint64_t) exponent->as.integer > VM_BIGNUM_MAX_BITS / bits)) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; integer too large.", name);
+  }
+  bignum_t *result = bignums.multiply(one, one);
+  bignum_t *square = NULL;
+  const bignum_t *factor = x;
+  for (uint64_t e = (uint64_t) exponent->as.integer; e; e >>= 1) {
+    if (e & 1) {
+      bignum_t *next = bignums.multiply(result, factor);
+      free(result);
+      result = next;
+    }
+    if (e > 1) {
+      bignum_t *next = bignums.multiply(factor, factor);
+      free(square);
+      factor = square = next;
+    }
+  }
+  free(square);
+  return vm_bignum(ctx, result);
+}
+
+// op, one of the generic arithmetic opcodes, on integers of either kind once
+// an int64 will not do: when either is a bignum or the result overflows.
+// `b` is unused for OP_NEGATE; `name` is the function to blame for errors.
+// Kept out of line, so the int64 fast paths that fall back on it stay small
+__attribute__((cold, noinline))
+value_t vm_arithmetic (wtjl_context_t *ctx, const char *name, int op, value_t *a, value_t *b) {
+  uint64_t x_view [BIGNUM_VIEW_SIZE];
+  uint64_t y_view [BIGNUM_VIEW_SIZE];
+  bignum_t *x = _vm_bignum_operand(a, x_view);
+  if (op == OP_NEGATE) {
+    return vm_bignum(ctx, bignums.subtract(bignums.integer(0, y_view), x));
+  }
+  if (op == OP_POWER) {
+    return _vm_bignum_power(ctx, name, x, b);
+  }
+  bignum_t *y = _vm_bignum_operand(b, y_view);
+  switch (op) {
+    case (OP_ADD):
+      return vm_bignum(ctx, bignums.add(x, y));
+    case (OP_SUBTRACT):
+      return vm_bignum(ctx, bignums.subtract(x, y));
+    case (OP_MULTIPLY):
+      return vm_bignum(ctx, bignums.multiply(x, y));
+    default:
+      if (!y->length) {
+        wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; division by zero.", name);
+      }
+      return vm_bignum(ctx, bignums.divide(x, y));
+  }
+}
+
+// -1, 0 or 1 as `a` is less than, equal to or greater than `b`, both
+// numbers; with a NaN, 0
+int vm_compare (value_t *a, value_t *b) {
+  double x;
+  double y;
+  if (_vm_double_operands(a, b, &x, &y)) {
+    return x < y ? -1 : x > y;
+  }
+  if (a->type == VALUE_INTEGER && b->type == VALUE_INTEGER) {
+    return a->as.integer < b->as.integer ? -1 : a->as.integer > b->as.integer;
+  }
+  uint64_t x_view [BIGNUM_VIEW_SIZE];
+  uint64_t y_view [BIGNUM_VIEW_SIZE];
+  return bignums.compare(_vm_bignum_operand(a, x_view), _vm_bignum_operand(b, y_view));
+}
+
+#ifdef VM_PROFILE
+
+#define VM_PROFILE_PAIRS 16
+#define VM_PROFILE_TRIPLES 8
+
+// with VM_PROFILE defined the vm counts every dispatch, and every run of two
+// and of three instructions that followed one another in the code, over all
+// contexts; vm_profile_report ranks the runs as superinstructions. Lanes
+// count too, so the counts are atomic
+uint64_t _vm_profile_dispatches;
+uint64_t _vm_profile_pairs [VM_OPCODES][VM_OPCODES];
+uint64_t _vm_profile_triples [VM_OPCODES][VM_OPCODES][VM_OPCODES];
+
+// `run` holds the last two instructions, -1 where a jump, call or return
+// came between them and `ip`, and `next` where the last one ended
+void _vm_profile (uint8_t *ip, uint8_t **next, int *run) {
+  opcode_t op = *ip;
+  __atomic_fetch_add(&_vm_profile_dispatches, 1, __ATOMIC_RELAXED);
+  if (ip != *next) {
+    run[0] = -1;
+    run[1] = -1;
+  }
+  if (run[1] >= 0) {
+    __atomic_fetch_add(&_vm_profile_pairs[run[1]][op], 1, __ATOMIC_RELAXED);
+  }
+  if (run[0] >= 0) {
+    __atomic_fetch_add(&_vm_profile_triples[run[0]][run[1]][op], 1, __ATOMIC_RELAXED);
+  }
+  run[0] = run[1];
+  run[1] = op;
+  *next = ip + _compiler_instruction_length(ip);
+}
+
+// prints the `num_runs` runs of `arity` instructions in `counts` that ran
+// most, by the dispatches fusing each would save, as the entries of
+// VM_PAIRS or VM_TRIPLES; runs the vm cannot fuse are left out
+void _vm_profile_rank (uint64_t *counts, size_t arity, size_t num_runs) {
+  size_t length = arity == 2 ? VM_OPCODES * VM_OPCODES : VM_OPCODES * VM_OPCODES * VM_OPCODES;
+  uint64_t last = UINT64_MAX;
+  size_t last_index = 0;
+  for (size_t n = 0; n < num_runs; n++) {
+    uint64_t best = 0;
+    size_t best_index = 0;
+    opcode_t ops [3];
+    for (size_t i = 0; i < length; i++) {
+      if (counts[i] <= best || counts[i] > last || (counts[i] == last && i <= last_index)) {
+        continue;
+      }
+      bool fusible = true;
+      for (size_t k = 0, index = i; k < arity; k++, index /= VM_OPCODES) {
+        ops[arity - 1 - k] = index % VM_OPCODES;
+        fusible = fusible && _compiler_fusible(ops[arity - 1 - k], k == 0);
+      }
+      if (fusible) {
+        best = counts[i];
+        best_index = i;
+      }
+    }
+    if (!best) {
+      return;
+    }
+    last = best;
+    last_index = best_index;
+    for (size_t k = 0, index = best_index; k < arity; k++, index /= VM_OPCODES) {
+      ops[arity - 1 - k] = index % VM_OPCODES;
+    }
+    printf("%6.2f%%  X(OP", 100.0 * (arity - 1) * best / MAX(_vm_profile_dispatches, 1));
+    for (size_t k = 0; k < arity; k++) {
+      printf("_%s", _compiler_opcode_names[ops[k]]);
+    }
+    for (size_t k = 0; k < arity; k++) {
+      printf(", %s", _compiler_opcode_names[ops[k]]);
+    }
+    printf(") \\\n");
+  }
+}
+
+void vm_profile_report (size_t num_pairs, size_t num_triples) {
+  printf("%llu dispatches\n", (unsigned long long) _vm_profile_dispatches);
+  _vm_profile_rank(&_vm_profile_pairs[0][0], 2, num_pairs);
+  _vm_profile_rank(&_vm_profile_triples[0][0][0], 3, num_triples);
+}
+
+#endif
+
+// runs until the frame count drops back to `exit_depth`
+void _vm_run (wtjl_context_t *ctx, size_t exit_depth) {
+  vm_state_t *state = &ctx->vm;
+  call_frame_t *frame = &state->frames[state->num_frames - 1];
+  uint8_t *ip = frame->ip;
+  value_t *base = frame->base;
+  value_t *constants = frame->function->chunk.constants;
+  value_t *sp = state->stack_top;
+  value_t *a;
+  value_t *b;
+  double x;
+  double y;
+  int64_t integer;
+#ifdef VM_PROFILE
+  uint8_t *profile_next = NULL;
+  int profile_run [2] = {-1, -1};
+#endif
+
+  #define VM_SYNC() frame->ip = ip; state->stack_top = sp;
+  #define VM_LOAD() \
+    frame = &state->frames[state->num_frames - 1]; \
+    ip = frame->ip; \
+    base = frame->base; \
+    constants = frame->function->chunk.constants;
+  #define VM_FAIL(message) VM_SYNC(); wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s.", frame->function->name, message);
+  // an integer result that will not fit an int64, or one of a bignum,
+  // leaves the fast path for vm_arithmetic
+  #define VM_BIGNUM_OPERATION(op) \
+    VM_SYNC(); \
+    sp[-2] = vm_arithmetic(ctx, frame->function->name, op, sp - 2, sp - 1); \
+    sp--; \
+    break;
+  #define VM_INTEGER_OPERANDS(op) \
+    b = sp - 1; \
+    a = sp - 2; \
+    if (a->type != VALUE_INTEGER || b->type != VALUE_INTEGER) { \
+      if (!_vm_is_integer(a) || !_vm_is_integer(b)) { \
+        VM_FAIL("operands must be numbers"); \
+      } \
+      VM_BIGNUM_OPERATION(op); \
+    }
+  // integers stay integers; with a double on either side the result is one
+  #define VM_DOUBLE_OPERATION(result) \
+    if (_vm_double_operands(sp - 2, sp - 1, &x, &y)) { \
+      sp[-2].type = VALUE_DOUBLE; \
+      sp[-2].as.number = (result); \
+      sp--; \
+      break; \
+    }
+  // the instructions superinstructions are made of, each run as a VM_STEP,
+  // inside which a break ends the step rather than the whole instruction
+  #define VM_STEP(op) do { VM_DO_##op } while (0);
+  #define VM_DO_CONSTANT \
+    *sp++ = constants[VM_READ_SHORT()];
+  #define VM_DO_GET_LOCAL \
+    *sp++ = base[VM_READ_SHORT()];
+  #define VM_DO_SET_LOCAL \
+    base[VM_READ_SHORT()] = *--sp;
+  #define VM_DO_GET_GLOBAL \
+    uint16_t slot = VM_READ_SHORT(); \
+    if (state->globals[slot].type == VALUE_UNDEFINED) { \
+      VM_SYNC(); \
+      wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; \"%s\" is not defined.", frame->function->name, state->global_names[slot]); \
+    } \
+    *sp++ = state->globals[slot];
+  #define VM_DO_ADD \
+    if (sp[-2].type == VALUE_STRING || sp[-1].type == VALUE_STRING) { \
+      if (sp[-2].type != VALUE_STRING || sp[-1].type != VALUE_STRING) { \
+        VM_FAIL("operands must both be strings"); \
+      } \
+      VM_SYNC(); \
+      sp[-2] = vm_concatenate(ctx, &sp[-2], &sp[-1]); \
+      sp--; \
+      break; \
+    } \
+    VM_DOUBLE_OPERATION(x + y); \
+    VM_INTEGER_OPERANDS(OP_ADD); \
+    if (__builtin_add_overflow(a->as.integer, b->as.integer, &integer)) { \
+      VM_BIGNUM_OPERATION(OP_ADD); \
+    } \
+    a->as.integer = integer; \
+    sp--;
+  #define VM_DO_SUBTRACT \
+    VM_DOUBLE_OPERATION(x - y); \
+    VM_INTEGER_OPERANDS(OP_SUBTRACT); \
+    if (__builtin_sub_overflow(a->as.integer, b->as.integer, &integer)) { \
+      VM_BIGNUM_OPERATION(OP_SUBTRACT); \
+    } \
+    a->as.integer = integer; \
+    sp--;
+  #define VM_DO_MULTIPLY \
+    VM_DOUBLE_OPERATION(x * y); \
+    VM_INTEGER_OPERANDS(OP_MULTIPLY); \
+    if (__builtin_mul_overflow(a->as.integer, b->as.integer, &integer)) { \
+      VM_BIGNUM_OPERATION(OP_MULTIPLY); \
+    } \
+    a->as.integer = integer; \
+    sp--;
+  #define VM_DO_LOOP \
+    uint16_t distance = VM_READ_SHORT(); \
+    ip -= distance; \
+    if (ctx->mem.pressure) { \
+      VM_SYNC(); \
+      heap.collect(ctx); \
+    }
+  #define VM_DO_EQUAL \
+    bool result = _vm_equal(ctx, sp - 2, sp - 1); \
+    sp[-2].type = VALUE_BOOLEAN; \
+    sp[-2].as.boolean = result; \
+    sp--;
+  #define VM_DO_JUMP_IF_FALSE \
+    uint16_t distance = VM_READ_SHORT(); \
+    sp--; \
+    if (sp->type != VALUE_BOOLEAN) { \
+      VM_FAIL("condition must be a boolean"); \
+    } \
+    if (!sp->as.boolean) { \
+      ip += distance; \
+    }
+  // the rest of a superinstruction's run follows it in the code, each
+  // instruction behind its own opcode, which the vm steps over
+  #define VM_FUSED_PAIR(name, first, second) \
+    case (name): \
+      VM_STEP(first) \
+      ip++; \
+      VM_STEP(second) \
+      break;
+  #define VM_FUSED_TRIPLE(name, first, second, third) \
+    case (name): \
+      VM_STEP(first) \
+      ip++; \
+      VM_STEP(second) \
+      ip++; \
+      VM_STEP(third) \
+      break;
+
+  for (; ; ) {
+#ifdef VM_PROFILE
+    _vm_profile(ip, &profile_next, profile_run);
+#endif
+    switch (VM_READ_BYTE()) {
+      case (OP_CONSTANT):
+        VM_STEP(CONSTANT)
+        break;
+      case (OP_VOID):
+        sp->type = VALUE_VOID;
+        sp++;
+        break;
+      case (OP_POP):
+        sp--;
+        break;
+      case (OP_GET_LOCAL):
+        VM_STEP(GET_LOCAL)
+        break;
+      case (OP_SET_LOCAL):
+        VM_STEP(SET_LOCAL)
+        break;
+      case (OP_GET_GLOBAL):
+        VM_STEP(GET_GLOBAL)
+        break;
+      case (OP_SET_GLOBAL): {
+        uint16_t slot = VM_READ_SHORT();
+        if (state->globals[slot].type == VALUE_UNDEFINED) {
+          VM_SYNC();
+          wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; \"%s\" is not defined.", frame->function->name, state->global_names[slot]);
+        }
+        if (state->lane) {
+          VM_FAIL("globals are read only inside a parallel iterate");
+        }
+        state->globals[slot] = *--sp;
+        break;
+      }
+      case (OP_DEFINE_GLOBAL):
+        state->globals[VM_READ_SHORT()] = *--sp;
+        break;
+      case (OP_NEGATE):
+        a = sp - 1;
+        if (a->type == VALUE_DOUBLE) {
+          a->as.number = -a->as.number;
+          break;
+        }
+        if (!_vm_is_integer(a)) {
+          VM_FAIL("operand must be a number");
+        }
+        if (a->type == VALUE_BIGNUM || a->as.integer == INT64_MIN) {
+          VM_SYNC();
+          *a = vm_arithmetic(ctx, frame->function->name, OP_NEGATE, a, a);
+          break;
+        }
+        a->as.integer = -a->as.integer;
+        break;
+      case (OP_ADD):
+        VM_STEP(ADD)
+        break;
+      case (OP_SUBTRACT):
+        VM_STEP(SUBTRACT)
+        break;
+      case (OP_MULTIPLY):
+        VM_STEP(MULTIPLY)
+        break;
+      case (OP_DIVIDE):
+        VM_DOUBLE_OPERATION(x / y);
+        VM_INTEGER_OPERANDS(OP_DIVIDE);
+        if (b->as.integer == 0) {
+          VM_FAIL("division by zero");
+        }
+        if (a->as.integer == INT64_MIN && b->as.integer == -1) {
+          VM_BIGNUM_OPERATION(OP_DIVIDE);
+        }
+        a->as.integer = a->as.integer / b->as.integer;
+        sp--;
+        break;
+      case (OP_POWER):
+        VM_DOUBLE_OPERATION(pow(x, y));
+        VM_INTEGER_OPERANDS(OP_POWER);
+        VM_SYNC();
+        if (!_vm_power(ctx, frame->function, a->as.integer, b->as.integer, &integer)) {
+          VM_BIGNUM_OPERATION(OP_POWER);
+        }
+        a->as.integer = integer;
+        sp--;
+        break;
+      case (OP_CALL):
+      case (OP_TAIL_CALL): {
+        bool tail = ip[-1] == OP_TAIL_CALL;
+        uint8_t num_arguments = VM_READ_BYTE();
+        value_t *callee = sp - num_arguments - 1;
+        if (callee->type != VALUE_FUNCTION) {
+          VM_FAIL("only functions can be called");
+        }
+        if (callee->as.function->arity != num_arguments) {
+          VM_SYNC();
+          wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s expects %d arguments, got %d.", frame->function->name, callee->as.function->name, (int) callee->as.function->arity, (int) num_arguments);
+        }
+        VM_SYNC();
+        // with the call's operands synced to the stack this is a safe point
+        // to collect at, see heap
+        if (ctx->mem.pressure) {
+          heap.collect(ctx);
+        }
+        if (callee->as.function->native) {
+          // eval runs code, which may move the stack and the frames
+          size_t at = callee - state->stack;
+          value_t result = callee->as.function->native(ctx, callee + 1);
+          VM_LOAD();
+          callee = state->stack + at;
+          *callee = result;
+          sp = callee + 1;
+          break;
+        }
+        if (callee->as.function->generator) {
+          generator_t *generator = _vm_new_generator(ctx, callee->as.function, callee);
+          callee->type = VALUE_GENERATOR;
+          callee->as.generator = generator;
+          sp = callee + 1;
+          break;
+        }
+        if (tail) {
+          // the callee and its arguments take this frame's slots, and the
+          // frame becomes the callee's, so tail recursion runs in constant
+          // space; the OP_RETURN after the call is left for natives and
+          // generators
+          function_t *function = callee->as.function;
+          memmove(base - 1, callee, (num_arguments + 1) * sizeof(value_t));
+          state->stack_top = base + num_arguments;
+          _vm_reserve(ctx, base, function->max_stack, function->name);
+          frame->function = function;
+          frame->ip = function->chunk.code;
+          VM_LOAD();
+          sp = base + num_arguments;
+          break;
+        }
+        _vm_push_frame(ctx, callee->as.function, callee + 1);
+        VM_LOAD();
+        sp = state->stack_top;
+        break;
+      }
+      case (OP_JUMP): {
+        uint16_t distance = VM_READ_SHORT();
+        ip += distance;
+        break;
+      }
+      case (OP_LOOP):
+        VM_STEP(LOOP)
+        break;
+      case (OP_LESS):
+      case (OP_GREATER): {
+        b = sp - 1;
+        a = sp - 2;
+        bool less = ip[-1] == OP_LESS;
+        bool result;
+        if (_vm_double_operands(a, b, &x, &y)) {
+          result = less ? x < y : x > y;
+        } else if (a->type == VALUE_INTEGER && b->type == VALUE_INTEGER) {
+          result = less ? a->as.integer < b->as.integer : a->as.integer > b->as.integer;
+        } else if (_vm_is_integer(a) && _vm_is_integer(b)) {
+          result = vm_compare(a, b) == (less ? -1 : 1);
+        } else {
+          VM_FAIL("operands must be numbers");
+        }
+        a->type = VALUE_BOOLEAN;
+        a->as.boolean = result;
+        sp--;
+        break;
+      }
+      case (OP_EQUAL):
+        VM_STEP(EQUAL)
+        break;
+      case (OP_NEXT): {
+        uint16_t distance = VM_READ_SHORT();
+        if (sp[-1].type != VALUE_GENERATOR) {
+          VM_FAIL("only generators can be iterated over");
+        }
+        generator_t *generator = sp[-1].as.generator;
+        if (generator->done) {
+          ip += distance;
+          break;
+        }
+        if (generator->running) {
+          VM_FAIL("the generator is already running");
+        }
+        if (generator->context != ctx) {
+          VM_FAIL("the generator belongs to another context");
+        }
+        // its slots go back on the stack above the generator, the callee first
+        VM_SYNC();
+        _vm_push_frame(ctx, generator->function, sp + 1);
+        sp = state->frames[state->num_frames - 1].base - 1;
+        memcpy(sp, generator->saved, generator->num_saved * sizeof(value_t));
+        sp += generator->num_saved;
+        generator->running = true;
+        state->frames[state->num_frames - 1].ip = generator->ip;
+        state->frames[state->num_frames - 1].generator = generator;
+        VM_LOAD();
+        break;
+      }
+      case (OP_YIELD): {
+        generator_t *generator = frame->generator;
+        value_t result = *--sp;
+        generator->num_saved = sp - (base - 1);
+        memcpy(generator->saved, base - 1, generator->num_saved * sizeof(value_t));
+        generator->ip = ip;
+        generator->running = false;
+        sp = base - 1;
+        *sp++ = result;
+        state->num_frames--;
+        VM_LOAD();
+        break;
+      }
+      case (OP_JUMP_IF_FALSE):
+        VM_STEP(JUMP_IF_FALSE)
+        break;
+      // the compiler only knows these are integers, not that they fit an
+      // int64; VALUE_BIGNUM has a bit VALUE_INTEGER lacks, so one test of
+      // both tags at once finds a bignum
+      case (OP_NEGATE_INTEGER):
+        if (sp[-1].type != VALUE_INTEGER || sp[-1].as.integer == INT64_MIN) {
+          VM_SYNC();
+          sp[-1] = vm_arithmetic(ctx, frame->function->name, OP_NEGATE, sp - 1, sp - 1);
+          break;
+        }
+        sp[-1].as.integer = -sp[-1].as.integer;
+        break;
+      case (OP_ADD_INTEGER):
+        if ((sp[-2].type | sp[-1].type) != VALUE_INTEGER || __builtin_add_overflow(sp[-2].as.integer, sp[-1].as.integer, &integer)) {
+          VM_BIGNUM_OPERATION(OP_ADD);
+        }
+        sp[-2].as.integer = integer;
+        sp--;
+        break;
+      case (OP_SUBTRACT_INTEGER):
+        if ((sp[-2].type | sp[-1].type) != VALUE_INTEGER || __builtin_sub_overflow(sp[-2].as.integer, sp[-1].as.integer, &integer)) {
+          VM_BIGNUM_OPERATION(OP_SUBTRACT);
+        }
+        sp[-2].as.integer = integer;
+        sp--;
+        break;
+      case (OP_MULTIPLY_INTEGER):
+        if ((sp[-2].type | sp[-1].type) != VALUE_INTEGER || __builtin_mul_overflow(sp[-2].as.integer, sp[-1].as.integer, &integer)) {
+          VM_BIGNUM_OPERATION(OP_MULTIPLY);
+        }
+        sp[-2].as.integer = integer;
+        sp--;
+        break;
+      case (OP_DIVIDE_INTEGER):
+        if ((sp[-2].type | sp[-1].type) != VALUE_INTEGER || (sp[-2].as.integer == INT64_MIN && sp[-1].as.integer == -1)) {
+          VM_BIGNUM_OPERATION(OP_DIVIDE);
+        }
+        if (sp[-1].as.integer == 0) {
+          VM_FAIL("division by zero");
+        }
+        sp[-2].as.integer = sp[-2].as.integer / sp[-1].as.integer;
+        sp--;
+        break;
+      case (OP_NEGATE_DOUBLE):
+        sp[-1].as.number = -sp[-1].as.number;
+        break;
+      case (OP_ADD_DOUBLE):
+        sp[-2].as.number = sp[-2].as.number + sp[-1].as.number;
+        sp--;
+        break;
+      case (OP_SUBTRACT_DOUBLE):
+        sp[-2].as.number = sp[-2].as.number - sp[-1].as.number;
+        sp--;
+        break;
+      case (OP_MULTIPLY_DOUBLE):
+        sp[-2].as.number = sp[-2].as.number * sp[-1].as.number;
+        sp--;
+        break;
+      case (OP_DIVIDE_DOUBLE):
+        sp[-2].as.number = sp[-2].as.number / sp[-1].as.number;
+        sp--;
+        break;
+      case (OP_CONCATENATE):
+        VM_SYNC();
+        sp[-2] = vm_concatenate(ctx, &sp[-2], &sp[-1]);
+        sp--;
+        break;
+      case (OP_CHECK): {
+        value_type_t type = VM_READ_BYTE();
+        if (sp[-1].type != type && (sp[-1].type != VALUE_BIGNUM || type != VALUE_INTEGER)) {
+          VM_SYNC();
+          wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; expected %s, got %s.", frame->function->name, compiler.type_name(type), compiler.type_name(sp[-1].type));
+        }
+        break;
+      }
+      case (OP_REDUCE): {
+        reduction_t reduction = VM_READ_BYTE();
+        if (sp[-2].type == VALUE_VOID && sp[-3].type != VALUE_ARRAY) {
+          VM_FAIL("only arrays and ranges can be reduced");
+        }
+        if (sp[-2].type != VALUE_VOID && (sp[-3].type != VALUE_INTEGER || sp[-2].type != VALUE_INTEGER)) {
+          VM_FAIL(_vm_is_integer(sp - 3) && _vm_is_integer(sp - 2) ? "range bounds must fit in 64 bits" : "range bounds must be integers");
+        }
+        VM_SYNC();
+        sp[-3] = parallel_reduce(ctx, reduction, sp[-3], sp[-2], sp[-1]);
+        sp -= 2;
+        break;
+      }
+      case (OP_NEW):
+        VM_SYNC();
+        sp->type = VALUE_OBJECT;
+        sp->as.object = _vm_new_object(ctx);
+        sp++;
+        break;
+      case (OP_GET_MEMBER): {
+        member_cache_t *cache = &frame->function->chunk.caches[VM_READ_SHORT()];
+        if (sp[-1].type != VALUE_OBJECT) {
+          VM_FAIL("only objects have members");
+        }
+        object_t *object = sp[-1].as.object;
+        size_t i = 0;
+        while (i < cache->num_shapes && cache->entries[i].shape != object->shape) {
+          i++;
+        }
+        if (i < cache->num_shapes) {
+          sp[-1] = object->slots[cache->entries[i].slot];
+          break;
+        }
+        long slot = _vm_shape_slot(object->shape, cache->name);
+        if (slot < 0) {
+          VM_SYNC();
+          wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; the object has no member \"%s\".", frame->function->name, cache->name);
+        }
+        _vm_cache_add(ctx, cache, object->shape, object->shape, slot);
+        sp[-1] = object->slots[slot];
+        break;
+      }
+      case (OP_SET_MEMBER): {
+        member_cache_t *cache = &frame->function->chunk.caches[VM_READ_SHORT()];
+        if (sp[-2].type != VALUE_OBJECT) {
+          VM_FAIL("only objects have members");
+        }
+        object_t *object = sp[-2].as.object;
+        if (object->context != ctx) {
+          VM_FAIL(state->lane ? "objects are read only inside a parallel iterate unless it made them" : "the object belongs to another context");
+        }
+        shape_t *next;
+        size_t slot;
+        size_t i = 0;
+        while (i < cache->num_shapes && cache->entries[i].shape != object->shape) {
+          i++;
+        }
+        if (i < cache->num_shapes) {
+          next = cache->entries[i].next;
+          slot = cache->entries[i].slot;
+        } else {
+          long found = _vm_shape_slot(object->shape, cache->name);
+          VM_SYNC();
+          next = found < 0 ? _vm_shape_add(ctx, object->shape, cache->name) : object->shape;
+          slot = found < 0 ? next->num_members - 1 : (size_t) found;
+          _vm_cache_add(ctx, cache, object->shape, next, slot);
+        }
+        if (next != object->shape) {
+          if (next->num_members > object->slots_capacity) {
+            VM_SYNC();
+            object->slots_capacity = object->slots_capacity ? object->slots_capacity * 2 : 4;
+            object->slots = realloc(object->slots, object->slots_capacity * sizeof(value_t));
+          }
+          object->shape = next;
+        }
+        object->slots[slot] = sp[-1];
+        sp -= 2;
+        break;
+      }
+      case (OP_GET_INDEX):
+      case (OP_SET_INDEX): {
+        bool get = ip[-1] == OP_GET_INDEX;
+        a = get ? sp - 2 : sp - 3;
+        if (a->type != VALUE_ARRAY && (a->type != VALUE_STRING || !get)) {
+          VM_FAIL(get ? "only arrays and strings can be indexed" : "only arrays can be changed by index");
+        }
+        if (a[1].type != VALUE_INTEGER) {
+          VM_FAIL(a[1].type == VALUE_BIGNUM ? "index is out of range" : "indices must be integers");
+        }
+        // a string's element is the integer its byte holds, as for 'c'
+        VM_SYNC();
+        size_t length = a->type == VALUE_STRING ? vm_string_length(ctx, a) : a->as.array->length;
+        if (a[1].as.integer < 0 || (uint64_t) a[1].as.integer >= length) {
+          wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; index %lld is out of range for length %lld.", frame->function->name, (long long) a[1].as.integer, (long long) length);
+        }
+        if (a->type == VALUE_STRING) {
+          unsigned char byte = (unsigned char) vm_string_read(ctx, a, &length)[a[1].as.integer];
+          a->type = VALUE_INTEGER;
+          a->as.integer = byte;
+          sp--;
+          break;
+        }
+        array_t *array = a->as.array;
+        if (get) {
+          *a = vm_array_get(array, a[1].as.integer);
+          sp--;
+          break;
+        }
+        if (array->context != ctx) {
+          VM_FAIL(state->lane ? "arrays are read only inside a parallel iterate unless it made them" : "the array belongs to another context");
+        }
+        const char *error = vm_array_check(array, a[2]);
+        if (error) {
+          VM_FAIL(error);
+        }
+        vm_array_set(array, a[1].as.integer, a[2]);
+        sp -= 3;
+        break;
+      }
+      case (OP_CLOSURE): {
+        function_t *function = constants[VM_READ_SHORT()].as.function;
+        sp -= function->num_captures;
+        VM_SYNC();
+        closure_t *closure = _vm_new_closure(ctx, function, sp);
+        sp->type = VALUE_FUNCTION;
+        sp->as.function = &closure->function;
+        sp++;
+        break;
+      }
+      // compiled code only reaches out to the frames it is declared in, but
+      // an image's is checked before it loads only as far as its own frame,
+      // see _image_check_code, so the frames further out are checked here
+      case (OP_GET_CAPTURE): {
+        // the running closure, or the one a direct function is declared in, sits in its callee slot
+        uint8_t depth = VM_READ_BYTE();
+        uint16_t index = VM_READ_SHORT();
+        value_t *callee = (depth ? state->frames[state->num_frames - 1 - MIN(depth, state->num_frames - 1)].base : base) - 1;
+        if (depth && (depth >= state->num_frames || callee->type != VALUE_FUNCTION || !callee->as.function->closure || index >= callee->as.function->num_captures)) {
+          VM_FAIL("a capture reaches outside the frames running");
+        }
+        *sp++ = ((closure_t *) callee->as.function)->captures[index];
+        break;
+      }
+      case (OP_GET_ENCLOSING):
+      case (OP_SET_ENCLOSING): {
+        bool get = ip[-1] == OP_GET_ENCLOSING;
+        uint8_t depth = VM_READ_BYTE();
+        uint16_t slot = VM_READ_SHORT();
+        if (depth >= state->num_frames || slot >= state->frames[state->num_frames - 1 - depth].function->max_stack) {
+          VM_FAIL("a slot reaches outside the frames running");
+        }
+        if (get) {
+          *sp++ = state->frames[state->num_frames - 1 - depth].base[slot];
+        } else {
+          state->frames[state->num_frames - 1 - depth].base[slot] = *--sp;
+        }
+        break;
+      }
+      case (OP_BOX):
+        VM_SYNC();
+        a = sp - 1;
+        a->as.box = _vm_new_box(ctx, *a);
+        a->type = VALUE_BOX;
+        break;
+      case (OP_GET_BOX):
+        sp[-1] = sp[-1].as.box->value;
+        break;
+      case (OP_SET_BOX):
+        if (sp[-1].as.box->context != ctx) {
+          VM_FAIL(state->lane ? "captured locals are read only inside a parallel iterate" : "the local belongs to another context");
+        }
+        sp[-1].as.box->value = sp[-2];
+        sp -= 2;
+        break;
+      case (OP_RETURN): {
+        if (frame->generator) {
+          // finished; the OP_NEXT that resumed it runs again and leaves the loop
+          frame->generator->done = true;
+          frame->generator->running = false;
+          sp = base - 1;
+          state->num_frames--;
+          VM_LOAD();
+          ip -= 3;
+          break;
+        }
+        value_t result = sp[-1];
+        sp = base - 1;
+        *sp++ = result;
+        state->num_frames--;
+        if (state->num_frames == exit_depth) {
+          state->stack_top = sp;
+          return;
+        }
+        VM_LOAD();
+        break;
+      }
+      VM_PAIRS(VM_FUSED_PAIR)
+      VM_TRIPLES(VM_FUSED_TRIPLE)
+    }
+  }
+
+  #undef VM_SYNC
+  #undef VM_LOAD
+  #undef VM_FAIL
+  #undef VM_INTEGER_OPERANDS
+  #undef VM_DOUBLE_OPERATION
+  #undef VM_STEP
+  #undef VM_DO_CONSTANT
+  #undef VM_DO_GET_LOCAL
+  #undef VM_DO_SET_LOCAL
+  #undef VM_DO_GET_GLOBAL
+  #undef VM_DO_ADD
+  #undef VM_DO_SUBTRACT
+  #undef VM_DO_MULTIPLY
+  #undef VM_DO_LOOP
+  #undef VM_DO_EQUAL
+  #undef VM_DO_JUMP_IF_FALSE
+  #undef VM_FUSED_PAIR
+  #undef VM_FUSED_TRIPLE
+}
+
+// calls `callee` with `num_arguments` values and returns its result
+value_t vm_call (wtjl_context_t *ctx, value_t callee, size_t num_arguments, value_t *arguments) {
+  vm_state_t *state = &ctx->vm;
+  if (callee.type != VALUE_FUNCTION) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error; only functions can be called.");
+  }
+  if (callee.as.function->arity != num_arguments) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error; %s expects %d arguments, got %d.", callee.as.function->name, (int) callee.as.function->arity, (int) num_arguments);
+  }
+  _vm_reserve(ctx, state->stack_top, num_arguments + 1, callee.as.function->name);
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_VM);
+  if (callee.as.function->native) {
+    value_t result = callee.as.function->native(ctx, arguments);
+    wtjl_context_t_charge(ctx, charged);
+    return result;
+  }
+  size_t exit_depth = state->num_frames;
+  value_t *base = state->stack_top;
+  *state->stack_top++ = callee;
+  for (size_t i = 0; i < num_arguments; i++) {
+    *state->stack_top++ = arguments[i];
+  }
+  if (callee.as.function->generator) {
+    value_t result;
+    result.type = VALUE_GENERATOR;
+    result.as.generator = _vm_new_generator(ctx, callee.as.function, base);
+    state->stack_top = base;
+    wtjl_context_t_charge(ctx, charged);
+    return result;
+  }
+  _vm_push_frame(ctx, callee.as.function, base + 1);
+  _vm_run(ctx, exit_depth);
+  wtjl_context_t_charge(ctx, charged);
+  return *--state->stack_top;
+}
+
+// drops the frames above `num_frames` after a failure; generators caught
+// running are finished, as their saved state is stale
+void vm_unwind (wtjl_context_t *ctx, size_t num_frames) {
+  vm_state_t *state = &ctx->vm;
+  for (size_t i = num_frames; i < state->num_frames; i++) {
+    if (state->frames[i].generator) {
+      state->frames[i].generator->running = false;
+      state->frames[i].generator->done = true;
+    }
+  }
+  state->num_frames = num_frames;
+}
+
+void vm_execute (wtjl_context_t *ctx, function_t *script) {
+  value_t callee;
+  callee.type = VALUE_FUNCTION;
+  callee.as.function = script;
+  vm_call(ctx, callee, 0, NULL);
+}
+
+void vm_initialize (wtjl_context_t *ctx) {
+  vm_state_t *state = &ctx->vm;
+  state->stack_capacity = VM_STACK_CAPACITY;
+  state->stack = malloc(state->stack_capacity * sizeof(value_t));
+  state->stack_top = state->stack;
+  state->frames_capacity = VM_FRAMES_CAPACITY;
+  state->frames = malloc(state->frames_capacity * sizeof(call_frame_t));
+  state->num_frames = 0;
+  state->globals = NULL;
+  state->global_names = NULL;
+  state->num_globals = 0;
+  state->globals_capacity = 0;
+  state->functions = NULL;
+  state->num_functions = 0;
+  state->functions_capacity = 0;
+  state->strings = NULL;
+  state->num_strings = 0;
+  state->strings_capacity = 0;
+  state->generators = NULL;
+  state->num_generators = 0;
+  state->generators_capacity = 0;
+  state->num_escaped = 0;
+  state->lane = false;
+  state->root_shape = _vm_new_shape(NULL, NULL);
+  state->objects = NULL;
+  state->num_objects = 0;
+  state->objects_capacity = 0;
+  state->arrays = NULL;
+  state->num_arrays = 0;
+  state->arrays_capacity = 0;
+  state->bignums = NULL;
+  state->num_bignums = 0;
+  state->bignums_capacity = 0;
+  state->closures = NULL;
+  state->num_closures = 0;
+  state->closures_capacity = 0;
+  state->boxes = NULL;
+  state->num_boxes = 0;
+  state->boxes_capacity = 0;
+}
+
+void vm_cleanup (wtjl_context_t *ctx) {
+  vm_state_t *state = &ctx->vm;
+  for (size_t i = state->num_functions; i > 0; i--) {
+    compiler.free_function(ctx, state->functions[i - 1]);
+  }
+  for (size_t i = state->num_globals; i > 0; i--) {
+    free(state->global_names[i - 1]);
+  }
+  for (size_t i = state->num_strings; i > 0; i--) {
+    if (state->strings[i - 1]->rope) {
+      free(state->strings[i - 1]->chars);
+    }
+    free(state->strings[i - 1]);
+  }
+  for (size_t i = state->num_generators; i > 0; i--) {
+    free(state->generators[i - 1]);
+  }
+  for (size_t i = state->num_objects; i > 0; i--) {
+    free(state->objects[i - 1]->slots);
+    free(state->objects[i - 1]);
+  }
+  for (size_t i = state->num_arrays; i > 0; i--) {
+    free(state->arrays[i - 1]->as.bytes);
+    free(state->arrays[i - 1]);
+  }
+  for (size_t i = state->num_bignums; i > 0; i--) {
+    free(state->bignums[i - 1]);
+  }
+  // a closure shares its function's code, which the functions above own
+  for (size_t i = state->num_closures; i > 0; i--) {
+    free(state->closures[i - 1]);
+  }
+  for (size_t i = state->num_boxes; i > 0; i--) {
+    free(state->boxes[i - 1]);
+  }
+  _vm_free_shape(state->root_shape);
+  free(state->boxes);
+  free(state->closures);
+  free(state->bignums);
+  free(state->arrays);
+  free(state->objects);
+  free(state->generators);
+  free(state->strings);
+  free(state->functions);
+  free(state->globals);
+  free(state->global_names);
+  free(state->frames);
+  free(state->stack);
+  state->functions = NULL;
+  state->strings = NULL;
+  state->generators = NULL;
+  state->objects = NULL;
+  state->arrays = NULL;
+  state->bignums = NULL;
+  state->closures = NULL;
+  state->boxes = NULL;
+  state->root_shape = NULL;
+  state->globals = NULL;
+  state->global_names = NULL;
+  state->frames = NULL;
+  state->stack = NULL;
+  state->num_functions = 0;
+  state->num_strings = 0;
+  state->num_generators = 0;
+  state->num_objects = 0;
+  state->num_arrays = 0;
+  state->num_bignums = 0;
+  state->num_closures = 0;
+  state->num_boxes = 0;
+  state->num_globals = 0;
+}
+
+void setup_vm () {
+  vm.initialize = vm_initialize;
+  vm.cleanup = vm_cleanup;
+  vm.execute = vm_execute;
+  vm.call = vm_call;
+  vm.global_slot = vm_global_slot;
+  vm.find_global = vm_find_global;
+  vm.new_string = vm_new_string;
+  vm.string_chars = vm_string_chars;
+  vm.string = vm_string;
+  vm.string_read = vm_string_read;
+  vm.string_length = vm_string_length;
+  vm.concatenate = vm_concatenate;
+  vm.substring = vm_substring;
+  vm.define_natives = vm_define_natives;
+  vm.new_array = vm_new_array;
+  vm.array_get = vm_array_get;
+  vm.array_check = vm_array_check;
+  vm.array_set = vm_array_set;
+  vm.bignum = vm_bignum;
+  vm.arithmetic = vm_arithmetic;
+  vm.compare = vm_compare;
+  vm.unwind = vm_unwind;
+}
+
+/* end vm */
+
+/* ``begin parallel */
+
+// `iterate sum x in start, end -> ...` splits its range into chunks run on a
+// process wide pool of threads. The chunk size depends only on the range, and
+// chunk results are combined in order once every chunk is done, so a
+// reduction gives the same result, bit for bit, however many threads ran it.
+// `iterate sum x in array -> ...` is the same over the array's indices.
+//
+// Each participant starts with an equal share of the chunks in its own deque
+// of chunk indices, taking from the front; once that is empty it steals the
+// back half of another's. A participant runs its chunks on a lane, a private
+// context with its own stack and tracker that reads the caller's globals.
+
+#define PARALLEL_MAX_THREADS 64
+#define PARALLEL_MAX_CHUNKS 1024
+#define PARALLEL_MIN_CHUNK 64
+
+typedef struct _parallel_deque_t {
+  pthread_mutex_t lock;
+  size_t head; // next chunk its owner takes
+  size_t tail; // one past the last chunk left, where thieves take from
+} _parallel_deque_t;
+
+typedef struct _parallel_job_t {
+  wtjl_context_t *ctx; // the caller, whose globals its lanes read
+  reduction_t reduction;
+  value_t function;
+  array_t *array; // NULL over a range
+  int64_t start;
+  uint64_t length;
+  uint64_t chunk_size;
+  size_t num_chunks;
+  value_t *results; // one per chunk
+  size_t num_workers;
+  _parallel_deque_t deques [PARALLEL_MAX_THREADS];
+  pthread_mutex_t lock;
+  size_t failed; // the first chunk that failed, num_chunks while none has
+  char error [256];
+} _parallel_job_t;
+
+typedef struct _parallel_pool_t {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t idle;
+  pthread_t threads [PARALLEL_MAX_THREADS];
+  size_t num_threads; // participants in a job, its caller included; 0 until first used
+  bool stopping;
+  bool busy; // a job is running; jobs started meanwhile run on their caller alone
+  _parallel_job_t *job;
+  size_t generation; // counts jobs, so a worker can tell a new one from the last
+  size_t num_working; // workers not yet done with the job
+} _parallel_pool_t;
+
+_parallel_pool_t _parallel_pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+// folds `value` into `result`, which is undefined before the first; returns
+// what is wrong when they cannot be combined, NULL otherwise. A sum past an
+// int64 becomes a bignum of `ctx`
+const char *_parallel_combine (wtjl_context_t *ctx, reduction_t reduction, value_t *result, value_t value) {
+  double x;
+  double y;
+  if (value.type != VALUE_INTEGER && value.type != VALUE_DOUBLE && value.type != VALUE_BIGNUM) {
+    return "only numbers can be reduced";
+  }
+  if (result->type == VALUE_UNDEFINED) {
+    *result = value;
+    return NULL;
+  }
+  if (reduction == REDUCE_SUM) {
+    int64_t integer;
+    if (_vm_double_operands(result, &value, &x, &y)) {
+      result->type = VALUE_DOUBLE;
+      result->as.number = x + y;
+    } else if (result->type != VALUE_INTEGER || value.type != VALUE_INTEGER || __builtin_add_overflow(result->as.integer, value.as.integer, &integer)) {
+      *result = vm.arithmetic(ctx, "iterate", OP_ADD, result, &value);
+    } else {
+      result->as.integer = integer;
+    }
+    return NULL;
+  }
+  // ties keep the earlier value, so an integer and an equal double never swap
+  int order = vm.compare(&value, result);
+  if (order == (reduction == REDUCE_MIN ? -1 : 1)) {
+    *result = value;
+  }
+  return NULL;
+}
+
+wtjl_context_t *_parallel_lane_new (wtjl_context_t *ctx) {
+  // calloc'd directly like a context, with everything it holds recorded
+  // against its own tracker
+  wtjl_context_t *lane = calloc(1, sizeof(wtjl_context_t));
+  j_mem_t *previous_mem = j_mem_bind(&lane->mem);
+  vm.initialize(lane);
+  j_mem_bind(previous_mem);
+  lane->vm.globals = ctx->vm.globals;
+  lane->vm.global_names = ctx->vm.global_names;
+  lane->vm.num_globals = ctx->vm.num_globals;
+  lane->vm.lane = true;
+  return lane;
+}
+
+// only numbers leave a lane, so nothing it made outlives the job
+void _parallel_lane_destroy (wtjl_context_t *lane) {
+  j_mem_reset(&lane->mem);
+  (free)(lane);
+}
+
+void _parallel_run_chunk (_parallel_job_t *job, wtjl_context_t *lane, size_t chunk) {
+  jmp_buf jmp;
+  j_mem_t *previous_mem = j_mem_bind(&lane->mem);
+  lane->_error_jmp = &jmp;
+  if (setjmp(jmp) == 0) {
+    int64_t first = job->start + (int64_t) (chunk * job->chunk_size);
+    int64_t count = (int64_t) MIN(job->chunk_size, job->length - chunk * job->chunk_size);
+    value_t result;
+    result.type = VALUE_UNDEFINED;
+    for (int64_t i = 0; i < count; i++) {
+      value_t argument;
+      argument.type = VALUE_INTEGER;
+      argument.as.integer = first + i;
+      if (job->array) {
+        argument = vm.array_get(job->array, (size_t) argument.as.integer);
+      }
+      const char *error = _parallel_combine(lane, job->reduction, &result, vm.call(lane, job->function, 1, &argument));
+      if (error) {
+        wtjl_context_t_fail(lane, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s.", job->function.as.function->name, error);
+      }
+    }
+    // a bignum would die with the lane, so it leaves as an untracked copy
+    // the caller takes over
+    if (result.type == VALUE_BIGNUM) {
+      size_t size = sizeof(bignum_t) + result.as.bignum->length * sizeof(uint64_t);
+      result.as.bignum = memcpy((malloc)(size), result.as.bignum, size);
+    }
+    job->results[chunk] = result;
+  } else {
+    vm.unwind(lane, 0);
+    lane->vm.stack_top = lane->vm.stack;
+    pthread_mutex_lock(&job->lock);
+    if (chunk < job->failed) {
+      __atomic_store_n(&job->failed, chunk, __ATOMIC_RELAXED);
+      memcpy(job->error, lane->error, sizeof(job->error));
+    }
+    pthread_mutex_unlock(&job->lock);
+  }
+  lane->_error_jmp = NULL;
+  j_mem_bind(previous_mem);
+}
+
+// the next chunk for participant `index`, from its own deque or, once that
+// is empty, from the back half of another's; false when none are left
+bool _parallel_take (_parallel_job_t *job, size_t index, size_t *chunk) {
+  _parallel_deque_t *own = &job->deques[index];
+  pthread_mutex_lock(&own->lock);
+  bool taken = own->head < own->tail;
+  if (taken) {
+    *chunk = own->head++;
+  }
+  pthread_mutex_unlock(&own->lock);
+  for (size_t i = 1; !taken && i < job->num_workers; i++) {
+    _parallel_deque_t *victim = &job->deques[(index + i) % job->num_workers];
+    pthread_mutex_lock(&victim->lock);
+    size_t num_stolen = (victim->tail - victim->head + 1) / 2;
+    size_t end = victim->tail;
+    victim->tail -= num_stolen;
+    pthread_mutex_unlock(&victim->lock);
+    if (num_stolen) {
+      taken = true;
+      *chunk = end - num_stolen;
+      pthread_mutex_lock(&own->lock);
+      own->head = *chunk + 1;
+      own->tail = end;
+      pthread_mutex_unlock(&own->lock);
+    }
+  }
+  return taken;
+}
+
+void _parallel_work (_parallel_job_t *job, size_t index) {
+  wtjl_context_t *lane = NULL;
+  size_t chunk;
+  while (_parallel_take(job, index, &chunk)) {
+    // whatever a later chunk gives, an earlier failure is what gets reported
+    if (chunk > __atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+      continue;
+    }
+    if (!lane) {
+      lane = _parallel_lane_new(job->ctx);
+    }
+    _parallel_run_chunk(job, lane, chunk);
+  }
+  if (lane) {
+    _parallel_lane_destroy(lane);
+  }
+}
+
+void *_parallel_worker (void *argument) {
+  _parallel_pool_t *pool = &_parallel_pool;
+  size_t index = (size_t) argument;
+  size_t generation = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (; ; ) {
+    while (!pool->stopping && (!pool->job || pool->generation == generation)) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    generation = pool->generation;
+    _parallel_job_t *job = pool->job;
+    pthread_mutex_unlock(&pool->lock);
+    _parallel_work(job, index);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->num_working == 0) {
+      pthread_cond_broadcast(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// both with the pool locked, and no job running
+void _parallel_start (size_t num_threads) {
+  _parallel_pool_t *pool = &_parallel_pool;
+  pool->num_threads = 1;
+  while (pool->num_threads < num_threads) {
+    if (pthread_create(&pool->threads[pool->num_threads], NULL, _parallel_worker, (void *) pool->num_threads) != 0) {
+      break;
+    }
+    pool->num_threads++;
+  }
+}
+
+void _parallel_stop () {
+  _parallel_pool_t *pool = &_parallel_pool;
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t i = 1; i < pool->num_threads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = false;
+  pool->num_threads = 0;
+}
+
+// WTJL_THREADS when it is set, one per online core otherwise
+size_t _parallel_default_threads () {
+  const char *threads = getenv("WTJL_THREADS");
+  long num_threads = threads ? atol(threads) : sysconf(_SC_NPROCESSORS_ONLN);
+  return (size_t) MAX(1, MIN(num_threads, PARALLEL_MAX_THREADS));
+}
+
+// how many threads run a parallel iterate, its caller included
+size_t parallel_threads () {
+  _parallel_pool_t *pool = &_parallel_pool;
+  pthread_mutex_lock(&pool->lock);
+  if (!pool->num_threads) {
+    _parallel_start(_parallel_default_threads());
+  }
+  size_t num_threads = pool->num_threads;
+  pthread_mutex_unlock(&pool->lock);
+  return num_threads;
+}
+
+// replaces the pool once the job running on it, if any, is done
+void parallel_set_threads (size_t num_threads) {
+  _parallel_pool_t *pool = &_parallel_pool;
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  if (pool->num_threads) {
+    _parallel_stop();
+  }
+  _parallel_start(MAX(1, MIN(num_threads, PARALLEL_MAX_THREADS)));
+  pthread_mutex_unlock(&pool->lock);
+}
+
+// lanes read the caller's strings from several threads at once, so none may
+// still be waiting to be decoded in place
+void _parallel_decode_strings (wtjl_context_t *ctx) {
+  for (size_t i = 0; ctx->vm.num_escaped && i < ctx->vm.num_strings; i++) {
+    if (ctx->vm.strings[i]->escaped) {
+      vm.string_chars(ctx, ctx->vm.strings[i]);
+    }
+  }
+}
+
+// `function` over every integer in [start, end), or every element of the
+// array `start` when `end` is void; a sum of nothing is 0, and the minimum or
+// maximum of nothing an error
+value_t parallel_reduce (wtjl_context_t *ctx, reduction_t reduction, value_t start, value_t end, value_t function) {
+  _parallel_pool_t *pool = &_parallel_pool;
+  _parallel_job_t job;
+  job.ctx = ctx;
+  job.reduction = reduction;
+  job.function = function;
+  job.array = end.type == VALUE_VOID ? start.as.array : NULL;
+  job.start = job.array ? 0 : start.as.integer;
+  if (job.array) {
+    job.length = job.array->length;
+  } else {
+    job.length = end.as.integer > start.as.integer ? (uint64_t) end.as.integer - (uint64_t) start.as.integer : 0;
+  }
+  job.chunk_size = MAX(PARALLEL_MIN_CHUNK, job.length / PARALLEL_MAX_CHUNKS + 1);
+  job.num_chunks = job.length / job.chunk_size + (job.length % job.chunk_size != 0);
+  job.results = malloc(MAX(job.num_chunks, 1) * sizeof(value_t));
+  for (size_t i = 0; i < job.num_chunks; i++) {
+    job.results[i].type = VALUE_UNDEFINED;
+  }
+  job.failed = job.num_chunks;
+  pthread_mutex_init(&job.lock, NULL);
+  _parallel_decode_strings(ctx);
+  pthread_mutex_lock(&pool->lock);
+  if (!pool->num_threads) {
+    _parallel_start(_parallel_default_threads());
+  }
+  // one started while another runs, from a lane or another context, runs on
+  // its caller alone
+  bool shared = !pool->busy;
+  job.num_workers = shared ? pool->num_threads : 1;
+  for (size_t i = 0; i < job.num_workers; i++) {
+    pthread_mutex_init(&job.deques[i].lock, NULL);
+    job.deques[i].head = job.num_chunks * i / job.num_workers;
+    job.deques[i].tail = job.num_chunks * (i + 1) / job.num_workers;
+  }
+  if (shared) {
+    pool->busy = true;
+    pool->job = &job;
+    pool->generation++;
+    pool->num_working = pool->num_threads - 1;
+    pthread_cond_broadcast(&pool->wake);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  _parallel_work(&job, 0);
+  if (shared) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->num_working) {
+      pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pool->job = NULL;
+    pool->busy = false;
+    pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  for (size_t i = 0; i < job.num_workers; i++) {
+    pthread_mutex_destroy(&job.deques[i].lock);
+  }
+  pthread_mutex_destroy(&job.lock);
+  for (size_t i = 0; i < job.num_chunks; i++) {
+    if (job.results[i].type == VALUE_BIGNUM) {
+      bignum_t *copy = job.results[i].as.bignum;
+      size_t size = sizeof(bignum_t) + copy->length * sizeof(uint64_t);
+      job.results[i] = vm.bignum(ctx, memcpy(malloc(size), copy, size));
+      (free)(copy);
+    }
+  }
+  value_t result;
+  result.type = VALUE_UNDEFINED;
+  const char *error = NULL;
+  for (size_t i = 0; job.failed == job.num_chunks && !error && i < job.num_chunks; i++) {
+    error = _parallel_combine(ctx, reduction, &result, job.results[i]);
+  }
+  free(job.results);
+  if (job.failed < job.num_chunks) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "%s", job.error);
+  }
+  if (error) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s.", function.as.function->name, error);
+  }
+  if (result.type == VALUE_UNDEFINED) {
+    if (reduction != REDUCE_SUM) {
+      wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s of an empty %s.", function.as.function->name, reduction == REDUCE_MIN ? "min" : "max", job.array ? "array" : "range");
+    }
+    result.type = VALUE_INTEGER;
+    result.as.integer = 0;
+  }
+  return result;
+}
+
+/* end parallel */
+
+/* ``begin arrays */
+
+// array(n) makes an array of n values, integers(n) and bytes(n) packed ones of
+// int64s and uint8s. The builtins below work on any array; over packed ones
+// they run 32 bytes at a time with AVX2 where the cpu has it, and finish,
+// or fall back, element by element.
+
+#define ARRAYS_MAX_LENGTH ((int64_t) 1 << 32)
+
+bool _arrays_avx2 = false; // whether the cpu has AVX2; benches turn it off to compare
+
+#ifdef __x86_64__
+
+// each kernel runs over whole blocks of `x` and returns where it stopped, for
+// the scalar loop after it to finish
+
+__attribute__((target("avx2")))
+size_t _arrays_integer_bounds_avx2 (const int64_t *x, size_t length, int64_t *min, int64_t *max) {
+  if (length < 4) {
+    return 0;
+  }
+  __m256i low = _mm256_loadu_si256((const __m256i *) x);
+  __m256i high = low;
+  size_t i = 4;
+  for (; i + 4 <= length; i += 4) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    low = _mm256_blendv_epi8(low, chunk, _mm256_cmpgt_epi64(low, chunk));
+    high = _mm256_blendv_epi8(high, chunk, _mm256_cmpgt_epi64(chunk, high));
+  }
+  int64_t lows [4];
+  int64_t highs [4];
+  _mm256_storeu_si256((__m256i *) lows, low);
+  _mm256_storeu_si256((__m256i *) highs, high);
+  *min = MIN(MIN(lows[0], lows[1]), MIN(lows[2], lows[3]));
+  *max = MAX(MAX(highs[0], highs[1]), MAX(highs[2], highs[3]));
+  return i;
+}
+
+// leaves `sum` alone and returns 0 when a lane overflows
+__attribute__((target("avx2")))
+size_t _arrays_integer_sum_avx2 (const int64_t *x, size_t length, __int128 *sum) {
+  __m256i total = _mm256_setzero_si256();
+  __m256i overflow = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    __m256i next = _mm256_add_epi64(total, chunk);
+    overflow = _mm256_or_si256(overflow, _mm256_and_si256(_mm256_xor_si256(total, next), _mm256_xor_si256(chunk, next)));
+    total = next;
+  }
+  if (_mm256_movemask_pd(_mm256_castsi256_pd(overflow))) {
+    return 0;
+  }
+  int64_t lanes [4];
+  _mm256_storeu_si256((__m256i *) lanes, total);
+  *sum = (__int128) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_integer_fill_avx2 (int64_t *x, size_t length, int64_t value) {
+  __m256i all = _mm256_set1_epi64x(value);
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    _mm256_storeu_si256((__m256i *) (x + i), all);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_integer_add_avx2 (int64_t *x, size_t length, int64_t k) {
+  __m256i all = _mm256_set1_epi64x(k);
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    _mm256_storeu_si256((__m256i *) (x + i), _mm256_add_epi64(chunk, all));
+  }
+  return i;
+}
+
+// AVX2 has no 64 bit multiply; the low 64 bits of a product are built from
+// 32 bit halves, which is the same for signed and unsigned operands
+__attribute__((target("avx2")))
+size_t _arrays_integer_multiply_avx2 (int64_t *x, size_t length, int64_t k) {
+  __m256i all = _mm256_set1_epi64x(k);
+  __m256i all_high = _mm256_srli_epi64(all, 32);
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    __m256i low = _mm256_mul_epu32(chunk, all);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(chunk, 32), all), _mm256_mul_epu32(chunk, all_high));
+    _mm256_storeu_si256((__m256i *) (x + i), _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32)));
+  }
+  return i;
+}
+
+// stops at the block holding the first match
+__attribute__((target("avx2")))
+size_t _arrays_integer_find_avx2 (const int64_t *x, size_t length, int64_t value) {
+  __m256i all = _mm256_set1_epi64x(value);
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    __m256i matches = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (x + i)), all);
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(matches))) {
+      break;
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_integer_count_avx2 (const int64_t *x, size_t length, int64_t value, size_t *count) {
+  __m256i all = _mm256_set1_epi64x(value);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    // matching lanes are -1
+    total = _mm256_sub_epi64(total, _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (x + i)), all));
+  }
+  int64_t lanes [4];
+  _mm256_storeu_si256((__m256i *) lanes, total);
+  *count += (size_t) (lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_byte_bounds_avx2 (const uint8_t *x, size_t length, int64_t *min, int64_t *max) {
+  if (length < 32) {
+    return 0;
+  }
+  __m256i low = _mm256_loadu_si256((const __m256i *) x);
+  __m256i high = low;
+  size_t i = 32;
+  for (; i + 32 <= length; i += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    low = _mm256_min_epu8(low, chunk);
+    high = _mm256_max_epu8(high, chunk);
+  }
+  uint8_t lows [32];
+  uint8_t highs [32];
+  _mm256_storeu_si256((__m256i *) lows, low);
+  _mm256_storeu_si256((__m256i *) highs, high);
+  *min = lows[0];
+  *max = highs[0];
+  for (size_t j = 1; j < 32; j++) {
+    *min = MIN(*min, lows[j]);
+    *max = MAX(*max, highs[j]);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_byte_sum_avx2 (const uint8_t *x, size_t length, __int128 *sum) {
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *) (x + i)), _mm256_setzero_si256()));
+  }
+  int64_t lanes [4];
+  _mm256_storeu_si256((__m256i *) lanes, total);
+  *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_byte_add_avx2 (uint8_t *x, size_t length, int64_t k) {
+  __m256i all = _mm256_set1_epi8((char) k);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) (x + i));
+    _mm256_storeu_si256((__m256i *) (x + i), _mm256_add_epi8(chunk, all));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_byte_find_avx2 (const uint8_t *x, size_t length, int64_t value) {
+  __m256i all = _mm256_set1_epi8((char) value);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (x + i)), all));
+    if (mask) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t _arrays_byte_count_avx2 (const uint8_t *x, size_t length, int64_t value, size_t *count) {
+  __m256i all = _mm256_set1_epi8((char) value);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (x + i)), all));
+    *count += __builtin_popcount(mask);
+  }
+  return i;
+}
+
+#endif
+
+// the packed kernels, by kind; `value` and `k` already fit the array
+
+// `array` is not empty
+void _arrays_bounds (array_t *array, int64_t *min, int64_t *max) {
+  size_t i = 0;
+  *min = *max = array->kind == ARRAY_INTEGERS ? array->as.integers[0] : array->as.bytes[0];
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = array->kind == ARRAY_INTEGERS ? _arrays_integer_bounds_avx2(array->as.integers, array->length, min, max) : _arrays_byte_bounds_avx2(array->as.bytes, array->length, min, max);
+  }
+#endif
+  for (; array->kind == ARRAY_INTEGERS && i < array->length; i++) {
+    *min = MIN(*min, array->as.integers[i]);
+    *max = MAX(*max, array->as.integers[i]);
+  }
+  for (; array->kind == ARRAY_BYTES && i < array->length; i++) {
+    *min = MIN(*min, array->as.bytes[i]);
+    *max = MAX(*max, array->as.bytes[i]);
+  }
+}
+
+// exact, as no packed array is long enough to overflow 128 bits
+__int128 _arrays_sum (array_t *array) {
+  __int128 sum = 0;
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = array->kind == ARRAY_INTEGERS ? _arrays_integer_sum_avx2(array->as.integers, array->length, &sum) : _arrays_byte_sum_avx2(array->as.bytes, array->length, &sum);
+  }
+#endif
+  for (; array->kind == ARRAY_INTEGERS && i < array->length; i++) {
+    sum += array->as.integers[i];
+  }
+  for (; array->kind == ARRAY_BYTES && i < array->length; i++) {
+    sum += array->as.bytes[i];
+  }
+  return sum;
+}
+
+void _arrays_fill (array_t *array, int64_t value) {
+  if (array->kind == ARRAY_BYTES) {
+    memset(array->as.bytes, (int) value, array->length);
+    return;
+  }
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = _arrays_integer_fill_avx2(array->as.integers, array->length, value);
+  }
+#endif
+  for (; i < array->length; i++) {
+    array->as.integers[i] = value;
+  }
+}
+
+void _arrays_add (array_t *array, int64_t k) {
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = array->kind == ARRAY_INTEGERS ? _arrays_integer_add_avx2(array->as.integers, array->length, k) : _arrays_byte_add_avx2(array->as.bytes, array->length, k);
+  }
+#endif
+  for (; array->kind == ARRAY_INTEGERS && i < array->length; i++) {
+    array->as.integers[i] += k;
+  }
+  for (; array->kind == ARRAY_BYTES && i < array->length; i++) {
+    array->as.bytes[i] += (uint8_t) k;
+  }
+}
+
+// AVX2 has no byte multiply, so bytes are always multiplied one by one
+void _arrays_multiply (array_t *array, int64_t k) {
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2 && array->kind == ARRAY_INTEGERS) {
+    i = _arrays_integer_multiply_avx2(array->as.integers, array->length, k);
+  }
+#endif
+  for (; array->kind == ARRAY_INTEGERS && i < array->length; i++) {
+    array->as.integers[i] *= k;
+  }
+  for (; array->kind == ARRAY_BYTES && i < array->length; i++) {
+    array->as.bytes[i] *= (uint8_t) k;
+  }
+}
+
+// the first index holding `value`, the length when none does
+size_t _arrays_find (array_t *array, int64_t value) {
+  if (array->kind == ARRAY_BYTES && !_arrays_avx2) {
+    uint8_t *found = memchr(array->as.bytes, (int) value, array->length);
+    return found ? (size_t) (found - array->as.bytes) : array->length;
+  }
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = array->kind == ARRAY_INTEGERS ? _arrays_integer_find_avx2(array->as.integers, array->length, value) : _arrays_byte_find_avx2(array->as.bytes, array->length, value);
+  }
+#endif
+  while (array->kind == ARRAY_INTEGERS && i < array->length && array->as.integers[i] != value) {
+    i++;
+  }
+  while (array->kind == ARRAY_BYTES && i < array->length && array->as.bytes[i] != value) {
+    i++;
+  }
+  return i;
+}
+
+size_t _arrays_count (array_t *array, int64_t value) {
+  size_t count = 0;
+  size_t i = 0;
+#ifdef __x86_64__
+  if (_arrays_avx2) {
+    i = array->kind == ARRAY_INTEGERS ? _arrays_integer_count_avx2(array->as.integers, array->length, value, &count) : _arrays_byte_count_avx2(array->as.bytes, array->length, value, &count);
+  }
+#endif
+  for (; array->kind == ARRAY_INTEGERS && i < array->length; i++) {
+    count += array->as.integers[i] == value;
+  }
+  for (; array->kind == ARRAY_BYTES && i < array->length; i++) {
+    count += array->as.bytes[i] == value;
+  }
+  return count;
+}
+
+// the builtins
+
+value_t _arrays_integer (int64_t integer) {
+  value_t value;
+  value.type = VALUE_INTEGER;
+  value.as.integer = integer;
+  return value;
+}
+
+void _arrays_fail (wtjl_context_t *ctx, const char *name, const char *error) {
+  wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in %s; %s.", name, error);
+}
+
+array_t *_arrays_argument (wtjl_context_t *ctx, const char *name, value_t *argument) {
+  if (argument->type != VALUE_ARRAY) {
+    _arrays_fail(ctx, name, "expects an array");
+  }
+  return argument->as.array;
+}
+
+// as in the vm, only the context that made an array may change it
+array_t *_arrays_writable (wtjl_context_t *ctx, const char *name, value_t *argument) {
+  array_t *array = _arrays_argument(ctx, name, argument);
+  if (array->context != ctx) {
+    _arrays_fail(ctx, name, ctx->vm.lane ? "arrays are read only inside a parallel iterate unless it made them" : "the array belongs to another context");
+  }
+  return array;
+}
+
+value_t _arrays_new (wtjl_context_t *ctx, const char *name, array_kind_t kind, value_t *arguments) {
+  if (arguments[0].type != VALUE_INTEGER || arguments[0].as.integer < 0 || arguments[0].as.integer > ARRAYS_MAX_LENGTH) {
+    _arrays_fail(ctx, name, "lengths must be integers from 0 to 2^32");
+  }
+  value_t value;
+  value.type = VALUE_ARRAY;
+  value.as.array = vm.new_array(ctx, kind, (size_t) arguments[0].as.integer);
+  return value;
+}
+
+value_t _arrays_array (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_new(ctx, "array", ARRAY_VALUES, arguments);
+}
+
+value_t _arrays_integers (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_new(ctx, "integers", ARRAY_INTEGERS, arguments);
+}
+
+value_t _arrays_bytes (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_new(ctx, "bytes", ARRAY_BYTES, arguments);
+}
+
+// of strings too
+value_t _arrays_length (wtjl_context_t *ctx, value_t *arguments) {
+  if (arguments[0].type == VALUE_STRING) {
+    return _arrays_integer((int64_t) vm.string_length(ctx, &arguments[0]));
+  }
+  return _arrays_integer((int64_t) _arrays_argument(ctx, "length", &arguments[0])->length);
+}
+
+// a packed sum is a bignum only when the total does not fit, however it was
+// added up; a sum of values adds them in order, like iterate sum
+value_t _arrays_sum_native (wtjl_context_t *ctx, value_t *arguments) {
+  array_t *array = _arrays_argument(ctx, "sum", &arguments[0]);
+  if (array->kind != ARRAY_VALUES) {
+    __int128 sum = _arrays_sum(array);
+    if (sum >= INT64_MIN && sum <= INT64_MAX) {
+      return _arrays_integer((int64_t) sum);
+    }
+    unsigned __int128 magnitude = sum < 0 ? 0 - (unsigned __int128) sum : (unsigned __int128) sum;
+    bignum_t *total = malloc(sizeof(bignum_t) + 2 * sizeof(uint64_t));
+    total->negative = sum < 0;
+    total->limbs[0] = (uint64_t) magnitude;
+    total->limbs[1] = (uint64_t) (magnitude >> 64);
+    total->length = total->limbs[1] ? 2 : 1;
+    return vm.bignum(ctx, total);
+  }
+  value_t result;
+  result.type = VALUE_UNDEFINED;
+  for (size_t i = 0; i < array->length; i++) {
+    const char *error = _parallel_combine(ctx, REDUCE_SUM, &result, array->as.values[i]);
+    if (error) {
+      _arrays_fail(ctx, "sum", error);
+    }
+  }
+  return result.type == VALUE_UNDEFINED ? _arrays_integer(0) : result;
+}
+
+value_t _arrays_bound (wtjl_context_t *ctx, const char *name, reduction_t reduction, value_t *arguments) {
+  array_t *array = _arrays_argument(ctx, name, &arguments[0]);
+  if (!array->length) {
+    _arrays_fail(ctx, name, reduction == REDUCE_MIN ? "min of an empty array" : "max of an empty array");
+  }
+  if (array->kind != ARRAY_VALUES) {
+    int64_t min;
+    int64_t max;
+    _arrays_bounds(array, &min, &max);
+    return _arrays_integer(reduction == REDUCE_MIN ? min : max);
+  }
+  value_t result;
+  result.type = VALUE_UNDEFINED;
+  for (size_t i = 0; i < array->length; i++) {
+    const char *error = _parallel_combine(ctx, reduction, &result, array->as.values[i]);
+    if (error) {
+      _arrays_fail(ctx, name, error);
+    }
+  }
+  return result;
+}
+
+value_t _arrays_min (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_bound(ctx, "min", REDUCE_MIN, arguments);
+}
+
+value_t _arrays_max (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_bound(ctx, "max", REDUCE_MAX, arguments);
+}
+
+value_t _arrays_fill_native (wtjl_context_t *ctx, value_t *arguments) {
+  array_t *array = _arrays_writable(ctx, "fill", &arguments[0]);
+  const char *error = vm.array_check(array, arguments[1]);
+  if (error) {
+    _arrays_fail(ctx, "fill", error);
+  }
+  if (array->kind != ARRAY_VALUES) {
+    _arrays_fill(array, arguments[1].as.integer);
+  }
+  for (size_t i = 0; array->kind == ARRAY_VALUES && i < array->length; i++) {
+    array->as.values[i] = arguments[1];
+  }
+  return arguments[0];
+}
+
+// `a` op `k` into `result`, as the vm's + and * do; what is wrong otherwise
+const char *_arrays_apply (wtjl_context_t *ctx, bool multiply, value_t a, value_t k, value_t *result) {
+  double x;
+  double y;
+  if ((!_vm_is_integer(&a) && a.type != VALUE_DOUBLE) || (!_vm_is_integer(&k) && k.type != VALUE_DOUBLE)) {
+    return "only numbers can be added or multiplied";
+  }
+  if (_vm_double_operands(&a, &k, &x, &y)) {
+    result->type = VALUE_DOUBLE;
+    result->as.number = multiply ? x * y : x + y;
+    return NULL;
+  }
+  result->type = VALUE_INTEGER;
+  if (a.type != VALUE_INTEGER || k.type != VALUE_INTEGER || (multiply ? __builtin_mul_overflow(a.as.integer, k.as.integer, &result->as.integer) : __builtin_add_overflow(a.as.integer, k.as.integer, &result->as.integer))) {
+    *result = vm.arithmetic(ctx, multiply ? "multiply" : "add", multiply ? OP_MULTIPLY : OP_ADD, &a, &k);
+  }
+  return NULL;
+}
+
+// changes every element of the array in place, or none of them when one
+// cannot be changed; a packed array is checked through its bounds, as the
+// results are monotonic in each element
+value_t _arrays_map (wtjl_context_t *ctx, const char *name, bool multiply, value_t *arguments) {
+  array_t *array = _arrays_writable(ctx, name, &arguments[0]);
+  value_t k = arguments[1];
+  if (array->kind == ARRAY_VALUES) {
+    value_t *results = malloc(MAX(array->length, 1) * sizeof(value_t));
+    for (size_t i = 0; i < array->length; i++) {
+      const char *error = _arrays_apply(ctx, multiply, array->as.values[i], k, &results[i]);
+      if (error) {
+        free(results);
+        _arrays_fail(ctx, name, error);
+      }
+    }
+    memcpy(array->as.values, results, array->length * sizeof(value_t));
+    free(results);
+    return arguments[0];
+  }
+  if (k.type != VALUE_INTEGER) {
+    _arrays_fail(ctx, name, k.type == VALUE_BIGNUM ? "the integer does not fit in 64 bits" : "the array holds only integers");
+  }
+  if (!array->length) {
+    return arguments[0];
+  }
+  int64_t min;
+  int64_t max;
+  value_t low;
+  value_t high;
+  _arrays_bounds(array, &min, &max);
+  const char *error = _arrays_apply(ctx, multiply, _arrays_integer(min), k, &low);
+  if (!error) {
+    error = _arrays_apply(ctx, multiply, _arrays_integer(max), k, &high);
+  }
+  if (!error) {
+    error = vm.array_check(array, low);
+  }
+  if (!error) {
+    error = vm.array_check(array, high);
+  }
+  if (error) {
+    _arrays_fail(ctx, name, error);
+  }
+  if (multiply) {
+    _arrays_multiply(array, k.as.integer);
+  } else {
+    _arrays_add(array, k.as.integer);
+  }
+  return arguments[0];
+}
+
+value_t _arrays_add_native (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_map(ctx, "add", false, arguments);
+}
+
+value_t _arrays_multiply_native (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_map(ctx, "multiply", true, arguments);
+}
+
+// the same length and elements that are =
+value_t _arrays_equal (wtjl_context_t *ctx, value_t *arguments) {
+  array_t *a = _arrays_argument(ctx, "equal", &arguments[0]);
+  array_t *b = _arrays_argument(ctx, "equal", &arguments[1]);
+  value_t result;
+  result.type = VALUE_BOOLEAN;
+  result.as.boolean = a->length == b->length;
+  if (result.as.boolean && a->kind == b->kind && a->kind != ARRAY_VALUES) {
+    // memcmp is vectorised already
+    result.as.boolean = memcmp(a->as.bytes, b->as.bytes, a->length * (a->kind == ARRAY_INTEGERS ? sizeof(int64_t) : sizeof(uint8_t))) == 0;
+    return result;
+  }
+  for (size_t i = 0; result.as.boolean && i < a->length; i++) {
+    value_t x = vm.array_get(a, i);
+    value_t y = vm.array_get(b, i);
+    result.as.boolean = _vm_equal(ctx, &x, &y);
+  }
+  return result;
+}
+
+// what a packed array must hold to be = `value`, false when it cannot; doubles
+// are left to _vm_equal, as large integers compare equal to nearby doubles
+bool _arrays_packed_key (array_t *array, value_t value, bool *boxed, int64_t *key) {
+  *boxed = value.type == VALUE_DOUBLE;
+  *key = value.as.integer;
+  return value.type == VALUE_INTEGER && !vm.array_check(array, value);
+}
+
+value_t _arrays_search (wtjl_context_t *ctx, const char *name, bool count, value_t *arguments) {
+  array_t *array = _arrays_argument(ctx, name, &arguments[0]);
+  size_t found = array->length;
+  size_t matches = 0;
+  bool boxed = array->kind == ARRAY_VALUES;
+  int64_t key;
+  if (!boxed && _arrays_packed_key(array, arguments[1], &boxed, &key)) {
+    found = count ? array->length : _arrays_find(array, key);
+    matches = count ? _arrays_count(array, key) : 0;
+  }
+  for (size_t i = 0; boxed && i < array->length && (count || found == array->length); i++) {
+    value_t element = vm.array_get(array, i);
+    if (_vm_equal(ctx, &element, &arguments[1])) {
+      found = MIN(found, i);
+      matches++;
+    }
+  }
+  return _arrays_integer(count ? (int64_t) matches : found < array->length ? (int64_t) found : -1);
+}
+
+// the first index holding something = `value`, -1 when none does
+value_t _arrays_find_native (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_search(ctx, "find", false, arguments);
+}
+
+value_t _arrays_count_native (wtjl_context_t *ctx, value_t *arguments) {
+  return _arrays_search(ctx, "count", true, arguments);
+}
+
+function_t _arrays_builtins [] = {
+  {.name = "array", .arity = 1, .native = _arrays_array},
+  {.name = "integers", .arity = 1, .native = _arrays_integers},
+  {.name = "bytes", .arity = 1, .native = _arrays_bytes},
+  {.name = "length", .arity = 1, .native = _arrays_length},
+  {.name = "sum", .arity = 1, .native = _arrays_sum_native},
+  {.name = "min", .arity = 1, .native = _arrays_min},
+  {.name = "max", .arity = 1, .native = _arrays_max},
+  {.name = "fill", .arity = 2, .native = _arrays_fill_native},
+  {.name = "add", .arity = 2, .native = _arrays_add_native},
+  {.name = "multiply", .arity = 2, .native = _arrays_multiply_native},
+  {.name = "equal", .arity = 2, .native = _arrays_equal},
+  {.name = "find", .arity = 2, .native = _arrays_find_native},
+  {.name = "count", .arity = 2, .native = _arrays_count_native}
+};
+
+void arrays_define (wtjl_context_t *ctx) {
+  vm.define_natives(ctx, _arrays_builtins, sizeof(_arrays_builtins) / sizeof(function_t));
+}
+
+void arrays_initialize (wtjl_context_t *ctx) {
+  arrays_define(ctx);
+}
+
+void arrays_cleanup (wtjl_context_t *ctx) {
+}
+
+void setup_arrays () {
+#ifdef __x86_64__
+  __builtin_cpu_init();
+  _arrays_avx2 = __builtin_cpu_supports("avx2");
+#endif
+  arrays.initialize = arrays_initialize;
+  arrays.cleanup = arrays_cleanup;
+  arrays.define = arrays_define;
+}
+
+/* end arrays */
+
+/* ``begin strings */
+
+// substring(s, from, to) is the part of s from index `from` up to, not
+// including, `to`; short ones are small strings, so taking them allocates
+// nothing
+
+value_t _strings_substring (wtjl_context_t *ctx, value_t *arguments) {
+  if (arguments[0].type != VALUE_STRING) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in substring; expects a string.");
+  }
+  if (arguments[1].type != VALUE_INTEGER || arguments[2].type != VALUE_INTEGER) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in substring; indices must be integers.");
+  }
+  int64_t from = arguments[1].as.integer;
+  int64_t to = arguments[2].as.integer;
+  size_t length = vm.string_length(ctx, &arguments[0]);
+  if (from < 0 || to < from || (uint64_t) to > length) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in substring; %lld to %lld is out of range for length %lld.", (long long) from, (long long) to, (long long) length);
+  }
+  return vm.substring(ctx, &arguments[0], (size_t) from, (size_t) to);
+}
+
+function_t _strings_builtins [] = {
+  {.name = "substring", .arity = 3, .native = _strings_substring}
+};
+
+void strings_define (wtjl_context_t *ctx) {
+  vm.define_natives(ctx, _strings_builtins, sizeof(_strings_builtins) / sizeof(function_t));
+}
+
+void strings_initialize (wtjl_context_t *ctx) {
+  strings_define(ctx);
+}
+
+void strings_cleanup (wtjl_context_t *ctx) {
+}
+
+void setup_strings () {
+  strings.initialize = strings_initialize;
+  strings.cleanup = strings_cleanup;
+  strings.define = strings_define;
+}
+
+/* end strings */
+
+/* ``begin evals */
+
+// eval(source) compiles source and runs it as a program of its own, in the
+// same globals; it returns nothing. Compiled sources are kept, the least
+// recently used going first once they hold more than the budget, so the
+// same text evaluated again is neither scanned, tokenized, parsed nor
+// compiled, and the same large string again is not even hashed
+
+// what `function` holds, with the functions nested in it, which are its
+// function constants
+size_t _evals_function_size (function_t *function) {
+  size_t size = sizeof(function_t) + strlen(function->name) + 1 + function->chunk.code_capacity + function->chunk.constants_capacity * sizeof(value_t) + function->chunk.caches_capacity * sizeof(member_cache_t);
+  for (size_t i = 0; i < function->chunk.constants_length; i++) {
+    if (function->chunk.constants[i].type == VALUE_FUNCTION) {
+      size += _evals_function_size(function->chunk.constants[i].as.function);
+    }
+  }
+  return size;
+}
+
+size_t _evals_string_slot (string_t *string) {
+  return ((uintptr_t) string >> 4) % EVALS_STRINGS;
+}
+
+void _evals_unlink (evals_state_t *state, evals_entry_t *entry) {
+  if (entry->newer) {
+    entry->newer->older = entry->older;
+  } else {
+    state->newest = entry->older;
+  }
+  if (entry->older) {
+    entry->older->newer = entry->newer;
+  } else {
+    state->oldest = entry->newer;
+  }
+}
+
+void _evals_link (evals_state_t *state, evals_entry_t *entry) {
+  entry->newer = NULL;
+  entry->older = state->newest;
+  if (state->newest) {
+    state->newest->newer = entry;
+  } else {
+    state->oldest = entry;
+  }
+  state->newest = entry;
+}
+
+// frees `script` once no eval is running, as it may be one of theirs
+void _evals_retire (wtjl_context_t *ctx, function_t *script) {
+  evals_state_t *state = &ctx->evals;
+  if (state->num_retired == state->retired_capacity) {
+    state->retired_capacity = state->retired_capacity ? state->retired_capacity * 2 : 8;
+    state->retired = realloc(state->retired, state->retired_capacity * sizeof(function_t *));
+  }
+  state->retired[state->num_retired++] = script;
+}
+
+void _evals_evict (wtjl_context_t *ctx) {
+  evals_state_t *state = &ctx->evals;
+  evals_entry_t *entry = state->oldest;
+  _evals_unlink(state, entry);
+  evals_entry_t **link = &state->buckets[entry->hash % EVALS_BUCKETS];
+  while (*link != entry) {
+    link = &(*link)->chain;
+  }
+  *link = entry->chain;
+  if (entry->string && state->strings[_evals_string_slot(entry->string)] == entry) {
+    state->strings[_evals_string_slot(entry->string)] = NULL;
+  }
+  if (state->running) {
+    _evals_retire(ctx, entry->script);
+  } else {
+    compiler.discard(ctx, entry->script);
+  }
+  state->size -= entry->size;
+  state->num_entries--;
+  state->evictions++;
+  free(entry->source);
+  free(entry);
+}
+
+// the cached entry for `source`, NULL with `hash` set if it is not cached
+evals_entry_t *_evals_find (wtjl_context_t *ctx, value_t *source, uint64_t *hash) {
+  evals_state_t *state = &ctx->evals;
+  string_t *string = source->small_length == VALUE_LARGE_STRING ? source->as.string : NULL;
+  if (string) {
+    evals_entry_t *entry = state->strings[_evals_string_slot(string)];
+    if (entry && entry->string == string) {
+      state->string_hits++;
+      return entry;
+    }
+  }
+  *hash = _vm_string_hash(ctx, source);
+  size_t length;
+  const char *chars = vm.string_read(ctx, source, &length);
+  for (evals_entry_t *entry = state->buckets[*hash % EVALS_BUCKETS]; entry; entry = entry->chain) {
+    if (entry->hash == *hash && entry->length == length && memcmp(entry->source, chars, length) == 0) {
+      state->hits++;
+      if (string) {
+        entry->string = string;
+        state->strings[_evals_string_slot(string)] = entry;
+      }
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void wtjl_context_t_compile (wtjl_context_t *ctx, function_t **script);
+
+// compiles `source` and keeps it, unless it alone would overflow the
+// budget; then the script is retired, to be freed once it has run
+function_t *_evals_compile (wtjl_context_t *ctx, value_t *source, uint64_t hash) {
+  evals_state_t *state = &ctx->evals;
+  state->misses++;
+  size_t length;
+  const char *chars = vm.string_read(ctx, source, &length);
+  // a small string's chars live in its value, on the stack, so the scanner
+  // reads a copy; it is held in the state until kept, so a compile error
+  // does not leak it
+  free(state->compiling);
+  state->compiling = malloc(length + 1);
+  memcpy(state->compiling, chars, length);
+  state->compiling[length] = '\0';
+  function_t *script = NULL;
+  scanner.scan_buffer(ctx, state->compiling, length);
+  wtjl_context_t_compile(ctx, &script);
+  size_t size = sizeof(evals_entry_t) + length + _evals_function_size(script);
+  if (size > state->budget) {
+    _evals_retire(ctx, script);
+    return script;
+  }
+  while (state->size + size > state->budget) {
+    _evals_evict(ctx);
+  }
+  evals_entry_t *kept = malloc(sizeof(evals_entry_t));
+  kept->hash = hash;
+  kept->source = state->compiling;
+  state->compiling = NULL;
+  kept->length = length;
+  kept->size = size;
+  kept->script = script;
+  kept->string = source->small_length == VALUE_LARGE_STRING ? source->as.string : NULL;
+  kept->chain = state->buckets[kept->hash % EVALS_BUCKETS];
+  state->buckets[kept->hash % EVALS_BUCKETS] = kept;
+  if (kept->string) {
+    state->strings[_evals_string_slot(kept->string)] = kept;
+  }
+  _evals_link(state, kept);
+  state->size += size;
+  state->num_entries++;
+  return script;
+}
+
+value_t _evals_eval (wtjl_context_t *ctx, value_t *arguments) {
+  evals_state_t *state = &ctx->evals;
+  if (arguments[0].type != VALUE_STRING) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in eval; expects a string.");
+  }
+  if (ctx->vm.lane) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in eval; not allowed inside a parallel iterate.");
+  }
+  value_t source = arguments[0];
+  uint64_t hash;
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_EVALS);
+  evals_entry_t *entry = _evals_find(ctx, &source, &hash);
+  function_t *script;
+  if (entry) {
+    _evals_unlink(state, entry);
+    _evals_link(state, entry);
+    script = entry->script;
+  } else {
+    script = _evals_compile(ctx, &source, hash);
+  }
+  wtjl_context_t_charge(ctx, charged);
+  state->running++;
+  vm.execute(ctx, script);
+  state->running--;
+  if (!state->running) {
+    for (size_t i = 0; i < state->num_retired; i++) {
+      compiler.discard(ctx, state->retired[i]);
+    }
+    state->num_retired = 0;
+  }
+  value_t result;
+  result.type = VALUE_VOID;
+  return result;
+}
+
+function_t _evals_builtins [] = {
+  {.name = "eval", .arity = 1, .native = _evals_eval}
+};
+
+void evals_define (wtjl_context_t *ctx) {
+  vm.define_natives(ctx, _evals_builtins, sizeof(_evals_builtins) / sizeof(function_t));
+}
+
+void evals_report (wtjl_context_t *ctx) {
+  evals_state_t *state = &ctx->evals;
+  printf("eval cache: %d sources in %d of %d bytes; %d hits, %d of them by string; %d misses; %d evictions\n", (int) state->num_entries, (int) state->size, (int) state->budget, (int) (state->hits + state->string_hits), (int) state->string_hits, (int) state->misses, (int) state->evictions);
+}
+
+void evals_initialize (wtjl_context_t *ctx) {
+  evals_state_t *state = &ctx->evals;
+  memset(state, 0, sizeof(evals_state_t));
+  state->budget = EVALS_BUDGET;
+  evals_define(ctx);
+}
+
+void evals_cleanup (wtjl_context_t *ctx) {
+  evals_state_t *state = &ctx->evals;
+  state->running = 0;
+  while (state->oldest) {
+    _evals_evict(ctx);
+  }
+  for (size_t i = 0; i < state->num_retired; i++) {
+    compiler.discard(ctx, state->retired[i]);
+  }
+  free(state->retired);
+  free(state->compiling);
+  state->retired = NULL;
+  state->compiling = NULL;
+  state->num_retired = 0;
+  state->retired_capacity = 0;
+}
+
+void setup_evals () {
+  evals.initialize = evals_initialize;
+  evals.cleanup = evals_cleanup;
+  evals.define = evals_define;
+  evals.report = evals_report;
+}
+
+/* end evals */
+
+/* ``begin output */
+
+// what print writes collects in a large buffer, and strings long enough to
+// be worth not copying are queued where they lie; both go out in one
+// writev once either fills, when the context is destroyed, and before an
+// error is reported. A terminal gets every record as it ends.
+
+// writes whatever is queued, resuming after partial writes
+void output_flush (wtjl_context_t *ctx) {
+  output_state_t *state = &ctx->output;
+  if (!state->num_iovecs) {
+    return;
+  }
+  if (state->fd == STDOUT_FILENO) {
+    // what stdio holds was printed first
+    fflush(stdout);
+  }
+  struct iovec *iovecs = state->iovecs;
+  size_t num_iovecs = state->num_iovecs;
+  while (num_iovecs && !state->failed) {
+    ssize_t written = writev(state->fd, iovecs, MIN(num_iovecs, OUTPUT_IOVECS));
+    if (written < 0) {
+      state->failed = errno != EINTR;
+      continue;
+    }
+    state->writes++;
+    while (num_iovecs && (size_t) written >= iovecs->iov_len) {
+      written -= iovecs->iov_len;
+      iovecs++;
+      num_iovecs--;
+    }
+    if (num_iovecs) {
+      iovecs->iov_base = (char *) iovecs->iov_base + written;
+      iovecs->iov_len -= written;
+    }
+  }
+  state->num_iovecs = 0;
+  state->length = 0;
+}
+
+// makes room for `length` more bytes in the buffer, returning where they go
+char *_output_reserve (wtjl_context_t *ctx, size_t length) {
+  output_state_t *state = &ctx->output;
+  if (state->length + length > OUTPUT_BUFFER_SIZE || state->num_iovecs == OUTPUT_IOVECS) {
+    output_flush(ctx);
+  }
+  return state->buffer + state->length;
+}
+
+// bytes just put at the end of the buffer join the last iovec when it ends
+// there too
+void _output_commit (wtjl_context_t *ctx, size_t length) {
+  output_state_t *state = &ctx->output;
+  char *at = state->buffer + state->length;
+  struct iovec *last = state->num_iovecs ? &state->iovecs[state->num_iovecs - 1] : NULL;
+  if (last && (char *) last->iov_base + last->iov_len == at) {
+    last->iov_len += length;
+  } else {
+    state->iovecs[state->num_iovecs].iov_base = at;
+    state->iovecs[state->num_iovecs].iov_len = length;
+    state->num_iovecs++;
+  }
+  state->length += length;
+  state->bytes += length;
+}
+
+void output_write (wtjl_context_t *ctx, const char *chars, size_t length) {
+  while (length > OUTPUT_BUFFER_SIZE) {
+    output_write(ctx, chars, OUTPUT_BUFFER_SIZE);
+    chars += OUTPUT_BUFFER_SIZE;
+    length -= OUTPUT_BUFFER_SIZE;
+  }
+  memcpy(_output_reserve(ctx, length), chars, length);
+  _output_commit(ctx, length);
+}
+
+// queues `length` bytes at `chars` without copying them; they must stay put
+// until the next flush, as a large string's chars do for its context's life
+void _output_write_in_place (wtjl_context_t *ctx, const char *chars, size_t length) {
+  output_state_t *state = &ctx->output;
+  if (state->num_iovecs == OUTPUT_IOVECS) {
+    output_flush(ctx);
+  }
+  state->iovecs[state->num_iovecs].iov_base = (char *) chars;
+  state->iovecs[state->num_iovecs].iov_len = length;
+  state->num_iovecs++;
+  state->bytes += length;
+}
+
+void _output_integer (wtjl_context_t *ctx, int64_t integer) {
+  char digits [20];
+  size_t length = 0;
+  uint64_t magnitude = integer < 0 ? -(uint64_t) integer : (uint64_t) integer;
+  do {
+    digits[length++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  char *at = _output_reserve(ctx, length + 1);
+  size_t written = 0;
+  if (integer < 0) {
+    at[written++] = '-';
+  }
+  while (length) {
+    at[written++] = digits[--length];
+  }
+  _output_commit(ctx, written);
+}
+
+// the shortest of 15 and 17 significant digits that reads back the same
+void _output_double (wtjl_context_t *ctx, double number) {
+  char *at = _output_reserve(ctx, 32);
+  int length = snprintf(at, 32, "%.15g", number);
+  if (strtod(at, NULL) != number) {
+    length = snprintf(at, 32, "%.17g", number);
+  }
+  _output_commit(ctx, length);
+}
+
+void output_value (wtjl_context_t *ctx, value_t *value) {
+  switch (value->type) {
+    case (VALUE_INTEGER):
+      _output_integer(ctx, value->as.integer);
+      break;
+    case (VALUE_DOUBLE):
+      _output_double(ctx, value->as.number);
+      break;
+    case (VALUE_BOOLEAN):
+      output_write(ctx, value->as.boolean ? "true" : "false", value->as.boolean ? 4 : 5);
+      break;
+    case (VALUE_STRING): {
+      size_t length;
+      const char *chars = vm.string_read(ctx, value, &length);
+      if (length >= OUTPUT_IN_PLACE && value->small_length == VALUE_LARGE_STRING) {
+        _output_write_in_place(ctx, chars, length);
+      } else {
+        output_write(ctx, chars, length);
+      }
+      break;
+    }
+    case (VALUE_BIGNUM): {
+      size_t length;
+      char *digits = bignums.to_decimal(value->as.bignum, &length);
+      output_write(ctx, digits, length);
+      free(digits);
+      break;
+    }
+    case (VALUE_VOID):
+      output_write(ctx, "void", 4);
+      break;
+    default: {
+      const char *name = compiler.type_name(value->type);
+      output_write(ctx, "<", 1);
+      output_write(ctx, name, strlen(name));
+      output_write(ctx, ">", 1);
+    }
+  }
+}
+
+// print(value) writes value and a newline; strings are written as they are
+value_t _output_print (wtjl_context_t *ctx, value_t *arguments) {
+  output_state_t *state = &ctx->output;
+  if (ctx->vm.lane) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error in print; not allowed inside a parallel iterate.");
+  }
+  output_value(ctx, &arguments[0]);
+  output_write(ctx, "\n", 1);
+  state->records++;
+  if (state->terminal) {
+    output_flush(ctx);
+  }
+  value_t result;
+  result.type = VALUE_VOID;
+  return result;
+}
+
+function_t _output_builtins [] = {
+  {.name = "print", .arity = 1, .native = _output_print}
+};
+
+void output_define (wtjl_context_t *ctx) {
+  vm.define_natives(ctx, _output_builtins, sizeof(_output_builtins) / sizeof(function_t));
+}
+
+// output goes to `fd` from here on, after what was queued for the last one
+void output_redirect (wtjl_context_t *ctx, int fd) {
+  output_state_t *state = &ctx->output;
+  output_flush(ctx);
+  state->fd = fd;
+  state->terminal = isatty(fd);
+  state->failed = false;
+}
+
+void output_initialize (wtjl_context_t *ctx) {
+  output_state_t *state = &ctx->output;
+  memset(state, 0, sizeof(output_state_t));
+  state->buffer = malloc(OUTPUT_BUFFER_SIZE);
+  output_redirect(ctx, ctx->arguments->output_fd);
+  output_define(ctx);
+}
+
+void output_cleanup (wtjl_context_t *ctx) {
+  output_flush(ctx);
+  free(ctx->output.buffer);
+  ctx->output.buffer = NULL;
+}
+
+void setup_output () {
+  output.initialize = output_initialize;
+  output.cleanup = output_cleanup;
+  output.define = output_define;
+  output.write = output_write;
+  output.value = output_value;
+  output.flush = output_flush;
+  output.redirect = output_redirect;
+}
+
+/* end output */
+
+/* ``begin loader */
+
+// a program run from a file may import others, `import "path";` at its top
+// level, the path relative to the importing file. Before anything runs, the
+// loader finds every file the program needs. Each round of newly named files
+// is read in one batch, through io_uring where the kernel has it and a pool
+// of reader threads where not, and each file is tokenized as soon as its
+// bytes arrive to find the files it names in turn. Then every file is
+// compiled and run once, after the files it imports.
+
+typedef struct _loader_ring_t {
+  int fd;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+} _loader_ring_t;
+
+// a read in flight; kept apart from the modules, which may move while it is
+typedef struct _loader_read_t {
+  size_t module;
+  int fd;
+  char *buffer;
+  size_t length;
+  size_t done;
+  int error;
+  struct iovec iovec;
+} _loader_read_t;
+
+typedef struct _loader_readers_t {
+  _loader_read_t *reads;
+  size_t num_reads;
+  size_t next; // the next read a thread takes
+  size_t *arrived; // reads in the order they finished
+  size_t num_arrived;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+} _loader_readers_t;
+
+bool _loader_ring_open (_loader_ring_t *ring) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = syscall(__NR_io_uring_setup, LOADER_RING_ENTRIES, &params);
+  if (ring->fd < 0) {
+    return false;
+  }
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single) {
+    ring->sq_ring_size = ring->cq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+  }
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = single ? ring->sq_ring : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    close(ring->fd);
+    return false;
+  }
+  ring->sq_tail = (unsigned *) ((char *) ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask = (unsigned *) ((char *) ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *) ((char *) ring->sq_ring + params.sq_off.array);
+  ring->cq_head = (unsigned *) ((char *) ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (unsigned *) ((char *) ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = (unsigned *) ((char *) ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ring + params.cq_off.cqes);
+  return true;
+}
+
+void _loader_ring_close (_loader_ring_t *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->fd);
+}
+
+// queues the rest of `read`, to be submitted with the next io_uring_enter
+void _loader_ring_queue (_loader_ring_t *ring, _loader_read_t *read, size_t index) {
+  unsigned tail = *ring->sq_tail;
+  unsigned slot = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  read->iovec.iov_base = read->buffer + read->done;
+  read->iovec.iov_len = read->length - read->done;
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = read->fd;
+  sqe->addr = (uintptr_t) &read->iovec;
+  sqe->len = 1;
+  sqe->off = read->done;
+  sqe->user_data = index;
+  ring->sq_array[slot] = slot;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// a read's completion, true once it needs nothing more
+bool _loader_complete (_loader_read_t *read, int result) {
+  if (result < 0) {
+    read->error = -result;
+    return true;
+  }
+  read->done += result;
+  // a file that shrank since it was measured ends where the reads do
+  if (result == 0) {
+    read->length = read->done;
+  }
+  return read->done == read->length;
+}
+
+void *_loader_reader (void *argument) {
+  _loader_readers_t *readers = argument;
+  for (; ; ) {
+    size_t index = __atomic_fetch_add(&readers->next, 1, __ATOMIC_RELAXED);
+    if (index >= readers->num_reads) {
+      return NULL;
+    }
+    _loader_read_t *read = &readers->reads[index];
+    while (!read->error && read->done < read->length) {
+      ssize_t result = pread(read->fd, read->buffer + read->done, read->length - read->done, read->done);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      _loader_complete(read, result < 0 ? -errno : (int) result);
+    }
+    pthread_mutex_lock(&readers->lock);
+    readers->arrived[readers->num_arrived++] = index;
+    pthread_cond_signal(&readers->ready);
+    pthread_mutex_unlock(&readers->lock);
+  }
+}
+
+size_t _loader_add (wtjl_context_t *ctx, const char *path) {
+  loader_state_t *state = &ctx->loader;
+  for (size_t i = 0; i < state->num_modules; i++) {
+    if (strcmp(state->modules[i].path, path) == 0) {
+      return i;
+    }
+  }
+  if (state->num_modules == state->modules_capacity) {
+    state->modules_capacity = state->modules_capacity ? state->modules_capacity * 2 : 16;
+    state->modules = realloc(state->modules, state->modules_capacity * sizeof(loader_module_t));
+  }
+  loader_module_t *module = &state->modules[state->num_modules];
+  memset(module, 0, sizeof(loader_module_t));
+  module->path = strdup(path);
+  return state->num_modules++;
+}
+
+// the module for `path` as written in `from`, relative to its directory
+size_t _loader_import (wtjl_context_t *ctx, size_t from, token_t *token) {
+  const char *importer = ctx->loader.modules[from].path;
+  const char *slash = strrchr(importer, '/');
+  size_t directory = slash ? slash - importer + 1 : 0;
+  size_t length = token->length - 2;
+  char *joined = malloc(directory + length + 1);
+  memcpy(joined, importer, directory);
+  memcpy(joined + directory, tokenizer.text(ctx, token) + 1, length);
+  joined[directory + length] = '\0';
+  char *resolved = realpath(*tokenizer.text(ctx, token) == '/' ? joined + directory : joined, NULL);
+  free(joined);
+  if (!resolved) {
+    wtjl_context_t_fail_at(ctx, WTJL_ERROR_IO, token->offset, "Loading error; cannot open %.*s.", (int) token->length, tokenizer.text(ctx, token));
+  }
+  size_t module = _loader_add(ctx, resolved);
+  (free)(resolved);
+  return module;
+}
+
+// tokenizes a module whose bytes have all arrived, noting what it imports,
+// and keeps its tokens for when it is compiled
+void _loader_tokenize (wtjl_context_t *ctx, size_t index) {
+  loader_state_t *state = &ctx->loader;
+  scanner.scan_buffer(ctx, state->modules[index].source, state->modules[index].length);
+  ctx->scanner.file_name = state->modules[index].path;
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_TOKENIZER);
+  tokenizer.tokenize(ctx);
+  wtjl_context_t_charge(ctx, charged);
+  tokenizer_state_t *tokens = &ctx->tokenizer;
+  for (size_t i = 0; i + 1 < tokens->tokens_size; i++) {
+    if (tokens->tokens[i]->token_type_secondary == KEYWORD_IMPORT && tokens->tokens[i + 1]->token_type_secondary == LITERAL_QUOTE_D) {
+      size_t imported = _loader_import(ctx, index, tokens->tokens[i + 1]);
+      loader_module_t *module = &state->modules[index];
+      if (module->num_imports == module->imports_capacity) {
+        module->imports_capacity = module->imports_capacity ? module->imports_capacity * 2 : 4;
+        module->imports = realloc(module->imports, module->imports_capacity * sizeof(size_t));
+      }
+      module->imports[module->num_imports++] = imported;
+    }
+  }
+  loader_module_t *module = &state->modules[index];
+  module->tokens = ctx->tokenizer;
+  module->tokenized = true;
+  bool recover = ctx->tokenizer.recover;
+  tokenizer.initialize(ctx);
+  ctx->tokenizer.recover = recover;
+  scanner.cleanup(ctx);
+}
+
+// hands a finished read to its module and tokenizes it; an error is kept
+// for after the batch, as reads still in flight write into their buffers
+void _loader_arrived (wtjl_context_t *ctx, _loader_read_t *read) {
+  loader_state_t *state = &ctx->loader;
+  state->modules[read->module].length = read->length;
+  if (state->status != WTJL_OK) {
+    return;
+  }
+  if (read->error) {
+    state->status = WTJL_ERROR_IO;
+    snprintf(ctx->error, sizeof(ctx->error), "%s: Failed to read file; %s.", state->modules[read->module].path, strerror(read->error));
+    return;
+  }
+  jmp_buf jmp;
+  jmp_buf *previous_jmp = ctx->_error_jmp;
+  ctx->_error_jmp = &jmp;
+  if (setjmp(jmp) == 0) {
+    _loader_tokenize(ctx, read->module);
+  } else {
+    state->status = ctx->status;
+    tokenizer.cleanup(ctx);
+    scanner.cleanup(ctx);
+  }
+  ctx->_error_jmp = previous_jmp;
+}
+
+void _loader_read_ring (wtjl_context_t *ctx, _loader_ring_t *ring, _loader_read_t *reads, size_t num_reads) {
+  size_t queued = 0;
+  size_t in_flight = 0;
+  size_t finished = 0;
+  unsigned unsubmitted = 0;
+  while (finished < num_reads) {
+    for (; queued < num_reads && in_flight < LOADER_RING_ENTRIES; queued++, in_flight++, unsubmitted++) {
+      _loader_ring_queue(ring, &reads[queued], queued);
+    }
+    int submitted = syscall(__NR_io_uring_enter, ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      // nothing more can be waited for; whatever has not finished fails
+      for (size_t i = 0; i < num_reads; i++) {
+        if (!reads[i].error && reads[i].done < reads[i].length) {
+          reads[i].error = errno;
+          _loader_arrived(ctx, &reads[i]);
+        }
+      }
+      return;
+    }
+    unsubmitted -= submitted;
+    ctx->loader.submissions++;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      _loader_read_t *read = &reads[cqe->user_data];
+      if (_loader_complete(read, cqe->res)) {
+        in_flight--;
+        finished++;
+        _loader_arrived(ctx, read);
+      } else {
+        // a short read; the rest goes with the next submission
+        _loader_ring_queue(ring, read, cqe->user_data);
+        unsubmitted++;
+      }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+}
+
+void _loader_read_threads (wtjl_context_t *ctx, _loader_read_t *reads, size_t num_reads) {
+  _loader_readers_t readers;
+  readers.reads = reads;
+  readers.num_reads = num_reads;
+  readers.next = 0;
+  readers.arrived = malloc(num_reads * sizeof(size_t));
+  readers.num_arrived = 0;
+  pthread_mutex_init(&readers.lock, NULL);
+  pthread_cond_init(&readers.ready, NULL);
+  pthread_t threads [LOADER_READERS];
+  size_t num_threads = MIN(num_reads, LOADER_READERS);
+  for (size_t i = 0; i < num_threads; i++) {
+    pthread_create(&threads[i], NULL, _loader_reader, &readers);
+  }
+  for (size_t taken = 0; taken < num_reads; taken++) {
+    pthread_mutex_lock(&readers.lock);
+    while (readers.num_arrived == taken) {
+      pthread_cond_wait(&readers.ready, &readers.lock);
+    }
+    size_t index = readers.arrived[taken];
+    pthread_mutex_unlock(&readers.lock);
+    _loader_arrived(ctx, &reads[index]);
+  }
+  for (size_t i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_mutex_destroy(&readers.lock);
+  pthread_cond_destroy(&readers.ready);
+  free(readers.arrived);
+}
+
+// reads and tokenizes modules `from` up to `to`, which may name more
+void _loader_read_batch (wtjl_context_t *ctx, size_t from, size_t to) {
+  loader_state_t *state = &ctx->loader;
+  size_t num_reads = to - from;
+  _loader_read_t *reads = malloc(num_reads * sizeof(_loader_read_t));
+  memset(reads, 0, num_reads * sizeof(_loader_read_t));
+  for (size_t i = 0; i < num_reads; i++) {
+    loader_module_t *module = &state->modules[from + i];
+    struct stat file_stat;
+    reads[i].module = from + i;
+    reads[i].fd = open(module->path, O_RDONLY);
+    if (reads[i].fd < 0 || fstat(reads[i].fd, &file_stat) != 0) {
+      reads[i].error = errno;
+      continue;
+    }
+    reads[i].length = file_stat.st_size;
+    module->source = malloc(reads[i].length + 1);
+    reads[i].buffer = module->source;
+  }
+  // reads that failed to open, or have nothing to read, are already finished
+  size_t num_pending = 0;
+  for (size_t i = 0; i < num_reads; i++) {
+    if (reads[i].error || !reads[i].length) {
+      _loader_arrived(ctx, &reads[i]);
+      if (reads[i].fd >= 0) {
+        close(reads[i].fd);
+      }
+    } else {
+      reads[num_pending++] = reads[i];
+    }
+  }
+  _loader_ring_t ring;
+  if (!num_pending) {
+  } else if (state->mode == LOADER_SEQUENTIAL) {
+    for (size_t i = 0; i < num_pending; i++) {
+      while (!reads[i].error && reads[i].done < reads[i].length) {
+        ssize_t result = read(reads[i].fd, reads[i].buffer + reads[i].done, reads[i].length - reads[i].done);
+        _loader_complete(&reads[i], result < 0 ? -errno : (int) result);
+      }
+      _loader_arrived(ctx, &reads[i]);
+    }
+  } else if (state->mode == LOADER_BATCHED && _loader_ring_open(&ring)) {
+    state->uring = true;
+    _loader_read_ring(ctx, &ring, reads, num_pending);
+    _loader_ring_close(&ring);
+  } else {
+    state->uring = false;
+    _loader_read_threads(ctx, reads, num_pending);
+  }
+  for (size_t i = 0; i < num_reads; i++) {
+    if (state->modules[from + i].source) {
+      state->modules[from + i].source[state->modules[from + i].length] = '\0';
+    }
+  }
+  for (size_t i = 0; i < num_pending; i++) {
+    close(reads[i].fd);
+  }
+  free(reads);
+  state->batches++;
+  if (state->status != WTJL_OK) {
+    wtjl_status_t status = state->status;
+    state->status = WTJL_OK;
+    _wtjl_context_t_raise(ctx, status);
+  }
+}
+
+void wtjl_context_t_compile_tokens (wtjl_context_t *ctx, function_t **script);
+
+// compiles `index` after what it imports, appending each to the order they
+// run in; a module met again while its imports are still being compiled,
+// through a cycle, is left to come after them
+void _loader_compile (wtjl_context_t *ctx, size_t index) {
+  loader_state_t *state = &ctx->loader;
+  if (state->modules[index].visited) {
+    return;
+  }
+  state->modules[index].visited = true;
+  for (size_t i = 0; i < state->modules[index].num_imports; i++) {
+    _loader_compile(ctx, state->modules[index].imports[i]);
+  }
+  loader_module_t *module = &state->modules[index];
+  scanner.scan_buffer(ctx, module->source, module->length);
+  ctx->scanner.file_name = module->path;
+  tokenizer.cleanup(ctx);
+  ctx->tokenizer = module->tokens;
+  module->tokenized = false;
+  state->compiling = true;
+  wtjl_context_t_compile_tokens(ctx, &module->script);
+  state->compiling = false;
+  state->order[state->num_compiled++] = index;
+}
+
+void _loader_clear (wtjl_context_t *ctx) {
+  loader_state_t *state = &ctx->loader;
+  for (size_t i = 0; i < state->num_modules; i++) {
+    loader_module_t *module = &state->modules[i];
+    if (module->tokenized) {
+      tokenizer_state_t tokens = ctx->tokenizer;
+      ctx->tokenizer = module->tokens;
+      tokenizer.cleanup(ctx);
+      ctx->tokenizer = tokens;
+    }
+    compiler.free_function(ctx, module->script);
+    free(module->path);
+    free(module->source);
+    free(module->imports);
+  }
+  free(state->modules);
+  free(state->order);
+  state->modules = NULL;
+  state->num_modules = 0;
+  state->modules_capacity = 0;
+  state->order = NULL;
+  state->num_compiled = 0;
+  state->compiling = false;
+  state->status = WTJL_OK;
+}
+
+// loads the program in `file_name` with everything it imports, and runs it
+void loader_run (wtjl_context_t *ctx, const char *file_name) {
+  loader_state_t *state = &ctx->loader;
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_LOADER);
+  _loader_clear(ctx);
+  state->batches = 0;
+  state->submissions = 0;
+  char *resolved = realpath(file_name, NULL);
+  if (!resolved) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Failed to open file.");
+  }
+  _loader_add(ctx, resolved);
+  (free)(resolved);
+  for (size_t from = 0; from < state->num_modules; ) {
+    size_t to = state->num_modules;
+    _loader_read_batch(ctx, from, to);
+    from = to;
+  }
+  // every file compiles before any of them runs, so a syntax error anywhere
+  // stops the program before it starts
+  state->order = malloc(state->num_modules * sizeof(size_t));
+  _loader_compile(ctx, 0);
+  for (size_t i = 0; i < state->num_compiled; i++) {
+    vm.execute(ctx, state->modules[state->order[i]].script);
+  }
+  _loader_clear(ctx);
+  wtjl_context_t_charge(ctx, charged);
+}
+
+void loader_initialize (wtjl_context_t *ctx) {
+  loader_state_t *state = &ctx->loader;
+  memset(state, 0, sizeof(loader_state_t));
+  state->mode = LOADER_BATCHED;
+}
+
+void loader_cleanup (wtjl_context_t *ctx) {
+  _loader_clear(ctx);
+}
+
+void setup_loader () {
+  loader.initialize = loader_initialize;
+  loader.cleanup = loader_cleanup;
+  loader.run = loader_run;
+}
+
+/* end loader */
+
+/* ``begin heap */
+
+// a context frees nothing a program made until it is destroyed, unless it
+// has a soft limit: past that, the allocator sets the tracker's pressure,
+// and at the next loop or call the vm collects. Marking starts from the
+// stack, the globals, the running frames, the eval cache's strings and what
+// the host was last handed. Literals are pinned for as long as the function
+// holding them, and functions are kept for good unless the eval cache has
+// released them. Anything unmarked afterwards is freed. Collections only
+// happen where the vm has stored all it holds in its stack, which is why
+// natives, which may hold values in C locals, never see one
+
+void _heap_gray (wtjl_context_t *ctx, value_t *values, size_t count) {
+  heap_state_t *state = &ctx->heap;
+  if (!count) {
+    return;
+  }
+  if (state->num_gray == state->gray_capacity) {
+    state->gray_capacity = state->gray_capacity ? state->gray_capacity * 2 : 64;
+    state->gray = realloc(state->gray, state->gray_capacity * sizeof(_heap_range_t));
+  }
+  state->gray[state->num_gray].values = values;
+  state->gray[state->num_gray].count = count;
+  state->num_gray++;
+}
+
+// marks what `value` refers to, leaving what that refers to in turn for
+// _heap_trace; values of other contexts are theirs to keep
+void _heap_mark (wtjl_context_t *ctx, value_t *value) {
+  switch (value->type) {
+    case (VALUE_STRING): {
+      if (value->small_length != VALUE_LARGE_STRING || value->as.string->marked) {
+        return;
+      }
+      string_t *string = value->as.string;
+      string->marked = true;
+      // a flattened rope never reads its halves again
+      if (!string->chars) {
+        _heap_gray(ctx, _vm_rope_halves(string), 2);
+      }
+      return;
+    }
+    case (VALUE_BIGNUM):
+      value->as.bignum->marked = true;
+      return;
+    case (VALUE_FUNCTION): {
+      function_t *function = value->as.function;
+      if (function->closure) {
+        closure_t *closure = (closure_t *) function;
+        if (closure->marked) {
+          return;
+        }
+        closure->marked = true;
+        _heap_gray(ctx, closure->captures, closure->function.num_captures);
+        function = closure->literal;
+      }
+      // every other function is kept, and so are the functions nested in it
+      // and its literals
+      if (!function->released || function->marked) {
+        return;
+      }
+      function->marked = true;
+      _heap_gray(ctx, function->chunk.constants, function->chunk.constants_length);
+      return;
+    }
+    case (VALUE_OBJECT): {
+      object_t *object = value->as.object;
+      if (object->context != ctx || object->marked) {
+        return;
+      }
+      object->marked = true;
+      _heap_gray(ctx, object->slots, object->shape->num_members);
+      return;
+    }
+    case (VALUE_ARRAY): {
+      array_t *array = value->as.array;
+      if (array->context != ctx || array->marked) {
+        return;
+      }
+      array->marked = true;
+      if (array->kind == ARRAY_VALUES) {
+        _heap_gray(ctx, array->as.values, array->length);
+      }
+      return;
+    }
+    case (VALUE_BOX): {
+      box_t *box = value->as.box;
+      if (box->context != ctx || box->marked) {
+        return;
+      }
+      box->marked = true;
+      _heap_gray(ctx, &box->value, 1);
+      return;
+    }
+    case (VALUE_GENERATOR): {
+      generator_t *generator = value->as.generator;
+      if (generator->context != ctx || generator->marked) {
+        return;
+      }
+      generator->marked = true;
+      _heap_gray(ctx, generator->saved, generator->num_saved);
+      return;
+    }
+    default:
+      return;
+  }
+}
+
+void _heap_mark_roots (wtjl_context_t *ctx) {
+  vm_state_t *vm_state = &ctx->vm;
+  _heap_gray(ctx, vm_state->stack, vm_state->stack_top - vm_state->stack);
+  _heap_gray(ctx, vm_state->globals, vm_state->num_globals);
+  value_t value;
+  // a running closure or generator is also in its frame's callee slot,
+  // except once a tail call has replaced it
+  for (size_t i = 0; i < vm_state->num_frames; i++) {
+    value.type = VALUE_FUNCTION;
+    value.as.function = vm_state->frames[i].function;
+    _heap_mark(ctx, &value);
+    if (vm_state->frames[i].generator) {
+      value.type = VALUE_GENERATOR;
+      value.as.generator = vm_state->frames[i].generator;
+      _heap_mark(ctx, &value);
+    }
+  }
+  // the cache knows a string by where it is, which a new one could take
+  value.type = VALUE_STRING;
+  value.small_length = VALUE_LARGE_STRING;
+  for (evals_entry_t *entry = ctx->evals.newest; entry; entry = entry->older) {
+    if (entry->string) {
+      value.as.string = entry->string;
+      _heap_mark(ctx, &value);
+    }
+  }
+  _heap_gray(ctx, ctx->heap.handed, ctx->heap.num_handed);
+}
+
+void _heap_trace (wtjl_context_t *ctx) {
+  heap_state_t *state = &ctx->heap;
+  while (state->num_gray) {
+    _heap_range_t range = state->gray[--state->num_gray];
+    for (size_t i = 0; i < range.count; i++) {
+      _heap_mark(ctx, &range.values[i]);
+    }
+  }
+}
+
+// keeps the marked of each of the vm's lists, and whatever `keep` holds
+// for, in order, clearing their marks for next time, and frees the rest like
+// vm_cleanup
+#define HEAP_SWEEP(list, count, keep, release) \
+  { \
+    size_t kept = 0; \
+    for (size_t i = 0; i < (count); i++) { \
+      if ((list)[i]->marked || (keep)) { \
+        (list)[i]->marked = false; \
+        (list)[kept++] = (list)[i]; \
+      } else { \
+        release; \
+        free((list)[i]); \
+      } \
+    } \
+    (count) = kept; \
+  }
+
+void _heap_sweep (wtjl_context_t *ctx) {
+  vm_state_t *vm_state = &ctx->vm;
+  // functions first, as freeing one unpins its literals, which may then go
+  // too; only released ones are ever freed, and only they are marked
+  size_t kept = 0;
+  for (size_t i = 0; i < vm_state->num_functions; i++) {
+    function_t *function = vm_state->functions[i];
+    if (function->marked || !function->released) {
+      function->marked = false;
+      vm_state->functions[kept++] = function;
+    } else {
+      compiler.free_function(ctx, function);
+    }
+  }
+  vm_state->num_functions = kept;
+  HEAP_SWEEP(vm_state->strings, vm_state->num_strings, vm_state->strings[i]->pinned,
+    if (vm_state->strings[i]->rope) {
+      free(vm_state->strings[i]->chars);
+    }
+    vm_state->num_escaped -= vm_state->strings[i]->escaped;
+  )
+  HEAP_SWEEP(vm_state->bignums, vm_state->num_bignums, vm_state->bignums[i]->pinned, )
+  HEAP_SWEEP(vm_state->objects, vm_state->num_objects, false, free(vm_state->objects[i]->slots))
+  HEAP_SWEEP(vm_state->arrays, vm_state->num_arrays, false, free(vm_state->arrays[i]->as.bytes))
+  HEAP_SWEEP(vm_state->closures, vm_state->num_closures, false, )
+  HEAP_SWEEP(vm_state->generators, vm_state->num_generators, false, )
+  HEAP_SWEEP(vm_state->boxes, vm_state->num_boxes, false, )
+}
+
+#undef HEAP_SWEEP
+
+// frees whatever the program can no longer reach, then waits to be asked
+// again until the heap has grown halfway from what is left to the hard
+// limit, or doubled without one, so a program whose live data sits near the
+// soft limit does not collect at every loop
+void heap_collect (wtjl_context_t *ctx) {
+  heap_state_t *state = &ctx->heap;
+  j_mem_t *mem = &ctx->mem;
+  if (ctx->vm.lane) {
+    mem->pressure = false;
+    return;
+  }
+  size_t before = mem->total_alloc - mem->total_free;
+  // strings queued to be written where they lie go out before any of them
+  // can be freed
+  for (size_t i = 0; i < ctx->output.num_iovecs; i++) {
+    char *base = ctx->output.iovecs[i].iov_base;
+    if (base < ctx->output.buffer || base >= ctx->output.buffer + OUTPUT_BUFFER_SIZE) {
+      output.flush(ctx);
+      break;
+    }
+  }
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_VM);
+  state->num_gray = 0;
+  _heap_mark_roots(ctx);
+  _heap_trace(ctx);
+  _heap_sweep(ctx);
+  memset(state->copies, 0, sizeof(state->copies));
+  wtjl_context_t_charge(ctx, charged);
+  size_t after = mem->total_alloc - mem->total_free;
+  state->collections++;
+  state->collected += before > after ? before - after : 0;
+  size_t trigger = mem->hard_limit ? after + (mem->hard_limit - MIN(after, mem->hard_limit)) / 2 : after * 2;
+  j_mem_collected(mem, MAX(mem->soft_limit, trigger));
+}
+
+// keeps what `value` refers to until heap_release, for values the host is
+// given, which it may hold on to where no collection can see them
+void heap_hand (wtjl_context_t *ctx, value_t *value) {
+  heap_state_t *state = &ctx->heap;
+  if (state->num_handed == state->handed_capacity) {
+    state->handed_capacity = state->handed_capacity ? state->handed_capacity * 2 : 8;
+    state->handed = realloc(state->handed, state->handed_capacity * sizeof(value_t));
+  }
+  state->handed[state->num_handed++] = *value;
+}
+
+// a large string of a small string's chars or a bignum's decimal digits,
+// handed to the host; reading the same value again before the next
+// collection gives back the same string rather than another one
+string_t *heap_copy (wtjl_context_t *ctx, value_t *value) {
+  heap_state_t *state = &ctx->heap;
+  bool small = value->type == VALUE_STRING;
+  uint64_t hash = small ? _vm_string_hash(ctx, value) : ((uint64_t) (uintptr_t) value->as.bignum >> 4);
+  _heap_copy_t *copy = &state->copies[hash % HEAP_COPIES];
+  bool same = copy->string && copy->of.type == value->type && (small
+    ? copy->of.small_length == value->small_length && memcmp(copy->of.small, value->small, value->small_length) == 0
+    : copy->of.as.bignum == value->as.bignum);
+  if (!same) {
+    if (small) {
+      copy->string = vm.new_string(ctx, value->small, value->small_length);
+    } else {
+      size_t length;
+      char *chars = bignums.to_decimal(value->as.bignum, &length);
+      copy->string = vm.new_string(ctx, chars, length);
+      free(chars);
+    }
+    copy->of = *value;
+  }
+  value_t handed;
+  handed.type = VALUE_STRING;
+  handed.small_length = VALUE_LARGE_STRING;
+  handed.as.string = copy->string;
+  heap_hand(ctx, &handed);
+  return copy->string;
+}
+
+// forgets what the host was handed, which it may only use until it calls
+// into the context again
+void heap_release (wtjl_context_t *ctx) {
+  ctx->heap.num_handed = 0;
+}
+
+void heap_initialize (wtjl_context_t *ctx) {
+  memset(&ctx->heap, 0, sizeof(heap_state_t));
+  size_t limit = ctx->arguments->memory_limit;
+  j_mem_limit(&ctx->mem, limit / 4 * 3, limit);
+}
+
+void heap_cleanup (wtjl_context_t *ctx) {
+  free(ctx->heap.gray);
+  ctx->heap.gray = NULL;
+  ctx->heap.num_gray = 0;
+  ctx->heap.gray_capacity = 0;
+  free(ctx->heap.handed);
+  ctx->heap.handed = NULL;
+  ctx->heap.num_handed = 0;
+  ctx->heap.handed_capacity = 0;
+}
+
+void setup_heap () {
+  heap.initialize = heap_initialize;
+  heap.cleanup = heap_cleanup;
+  heap.collect = heap_collect;
+  heap.hand = heap_hand;
+  heap.copy = heap_copy;
+  heap.release = heap_release;
+}
+
+/* end heap */
+
+/* ``begin image */
+
+// An image is what a context's globals hold, and everything that reaches,
+// written out after a program has run, so that another context can start
+// from it without scanning, parsing or compiling anything. It holds no
+// pointers: strings, bignums, functions, objects, arrays, closures and boxes
+// are each numbered and refer to one another by number, so an image works
+// wherever it is mapped. Strings are interned as they are written, one copy
+// of each text however many values held it. A context that loads an image
+// reads its strings where they lie, so a mapped or embedded image lasts as
+// long as the context does; the rest, code included, is built once from it.
+//
+// After the header come the global names in slot order, then a record for
+// each string, bignum, function, object, array and closure, then the values
+// they hold: constants, members, elements, captures, the boxes' contents and
+// the globals. Fields are u64s and records start on 8 byte boundaries; a
+// value is a value_t with a number in place of its pointer.
+//
+// A loaded image is trusted no further than it has to be: the header holds
+// a checksum of the whole image, and every number in it is checked against
+// what it numbers, down to the indices and jump distances in its code,
+// before anything runs, so a damaged image fails to load with
+// WTJL_ERROR_IO rather than running off the end of something.
+
+#define IMAGE_MAGIC "wtjlimg"
+#define IMAGE_VERSION 2
+#define IMAGE_OPCODES VM_OPCODES
+
+#define IMAGE_NATIVE 1
+#define IMAGE_GENERATOR 2
+
+#define IMAGE_CLOSURE 1 // in the small_length of a function value, numbering a closure instead
+
+typedef enum _image_kind_t {
+  IMAGE_BIGNUMS,
+  IMAGE_FUNCTIONS,
+  IMAGE_OBJECTS,
+  IMAGE_ARRAYS,
+  IMAGE_CLOSURES,
+  IMAGE_BOXES,
+  IMAGE_KINDS
+} _image_kind_t;
+
+typedef struct _image_header_t {
+  char magic [8];
+  uint32_t version;
+  uint32_t opcodes; // code only runs on the build that compiled it
+  uint64_t length;
+  uint64_t checksum; // see _image_checksum
+  uint64_t num_globals;
+  uint64_t num_strings;
+  uint64_t counts [IMAGE_KINDS];
+} _image_header_t;
+
+// numbers the things of one kind as they are first reached, by address
+typedef struct _image_table_t {
+  void **keys; // open addressing, NULL where empty
+  size_t *numbers;
+  size_t capacity;
+  void **items; // by number
+  size_t count;
+  size_t items_capacity;
+  size_t visited; // items whose own references have been numbered
+} _image_table_t;
+
+// numbers strings by their text, so that equal strings are written once
+typedef struct _image_strings_t {
+  const char **chars; // by number
+  size_t *lengths;
+  size_t count;
+  size_t items_capacity;
+  size_t *slots; // open addressing by hash, a number plus one, 0 where empty
+  size_t capacity;
+} _image_strings_t;
+
+typedef struct _image_saver_t {
+  wtjl_context_t *ctx;
+  char *bytes;
+  size_t length;
+  size_t capacity;
+  _image_strings_t strings;
+  _image_table_t tables [IMAGE_KINDS];
+} _image_saver_t;
+
+typedef struct _image_loader_t {
+  wtjl_context_t *ctx;
+  const char *bytes;
+  size_t length;
+  size_t offset;
+  _image_header_t header;
+  const char **chars; // every string's text, in the image
+  size_t *lengths;
+  string_t **strings; // made when a value first needs them
+  value_t *bignums;
+  function_t **functions;
+  object_t **objects;
+  array_t **arrays;
+  closure_t **closures;
+  box_t **boxes;
+  bool constants; // reading a function's constants, which alone hold functions with captures, for OP_CLOSURE
+} _image_loader_t;
+
+uint64_t _image_hash_pointer (void *key) {
+  return ((uint64_t) (uintptr_t) key >> 4) * 11400714819323198485ULL;
+}
+
+uint64_t _image_hash_chars (const char *chars, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t) chars[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// of the whole image, taken with this field 0, a word at a time, so
+// checking it costs little next to loading the image
+uint64_t _image_checksum (const _image_header_t *header, const char *bytes, size_t length) {
+  _image_header_t zeroed = *header;
+  zeroed.checksum = 0;
+  uint64_t sum = 14695981039346656037ULL;
+  for (size_t part = 0; part < 2; part++) {
+    const char *at = part ? bytes + sizeof(zeroed) : (const char *) &zeroed;
+    size_t left = part ? length - sizeof(zeroed) : sizeof(zeroed);
+    for (; left >= sizeof(uint64_t); at += sizeof(uint64_t), left -= sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, at, sizeof(word));
+      sum = (sum ^ word) * 0xff51afd7ed558ccdULL;
+      sum ^= sum >> 32;
+    }
+    for (; left; at++, left--) {
+      sum = (sum ^ (uint8_t) *at) * 1099511628211ULL;
+    }
+  }
+  return sum;
+}
+
+void _image_table_grow (_image_table_t *table) {
+  size_t capacity = table->capacity ? table->capacity * 2 : 64;
+  void **keys = malloc(capacity * sizeof(void *));
+  size_t *numbers = malloc(capacity * sizeof(size_t));
+  memset(keys, 0, capacity * sizeof(void *));
+  for (size_t i = 0; i < table->capacity; i++) {
+    if (table->keys[i]) {
+      size_t slot = _image_hash_pointer(table->keys[i]) & (capacity - 1);
+      while (keys[slot]) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      keys[slot] = table->keys[i];
+      numbers[slot] = table->numbers[i];
+    }
+  }
+  free(table->keys);
+  free(table->numbers);
+  table->keys = keys;
+  table->numbers = numbers;
+  table->capacity = capacity;
+}
+
+// the number of what `key` identifies, numbering `item` if it is new
+size_t _image_number (_image_table_t *table, void *key, void *item) {
+  if (table->count * 2 >= table->capacity) {
+    _image_table_grow(table);
+  }
+  size_t slot = _image_hash_pointer(key) & (table->capacity - 1);
+  while (table->keys[slot]) {
+    if (table->keys[slot] == key) {
+      return table->numbers[slot];
+    }
+    slot = (slot + 1) & (table->capacity - 1);
+  }
+  if (table->count == table->items_capacity) {
+    table->items_capacity = table->items_capacity ? table->items_capacity * 2 : 64;
+    table->items = realloc(table->items, table->items_capacity * sizeof(void *));
+  }
+  table->keys[slot] = key;
+  table->numbers[slot] = table->count;
+  table->items[table->count] = item;
+  return table->count++;
+}
+
+void _image_strings_grow (_image_strings_t *strings) {
+  size_t capacity = strings->capacity ? strings->capacity * 2 : 256;
+  size_t *slots = malloc(capacity * sizeof(size_t));
+  memset(slots, 0, capacity * sizeof(size_t));
+  for (size_t number = 0; number < strings->count; number++) {
+    size_t slot = _image_hash_chars(strings->chars[number], strings->lengths[number]) & (capacity - 1);
+    while (slots[slot]) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    slots[slot] = number + 1;
+  }
+  free(strings->slots);
+  strings->slots = slots;
+  strings->capacity = capacity;
+}
+
+// the number of the string with this text, which must last until the image is written
+size_t _image_intern (_image_saver_t *saver, const char *chars, size_t length) {
+  _image_strings_t *strings = &saver->strings;
+  if (strings->count * 2 >= strings->capacity) {
+    _image_strings_grow(strings);
+  }
+  size_t slot = _image_hash_chars(chars, length) & (strings->capacity - 1);
+  for (; strings->slots[slot]; slot = (slot + 1) & (strings->capacity - 1)) {
+    size_t number = strings->slots[slot] - 1;
+    if (strings->lengths[number] == length && memcmp(strings->chars[number], chars, length) == 0) {
+      return number;
+    }
+  }
+  if (strings->count == strings->items_capacity) {
+    strings->items_capacity = strings->items_capacity ? strings->items_capacity * 2 : 64;
+    strings->chars = realloc(strings->chars, strings->items_capacity * sizeof(char *));
+    strings->lengths = realloc(strings->lengths, strings->items_capacity * sizeof(size_t));
+  }
+  strings->chars[strings->count] = chars;
+  strings->lengths[strings->count] = length;
+  strings->slots[slot] = strings->count + 1;
+  return strings->count++;
+}
+
+// a closure shares its function's code, so functions are known by their code
+void *_image_function_key (function_t *function) {
+  return function->native || !function->chunk.code ? (void *) function : (void *) function->chunk.code;
+}
+
+// numbers what `value` refers to; the number is the same when it is asked again
+size_t _image_reach (_image_saver_t *saver, value_t *value) {
+  wtjl_context_t *ctx = saver->ctx;
+  _image_table_t *tables = saver->tables;
+  switch (value->type) {
+    case (VALUE_STRING): {
+      if (value->small_length != VALUE_LARGE_STRING) {
+        return 0;
+      }
+      // decoded and flattened first, so what is written is what a program reads
+      const char *chars = vm.string_chars(ctx, value->as.string);
+      return _image_intern(saver, chars, value->as.string->length);
+    }
+    case (VALUE_BIGNUM):
+      return _image_number(&tables[IMAGE_BIGNUMS], value->as.bignum, value->as.bignum);
+    case (VALUE_FUNCTION):
+      if (value->as.function->closure) {
+        return _image_number(&tables[IMAGE_CLOSURES], value->as.function, value->as.function);
+      }
+      return _image_number(&tables[IMAGE_FUNCTIONS], _image_function_key(value->as.function), value->as.function);
+    case (VALUE_OBJECT):
+      return _image_number(&tables[IMAGE_OBJECTS], value->as.object, value->as.object);
+    case (VALUE_ARRAY):
+      return _image_number(&tables[IMAGE_ARRAYS], value->as.array, value->as.array);
+    case (VALUE_BOX):
+      return _image_number(&tables[IMAGE_BOXES], value->as.box, value->as.box);
+    case (VALUE_GENERATOR):
+      wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Image error; a generator cannot be saved.");
+    default:
+      return 0;
+  }
+}
+
+// the names of an object's members, in slot order
+void _image_members (object_t *object, char **names) {
+  for (shape_t *shape = object->shape; shape->parent; shape = shape->parent) {
+    names[shape->num_members - 1] = shape->name;
+  }
+}
+
+// numbers everything `item`, one of `kind`, refers to
+void _image_visit (_image_saver_t *saver, _image_kind_t kind, void *item) {
+  switch (kind) {
+    case (IMAGE_FUNCTIONS): {
+      function_t *function = item;
+      _image_intern(saver, function->name, strlen(function->name));
+      for (size_t i = 0; !function->native && i < function->chunk.constants_length; i++) {
+        _image_reach(saver, &function->chunk.constants[i]);
+      }
+      for (size_t i = 0; !function->native && i < function->chunk.num_caches; i++) {
+        _image_intern(saver, function->chunk.caches[i].name, strlen(function->chunk.caches[i].name));
+      }
+      return;
+    }
+    case (IMAGE_OBJECTS): {
+      object_t *object = item;
+      char *names [object->shape->num_members + 1];
+      _image_members(object, names);
+      for (size_t i = 0; i < object->shape->num_members; i++) {
+        _image_intern(saver, names[i], strlen(names[i]));
+        _image_reach(saver, &object->slots[i]);
+      }
+      return;
+    }
+    case (IMAGE_ARRAYS): {
+      array_t *array = item;
+      for (size_t i = 0; array->kind == ARRAY_VALUES && i < array->length; i++) {
+        _image_reach(saver, &array->as.values[i]);
+      }
+      return;
+    }
+    case (IMAGE_CLOSURES): {
+      closure_t *closure = item;
+      _image_number(&saver->tables[IMAGE_FUNCTIONS], _image_function_key(&closure->function), &closure->function);
+      for (size_t i = 0; i < closure->function.num_captures; i++) {
+        _image_reach(saver, &closure->captures[i]);
+      }
+      return;
+    }
+    case (IMAGE_BOXES):
+      _image_reach(saver, &((box_t *) item)->value);
+      return;
+    default:
+      return;
+  }
+}
+
+void _image_put (_image_saver_t *saver, const void *bytes, size_t length) {
+  if (saver->length + length > saver->capacity) {
+    saver->capacity = MAX(saver->capacity * 2, saver->length + length);
+    saver->bytes = realloc(saver->bytes, saver->capacity);
+  }
+  memcpy(saver->bytes + saver->length, bytes, length);
+  saver->length += length;
+}
+
+void _image_put_u64 (_image_saver_t *saver, uint64_t field) {
+  _image_put(saver, &field, sizeof(field));
+}
+
+void _image_put_align (_image_saver_t *saver) {
+  uint64_t zero = 0;
+  _image_put(saver, &zero, (8 - saver->length % 8) % 8);
+}
+
+// a value_t, with the bytes it does not use zeroed and a number for its pointer
+void _image_put_value (_image_saver_t *saver, value_t *value) {
+  value_t written;
+  memset(&written, 0, sizeof(written));
+  written.type = value->type;
+  if (value->type == VALUE_STRING && value->small_length != VALUE_LARGE_STRING) {
+    written.small_length = value->small_length;
+    memcpy(written.small, value->small, value->small_length);
+  } else if (value->type == VALUE_STRING || value->type == VALUE_FUNCTION || value->type >= VALUE_OBJECT) {
+    written.small_length = value->type == VALUE_STRING ? VALUE_LARGE_STRING : value->type == VALUE_FUNCTION && value->as.function->closure ? IMAGE_CLOSURE : 0;
+    written.as.integer = (int64_t) _image_reach(saver, value);
+  } else if (value->type == VALUE_BOOLEAN) {
+    written.as.boolean = value->as.boolean;
+  } else if (value->type == VALUE_INTEGER || value->type == VALUE_DOUBLE) {
+    written.as = value->as;
+  }
+  _image_put(saver, &written, sizeof(written));
+}
+
+void _image_free_saver (_image_saver_t *saver) {
+  free(saver->bytes);
+  free(saver->strings.chars);
+  free(saver->strings.lengths);
+  free(saver->strings.slots);
+  for (size_t kind = 0; kind < IMAGE_KINDS; kind++) {
+    free(saver->tables[kind].keys);
+    free(saver->tables[kind].numbers);
+    free(saver->tables[kind].items);
+  }
+}
+
+// writes an image of the globals to `path`; if this fails part way, what it
+// allocated is freed with the context
+void image_save (wtjl_context_t *ctx, const char *path) {
+  _image_saver_t saver;
+  memset(&saver, 0, sizeof(saver));
+  saver.ctx = ctx;
+  _image_table_t *tables = saver.tables;
+  vm_state_t *state = &ctx->vm;
+  for (size_t i = 0; i < state->num_globals; i++) {
+    _image_intern(&saver, state->global_names[i], strlen(state->global_names[i]));
+    _image_reach(&saver, &state->globals[i]);
+  }
+  for (bool reached = true; reached;) {
+    reached = false;
+    for (size_t kind = 0; kind < IMAGE_KINDS; kind++) {
+      while (tables[kind].visited < tables[kind].count) {
+        _image_visit(&saver, kind, tables[kind].items[tables[kind].visited++]);
+        reached = true;
+      }
+    }
+  }
+  _image_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  header.version = IMAGE_VERSION;
+  header.opcodes = IMAGE_OPCODES;
+  header.num_globals = state->num_globals;
+  header.num_strings = saver.strings.count;
+  for (size_t kind = 0; kind < IMAGE_KINDS; kind++) {
+    header.counts[kind] = tables[kind].count;
+  }
+  _image_put(&saver, &header, sizeof(header));
+  for (size_t i = 0; i < state->num_globals; i++) {
+    _image_put_u64(&saver, _image_intern(&saver, state->global_names[i], strlen(state->global_names[i])));
+  }
+  for (size_t i = 0; i < saver.strings.count; i++) {
+    _image_put_u64(&saver, saver.strings.lengths[i]);
+    _image_put(&saver, saver.strings.chars[i], saver.strings.lengths[i]);
+    _image_put(&saver, "", 1);
+    _image_put_align(&saver);
+  }
+  for (size_t i = 0; i < tables[IMAGE_BIGNUMS].count; i++) {
+    bignum_t *bignum = tables[IMAGE_BIGNUMS].items[i];
+    _image_put_u64(&saver, bignum->negative);
+    _image_put_u64(&saver, bignum->length);
+    _image_put(&saver, bignum->limbs, bignum->length * sizeof(uint64_t));
+  }
+  for (size_t i = 0; i < tables[IMAGE_FUNCTIONS].count; i++) {
+    function_t *function = tables[IMAGE_FUNCTIONS].items[i];
+    chunk_t *chunk = &function->chunk;
+    _image_put_u64(&saver, _image_intern(&saver, function->name, strlen(function->name)));
+    _image_put_u64(&saver, (function->native ? IMAGE_NATIVE : 0) | (function->generator ? IMAGE_GENERATOR : 0));
+    if (function->native) {
+      continue;
+    }
+    _image_put_u64(&saver, function->arity);
+    _image_put_u64(&saver, function->max_stack);
+    _image_put_u64(&saver, function->num_captures);
+    _image_put_u64(&saver, chunk->code_length);
+    _image_put(&saver, chunk->code, chunk->code_length);
+    _image_put_align(&saver);
+    _image_put_u64(&saver, chunk->constants_length);
+    _image_put_u64(&saver, chunk->num_caches);
+    for (size_t j = 0; j < chunk->num_caches; j++) {
+      _image_put_u64(&saver, _image_intern(&saver, chunk->caches[j].name, strlen(chunk->caches[j].name)));
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_OBJECTS].count; i++) {
+    object_t *object = tables[IMAGE_OBJECTS].items[i];
+    char *names [object->shape->num_members + 1];
+    _image_members(object, names);
+    _image_put_u64(&saver, object->shape->num_members);
+    for (size_t j = 0; j < object->shape->num_members; j++) {
+      _image_put_u64(&saver, _image_intern(&saver, names[j], strlen(names[j])));
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_ARRAYS].count; i++) {
+    array_t *array = tables[IMAGE_ARRAYS].items[i];
+    _image_put_u64(&saver, array->kind);
+    _image_put_u64(&saver, array->length);
+    if (array->kind != ARRAY_VALUES) {
+      _image_put(&saver, array->as.bytes, array->length * (array->kind == ARRAY_INTEGERS ? sizeof(int64_t) : sizeof(uint8_t)));
+      _image_put_align(&saver);
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_CLOSURES].count; i++) {
+    closure_t *closure = tables[IMAGE_CLOSURES].items[i];
+    _image_put_u64(&saver, _image_number(&tables[IMAGE_FUNCTIONS], _image_function_key(&closure->function), NULL));
+  }
+  for (size_t i = 0; i < tables[IMAGE_FUNCTIONS].count; i++) {
+    function_t *function = tables[IMAGE_FUNCTIONS].items[i];
+    for (size_t j = 0; !function->native && j < function->chunk.constants_length; j++) {
+      _image_put_value(&saver, &function->chunk.constants[j]);
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_OBJECTS].count; i++) {
+    object_t *object = tables[IMAGE_OBJECTS].items[i];
+    for (size_t j = 0; j < object->shape->num_members; j++) {
+      _image_put_value(&saver, &object->slots[j]);
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_ARRAYS].count; i++) {
+    array_t *array = tables[IMAGE_ARRAYS].items[i];
+    for (size_t j = 0; array->kind == ARRAY_VALUES && j < array->length; j++) {
+      _image_put_value(&saver, &array->as.values[j]);
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_CLOSURES].count; i++) {
+    closure_t *closure = tables[IMAGE_CLOSURES].items[i];
+    for (size_t j = 0; j < closure->function.num_captures; j++) {
+      _image_put_value(&saver, &closure->captures[j]);
+    }
+  }
+  for (size_t i = 0; i < tables[IMAGE_BOXES].count; i++) {
+    _image_put_value(&saver, &((box_t *) tables[IMAGE_BOXES].items[i])->value);
+  }
+  for (size_t i = 0; i < state->num_globals; i++) {
+    _image_put_value(&saver, &state->globals[i]);
+  }
+  ((_image_header_t *) saver.bytes)->length = saver.length;
+  ((_image_header_t *) saver.bytes)->checksum = _image_checksum((_image_header_t *) saver.bytes, saver.bytes, saver.length);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; cannot open \"%s\".", path);
+  }
+  size_t written = fwrite(saver.bytes, 1, saver.length, file);
+  if (fclose(file) != 0 || written != saver.length) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; cannot write \"%s\".", path);
+  }
+  _image_free_saver(&saver);
+}
+
+void _image_damaged (_image_loader_t *loader) {
+  wtjl_context_t_fail(loader->ctx, WTJL_ERROR_IO, "Image error; the image is damaged.");
+}
+
+// the next `length` bytes of the image, where they lie
+const char *_image_get (_image_loader_t *loader, size_t length) {
+  if (length > loader->length - loader->offset) {
+    _image_damaged(loader);
+  }
+  const char *bytes = loader->bytes + loader->offset;
+  loader->offset += length;
+  return bytes;
+}
+
+uint64_t _image_get_u64 (_image_loader_t *loader) {
+  uint64_t field;
+  memcpy(&field, _image_get(loader, sizeof(field)), sizeof(field));
+  return field;
+}
+
+// a u64 that numbers one of `count` things
+size_t _image_get_number (_image_loader_t *loader, uint64_t count) {
+  uint64_t number = _image_get_u64(loader);
+  if (number >= count) {
+    _image_damaged(loader);
+  }
+  return (size_t) number;
+}
+
+void _image_get_align (_image_loader_t *loader) {
+  _image_get(loader, (8 - loader->offset % 8) % 8);
+}
+
+const char *_image_get_name (_image_loader_t *loader) {
+  return loader->chars[_image_get_number(loader, loader->header.num_strings)];
+}
+
+// scratch for `count` things, each of which takes at least `least` bytes of
+// the image, so a damaged count cannot ask for more memory than that
+void *_image_scratch (_image_loader_t *loader, uint64_t count, size_t least, size_t size) {
+  if (count > (loader->length - loader->offset) / least) {
+    _image_damaged(loader);
+  }
+  return malloc(MAX(count, 1) * size);
+}
+
+string_t *_image_string (_image_loader_t *loader, size_t number) {
+  if (!loader->strings[number]) {
+    // read in place; only escaped literals are ever written to, and an
+    // image's strings were all decoded before it was saved
+    string_t *string = _vm_track_string(loader->ctx, malloc(sizeof(string_t)));
+    string->length = loader->lengths[number];
+    string->hash = 0;
+    string->escaped = false;
+    string->rope = false;
+    string->chars = (char *) loader->chars[number];
+    string->pinned = true;
+    loader->strings[number] = string;
+  }
+  return loader->strings[number];
+}
+
+value_t _image_get_value (_image_loader_t *loader) {
+  uint64_t *counts = loader->header.counts;
+  value_t value;
+  memcpy(&value, _image_get(loader, sizeof(value)), sizeof(value));
+  switch (value.type) {
+    case (VALUE_UNDEFINED):
+    case (VALUE_VOID):
+    case (VALUE_INTEGER):
+    case (VALUE_DOUBLE):
+    case (VALUE_BOOLEAN):
+      return value;
+    case (VALUE_STRING):
+      if (value.small_length == VALUE_LARGE_STRING) {
+        if ((uint64_t) value.as.integer >= loader->header.num_strings) {
+          _image_damaged(loader);
+        }
+        value.as.string = _image_string(loader, (size_t) value.as.integer);
+      } else if (value.small_length > VALUE_SMALL_STRING) {
+        _image_damaged(loader);
+      }
+      return value;
+    default:
+      break;
+  }
+  _image_kind_t kinds [] = {
+    [VALUE_FUNCTION] = IMAGE_FUNCTIONS,
+    [VALUE_OBJECT] = IMAGE_OBJECTS,
+    [VALUE_ARRAY] = IMAGE_ARRAYS,
+    [VALUE_BIGNUM] = IMAGE_BIGNUMS,
+    [VALUE_BOX] = IMAGE_BOXES
+  };
+  if (value.type > VALUE_BOX || value.type == VALUE_GENERATOR) {
+    _image_damaged(loader);
+  }
+  _image_kind_t kind = value.type == VALUE_FUNCTION && value.small_length == IMAGE_CLOSURE ? IMAGE_CLOSURES : kinds[value.type];
+  uint64_t number = (uint64_t) value.as.integer;
+  if (number >= counts[kind]) {
+    _image_damaged(loader);
+  }
+  switch (kind) {
+    case (IMAGE_BIGNUMS):
+      return loader->bignums[number];
+    case (IMAGE_FUNCTIONS):
+      // elsewhere one with captures is only ever a value as a closure
+      if (!loader->constants && !loader->functions[number]->native && loader->functions[number]->num_captures > 0) {
+        _image_damaged(loader);
+      }
+      value.as.function = loader->functions[number];
+      break;
+    case (IMAGE_CLOSURES):
+      value.as.function = &loader->closures[number]->function;
+      break;
+    case (IMAGE_OBJECTS):
+      value.as.object = loader->objects[number];
+      break;
+    case (IMAGE_ARRAYS):
+      value.as.array = loader->arrays[number];
+      break;
+    default:
+      value.as.box = loader->boxes[number];
+  }
+  value.small_length = 0;
+  return value;
+}
+
+function_t *_image_native (const char *name) {
+  struct {
+    function_t *natives;
+    size_t count;
+  } tables [] = {
+    {_arrays_builtins, sizeof(_arrays_builtins) / sizeof(function_t)},
+    {_strings_builtins, sizeof(_strings_builtins) / sizeof(function_t)},
+    {_evals_builtins, sizeof(_evals_builtins) / sizeof(function_t)},
+    {_output_builtins, sizeof(_output_builtins) / sizeof(function_t)}
+  };
+  for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+    for (size_t j = 0; j < tables[i].count; j++) {
+      if (strcmp(tables[i].natives[j].name, name) == 0) {
+        return &tables[i].natives[j];
+      }
+    }
+  }
+  return NULL;
+}
+
+function_t *_image_get_function (_image_loader_t *loader) {
+  wtjl_context_t *ctx = loader->ctx;
+  const char *name = _image_get_name(loader);
+  uint64_t flags = _image_get_u64(loader);
+  if (flags & IMAGE_NATIVE) {
+    function_t *native = _image_native(name);
+    if (!native) {
+      wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; the image is from another build.");
+    }
+    return native;
+  }
+  function_t *function = _compiler_function_new(ctx, (char *) name);
+  _compiler_register_function(ctx, function);
+  chunk_t *chunk = &function->chunk;
+  function->generator = flags & IMAGE_GENERATOR;
+  function->arity = _image_get_u64(loader);
+  function->max_stack = _image_get_u64(loader);
+  function->num_captures = _image_get_u64(loader);
+  if (function->arity > UINT8_MAX || function->max_stack > VM_STACK_MAX || function->num_captures > UINT16_MAX) {
+    _image_damaged(loader);
+  }
+  // the function is the context's already, so a load failing from here on
+  // frees it, and it must only ever count what it has read
+  uint64_t code_length = _image_get_u64(loader);
+  const char *code = _image_get(loader, code_length);
+  chunk->code = malloc(MAX(code_length, 1));
+  memcpy(chunk->code, code, code_length);
+  chunk->code_length = chunk->code_capacity = code_length;
+  _image_get_align(loader);
+  // filled in with the rest of the values, as they may be functions still to
+  // come; constants_length counts them in
+  uint64_t num_constants = _image_get_u64(loader);
+  chunk->constants = _image_scratch(loader, num_constants, sizeof(value_t), sizeof(value_t));
+  chunk->constants_capacity = num_constants;
+  size_t num_caches = _image_get_u64(loader);
+  chunk->caches = _image_scratch(loader, num_caches, sizeof(uint64_t), sizeof(member_cache_t));
+  chunk->caches_capacity = num_caches;
+  for (; chunk->num_caches < num_caches; chunk->num_caches++) {
+    chunk->caches[chunk->num_caches].name = strdup(_image_get_name(loader));
+    chunk->caches[chunk->num_caches].num_shapes = 0;
+  }
+  return function;
+}
+
+// how many values the instruction at `at` takes off the stack and how many
+// it leaves there, as the compiler counted them when it emitted it
+void _image_stack_use (chunk_t *chunk, size_t at, size_t *pops, size_t *pushes) {
+  uint8_t *code = chunk->code;
+  *pops = 0;
+  *pushes = 0;
+  switch (_compiler_unfused(code[at])) {
+    case (OP_CONSTANT):
+    case (OP_VOID):
+    case (OP_GET_LOCAL):
+    case (OP_GET_GLOBAL):
+    case (OP_NEW):
+    case (OP_GET_CAPTURE):
+    case (OP_GET_ENCLOSING):
+      *pushes = 1;
+      break;
+    case (OP_POP):
+    case (OP_SET_LOCAL):
+    case (OP_SET_GLOBAL):
+    case (OP_DEFINE_GLOBAL):
+    case (OP_SET_ENCLOSING):
+    case (OP_JUMP_IF_FALSE):
+    case (OP_YIELD):
+    case (OP_RETURN):
+      *pops = 1;
+      break;
+    case (OP_NEGATE):
+    case (OP_NEGATE_INTEGER):
+    case (OP_NEGATE_DOUBLE):
+    case (OP_CHECK):
+    case (OP_GET_MEMBER):
+    case (OP_BOX):
+    case (OP_GET_BOX):
+      *pops = 1;
+      *pushes = 1;
+      break;
+    case (OP_NEXT):
+      // the generator stays, and what it yields goes above it
+      *pops = 1;
+      *pushes = 2;
+      break;
+    case (OP_SET_MEMBER):
+    case (OP_SET_BOX):
+      *pops = 2;
+      break;
+    case (OP_SET_INDEX):
+      *pops = 3;
+      break;
+    case (OP_REDUCE):
+      *pops = 3;
+      *pushes = 1;
+      break;
+    case (OP_CALL):
+    case (OP_TAIL_CALL):
+      *pops = code[at + 1] + 1;
+      *pushes = 1;
+      break;
+    case (OP_CLOSURE):
+      *pops = chunk->constants[code[at + 1] | (code[at + 2] << 8)].as.function->num_captures;
+      *pushes = 1;
+      break;
+    case (OP_JUMP):
+    case (OP_LOOP):
+      break;
+    default:
+      // the binary operators and OP_GET_INDEX
+      *pops = 2;
+      *pushes = 1;
+  }
+}
+
+// fails unless every instruction of `function`, once its constants are in,
+// stays inside its code, and every index and jump in it inside what it
+// indexes, and unless the stack each reachable instruction starts with is
+// the same however it is reached, holds what the instruction takes and
+// stays inside the frame. Captures and slots of frames further out depend
+// on the frames running, so the vm checks those where they are used
+void _image_check_code (_image_loader_t *loader, function_t *function) {
+  chunk_t *chunk = &function->chunk;
+  uint8_t *code = chunk->code;
+  size_t length = chunk->code_length;
+  // where each instruction starts, for the jumps, which must land on one
+  bool *starts = malloc(MAX(length, 1) * sizeof(bool));
+  memset(starts, 0, MAX(length, 1) * sizeof(bool));
+  bool damaged = length == 0;
+  size_t last = 0;
+  for (size_t at = 0; at < length && !damaged; at += 1 + _compiler_operand_bytes(code[at])) {
+    starts[at] = true;
+    last = at;
+    damaged = code[at] >= VM_OPCODES || at + 1 + _compiler_operand_bytes(code[at]) > length;
+  }
+  damaged = damaged || code[last] != OP_RETURN;
+  for (size_t at = 0; at < length && !damaged; at += 1 + _compiler_operand_bytes(code[at])) {
+    opcode_t op = _compiler_unfused(code[at]);
+    size_t next = at + 1 + _compiler_operand_bytes(code[at]);
+    // the u16 that ends the operands, or the lone u8
+    size_t operand = next - at >= 3 ? (size_t) (code[next - 2] | (code[next - 1] << 8)) : next - at == 2 ? code[at + 1] : 0;
+    switch (op) {
+      case (OP_CONSTANT):
+        damaged = operand >= chunk->constants_length || (chunk->constants[operand].type == VALUE_FUNCTION && !chunk->constants[operand].as.function->native && !chunk->constants[operand].as.function->closure && chunk->constants[operand].as.function->num_captures > 0);
+        break;
+      case (OP_CLOSURE):
+        damaged = operand >= chunk->constants_length || chunk->constants[operand].type != VALUE_FUNCTION || chunk->constants[operand].as.function->native || chunk->constants[operand].as.function->closure;
+        break;
+      case (OP_GET_LOCAL):
+      case (OP_SET_LOCAL):
+        damaged = operand >= function->max_stack;
+        break;
+      case (OP_GET_GLOBAL):
+      case (OP_SET_GLOBAL):
+      case (OP_DEFINE_GLOBAL):
+        damaged = operand >= loader->header.num_globals;
+        break;
+      case (OP_GET_MEMBER):
+      case (OP_SET_MEMBER):
+        damaged = operand >= chunk->num_caches;
+        break;
+      case (OP_JUMP):
+      case (OP_JUMP_IF_FALSE):
+      case (OP_NEXT):
+        damaged = next + operand >= length || !starts[next + operand];
+        break;
+      case (OP_LOOP):
+        damaged = operand > next || !starts[next - operand];
+        break;
+      case (OP_GET_CAPTURE):
+        damaged = code[at + 1] == 0 && operand >= function->num_captures;
+        break;
+      case (OP_REDUCE):
+        damaged = operand > REDUCE_MAX;
+        break;
+      case (OP_YIELD):
+        damaged = !function->generator;
+        break;
+      default:
+        break;
+    }
+    // the vm steps over the rest of a superinstruction's run unchecked
+    for (size_t i = 0; i < sizeof(_compiler_superinstructions) / sizeof(_compiler_superinstructions[0]) && !damaged; i++) {
+      if (_compiler_superinstructions[i].fused != code[at]) {
+        continue;
+      }
+      for (size_t k = 1, in = next; k < _compiler_superinstructions[i].length && !damaged; k++) {
+        damaged = in >= length || code[in] != _compiler_superinstructions[i].run[k];
+        in += damaged ? 0 : 1 + _compiler_operand_bytes(code[in]);
+      }
+    }
+  }
+  // SIZE_MAX for instructions nothing reaches yet
+  size_t *depths = malloc(MAX(length, 1) * sizeof(size_t));
+  size_t *pending = malloc(MAX(length, 1) * sizeof(size_t));
+  for (size_t at = 0; at < length; at++) {
+    depths[at] = SIZE_MAX;
+  }
+  size_t num_pending = 0;
+  if (!damaged) {
+    depths[0] = function->arity;
+    pending[num_pending++] = 0;
+  }
+  while (num_pending > 0 && !damaged) {
+    size_t at = pending[--num_pending];
+    size_t depth = depths[at];
+    opcode_t op = _compiler_unfused(code[at]);
+    size_t next = at + 1 + _compiler_operand_bytes(code[at]);
+    size_t operand = next - at >= 3 ? (size_t) (code[next - 2] | (code[next - 1] << 8)) : next - at == 2 ? code[at + 1] : 0;
+    size_t pops;
+    size_t pushes;
+    _image_stack_use(chunk, at, &pops, &pushes);
+    damaged = depth < pops || depth - pops + pushes > function->max_stack;
+    // a local is read or written where it already is, below what is taken
+    damaged = damaged || ((op == OP_GET_LOCAL || op == OP_SET_LOCAL) && operand >= depth - pops);
+    // where it goes on, and with how much; a finished generator leaves nothing
+    size_t targets [2];
+    size_t target_depths [2];
+    size_t num_targets = 0;
+    if (op != OP_RETURN && op != OP_JUMP && op != OP_LOOP) {
+      targets[num_targets] = next;
+      target_depths[num_targets++] = depth - pops + pushes;
+    }
+    if (op == OP_JUMP || op == OP_JUMP_IF_FALSE || op == OP_NEXT) {
+      targets[num_targets] = next + operand;
+      target_depths[num_targets++] = op == OP_NEXT ? depth : depth - pops;
+    } else if (op == OP_LOOP) {
+      targets[num_targets] = next - operand;
+      target_depths[num_targets++] = depth;
+    }
+    for (size_t i = 0; i < num_targets && !damaged; i++) {
+      if (depths[targets[i]] == SIZE_MAX) {
+        depths[targets[i]] = target_depths[i];
+        pending[num_pending++] = targets[i];
+      }
+      damaged = depths[targets[i]] != target_depths[i];
+    }
+  }
+  free(depths);
+  free(pending);
+  free(starts);
+  if (damaged) {
+    _image_damaged(loader);
+  }
+}
+
+void _image_free_loader (_image_loader_t *loader) {
+  free(loader->chars);
+  free(loader->lengths);
+  free(loader->strings);
+  free(loader->bignums);
+  free(loader->functions);
+  free(loader->objects);
+  free(loader->arrays);
+  free(loader->closures);
+  free(loader->boxes);
+}
+
+// starts `ctx` from the image in `bytes`, which must outlive it. Only a
+// context that has run nothing yet may load one: the image's code reads
+// globals by slot, so they must all be where they were when it was saved
+void image_load (wtjl_context_t *ctx, const char *bytes, size_t length) {
+  if (ctx->image.loaded) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; a context loads only one image.");
+  }
+  _image_loader_t loader;
+  memset(&loader, 0, sizeof(loader));
+  loader.ctx = ctx;
+  loader.bytes = bytes;
+  loader.length = length;
+  _image_header_t *header = &loader.header;
+  memcpy(header, _image_get(&loader, sizeof(*header)), sizeof(*header));
+  if (memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || header->length != length) {
+    _image_damaged(&loader);
+  }
+  if (header->version != IMAGE_VERSION || header->opcodes != IMAGE_OPCODES) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; the image is from another build.");
+  }
+  if (header->checksum != _image_checksum(header, bytes, length)) {
+    _image_damaged(&loader);
+  }
+  ctx->image.loaded = true;
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_CONTEXT);
+  uint64_t *counts = header->counts;
+  vm_state_t *state = &ctx->vm;
+  loader.chars = _image_scratch(&loader, header->num_strings, 2 * sizeof(uint64_t), sizeof(char *));
+  loader.lengths = malloc(MAX(header->num_strings, 1) * sizeof(size_t));
+  loader.strings = malloc(MAX(header->num_strings, 1) * sizeof(string_t *));
+  memset(loader.strings, 0, MAX(header->num_strings, 1) * sizeof(string_t *));
+  // the names come first, so a context they do not fit is turned away before
+  // anything is made; they are checked once the strings are known
+  size_t names = loader.offset;
+  if (header->num_globals < state->num_globals || header->num_globals > (length - names) / sizeof(uint64_t)) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; the context already has globals of its own.");
+  }
+  loader.offset += header->num_globals * sizeof(uint64_t);
+  for (size_t i = 0; i < header->num_strings; i++) {
+    loader.lengths[i] = _image_get_u64(&loader);
+    loader.chars[i] = _image_get(&loader, loader.lengths[i] + 1);
+    if (loader.chars[i][loader.lengths[i]] != '\0') {
+      _image_damaged(&loader);
+    }
+    _image_get_align(&loader);
+  }
+  size_t strings = loader.offset;
+  loader.offset = names;
+  for (size_t i = 0; i < state->num_globals; i++) {
+    if (strcmp(state->global_names[i], _image_get_name(&loader)) != 0) {
+      wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; the context already has globals of its own.");
+    }
+  }
+  // the rest are new, and were saved from slots with names of their own, so
+  // they are added without looking each one up
+  if (header->num_globals > state->globals_capacity) {
+    state->globals_capacity = header->num_globals;
+    state->globals = realloc(state->globals, state->globals_capacity * sizeof(value_t));
+    state->global_names = realloc(state->global_names, state->globals_capacity * sizeof(char *));
+  }
+  while (state->num_globals < header->num_globals) {
+    state->globals[state->num_globals].type = VALUE_UNDEFINED;
+    state->global_names[state->num_globals++] = strdup(_image_get_name(&loader));
+  }
+  loader.offset = strings;
+  wtjl_context_t_charge(ctx, WTJL_MODULE_VM);
+  loader.bignums = _image_scratch(&loader, counts[IMAGE_BIGNUMS], 2 * sizeof(uint64_t), sizeof(value_t));
+  for (size_t i = 0; i < counts[IMAGE_BIGNUMS]; i++) {
+    bool negative = _image_get_u64(&loader);
+    uint64_t limbs = _image_get_u64(&loader);
+    if (limbs > (length - loader.offset) / sizeof(uint64_t)) {
+      _image_damaged(&loader);
+    }
+    bignum_t *bignum = malloc(sizeof(bignum_t) + limbs * sizeof(uint64_t));
+    bignum->negative = negative;
+    bignum->length = limbs;
+    memcpy(bignum->limbs, _image_get(&loader, limbs * sizeof(uint64_t)), limbs * sizeof(uint64_t));
+    loader.bignums[i] = vm.bignum(ctx, bignum);
+    if (loader.bignums[i].type == VALUE_BIGNUM) {
+      loader.bignums[i].as.bignum->pinned = true;
+    }
+  }
+  wtjl_context_t_charge(ctx, WTJL_MODULE_COMPILER);
+  loader.functions = _image_scratch(&loader, counts[IMAGE_FUNCTIONS], 2 * sizeof(uint64_t), sizeof(function_t *));
+  for (size_t i = 0; i < counts[IMAGE_FUNCTIONS]; i++) {
+    loader.functions[i] = _image_get_function(&loader);
+  }
+  wtjl_context_t_charge(ctx, WTJL_MODULE_VM);
+  loader.objects = _image_scratch(&loader, counts[IMAGE_OBJECTS], sizeof(uint64_t), sizeof(object_t *));
+  for (size_t i = 0; i < counts[IMAGE_OBJECTS]; i++) {
+    object_t *object = loader.objects[i] = _vm_new_object(ctx);
+    uint64_t num_members = _image_get_u64(&loader);
+    object->slots = _image_scratch(&loader, num_members, sizeof(uint64_t), sizeof(value_t));
+    object->slots_capacity = num_members;
+    for (size_t j = 0; j < num_members; j++) {
+      const char *name = _image_get_name(&loader);
+      if (_vm_shape_slot(object->shape, name) >= 0) {
+        _image_damaged(&loader);
+      }
+      object->shape = _vm_shape_add(ctx, object->shape, name);
+      object->slots[j].type = VALUE_VOID;
+    }
+  }
+  loader.arrays = _image_scratch(&loader, counts[IMAGE_ARRAYS], 2 * sizeof(uint64_t), sizeof(array_t *));
+  for (size_t i = 0; i < counts[IMAGE_ARRAYS]; i++) {
+    uint64_t kind = _image_get_u64(&loader);
+    uint64_t elements = _image_get_u64(&loader);
+    size_t size = kind == ARRAY_VALUES ? sizeof(value_t) : kind == ARRAY_INTEGERS ? sizeof(int64_t) : sizeof(uint8_t);
+    if (kind > ARRAY_BYTES || elements > (length - loader.offset) / size) {
+      _image_damaged(&loader);
+    }
+    array_t *array = loader.arrays[i] = vm.new_array(ctx, (array_kind_t) kind, (size_t) elements);
+    if (kind != ARRAY_VALUES) {
+      memcpy(array->as.bytes, _image_get(&loader, elements * size), elements * size);
+      _image_get_align(&loader);
+    }
+  }
+  loader.closures = _image_scratch(&loader, counts[IMAGE_CLOSURES], sizeof(uint64_t), sizeof(closure_t *));
+  for (size_t i = 0; i < counts[IMAGE_CLOSURES]; i++) {
+    function_t *function = loader.functions[_image_get_number(&loader, counts[IMAGE_FUNCTIONS])];
+    if (function->native) {
+      _image_damaged(&loader);
+    }
+    value_t captures [function->num_captures + 1];
+    memset(captures, 0, sizeof(captures));
+    loader.closures[i] = _vm_new_closure(ctx, function, captures);
+  }
+  loader.boxes = _image_scratch(&loader, counts[IMAGE_BOXES], sizeof(value_t), sizeof(box_t *));
+  for (size_t i = 0; i < counts[IMAGE_BOXES]; i++) {
+    value_t value;
+    value.type = VALUE_VOID;
+    loader.boxes[i] = _vm_new_box(ctx, value);
+  }
+  // everything exists now, so the values can point at any of it
+  loader.constants = true;
+  for (size_t i = 0; i < counts[IMAGE_FUNCTIONS]; i++) {
+    function_t *function = loader.functions[i];
+    while (!function->native && function->chunk.constants_length < function->chunk.constants_capacity) {
+      value_t constant = _image_get_value(&loader);
+      function->chunk.constants[function->chunk.constants_length++] = constant;
+    }
+    if (!function->native) {
+      _image_check_code(&loader, function);
+    }
+  }
+  loader.constants = false;
+  // closures copied their functions before the constants were counted in
+  for (size_t i = 0; i < counts[IMAGE_CLOSURES]; i++) {
+    loader.closures[i]->function.chunk = loader.closures[i]->literal->chunk;
+  }
+  for (size_t i = 0; i < counts[IMAGE_OBJECTS]; i++) {
+    for (size_t j = 0; j < loader.objects[i]->shape->num_members; j++) {
+      loader.objects[i]->slots[j] = _image_get_value(&loader);
+    }
+  }
+  for (size_t i = 0; i < counts[IMAGE_ARRAYS]; i++) {
+    array_t *array = loader.arrays[i];
+    for (size_t j = 0; array->kind == ARRAY_VALUES && j < array->length; j++) {
+      array->as.values[j] = _image_get_value(&loader);
+    }
+  }
+  for (size_t i = 0; i < counts[IMAGE_CLOSURES]; i++) {
+    closure_t *closure = loader.closures[i];
+    for (size_t j = 0; j < closure->function.num_captures; j++) {
+      closure->captures[j] = _image_get_value(&loader);
+    }
+  }
+  for (size_t i = 0; i < counts[IMAGE_BOXES]; i++) {
+    loader.boxes[i]->value = _image_get_value(&loader);
+  }
+  for (size_t i = 0; i < header->num_globals; i++) {
+    state->globals[i] = _image_get_value(&loader);
+  }
+  wtjl_context_t_charge(ctx, charged);
+  _image_free_loader(&loader);
+}
+
+// maps the image file at `path` and loads it; the mapping goes with the context
+void image_load_file (wtjl_context_t *ctx, const char *path) {
+  if (ctx->image.mapping) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; a context loads only one image.");
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; cannot open \"%s\".", path);
+  }
+  struct stat file_stat;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    mapping = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_IO, "Image error; cannot read \"%s\".", path);
+  }
+  ctx->image.mapping = mapping;
+  ctx->image.mapping_length = (size_t) file_stat.st_size;
+  image_load(ctx, mapping, ctx->image.mapping_length);
+}
+
+void image_initialize (wtjl_context_t *ctx) {
+  ctx->image.mapping = NULL;
+  ctx->image.mapping_length = 0;
+  ctx->image.loaded = false;
+}
+
+// strings still read from the mapping, so it goes only after the vm has
+void image_cleanup (wtjl_context_t *ctx) {
+  if (ctx->image.mapping) {
+    munmap(ctx->image.mapping, ctx->image.mapping_length);
+  }
+  ctx->image.mapping = NULL;
+  ctx->image.mapping_length = 0;
+}
+
+void setup_image () {
+  image.initialize = image_initialize;
+  image.cleanup = image_cleanup;
+  image.save = image_save;
+  image.load = image_load;
+  image.load_file = image_load_file;
+}
+
+/* end image */
+
+/* ``begin bignums */
+
+// Integers past an int64 are bignums. These work on magnitudes in 64 bit
+// limbs and return new bignums, malloc'd and trimmed; the vm tracks the ones
+// that become values and turns any that fit back into int64s. Products of
+// BIGNUM_KARATSUBA limbs or more split Karatsuba's way, and decimal goes
+// BIGNUM_DECIMAL_DIGITS digits per pass over the limbs rather than one.
+
+#define BIGNUM_KARATSUBA 32
+#define BIGNUM_DECIMAL_DIGITS 19
+#define BIGNUM_DECIMAL_BASE 10000000000000000000ULL
+
+bignum_t *_bignums_new (size_t length) {
+  bignum_t *x = malloc(sizeof(bignum_t) + MAX(length, 1) * sizeof(uint64_t));
+  x->negative = false;
+  x->length = length;
+  memset(x->limbs, 0, length * sizeof(uint64_t));
+  return x;
+}
+
+size_t _bignums_significant (const uint64_t *limbs, size_t length) {
+  while (length && !limbs[length - 1]) {
+    length--;
+  }
+  return length;
+}
+
+bignum_t *_bignums_trim (bignum_t *x) {
+  x->length = _bignums_significant(x->limbs, x->length);
+  x->negative &= x->length != 0;
+  return x;
+}
+
+// `integer` as a bignum in `buffer`, BIGNUM_VIEW_SIZE uint64s, which needs no freeing
+bignum_t *bignums_integer (int64_t integer, uint64_t *buffer) {
+  bignum_t *x = (bignum_t *) buffer;
+  x->negative = integer < 0;
+  x->limbs[0] = integer < 0 ? 0 - (uint64_t) integer : (uint64_t) integer;
+  x->length = x->limbs[0] != 0;
+  return x;
+}
+
+// x += y where nx >= ny; returns the carry out of x
+uint64_t _bignums_add_limbs (uint64_t *x, size_t nx, const uint64_t *y, size_t ny) {
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < ny; i++) {
+    unsigned __int128 sum = (unsigned __int128) x[i] + y[i] + carry;
+    x[i] = (uint64_t) sum;
+    carry = (uint64_t) (sum >> 64);
+  }
+  for (; carry && i < nx; i++) {
+    carry = ++x[i] == 0;
+  }
+  return carry;
+}
+
+// x -= y where nx >= ny; returns the borrow out of x
+uint64_t _bignums_subtract_limbs (uint64_t *x, size_t nx, const uint64_t *y, size_t ny) {
+  uint64_t borrow = 0;
+  size_t i = 0;
+  for (; i < ny; i++) {
+    uint64_t difference = x[i] - y[i];
+    uint64_t next = x[i] < y[i] || difference < borrow;
+    x[i] = difference - borrow;
+    borrow = next;
+  }
+  for (; borrow && i < nx; i++) {
+    borrow = x[i]-- == 0;
+  }
+  return borrow;
+}
+
+// of trimmed magnitudes
+int _bignums_compare_limbs (const uint64_t *x, size_t nx, const uint64_t *y, size_t ny) {
+  if (nx != ny) {
+    return nx < ny ? -1 : 1;
+  }
+  for (size_t i = nx; i > 0; i--) {
+    if (x[i - 1] != y[i - 1]) {
+      return x[i - 1] < y[i - 1] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// out = a * b, na + nb limbs of it, where out overlaps neither
+void _bignums_multiply_schoolbook (const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out) {
+  memset(out, 0, (na + nb) * sizeof(uint64_t));
+  for (size_t j = 0; j < nb; j++) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < na; i++) {
+      unsigned __int128 product = (unsigned __int128) a[i] * b[j] + out[i + j] + carry;
+      out[i + j] = (uint64_t) product;
+      carry = (uint64_t) (product >> 64);
+    }
+    out[j + na] = carry;
+  }
+}
+
+// the same, Karatsuba's way once both are long enough: with a split into
+// a1 B^m + a0 and b likewise, a b is z2 B^2m + z1 B^m + z0 where z1 =
+// (a0 + a1)(b0 + b1) - z2 - z0, three products of half the size instead of four
+void _bignums_multiply_limbs (const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out) {
+  if (na < nb) {
+    _bignums_multiply_limbs(b, nb, a, na, out);
+    return;
+  }
+  if (nb < BIGNUM_KARATSUBA) {
+    _bignums_multiply_schoolbook(a, na, b, nb, out);
+    return;
+  }
+  size_t m = na / 2;
+  if (nb <= m) {
+    // too lopsided to split b, so a0 b + a1 b B^m
+    uint64_t *high = malloc((na - m + nb) * sizeof(uint64_t));
+    _bignums_multiply_limbs(a, m, b, nb, out);
+    _bignums_multiply_limbs(a + m, na - m, b, nb, high);
+    memset(out + m + nb, 0, (na - m) * sizeof(uint64_t));
+    _bignums_add_limbs(out + m, na + nb - m, high, na - m + nb);
+    free(high);
+    return;
+  }
+  // the halves' sums fit in ns limbs, as a1 is the longer half of a and b1 no longer than it
+  size_t ns = na - m + 1;
+  uint64_t *sa = malloc(4 * ns * sizeof(uint64_t));
+  uint64_t *sb = sa + ns;
+  uint64_t *z1 = sb + ns;
+  _bignums_multiply_limbs(a, m, b, m, out);
+  _bignums_multiply_limbs(a + m, na - m, b + m, nb - m, out + 2 * m);
+  memcpy(sa, a + m, (na - m) * sizeof(uint64_t));
+  sa[na - m] = 0;
+  _bignums_add_limbs(sa, ns, a, m);
+  memset(sb, 0, ns * sizeof(uint64_t));
+  memcpy(sb, b + m, (nb - m) * sizeof(uint64_t));
+  _bignums_add_limbs(sb, ns, b, m);
+  _bignums_multiply_limbs(sa, ns, sb, ns, z1);
+  _bignums_subtract_limbs(z1, 2 * ns, out, 2 * m);
+  _bignums_subtract_limbs(z1, 2 * ns, out + 2 * m, na + nb - 2 * m);
+  _bignums_add_limbs(out + m, na + nb - m, z1, _bignums_significant(z1, 2 * ns));
+  free(sa);
+}
+
+// q = u / v, nu - nv + 1 limbs of it, for trimmed u and v with nu >= nv > 0;
+// Knuth's algorithm D, estimating each limb of q from the top two of the
+// remainder and the top one of v, shifted so its top bit is set
+void _bignums_divide_limbs (const uint64_t *u, size_t nu, const uint64_t *v, size_t nv, uint64_t *q) {
+  if (nv == 1) {
+    unsigned __int128 remainder = 0;
+    for (size_t i = nu; i > 0; i--) {
+      unsigned __int128 numerator = (remainder << 64) | u[i - 1];
+      q[i - 1] = (uint64_t) (numerator / v[0]);
+      remainder = numerator % v[0];
+    }
+    return;
+  }
+  int shift = __builtin_clzll(v[nv - 1]);
+  uint64_t *vn = malloc((nv + nu + 1) * sizeof(uint64_t));
+  uint64_t *un = vn + nv;
+  for (size_t i = nv - 1; i > 0; i--) {
+    vn[i] = (v[i] << shift) | (shift ? v[i - 1] >> (64 - shift) : 0);
+  }
+  vn[0] = v[0] << shift;
+  un[nu] = shift ? u[nu - 1] >> (64 - shift) : 0;
+  for (size_t i = nu - 1; i > 0; i--) {
+    un[i] = (u[i] << shift) | (shift ? u[i - 1] >> (64 - shift) : 0);
+  }
+  un[0] = u[0] << shift;
+  for (size_t j = nu - nv + 1; j > 0; j--) {
+    uint64_t *window = un + j - 1; // nv + 1 limbs
+    unsigned __int128 numerator = ((unsigned __int128) window[nv] << 64) | window[nv - 1];
+    unsigned __int128 estimate = numerator / vn[nv - 1];
+    unsigned __int128 rest = numerator % vn[nv - 1];
+    while (estimate >> 64 || estimate * vn[nv - 2] > ((rest << 64) | window[nv - 2])) {
+      estimate--;
+      rest += vn[nv - 1];
+      if (rest >> 64) {
+        break;
+      }
+    }
+    uint64_t carry = 0;
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < nv; i++) {
+      unsigned __int128 product = estimate * vn[i] + carry;
+      uint64_t low = (uint64_t) product;
+      carry = (uint64_t) (product >> 64);
+      uint64_t difference = window[i] - low;
+      uint64_t next = window[i] < low || difference < borrow;
+      window[i] = difference - borrow;
+      borrow = next;
+    }
+    bool negative = window[nv] < carry || window[nv] - carry < borrow;
+    window[nv] -= carry + borrow;
+    // still one too many, rarely; adding v back carries out of the window
+    if (negative) {
+      estimate--;
+      _bignums_add_limbs(window, nv + 1, vn, nv);
+    }
+    q[j - 1] = (uint64_t) estimate;
+  }
+  free(vn);
+}
+
+// a + b, or a - b when `subtract`
+bignum_t *_bignums_add_signed (const bignum_t *a, const bignum_t *b, bool subtract) {
+  bool b_negative = b->negative != subtract;
+  if (a->negative == b_negative) {
+    const bignum_t *longer = a->length >= b->length ? a : b;
+    const bignum_t *shorter = longer == a ? b : a;
+    bignum_t *result = _bignums_new(longer->length + 1);
+    memcpy(result->limbs, longer->limbs, longer->length * sizeof(uint64_t));
+    _bignums_add_limbs(result->limbs, result->length, shorter->limbs, shorter->length);
+    result->negative = a->negative;
+    return _bignums_trim(result);
+  }
+  bool a_larger = _bignums_compare_limbs(a->limbs, a->length, b->limbs, b->length) >= 0;
+  const bignum_t *larger = a_larger ? a : b;
+  const bignum_t *smaller = a_larger ? b : a;
+  bignum_t *result = _bignums_new(larger->length);
+  memcpy(result->limbs, larger->limbs, larger->length * sizeof(uint64_t));
+  _bignums_subtract_limbs(result->limbs, result->length, smaller->limbs, smaller->length);
+  result->negative = a_larger ? a->negative : b_negative;
+  return _bignums_trim(result);
+}
+
+bignum_t *bignums_add (const bignum_t *a, const bignum_t *b) {
+  return _bignums_add_signed(a, b, false);
+}
+
+bignum_t *bignums_subtract (const bignum_t *a, const bignum_t *b) {
+  return _bignums_add_signed(a, b, true);
+}
+
+bignum_t *bignums_multiply (const bignum_t *a, const bignum_t *b) {
+  if (!a->length || !b->length) {
+    return _bignums_new(0);
+  }
+  bignum_t *result = _bignums_new(a->length + b->length);
+  _bignums_multiply_limbs(a->limbs, a->length, b->limbs, b->length, result->limbs);
+  result->negative = a->negative != b->negative;
+  return _bignums_trim(result);
+}
+
+// rounded toward zero, like int64 division; `b` must not be 0
+bignum_t *bignums_divide (const bignum_t *a, const bignum_t *b) {
+  if (_bignums_compare_limbs(a->limbs, a->length, b->limbs, b->length) < 0) {
+    return _bignums_new(0);
+  }
+  bignum_t *result = _bignums_new(a->length - b->length + 1);
+  _bignums_divide_limbs(a->limbs, a->length, b->limbs, b->length, result->limbs);
+  result->negative = a->negative != b->negative;
+  return _bignums_trim(result);
+}
+
+int bignums_compare (const bignum_t *a, const bignum_t *b) {
+  if (a->negative != b->negative) {
+    return a->negative ? -1 : 1;
+  }
+  int order = _bignums_compare_limbs(a->limbs, a->length, b->limbs, b->length);
+  return a->negative ? -order : order;
+}
+
+// false when it does not fit
+bool bignums_to_integer (const bignum_t *x, int64_t *integer) {
+  uint64_t magnitude = x->length ? x->limbs[0] : 0;
+  if (x->length > 1 || magnitude > (uint64_t) INT64_MAX + x->negative) {
+    return false;
+  }
+  *integer = x->negative ? (int64_t) (0 - magnitude) : (int64_t) magnitude;
+  return true;
+}
+
+double bignums_to_double (const bignum_t *x) {
+  double result = 0;
+  for (size_t i = x->length; i > 0; i--) {
+    result = result * 18446744073709551616.0 + (double) x->limbs[i - 1];
+  }
+  return x->negative ? -result : result;
+}
+
+// malloc'd and NUL terminated, with a - in front when negative; each pass
+// divides the whole magnitude by 10^19 for the next 19 digits
+char *bignums_to_decimal (const bignum_t *x, size_t *length) {
+  size_t n = x->length;
+  uint64_t *rest = malloc((3 * n + 2) * sizeof(uint64_t));
+  uint64_t *groups = rest + n; // least significant first; a limb is under 20 digits
+  size_t num_groups = 0;
+  memcpy(rest, x->limbs, n * sizeof(uint64_t));
+  do {
+    unsigned __int128 remainder = 0;
+    for (size_t i = n; i > 0; i--) {
+      unsigned __int128 numerator = (remainder << 64) | rest[i - 1];
+      rest[i - 1] = (uint64_t) (numerator / BIGNUM_DECIMAL_BASE);
+      remainder = numerator % BIGNUM_DECIMAL_BASE;
+    }
+    groups[num_groups++] = (uint64_t) remainder;
+    n = _bignums_significant(rest, n);
+  } while (n);
+  char *chars = malloc(num_groups * BIGNUM_DECIMAL_DIGITS + 2);
+  *length = 0;
+  if (x->negative) {
+    chars[(*length)++] = '-';
+  }
+  *length += sprintf(chars + *length, "%llu", (unsigned long long) groups[num_groups - 1]);
+  for (size_t i = num_groups - 1; i > 0; i--) {
+    *length += sprintf(chars + *length, "%019llu", (unsigned long long) groups[i - 1]);
+  }
+  free(rest);
+  return chars;
+}
+
+// of decimal digits with an optional - in front, nothing else; 19 digits at
+// a time are multiplied in
+bignum_t *bignums_from_decimal (const char *chars, size_t length) {
+  bool negative = length && chars[0] == '-';
+  chars += negative;
+  length -= negative;
+  bignum_t *x = _bignums_new(length / BIGNUM_DECIMAL_DIGITS + 1);
+  size_t used = 0;
+  size_t group = length % BIGNUM_DECIMAL_DIGITS ? length % BIGNUM_DECIMAL_DIGITS : BIGNUM_DECIMAL_DIGITS;
+  for (size_t i = 0; i < length; i += group, group = BIGNUM_DECIMAL_DIGITS) {
+    uint64_t scale = 1;
+    uint64_t carry = 0;
+    for (size_t j = 0; j < group; j++) {
+      scale *= 10;
+      carry = carry * 10 + (uint64_t) (chars[i + j] - '0');
+    }
+    for (size_t j = 0; j < used; j++) {
+      unsigned __int128 product = (unsigned __int128) x->limbs[j] * scale + carry;
+      x->limbs[j] = (uint64_t) product;
+      carry = (uint64_t) (product >> 64);
+    }
+    if (carry) {
+      x->limbs[used++] = carry;
+    }
+  }
+  x->length = used;
+  x->negative = negative;
+  return _bignums_trim(x);
+}
+
+// of hexadecimal or binary digits, `bits` to each, nothing else; a digit
+// never straddles two limbs
+bignum_t *bignums_from_radix (const char *chars, size_t length, int bits) {
+  bignum_t *x = _bignums_new(length * bits / 64 + 1);
+  for (size_t i = 0; i < length; i++) {
+    char c = chars[length - 1 - i];
+    uint64_t digit = isdigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+    x->limbs[i * bits / 64] |= digit << (i * bits % 64);
+  }
+  return _bignums_trim(x);
+}
+
+void bignums_initialize () {
+}
+
+void bignums_cleanup () {
+}
+
+void setup_bignums () {
+  bignums.initialize = bignums_initialize;
+  bignums.cleanup = bignums_cleanup;
+  bignums.integer = bignums_integer;
+  bignums.add = bignums_add;
+  bignums.subtract = bignums_subtract;
+  bignums.multiply = bignums_multiply;
+  bignums.divide = bignums_divide;
+  bignums.compare = bignums_compare;
+  bignums.to_integer = bignums_to_integer;
+  bignums.to_double = bignums_to_double;
+  bignums.to_decimal = bignums_to_decimal;
+  bignums.from_decimal = bignums_from_decimal;
+  bignums.from_radix = bignums_from_radix;
+}
+
+/* end bignums */
+
+/* ``begin setup modules */
+
+void _wtjl_setup_modules () {
+  SETUP_MODULE(ll)
+  SETUP_MODULE(bignums)
+  SETUP_MODULE(scanner)
+  SETUP_MODULE(tokenizer)
+  SETUP_MODULE(parser)
+  SETUP_MODULE(optimizer)
+  SETUP_MODULE(compiler)
+  SETUP_MODULE(vm)
+  SETUP_MODULE(arrays)
+  SETUP_MODULE(strings)
+  SETUP_MODULE(evals)
+  SETUP_MODULE(output)
+  SETUP_MODULE(loader)
+  SETUP_MODULE(heap)
+  SETUP_MODULE(image)
+}
+
+void wtjl_context_t_initialize_modules (wtjl_context_t *ctx) {
+  // first, so that it is cleaned up last
+  INITIALIZE_MODULE(image, ctx)
+  INITIALIZE_MODULE(scanner, ctx)
+  INITIALIZE_MODULE(tokenizer, ctx)
+  INITIALIZE_MODULE(parser, ctx)
+  INITIALIZE_MODULE(optimizer, ctx)
+  INITIALIZE_MODULE(compiler, ctx)
+  // the stack, the frames and the globals builtins take
+  wtjl_context_t_charge(ctx, WTJL_MODULE_VM);
+  INITIALIZE_MODULE(vm, ctx)
+  INITIALIZE_MODULE(arrays, ctx)
+  INITIALIZE_MODULE(strings, ctx)
+  INITIALIZE_MODULE(evals, ctx)
+  wtjl_context_t_charge(ctx, WTJL_MODULE_OUTPUT);
+  INITIALIZE_MODULE(output, ctx)
+  wtjl_context_t_charge(ctx, WTJL_MODULE_CONTEXT);
+  INITIALIZE_MODULE(loader, ctx)
+  INITIALIZE_MODULE(heap, ctx)
+}
+
+void wtjl_context_t_cleanup_modules (wtjl_context_t *ctx) {
+  heap.cleanup(ctx);
+  loader.cleanup(ctx);
+  output.cleanup(ctx);
+  evals.cleanup(ctx);
+  strings.cleanup(ctx);
+  arrays.cleanup(ctx);
+  vm.cleanup(ctx);
+  compiler.cleanup(ctx);
+  optimizer.cleanup(ctx);
+  parser.cleanup(ctx);
+  tokenizer.cleanup(ctx);
+  scanner.cleanup(ctx);
+  image.cleanup(ctx);
+}
+
+/* end setup modules */
+
+/* ``begin begin */
+
+// compiles the tokens the tokenizer holds, from whatever the scanner holds;
+// `script` is set while it is live so an error unwinding past this can
+// still release it
+void wtjl_context_t_compile_tokens (wtjl_context_t *ctx, function_t **script) {
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_PARSER);
+  parser.parse(ctx);
+  if (ctx->arguments->optimize) {
+    // compiled as written first, so code the optimizer removes still has
+    // its static errors reported, as it would without -O
+    wtjl_context_t_charge(ctx, WTJL_MODULE_COMPILER);
+    *script = compiler.compile(ctx, ctx->parser.ast);
+    compiler.discard(ctx, *script);
+    *script = NULL;
+    wtjl_context_t_charge(ctx, WTJL_MODULE_OPTIMIZER);
+    optimizer.optimize(ctx, ctx->parser.ast);
+  }
+  wtjl_context_t_charge(ctx, WTJL_MODULE_COMPILER);
+  *script = compiler.compile(ctx, ctx->parser.ast);
+  wtjl_context_t_charge(ctx, charged);
+  parser.cleanup(ctx);
+  tokenizer.cleanup(ctx);
+  scanner.cleanup(ctx);
+}
+
+void wtjl_context_t_compile (wtjl_context_t *ctx, function_t **script) {
+  wtjl_module_t charged = wtjl_context_t_charge(ctx, WTJL_MODULE_TOKENIZER);
+  tokenizer.tokenize(ctx);
+  wtjl_context_t_charge(ctx, charged);
+  wtjl_context_t_compile_tokens(ctx, script);
+}
+
+void wtjl_context_t_evaluate (wtjl_context_t *ctx, function_t **script) {
+  wtjl_context_t_compile(ctx, script);
+  vm.execute(ctx, *script);
+  compiler.free_function(ctx, *script);
+  *script = NULL;
+}
+
+void begin (wtjl_context_t *ctx) {
+  printf("Interpretting `%s`.\n", ctx->arguments->file_name);
+  loader.run(ctx, ctx->arguments->file_name);
+  // what the program printed comes out before anything reported after it
+  output.flush(ctx);
+  if (ctx->arguments->optimize) {
+    printf("Optimizer eliminated %d nodes.\n", (int) ctx->optimizer.eliminated);
+  }
+  /*token_t **tokens;
+  while (tokens = tokenizer.consume(ctx, 1)) {
+    printf("%s\n", tokenizer.token_as_string(ctx, tokens[0]));
+  }*/
+}
+
+/* end begin */
+
+/* ``begin api */
+
+typedef struct _wtjl_call_t {
+  const char *source;
+  size_t length;
+  const char *file_name;
+  function_t *script; // owned, released if the call fails
+  function_t *program; // borrowed
+  const char *name;
+  size_t argc;
+  const wtjl_value_t *argv;
+  wtjl_value_t *result;
+} _wtjl_call_t;
+
+wtjl_value_t _wtjl_value_from (wtjl_context_t *ctx, value_t value) {
+  wtjl_value_t result;
+  switch (value.type) {
+    case (VALUE_DOUBLE):
+      result.type = WTJL_DOUBLE;
+      result.as.number = value.as.number;
+      break;
+    case (VALUE_BOOLEAN):
+      result.type = WTJL_BOOLEAN;
+      result.as.boolean = value.as.boolean;
+      break;
+    case (VALUE_STRING):
+      // small strings are copied out of the value, which does not last
+      if (value.small_length != VALUE_LARGE_STRING) {
+        value.as.string = heap.copy(ctx, &value);
+        value.small_length = VALUE_LARGE_STRING;
+      } else {
+        heap.hand(ctx, &value);
+      }
+      result.type = WTJL_STRING;
+      result.as.string.chars = vm.string_chars(ctx, value.as.string);
+      result.as.string.length = value.as.string->length;
+      break;
+    case (VALUE_INTEGER):
+      result.type = WTJL_INTEGER;
+      result.as.integer = value.as.integer;
+      break;
+    case (VALUE_FUNCTION):
+      heap.hand(ctx, &value);
+      result.type = WTJL_FUNCTION;
+      result.as.function = value.as.function;
+      break;
+    case (VALUE_GENERATOR):
+      heap.hand(ctx, &value);
+      result.type = WTJL_GENERATOR;
+      result.as.generator = value.as.generator;
+      break;
+    case (VALUE_OBJECT):
+      heap.hand(ctx, &value);
+      result.type = WTJL_OBJECT;
+      result.as.object = value.as.object;
+      break;
+    case (VALUE_ARRAY):
+      heap.hand(ctx, &value);
+      result.type = WTJL_ARRAY;
+      result.as.array = value.as.array;
+      break;
+    case (VALUE_BIGNUM): {
+      string_t *digits = heap.copy(ctx, &value);
+      result.type = WTJL_BIG_INTEGER;
+      result.as.string.chars = digits->chars;
+      result.as.string.length = digits->length;
+      break;
+    }
+    default:
+      result.type = WTJL_VOID;
+      result.as.integer = 0;
+  }
+  return result;
+}
+
+value_t _wtjl_value_to (wtjl_context_t *ctx, wtjl_value_t value) {
+  value_t result;
+  switch (value.type) {
+    case (WTJL_DOUBLE):
+      result.type = VALUE_DOUBLE;
+      result.as.number = value.as.number;
+      break;
+    case (WTJL_BOOLEAN):
+      result.type = VALUE_BOOLEAN;
+      result.as.boolean = value.as.boolean != 0;
+      break;
+    case (WTJL_STRING):
+      result = vm.string(ctx, value.as.string.chars, value.as.string.length);
+      break;
+    case (WTJL_INTEGER):
+      result.type = VALUE_INTEGER;
+      result.as.integer = value.as.integer;
+      break;
+    case (WTJL_FUNCTION):
+      result.type = VALUE_FUNCTION;
+      result.as.function = value.as.function;
+      break;
+    case (WTJL_GENERATOR):
+      result.type = VALUE_GENERATOR;
+      result.as.generator = value.as.generator;
+      break;
+    case (WTJL_OBJECT):
+      result.type = VALUE_OBJECT;
+      result.as.object = value.as.object;
+      break;
+    case (WTJL_ARRAY):
+      result.type = VALUE_ARRAY;
+      result.as.array = value.as.array;
+      break;
+    case (WTJL_BIG_INTEGER):
+      result = vm.bignum(ctx, bignums.from_decimal(value.as.string.chars, value.as.string.length));
+      break;
+    default:
+      result.type = VALUE_VOID;
+  }
+  return result;
+}
+
+// runs `body` inside `ctx` with errors unwinding back here instead of exiting
+wtjl_status_t _wtjl_protect (wtjl_context_t *ctx, void (*body) (wtjl_context_t *, _wtjl_call_t *), _wtjl_call_t *call) {
+  if (ctx->heap.exhausted) {
+    ctx->status = WTJL_ERROR_MEMORY;
+    return ctx->status;
+  }
+  jmp_buf jmp;
+  jmp_buf *previous_jmp = ctx->_error_jmp;
+  size_t num_frames = ctx->vm.num_frames;
+  size_t stack_top = ctx->vm.stack_top - ctx->vm.stack;
+  size_t running = ctx->evals.running;
+  uint32_t account = ctx->mem.account;
+  j_mem_t *previous_mem = j_mem_bind(&ctx->mem);
+  ctx->status = WTJL_OK;
+  ctx->error[0] = '\0';
+  ctx->_error_jmp = &jmp;
+  if (setjmp(jmp) == 0) {
+    // the host holds nothing of the context's but what it was last handed,
+    // which it may be passing back in, so this is as safe a point to collect
+    // at as the vm's own, and one where a host that only reads globals or
+    // runs short snippets still gets its garbage back
+    if (ctx->mem.pressure) {
+      heap.collect(ctx);
+    }
+    heap.release(ctx);
+    body(ctx, call);
+  } else {
+    // drop whatever the failed phase left behind
+    vm.unwind(ctx, num_frames);
+    ctx->vm.stack_top = ctx->vm.stack + stack_top;
+    ctx->evals.running = running;
+    ctx->mem.account = account;
+    ctx->compiler.frame = NULL;
+    compiler.free_function(ctx, call->script);
+    call->script = NULL;
+    parser.cleanup(ctx);
+    tokenizer.cleanup(ctx);
+    scanner.cleanup(ctx);
+  }
+  ctx->_error_jmp = previous_jmp;
+  j_mem_bind(previous_mem);
+  return ctx->status;
+}
+
+void _wtjl_eval (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  scanner.scan_buffer(ctx, call->source, call->length);
+  wtjl_context_t_evaluate(ctx, &call->script);
+}
+
+int _wtjl_defined_global (wtjl_context_t *ctx, const char *name) {
+  int slot = vm.find_global(ctx, name);
+  if (slot < 0 || ctx->vm.globals[slot].type == VALUE_UNDEFINED) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_UNDEFINED, "\"%s\" is not defined.", name);
+  }
+  return slot;
+}
+
+void _wtjl_call (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  if (call->argc > UINT8_MAX) {
+    wtjl_context_t_fail(ctx, WTJL_ERROR_RUNTIME, "Runtime error; too many arguments.");
+  }
+  value_t callee = ctx->vm.globals[_wtjl_defined_global(ctx, call->name)];
+  value_t arguments [call->argc ? call->argc : 1];
+  for (size_t i = 0; i < call->argc; i++) {
+    arguments[i] = _wtjl_value_to(ctx, call->argv[i]);
+  }
+  value_t result = vm.call(ctx, callee, call->argc, arguments);
+  if (call->result) {
+    *call->result = _wtjl_value_from(ctx, result);
+  }
+}
+
+void _wtjl_get (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  *call->result = _wtjl_value_from(ctx, ctx->vm.globals[_wtjl_defined_global(ctx, call->name)]);
+}
+
+wtjl_context_t *wtjl_new (void) {
+  return wtjl_context_t_new(0, NULL);
+}
+
+void wtjl_destroy (wtjl_context_t *ctx) {
+  wtjl_context_t_destroy(ctx);
+}
+
+wtjl_status_t wtjl_eval (wtjl_context_t *ctx, const char *source, size_t length) {
+  _wtjl_call_t call = {0};
+  call.source = source;
+  call.length = length;
+  return _wtjl_protect(ctx, _wtjl_eval, &call);
+}
+
+wtjl_status_t wtjl_call (wtjl_context_t *ctx, const char *name, size_t argc, const wtjl_value_t *argv, wtjl_value_t *result) {
+  _wtjl_call_t call = {0};
+  call.name = name;
+  call.argc = argc;
+  call.argv = argv;
+  call.result = result;
+  return _wtjl_protect(ctx, _wtjl_call, &call);
+}
+
+wtjl_status_t wtjl_get (wtjl_context_t *ctx, const char *name, wtjl_value_t *value) {
+  _wtjl_call_t call = {0};
+  call.name = name;
+  call.result = value;
+  return _wtjl_protect(ctx, _wtjl_get, &call);
+}
+
+const char *wtjl_error (wtjl_context_t *ctx) {
+  return ctx->error;
+}
+
+void _wtjl_save_image (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  image.save(ctx, call->file_name);
+}
+
+void _wtjl_load_image (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  if (call->file_name) {
+    image.load_file(ctx, call->file_name);
+  } else {
+    image.load(ctx, call->source, call->length);
+  }
+}
+
+wtjl_status_t wtjl_save_image (wtjl_context_t *ctx, const char *path) {
+  _wtjl_call_t call = {0};
+  call.file_name = path;
+  return _wtjl_protect(ctx, _wtjl_save_image, &call);
+}
+
+wtjl_status_t wtjl_load_image (wtjl_context_t *ctx, const void *image, size_t length) {
+  _wtjl_call_t call = {0};
+  call.source = image;
+  call.length = length;
+  return _wtjl_protect(ctx, _wtjl_load_image, &call);
+}
+
+wtjl_status_t wtjl_load_image_file (wtjl_context_t *ctx, const char *path) {
+  _wtjl_call_t call = {0};
+  call.file_name = path;
+  return _wtjl_protect(ctx, _wtjl_load_image, &call);
+}
+
+void wtjl_limit_memory (wtjl_context_t *ctx, size_t soft_limit, size_t hard_limit) {
+  j_mem_limit(&ctx->mem, soft_limit, hard_limit);
+}
+
+void wtjl_memory (wtjl_context_t *ctx, wtjl_memory_t *memory) {
+  j_mem_t *mem = &ctx->mem;
+  memory->live = mem->total_alloc - mem->total_free;
+  memory->peak = mem->peak;
+  memory->soft_limit = mem->soft_limit;
+  memory->hard_limit = mem->hard_limit;
+  memory->collections = ctx->heap.collections;
+  memory->collected = ctx->heap.collected;
+  for (size_t i = 0; i < WTJL_MODULES; i++) {
+    memory->modules[i] = mem->accounts[i];
+  }
+}
+
+/* end api */
+
+/* ``begin document */
+
+// a source text kept tokenized and parsed for an editor; an edit re-lexes
+// only the tokens around it and re-parses only the top level statements
+// whose tokens changed, reusing the subtrees of everything else
+
+typedef struct document_statement_t {
+  node_t *node; // NULL if the statement failed to parse
+  size_t first_token;
+  size_t num_tokens;
+  bool open; // failed and ran to the end of input, so text appended later may change it
+  size_t error_offset;
+  char *error;
+} document_statement_t;
+
+typedef struct document_t {
+  wtjl_context_t *ctx; // holds the tokens and owns everything the document allocates
+  char *text;
+  size_t length;
+  size_t capacity;
+  document_statement_t *statements; // together they cover every token, in order
+  size_t num_statements;
+  size_t statements_capacity;
+  size_t num_errors;
+  // kept here rather than in the tokenizer, so parse errors carry no location
+  // that a later edit could make stale; diagnostics are located when asked for
+  uint32_t *line_starts;
+  size_t num_lines;
+  size_t lines_capacity;
+  // tokens from shift_from on really start shift_delta bytes from their offset;
+  // settling it lazily keeps a run of edits in one place from touching the
+  // tokens after them
+  size_t shift_from;
+  long shift_delta;
+  size_t relexed; // tokens lexed by the last edit
+  size_t reparsed; // statements parsed by the last edit
+} document_t;
+
+// offsets are 32 bits and may wrap while a shift is pending, so they are
+// resolved in 32 bits too
+size_t _document_token_start (document_t *document, size_t token) {
+  uint32_t offset = document->ctx->tokenizer.tokens[token]->offset;
+  return token >= document->shift_from ? (uint32_t) (offset + document->shift_delta) : offset;
+}
+
+size_t _document_token_end (document_t *document, size_t token) {
+  return _document_token_start(document, token) + document->ctx->tokenizer.tokens[token]->length;
+}
+
+// moves the start of the pending shift to `token`, touching only the tokens in between
+void _document_shift_to (document_t *document, size_t token) {
+  token_t **tokens = document->ctx->tokenizer.tokens;
+  for (size_t i = document->shift_from; i < token; i++) {
+    tokens[i]->offset += document->shift_delta;
+  }
+  for (size_t i = token; i < document->shift_from; i++) {
+    tokens[i]->offset -= document->shift_delta;
+  }
+  document->shift_from = token;
+}
+
+// first token ending at or after `offset`
+size_t _document_token_ending_after (document_t *document, size_t offset) {
+  size_t low = 0;
+  size_t high = document->ctx->tokenizer.tokens_size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (_document_token_end(document, middle) < offset) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// first token starting at or after `offset`
+size_t _document_token_starting_after (document_t *document, size_t offset) {
+  size_t low = 0;
+  size_t high = document->ctx->tokenizer.tokens_size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (_document_token_start(document, middle) < offset) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// first statement that does not end at or before `token`
+size_t _document_statement_after (document_t *document, size_t token) {
+  size_t low = 0;
+  size_t high = document->num_statements;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    document_statement_t *statement = &document->statements[middle];
+    if (statement->first_token + statement->num_tokens <= token && !statement->open) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+void _document_splice_text (document_t *document, size_t offset, size_t deleted, const char *inserted, size_t inserted_length) {
+  size_t length = document->length - deleted + inserted_length;
+  if (length + 1 > document->capacity) {
+    document->capacity = MAX(length + 1, document->capacity * 2);
+    document->text = realloc(document->text, document->capacity);
+  }
+  memmove(document->text + offset + inserted_length, document->text + offset + deleted, document->length - offset - deleted);
+  memcpy(document->text + offset, inserted, inserted_length);
+  document->length = length;
+  document->text[length] = '\0';
+}
+
+// keeps the line table in step with the same edit
+void _document_splice_lines (document_t *document, size_t offset, size_t deleted, const char *inserted, size_t inserted_length) {
+  long delta = (long) inserted_length - (long) deleted;
+  // lines starting in (offset, offset + deleted] began inside the deleted text
+  size_t from = _tokenizer_lines_through(document->line_starts, document->num_lines, offset);
+  size_t to = _tokenizer_lines_through(document->line_starts, document->num_lines, offset + deleted);
+  size_t num_inserted = 0;
+  for (const char *newline = inserted; (newline = memchr(newline, '\n', inserted + inserted_length - newline)); newline++) {
+    num_inserted++;
+  }
+  size_t num_lines = document->num_lines - (to - from) + num_inserted;
+  if (num_lines > document->lines_capacity) {
+    document->lines_capacity = MAX(num_lines, document->lines_capacity * 2);
+    document->line_starts = realloc(document->line_starts, document->lines_capacity * sizeof(uint32_t));
+  }
+  memmove(document->line_starts + from + num_inserted, document->line_starts + to, (document->num_lines - to) * sizeof(uint32_t));
+  size_t line = from;
+  for (const char *newline = inserted; (newline = memchr(newline, '\n', inserted + inserted_length - newline)); newline++) {
+    document->line_starts[line++] = offset + (newline - inserted) + 1;
+  }
+  document->num_lines = num_lines;
+  for (; line < num_lines; line++) {
+    document->line_starts[line] += delta;
+  }
+}
+
+// lexes from just after the last token before the edit until the new tokens
+// line up with old ones past it, then splices the new tokens over old tokens
+// [first, *resume); returns how many new tokens there are
+size_t _document_relex (document_t *document, size_t offset, size_t deleted, const char *inserted, size_t inserted_length, size_t *first, size_t *resume) {
+  wtjl_context_t *ctx = document->ctx;
+  tokenizer_state_t *state = &ctx->tokenizer;
+  long delta = (long) inserted_length - (long) deleted;
+  *first = _document_token_ending_after(document, offset);
+  // old tokens starting past the deleted text are unchanged and may be picked up again
+  *resume = MAX(*first, _document_token_starting_after(document, offset + deleted));
+  size_t lex_from = *first ? _document_token_end(document, *first - 1) : 0;
+  _document_shift_to(document, *first);
+  _document_splice_text(document, offset, deleted, inserted, inserted_length);
+  _document_splice_lines(document, offset, deleted, inserted, inserted_length);
+  state->input_length = document->length;
+
+  token_t **lexed = NULL;
+  size_t num_lexed = 0;
+  size_t lexed_capacity = 0;
+  scanner.scan_buffer(ctx, document->text, document->length);
+  ctx->scanner.index = lex_from;
+  for (; ; ) {
+    _tokenizer_skip_extras(ctx);
+    size_t position = ctx->scanner.index;
+    while (*resume < state->tokens_size && (long) _document_token_start(document, *resume) + delta < (long) position) {
+      (*resume)++;
+    }
+    if (*resume < state->tokens_size && (long) _document_token_start(document, *resume) + delta == (long) position) {
+      break;
+    }
+    token_t *token = _tokenizer_next(ctx);
+    if (!token) {
+      break;
+    }
+    if (num_lexed == lexed_capacity) {
+      lexed_capacity = lexed_capacity ? lexed_capacity * 2 : 16;
+      lexed = realloc(lexed, lexed_capacity * sizeof(token_t *));
+    }
+    lexed[num_lexed++] = token;
+  }
+  scanner.cleanup(ctx);
+
+  for (size_t i = *first; i < *resume; i++) {
+    free(state->tokens[i]->representation);
+    free(state->tokens[i]);
+  }
+  size_t tokens_size = state->tokens_size - (*resume - *first) + num_lexed;
+  if (tokens_size > state->tokens_capacity) {
+    state->tokens_capacity = MAX(tokens_size, state->tokens_capacity * 2);
+    state->tokens = realloc(state->tokens, state->tokens_capacity * sizeof(token_t *));
+  }
+  memmove(state->tokens + *first + num_lexed, state->tokens + *resume, (state->tokens_size - *resume) * sizeof(token_t *));
+  if (num_lexed) {
+    memcpy(state->tokens + *first, lexed, num_lexed * sizeof(token_t *));
+  }
+  state->tokens_size = tokens_size;
+  // the new tokens carry their real offsets, the ones after them move with the edit
+  document->shift_from = *first + num_lexed;
+  document->shift_delta += delta;
+  free(lexed);
+  document->relexed = num_lexed;
+  return num_lexed;
+}
+
+// parses one statement at `position`; on failure everything the attempt built
+// is dropped and the statement runs through the next `;`, so one mistake costs
+// one diagnostic
+void _document_parse_statement (document_t *document, size_t position, document_statement_t *statement) {
+  wtjl_context_t *ctx = document->ctx;
+  tokenizer_state_t *state = &ctx->tokenizer;
+  jmp_buf jmp;
+  jmp_buf *previous_jmp = ctx->_error_jmp;
+  _mem_node_t *mark = j_mem_mark(&ctx->mem);
+  statement->node = NULL;
+  statement->first_token = position;
+  statement->open = false;
+  statement->error_offset = 0;
+  statement->error = NULL;
+  state->tokens_index = position;
+  ctx->_error_jmp = &jmp;
+  if (setjmp(jmp) == 0) {
+    statement->node = _parser_statement(ctx);
+  } else {
+    j_mem_release_since(&ctx->mem, mark);
+    size_t failed = state->tokens_index;
+    statement->error_offset = failed < state->tokens_size ? _document_token_start(document, failed) : document->length;
+    statement->error = strdup(ctx->error);
+    while (failed < state->tokens_size && state->tokens[failed]->token_type_secondary != DELIMITER_SEMI) {
+      failed++;
+    }
+    statement->open = failed >= state->tokens_size;
+    state->tokens_index = MAX(position + 1, MIN(failed + 1, state->tokens_size));
+    document->num_errors++;
+  }
+  ctx->_error_jmp = previous_jmp;
+  ctx->status = WTJL_OK;
+  statement->num_tokens = state->tokens_index - position;
+}
+
+void _document_statement_free (document_t *document, document_statement_t *statement) {
+  _parser_node_free(statement->node);
+  if (statement->error) {
+    free(statement->error);
+    document->num_errors--;
+  }
+}
+
+// re-parses from the first statement touching the new tokens [first, first +
+// num_lexed) until a statement boundary lines up with an old statement past
+// them; old tokens from `resume` on are the ones that were kept, and moved by
+// `delta` bytes
+void _document_reparse (document_t *document, size_t first, size_t num_lexed, size_t resume, long delta) {
+  tokenizer_state_t *state = &document->ctx->tokenizer;
+  long token_delta = (long) num_lexed - (long) (resume - first);
+  size_t changed_end = first + num_lexed;
+  size_t replaced_from = _document_statement_after(document, first);
+  size_t replaced_to = replaced_from;
+  size_t position = replaced_from < document->num_statements ? document->statements[replaced_from].first_token : first;
+  bool lined_up = false;
+
+  document_statement_t *parsed = NULL;
+  size_t num_parsed = 0;
+  size_t parsed_capacity = 0;
+  while (position < state->tokens_size) {
+    while (replaced_to < document->num_statements && (document->statements[replaced_to].first_token < resume || (long) document->statements[replaced_to].first_token + token_delta < (long) position)) {
+      replaced_to++;
+    }
+    if (position >= changed_end && replaced_to < document->num_statements && (long) document->statements[replaced_to].first_token + token_delta == (long) position) {
+      lined_up = true;
+      break;
+    }
+    if (num_parsed == parsed_capacity) {
+      parsed_capacity = parsed_capacity ? parsed_capacity * 2 : 4;
+      parsed = realloc(parsed, parsed_capacity * sizeof(document_statement_t));
+    }
+    _document_parse_statement(document, position, &parsed[num_parsed]);
+    position += parsed[num_parsed].num_tokens;
+    num_parsed++;
+  }
+  if (!lined_up) {
+    replaced_to = document->num_statements;
+  }
+
+  for (size_t i = replaced_to; i > replaced_from; i--) {
+    _document_statement_free(document, &document->statements[i - 1]);
+  }
+  size_t num_statements = document->num_statements - (replaced_to - replaced_from) + num_parsed;
+  if (num_statements > document->statements_capacity) {
+    document->statements_capacity = MAX(num_statements, document->statements_capacity * 2);
+    document->statements = realloc(document->statements, document->statements_capacity * sizeof(document_statement_t));
+  }
+  memmove(document->statements + replaced_from + num_parsed, document->statements + replaced_to, (document->num_statements - replaced_to) * sizeof(document_statement_t));
+  if (num_parsed) {
+    memcpy(document->statements + replaced_from, parsed, num_parsed * sizeof(document_statement_t));
+  }
+  document->num_statements = num_statements;
+  for (size_t i = replaced_from + num_parsed; i < num_statements; i++) {
+    document->statements[i].first_token += token_delta;
+    if (document->statements[i].error) {
+      document->statements[i].error_offset += delta;
+    }
+  }
+  free(parsed);
+  document->reparsed = num_parsed;
+}
+
+document_t *document_t_new () {
+  // calloc'd directly like contexts; everything else lives in its context
+  document_t *document = calloc(1, sizeof(document_t));
+  document->ctx = wtjl_context_t_new(0, NULL);
+  document->ctx->tokenizer.recover = true;
+  wtjl_context_t_enter(document->ctx);
+  document->capacity = 1;
+  document->text = malloc(1);
+  document->text[0] = '\0';
+  document->lines_capacity = 64;
+  document->line_starts = malloc(document->lines_capacity * sizeof(uint32_t));
+  document->line_starts[0] = 0;
+  document->num_lines = 1;
+  wtjl_context_t_leave(document->ctx);
+  return document;
+}
+
+void document_t_destroy (document_t *document) {
+  if (document == NULL) {
+    return;
+  }
+  wtjl_context_t_destroy(document->ctx);
+  (free)(document);
+}
+
+// replaces `deleted` bytes at `offset` with `inserted`
+void document_t_edit (document_t *document, size_t offset, size_t deleted, const char *inserted, size_t inserted_length) {
+  offset = MIN(offset, document->length);
+  deleted = MIN(deleted, document->length - offset);
+  wtjl_context_t_enter(document->ctx);
+  size_t first;
+  size_t resume;
+  size_t num_lexed = _document_relex(document, offset, deleted, inserted, inserted_length, &first, &resume);
+  _document_reparse(document, first, num_lexed, resume, (long) inserted_length - (long) deleted);
+  wtjl_context_t_leave(document->ctx);
+}
+
+// brings every token's index up to date, for anything reading them directly
+void document_t_settle (document_t *document) {
+  _document_shift_to(document, document->ctx->tokenizer.tokens_size);
+  document->shift_delta = 0;
+}
+
+// 1-based line and column of `offset`
+void document_t_position (document_t *document, size_t offset, size_t *line, size_t *column) {
+  *line = _tokenizer_lines_through(document->line_starts, document->num_lines, offset);
+  *column = offset - document->line_starts[*line - 1] + 1;
+}
+
+/* end document */
+
+/* ``begin serve */
+
+// protocol, one request per line over a unix stream socket:
+//   run <path>\n             compile (or reuse) and run the file at <path>
+//   eval <length>\n<source>  compile (or reuse) and run <length> bytes of source
+// each request is answered with one line, however long:
+//   ok [<result>]\n          <result> is the global `result` when it is an integer
+//   error <message>\n
+// with \n, \r and \\ in <message> escaped as two characters, as --lsp does
+// every request starts from undefined globals, builtins aside, whichever worker runs it
+
+#define SERVE_QUEUE_SIZE 1024
+#define SERVE_CACHE_SIZE 256
+#define SERVE_BUFFER_SIZE 4096
+#define SERVE_LINE_SIZE 4096
+#define SERVE_MAX_SOURCE (64 << 20)
+// compiled functions and strings are owned by their context, so a worker's
+// context is replaced once enough of them have built up in it
+#define SERVE_RECYCLE_FUNCTIONS 4096
+#define SERVE_RECYCLE_STRINGS 65536
+
+// connections move between the poller and the workers, so they are kept off
+// the per-thread memory trackers
+typedef struct _serve_connection_t {
+  int fd;
+  char buffer [SERVE_BUFFER_SIZE];
+  size_t buffer_start;
+  size_t buffer_length;
+} _serve_connection_t;
+
+typedef struct _serve_cache_entry_t {
+  uint64_t hash;
+  bool is_file;
+  char *key;
+  size_t key_length;
+  struct timespec mtime;
+  off_t size;
+  function_t *script;
+} _serve_cache_entry_t;
+
+typedef struct _serve_t _serve_t;
+
+typedef struct _serve_worker_t {
+  _serve_t *serve;
+  pthread_t thread;
+  wtjl_context_t *ctx;
+  _serve_cache_entry_t cache [SERVE_CACHE_SIZE];
+  size_t hits;
+  size_t misses;
+} _serve_worker_t;
+
+typedef struct _serve_t {
+  int listen_fd;
+  int wake_fds [2]; // workers hand connections back to the poller through this
+  bool stopping;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  _serve_connection_t *queue [SERVE_QUEUE_SIZE];
+  size_t queue_head;
+  size_t queue_length;
+  _serve_worker_t *workers;
+  size_t num_workers;
+  size_t memory_limit; // each worker's context's hard limit, 0 for none
+} _serve_t;
+
+uint64_t _serve_hash (const char *key, size_t key_length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < key_length; i++) {
+    hash = (hash ^ (uint8_t) key[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool _serve_enqueue (_serve_t *serve, _serve_connection_t *connection) {
+  bool queued = false;
+  pthread_mutex_lock(&serve->lock);
+  if (serve->queue_length < SERVE_QUEUE_SIZE) {
+    serve->queue[(serve->queue_head + serve->queue_length) % SERVE_QUEUE_SIZE] = connection;
+    serve->queue_length++;
+    queued = true;
+    pthread_cond_signal(&serve->ready);
+  }
+  pthread_mutex_unlock(&serve->lock);
+  return queued;
+}
+
+// blocks until a connection is ready, NULL once the server is stopping
+_serve_connection_t *_serve_dequeue (_serve_t *serve) {
+  _serve_connection_t *connection = NULL;
+  pthread_mutex_lock(&serve->lock);
+  while (!serve->queue_length && !serve->stopping) {
+    pthread_cond_wait(&serve->ready, &serve->lock);
+  }
+  if (serve->queue_length) {
+    connection = serve->queue[serve->queue_head];
+    serve->queue_head = (serve->queue_head + 1) % SERVE_QUEUE_SIZE;
+    serve->queue_length--;
+  }
+  pthread_mutex_unlock(&serve->lock);
+  return connection;
+}
+
+bool _serve_fill (_serve_connection_t *connection) {
+  if (connection->buffer_start == connection->buffer_length) {
+    connection->buffer_start = 0;
+    connection->buffer_length = 0;
+  }
+  if (connection->buffer_length == SERVE_BUFFER_SIZE) {
+    memmove(connection->buffer, connection->buffer + connection->buffer_start, connection->buffer_length - connection->buffer_start);
+    connection->buffer_length -= connection->buffer_start;
+    connection->buffer_start = 0;
+  }
+  ssize_t bytes_read = read(connection->fd, connection->buffer + connection->buffer_length, SERVE_BUFFER_SIZE - connection->buffer_length);
+  if (bytes_read <= 0) {
+    return false;
+  }
+  connection->buffer_length += bytes_read;
+  return true;
+}
+
+bool _serve_read_line (_serve_connection_t *connection, char *line, size_t line_size) {
+  size_t length = 0;
+  for (; ; ) {
+    while (connection->buffer_start < connection->buffer_length) {
+      char c = connection->buffer[connection->buffer_start++];
+      if (c == '\n') {
+        line[length] = '\0';
+        return true;
+      }
+      if (length + 1 == line_size) {
+        return false;
+      }
+      line[length++] = c;
+    }
+    if (!_serve_fill(connection)) {
+      return false;
+    }
+  }
+}
+
+bool _serve_read_bytes (_serve_connection_t *connection, char *bytes, size_t length) {
+  size_t copied = 0;
+  while (copied < length) {
+    if (connection->buffer_start == connection->buffer_length && !_serve_fill(connection)) {
+      return false;
+    }
+    size_t available = MIN(length - copied, connection->buffer_length - connection->buffer_start);
+    memcpy(bytes + copied, connection->buffer + connection->buffer_start, available);
+    connection->buffer_start += available;
+    copied += available;
+  }
+  return true;
+}
+
+bool _serve_write (int fd, const char *bytes, size_t length) {
+  while (length) {
+    ssize_t written = write(fd, bytes, length);
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    length -= written;
+  }
+  return true;
+}
+
+void _serve_compile (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  if (call->file_name) {
+    scanner.scan_file(ctx, call->file_name);
+  } else {
+    scanner.scan_buffer(ctx, call->source, call->length);
+  }
+  wtjl_context_t_compile(ctx, &call->script);
+  scanner.cleanup(ctx);
+}
+
+void _serve_execute (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  vm.execute(ctx, call->program);
+}
+
+void _serve_cache_clear (_serve_worker_t *worker) {
+  for (size_t i = 0; i < SERVE_CACHE_SIZE; i++) {
+    _serve_cache_entry_t *entry = &worker->cache[i];
+    compiler.free_function(worker->ctx, entry->script);
+    free(entry->key);
+    entry->script = NULL;
+    entry->key = NULL;
+  }
+}
+
+// a worker's context, held to the server's memory limit; a request that
+// goes past it fails alone, and the context is replaced after it
+wtjl_context_t *_serve_context_new (_serve_worker_t *worker) {
+  wtjl_context_t *ctx = wtjl_context_t_new(0, NULL);
+  size_t limit = worker->serve->memory_limit;
+  wtjl_limit_memory(ctx, limit / 4 * 3, limit);
+  return ctx;
+}
+
+void _serve_recycle (_serve_worker_t *worker) {
+  _serve_cache_clear(worker);
+  j_mem_bind(NULL);
+  wtjl_context_t_destroy(worker->ctx);
+  worker->ctx = _serve_context_new(worker);
+  j_mem_bind(&worker->ctx->mem);
+}
+
+// the line answering a request, `status` then `payload` escaped, sized to
+// fit; kept off the worker's tracker like the connections, so a context
+// at its limit can still say so
+char *_serve_response (const char *status, const char *payload) {
+  size_t length = strlen(status) + (payload ? 1 + 2 * strlen(payload) : 0) + 2;
+  char *response = (malloc)(length);
+  char *at = stpcpy(response, status);
+  if (payload) {
+    *at++ = ' ';
+    for (const char *c = payload; *c; c++) {
+      if (*c == '\n' || *c == '\r' || *c == '\\') {
+        *at++ = '\\';
+        *at++ = *c == '\n' ? 'n' : *c == '\r' ? 'r' : '\\';
+      } else {
+        *at++ = *c;
+      }
+    }
+  }
+  strcpy(at, "\n");
+  return response;
+}
+
+// finds or compiles the program for `key`, NULL with `response` made on failure
+function_t *_serve_program (_serve_worker_t *worker, bool is_file, char *key, size_t key_length, char **response) {
+  wtjl_context_t *ctx = worker->ctx;
+  struct stat file_stat;
+  if (is_file && stat(key, &file_stat) != 0) {
+    *response = _serve_response("error", "Failed to open file.");
+    return NULL;
+  }
+  uint64_t hash = _serve_hash(key, key_length);
+  _serve_cache_entry_t *entry = &worker->cache[hash % SERVE_CACHE_SIZE];
+  if (entry->script && entry->hash == hash && entry->is_file == is_file && entry->key_length == key_length && memcmp(entry->key, key, key_length) == 0) {
+    if (!is_file || (entry->size == file_stat.st_size && entry->mtime.tv_sec == file_stat.st_mtim.tv_sec && entry->mtime.tv_nsec == file_stat.st_mtim.tv_nsec)) {
+      worker->hits++;
+      return entry->script;
+    }
+  }
+  worker->misses++;
+  _wtjl_call_t call = {0};
+  call.file_name = is_file ? key : NULL;
+  call.source = key;
+  call.length = key_length;
+  if (_wtjl_protect(ctx, _serve_compile, &call) != WTJL_OK) {
+    *response = _serve_response("error", wtjl_error(ctx));
+    return NULL;
+  }
+  compiler.free_function(ctx, entry->script);
+  free(entry->key);
+  entry->hash = hash;
+  entry->is_file = is_file;
+  entry->key = malloc(key_length);
+  memcpy(entry->key, key, key_length);
+  entry->key_length = key_length;
+  if (is_file) {
+    entry->mtime = file_stat.st_mtim;
+    entry->size = file_stat.st_size;
+  }
+  entry->script = call.script;
+  return entry->script;
+}
+
+// runs the program for `key`, returning the response to free with (free)
+char *_serve_request (_serve_worker_t *worker, bool is_file, char *key, size_t key_length) {
+  wtjl_context_t *ctx = worker->ctx;
+  for (size_t i = 0; i < ctx->vm.num_globals; i++) {
+    ctx->vm.globals[i].type = VALUE_UNDEFINED;
+  }
+  arrays.define(ctx);
+  strings.define(ctx);
+  evals.define(ctx);
+  output.define(ctx);
+  char *response = NULL;
+  function_t *program = _serve_program(worker, is_file, key, key_length, &response);
+  if (!program) {
+    return response;
+  }
+  _wtjl_call_t call = {0};
+  call.program = program;
+  if (_wtjl_protect(ctx, _serve_execute, &call) != WTJL_OK) {
+    return _serve_response("error", wtjl_error(ctx));
+  }
+  int slot = vm.find_global(ctx, "result");
+  if (slot >= 0 && ctx->vm.globals[slot].type == VALUE_INTEGER) {
+    char digits [24];
+    snprintf(digits, sizeof(digits), "%lld", (long long) ctx->vm.globals[slot].as.integer);
+    return _serve_response("ok", digits);
+  }
+  if (slot >= 0 && ctx->vm.globals[slot].type == VALUE_BIGNUM) {
+    size_t length;
+    char *digits = bignums.to_decimal(ctx->vm.globals[slot].as.bignum, &length);
+    response = _serve_response("ok", digits);
+    free(digits);
+    return response;
+  }
+  return _serve_response("ok", NULL);
+}
+
+// answers every request already buffered on `connection`, false once it should be closed
+bool _serve_connection (_serve_worker_t *worker, _serve_connection_t *connection) {
+  char line [SERVE_LINE_SIZE];
+  do {
+    char *response;
+    if (!_serve_read_line(connection, line, sizeof(line))) {
+      return false;
+    }
+    if (strncmp(line, "run ", 4) == 0) {
+      response = _serve_request(worker, true, line + 4, strlen(line + 4) + 1);
+    } else if (strncmp(line, "eval ", 5) == 0) {
+      char *end;
+      unsigned long long length = strtoull(line + 5, &end, 10);
+      if (*end || length > SERVE_MAX_SOURCE) {
+        return false;
+      }
+      char *source = malloc(length ? length : 1);
+      if (!_serve_read_bytes(connection, source, length)) {
+        free(source);
+        return false;
+      }
+      response = _serve_request(worker, false, source, length);
+      free(source);
+    } else {
+      response = _serve_response("error", "unknown request");
+    }
+    bool written = _serve_write(connection->fd, response, strlen(response));
+    (free)(response);
+    if (!written) {
+      return false;
+    }
+    if (worker->ctx->vm.num_functions > SERVE_RECYCLE_FUNCTIONS || worker->ctx->vm.num_strings > SERVE_RECYCLE_STRINGS || worker->ctx->heap.exhausted) {
+      _serve_recycle(worker);
+    }
+  } while (connection->buffer_start < connection->buffer_length);
+  return true;
+}
+
+void *_serve_worker (void *arg) {
+  _serve_worker_t *worker = arg;
+  _serve_t *serve = worker->serve;
+  worker->ctx = _serve_context_new(worker);
+  // the worker's context owns everything the worker allocates
+  j_mem_bind(&worker->ctx->mem);
+  _serve_connection_t *connection;
+  while ((connection = _serve_dequeue(serve))) {
+    if (_serve_connection(worker, connection)) {
+      if (write(serve->wake_fds[1], &connection, sizeof(connection)) == sizeof(connection)) {
+        continue;
+      }
+    }
+    close(connection->fd);
+    (free)(connection);
+  }
+  _serve_cache_clear(worker);
+  j_mem_bind(NULL);
+  wtjl_context_t_destroy(worker->ctx);
+  worker->ctx = NULL;
+  return NULL;
+}
+
+_serve_t *_serve_new (const char *socket_name, size_t num_workers, size_t memory_limit) {
+  struct sockaddr_un address;
+  if (strlen(socket_name) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "Socket path too long.\n");
+    return NULL;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_name);
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socket_name);
+  if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listen_fd, 128) != 0) {
+    fprintf(stderr, "Failed to listen on `%s`.\n", socket_name);
+    if (listen_fd >= 0) {
+      close(listen_fd);
+    }
+    return NULL;
+  }
+  _serve_t *serve = calloc(1, sizeof(_serve_t));
+  serve->listen_fd = listen_fd;
+  if (pipe(serve->wake_fds) != 0) {
+    close(listen_fd);
+    (free)(serve);
+    return NULL;
+  }
+  pthread_mutex_init(&serve->lock, NULL);
+  pthread_cond_init(&serve->ready, NULL);
+  serve->num_workers = num_workers;
+  serve->memory_limit = memory_limit;
+  serve->workers = calloc(num_workers, sizeof(_serve_worker_t));
+  for (size_t i = 0; i < num_workers; i++) {
+    serve->workers[i].serve = serve;
+    pthread_create(&serve->workers[i].thread, NULL, _serve_worker, &serve->workers[i]);
+  }
+  return serve;
+}
+
+// waits for readable connections and queues them for the workers; returns
+// once the server is stopped
+void _serve_poll (_serve_t *serve) {
+  _serve_connection_t **idle = NULL;
+  struct pollfd *fds = NULL;
+  size_t num_idle = 0;
+  size_t idle_capacity = 0;
+  for (; ; ) {
+    if (idle_capacity < num_idle + 1) {
+      idle_capacity = idle_capacity ? idle_capacity * 2 : 64;
+      idle = realloc(idle, idle_capacity * sizeof(_serve_connection_t *));
+      fds = realloc(fds, (idle_capacity + 2) * sizeof(struct pollfd));
+    }
+    fds[0].fd = serve->listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = serve->wake_fds[0];
+    fds[1].events = POLLIN;
+    for (size_t i = 0; i < num_idle; i++) {
+      fds[i + 2].fd = idle[i]->fd;
+      fds[i + 2].events = POLLIN;
+    }
+    if (poll(fds, num_idle + 2, -1) < 0) {
+      continue;
+    }
+    // ready connections go to the workers; full queues leave them for the next poll
+    for (size_t i = num_idle; i > 0; i--) {
+      if (fds[i + 1].revents && _serve_enqueue(serve, idle[i - 1])) {
+        idle[i - 1] = idle[--num_idle];
+      }
+    }
+    if (fds[1].revents & POLLIN) {
+      _serve_connection_t *connection;
+      if (read(serve->wake_fds[0], &connection, sizeof(connection)) == sizeof(connection)) {
+        if (!connection) {
+          break;
+        }
+        idle[num_idle++] = connection;
+        continue;
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(serve->listen_fd, NULL, NULL);
+      if (fd >= 0) {
+        _serve_connection_t *connection = calloc(1, sizeof(_serve_connection_t));
+        connection->fd = fd;
+        idle[num_idle++] = connection;
+      }
+    }
+  }
+  for (size_t i = 0; i < num_idle; i++) {
+    close(idle[i]->fd);
+    (free)(idle[i]);
+  }
+  free(idle);
+  free(fds);
+}
+
+void _serve_stop (_serve_t *serve) {
+  _serve_connection_t *stop = NULL;
+  if (write(serve->wake_fds[1], &stop, sizeof(stop)) != sizeof(stop)) {
+    fprintf(stderr, "Failed to stop server.\n");
+  }
+}
+
+void _serve_destroy (_serve_t *serve) {
+  pthread_mutex_lock(&serve->lock);
+  serve->stopping = true;
+  pthread_cond_broadcast(&serve->ready);
+  pthread_mutex_unlock(&serve->lock);
+  for (size_t i = 0; i < serve->num_workers; i++) {
+    pthread_join(serve->workers[i].thread, NULL);
+  }
+  while (serve->queue_length) {
+    _serve_connection_t *connection = serve->queue[serve->queue_head];
+    serve->queue_head = (serve->queue_head + 1) % SERVE_QUEUE_SIZE;
+    serve->queue_length--;
+    close(connection->fd);
+    (free)(connection);
+  }
+  close(serve->listen_fd);
+  close(serve->wake_fds[0]);
+  close(serve->wake_fds[1]);
+  pthread_mutex_destroy(&serve->lock);
+  pthread_cond_destroy(&serve->ready);
+  (free)(serve->workers);
+  (free)(serve);
+}
+
+size_t serve_num_workers () {
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return num_cpus > 0 ? (size_t) num_cpus : 1;
+}
+
+void serve (const char *socket_name, size_t memory_limit) {
+  signal(SIGPIPE, SIG_IGN);
+  _serve_t *serve = _serve_new(socket_name, serve_num_workers(), memory_limit);
+  if (!serve) {
+    exit(1);
+  }
+  printf("Serving on `%s` with %d workers.\n", socket_name, (int) serve->num_workers);
+  fflush(stdout);
+  _serve_poll(serve);
+  _serve_destroy(serve);
+}
+
+/* end serve */
+
+/* ``begin load */
+
+#define LOAD_CONNECTIONS 4
+#define LOAD_REQUESTS 5000
+
+char *_load_source =
+  "var square <- (x) -> x * x;\n"
+  "var result <- square(12) + 3;\n";
+
+typedef struct _load_job_t {
+  pthread_t thread;
+  const char *socket_name;
+  const char *request;
+  size_t request_length;
+  double *latencies;
+  size_t completed;
+  bool failed;
+} _load_job_t;
+
+int _load_connect (const char *socket_name) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_name, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// reads one response line into `line`
+bool _load_read_line (int fd, char *line, size_t line_size) {
+  size_t length = 0;
+  while (length + 1 < line_size) {
+    if (read(fd, line + length, 1) != 1) {
+      return false;
+    }
+    if (line[length] == '\n') {
+      line[length] = '\0';
+      return true;
+    }
+    length++;
+  }
+  return false;
+}
+
+void *_load_run (void *arg) {
+  _load_job_t *job = arg;
+  char line [SERVE_LINE_SIZE];
+  int fd = _load_connect(job->socket_name);
+  if (fd < 0) {
+    job->failed = true;
+    return NULL;
+  }
+  for (size_t i = 0; i < LOAD_REQUESTS; i++) {
+    double start = bench_now();
+    if (!_serve_write(fd, job->request, job->request_length) || !_load_read_line(fd, line, sizeof(line)) || strcmp(line, "ok 147") != 0) {
+      job->failed = true;
+      break;
+    }
+    job->latencies[job->completed++] = bench_now() - start;
+  }
+  close(fd);
+  return NULL;
+}
+
+int _load_compare (const void *a, const void *b) {
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+// drives a server with LOAD_CONNECTIONS clients, half of them sending the
+// script inline and half sending it by path
+void load (const char *socket_name) {
+  signal(SIGPIPE, SIG_IGN);
+  char file_name [] = "/tmp/wtjl_load_XXXXXX";
+  int fd = mkstemp(file_name);
+  size_t source_length = strlen(_load_source);
+  if (fd < 0 || !_serve_write(fd, _load_source, source_length)) {
+    fprintf(stderr, "Failed to write load script.\n");
+    exit(1);
+  }
+  close(fd);
+  char eval_request [SERVE_LINE_SIZE];
+  char run_request [SERVE_LINE_SIZE];
+  snprintf(eval_request, sizeof(eval_request), "eval %d\n%s", (int) source_length, _load_source);
+  snprintf(run_request, sizeof(run_request), "run %s\n", file_name);
+
+  _load_job_t jobs [LOAD_CONNECTIONS];
+  double start = bench_now();
+  for (size_t i = 0; i < LOAD_CONNECTIONS; i++) {
+    jobs[i].socket_name = socket_name;
+    jobs[i].request = i % 2 ? run_request : eval_request;
+    jobs[i].request_length = strlen(jobs[i].request);
+    jobs[i].latencies = malloc(LOAD_REQUESTS * sizeof(double));
+    jobs[i].completed = 0;
+    jobs[i].failed = false;
+    pthread_create(&jobs[i].thread, NULL, _load_run, &jobs[i]);
+  }
+  size_t completed = 0;
+  bool failed = false;
+  for (size_t i = 0; i < LOAD_CONNECTIONS; i++) {
+    pthread_join(jobs[i].thread, NULL);
+    completed += jobs[i].completed;
+    failed = failed || jobs[i].failed;
+  }
+  double elapsed = bench_now() - start;
+  unlink(file_name);
+
+  double *latencies = malloc((completed ? completed : 1) * sizeof(double));
+  size_t num_latencies = 0;
+  for (size_t i = 0; i < LOAD_CONNECTIONS; i++) {
+    memcpy(latencies + num_latencies, jobs[i].latencies, jobs[i].completed * sizeof(double));
+    num_latencies += jobs[i].completed;
+    free(jobs[i].latencies);
+  }
+  if (failed) {
+    fprintf(stderr, CLR(RED, "some requests failed\n"));
+  }
+  if (completed) {
+    qsort(latencies, completed, sizeof(double), _load_compare);
+    printf("%d requests over %d connections in %.3fs\n", (int) completed, LOAD_CONNECTIONS, elapsed);
+    printf("%.0f requests/sec\n", completed / elapsed);
+    printf("latency p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n",
+      latencies[completed / 2] * 1e6,
+      latencies[completed * 9 / 10] * 1e6,
+      latencies[completed * 99 / 100] * 1e6,
+      latencies[completed - 1] * 1e6);
+  }
+  free(latencies);
+  if (failed || !completed) {
+    exit(1);
+  }
+}
+
+/* end load */
+
+/* ``begin lsp */
+
+// a language-server-style front end for editors on stdin and stdout:
+//   open <length>\n<text>                      replaces the whole document
+//   edit <offset> <deleted> <length>\n<text>   replaces `deleted` bytes at `offset`
+// each is answered with every diagnostic in the document:
+//   diagnostics <count> <microseconds to apply the change>\n
+//   <line>:<column> <message>\n                once per diagnostic
+
+// one line per diagnostic, so a message quoting text that spans lines, such
+// as an unterminated comment, has its line breaks and backslashes escaped
+void _lsp_publish (FILE *out, document_t *document, double seconds) {
+  fprintf(out, "diagnostics %d %.1f\n", (int) document->num_errors, seconds * 1e6);
+  for (size_t i = 0; i < document->num_statements; i++) {
+    document_statement_t *statement = &document->statements[i];
+    if (statement->error) {
+      size_t line;
+      size_t column;
+      document_t_position(document, statement->error_offset, &line, &column);
+      fprintf(out, "%d:%d ", (int) line, (int) column);
+      for (const char *c = statement->error; *c; c++) {
+        if (*c == '\n' || *c == '\r' || *c == '\\') {
+          fputc('\\', out);
+          fputc(*c == '\n' ? 'n' : *c == '\r' ? 'r' : '\\', out);
+        } else {
+          fputc(*c, out);
+        }
+      }
+      fputc('\n', out);
+    }
+  }
+  fflush(out);
+}
+
+void lsp () {
+  _serve_connection_t *connection = calloc(1, sizeof(_serve_connection_t));
+  connection->fd = STDIN_FILENO;
+  document_t *document = document_t_new();
+  char line [SERVE_LINE_SIZE];
+  while (_serve_read_line(connection, line, sizeof(line))) {
+    unsigned long offset = 0;
+    unsigned long deleted = document->length;
+    unsigned long length;
+    if (sscanf(line, "open %lu", &length) != 1 && sscanf(line, "edit %lu %lu %lu", &offset, &deleted, &length) != 3) {
+      printf("error unknown request\n");
+      fflush(stdout);
+      continue;
+    }
+    // the text that follows cannot be skipped without reading it, so a
+    // length too large to take ends the session, as it ends a connection
+    // to --serve
+    if (length > SERVE_MAX_SOURCE) {
+      printf("error request too large\n");
+      fflush(stdout);
+      break;
+    }
+    char *text = malloc(length ? length : 1);
+    if (!_serve_read_bytes(connection, text, length)) {
+      free(text);
+      break;
+    }
+    double start = bench_now();
+    document_t_edit(document, offset, deleted, text, length);
+    double seconds = bench_now() - start;
+    free(text);
+    _lsp_publish(stdout, document, seconds);
+  }
+  document_t_destroy(document);
+  (free)(connection);
+}
+
+/* end lsp */
+
+/* ``begin test ll */
+
+void test_ll_iterate () {
+  ll_t *list = ll.new();
+  for (int i = 0; i < 100; i++) {
+    ll.add(list, "hello, world");
+  }
+  for (int i = 0; i < 100; i++) {
+    if (strcmp(ll.get(list, i), "hello, world") != 0) {
+      printf("bad str cmp\n");
+      TEST_FAIL;
+      return;
+    }
+  }
+  for (int i = 0; i < 100; i++) {
+    ll.remove(list, ll.size(list) - 1);
+  }
+  if (ll.get(list, 0)) {
+    printf("bad first\n");
+    TEST_FAIL;
+    return;
+  }
+  if (ll.size(list)) {
+    printf("bad size\n");
+    TEST_FAIL;
+    return;
+  }
+  ll.delete(list);
+  TEST_PASS;
+}
+
+void test_ll_basic () {
+  ll_t *list = ll.new();
+  if (!list) {
+    TEST_FAIL;
+    return;
+  }
+  char *foo = "foo";
+  char *bar = "bar";
+  ll.add(list, foo);
+  ll.add(list, bar);
+  if (((char *) ll.get(list, 0)) != foo) {
+    TEST_FAIL;
+    return;
+  }
+  if (((char *) ll.get(list, 1)) != bar) {
+    TEST_FAIL;
+    return;
+  }
+  ll.remove(list, 0);
+  if (((char *) ll.get(list, 0)) != bar) {
+    printf("not bar %s\n", (char *) ll.get(list, 0));
+    TEST_FAIL;
+    return;
+  }
+  ll.remove(list, 0);
+  if (((char *) ll.get(list, 0)) != NULL) {
+    TEST_FAIL;
+    return;
+  }
+  ll.remove(list, 0);
   if (((char *) ll.get(list, 0)) != NULL) {
     TEST_FAIL;
     return;
   }
-  ll.delete(list);
+  ll.delete(list);
+  TEST_PASS;
+}
+
+void test_ll_new_delete () {
+  ll_t *list = ll.new();
+  if (!list) {
+    TEST_FAIL;
+    return;
+  }
+  ll.delete(list);
+  list = NULL;
+  TEST_PASS;
+}
+
+void test_ll () {
+  TEST_SUITE;
+  test_ll_new_delete();
+  test_ll_basic();
+  test_ll_iterate();
+}
+
+/* end test ll */
+
+/* ``begin test context */
+
+#define TEST_CONTEXT_THREADS 16
+#define TEST_CONTEXT_ITERATIONS 64
+
+typedef struct _test_context_job_t {
+  char *file_name;
+  bool ok;
+} _test_context_job_t;
+
+void *_test_context_worker (void *arg) {
+  _test_context_job_t *job = arg;
+  char *argv [2] = {"wtjl", job->file_name};
+  job->ok = true;
+  for (int i = 0; i < TEST_CONTEXT_ITERATIONS; i++) {
+    wtjl_context_t *ctx = wtjl_context_t_new(2, argv);
+    function_t *script = NULL;
+    wtjl_context_t_enter(ctx);
+    scanner.scan(ctx);
+    wtjl_context_t_evaluate(ctx, &script);
+    int slot = vm.find_global(ctx, "foo");
+    if (slot < 0 || ctx->vm.globals[slot].type != VALUE_INTEGER || ctx->vm.globals[slot].as.integer != 42) {
+      job->ok = false;
+    }
+    wtjl_context_t_leave(ctx);
+    wtjl_context_t_destroy(ctx);
+  }
+  // every allocation belonged to a context, none leaked onto the thread
+  if (j_mem_size(j_mem_current()) != 0) {
+    job->ok = false;
+  }
+  return NULL;
+}
+
+void test_context_concurrent () {
+  char file_name [] = "/tmp/wtjl_test_XXXXXX";
+  int fd = mkstemp(file_name);
+  if (fd < 0) {
+    TEST_FAIL;
+    return;
+  }
+  char *source = "var foo <- 6 * 7;\n";
+  if (write(fd, source, strlen(source)) != (ssize_t) strlen(source)) {
+    close(fd);
+    unlink(file_name);
+    TEST_FAIL;
+    return;
+  }
+  close(fd);
+  pthread_t threads [TEST_CONTEXT_THREADS];
+  _test_context_job_t jobs [TEST_CONTEXT_THREADS];
+  for (int i = 0; i < TEST_CONTEXT_THREADS; i++) {
+    jobs[i].file_name = file_name;
+    jobs[i].ok = false;
+    pthread_create(&threads[i], NULL, _test_context_worker, &jobs[i]);
+  }
+  bool ok = true;
+  for (int i = 0; i < TEST_CONTEXT_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    ok = ok && jobs[i].ok;
+  }
+  unlink(file_name);
+  if (!ok) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+void test_context_isolated () {
+  char *argv [2] = {"wtjl", "a"};
+  wtjl_context_t *a = wtjl_context_t_new(2, argv);
+  wtjl_context_t *b = wtjl_context_t_new(2, argv);
+  if (a->mem.total_alloc == 0 || a->mem.total_alloc != b->mem.total_alloc) {
+    TEST_FAIL;
+    return;
+  }
+  if (a->arguments == b->arguments || a->arguments->file_name == b->arguments->file_name) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_context_t_destroy(a);
+  wtjl_context_t_destroy(b);
+  TEST_PASS;
+}
+
+void test_context () {
+  TEST_SUITE;
+  test_context_isolated();
+  test_context_concurrent();
+}
+
+/* end test context */
+
+/* ``begin test eval */
+
+bool _test_eval_integer (wtjl_context_t *ctx, char *name, int64_t expected) {
+  wtjl_value_t value;
+  if (wtjl_get(ctx, name, &value) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    return false;
+  }
+  return value.type == WTJL_INTEGER && value.as.integer == expected;
+}
+
+void test_eval_arithmetic () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var a <- 1 + 2 * 3 - 8 / 2 ** 2;\n"
+    "var b <- -(a - 10) * 2;\n"
+    "var c;\n"
+    "c <- 2 ** 3 ** 2;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (!_test_eval_integer(ctx, "a", 5) || !_test_eval_integer(ctx, "b", 10) || !_test_eval_integer(ctx, "c", 512)) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_functions () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var add <- (a, b) -> a + b;\n"
+    "var sum_of_squares <- (a, b) -> {\n"
+    "  var aa <- a * a;\n"
+    "  var bb <- b * b;\n"
+    "  return add(aa, bb);\n"
+    "};\n"
+    "var r <- sum_of_squares(3, 4);\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "r", 25)) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t arguments [2] = {wtjl_integer(40), wtjl_integer(2)};
+  wtjl_value_t result;
+  if (wtjl_call(ctx, "add", 2, arguments, &result) != WTJL_OK || result.type != WTJL_INTEGER || result.as.integer != 42) {
+    TEST_FAIL;
+    return;
+  }
+  // globals persist across evaluations
+  char *more = "var twice <- (x) -> add(x, x);";
+  wtjl_value_t argument = wtjl_integer(21);
+  if (wtjl_eval(ctx, more, strlen(more)) != WTJL_OK || wtjl_call(ctx, "twice", 1, &argument, &result) != WTJL_OK || result.as.integer != 42) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+size_t _test_eval_count_op (function_t *function, opcode_t op);
+
+void test_eval_closures () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var counter <- () -> {\n"
+    "  var count <- 0;\n"
+    "  return () -> {\n"
+    "    count <- count + 1;\n"
+    "    return count;\n"
+    "  };\n"
+    "};\n"
+    "var next <- counter();\n"
+    "next();\n"
+    "var two <- next();\n"
+    "var adder <- (k) -> (x) -> x + k;\n"
+    "var seven <- adder(5)(2);\n"
+    "var sum <- (n) -> {\n"
+    "  var total <- 0;\n"
+    "  var add <- (x) -> {\n"
+    "    var twice <- () -> {\n"
+    "      total <- total + x * 2;\n"
+    "    };\n"
+    "    twice();\n"
+    "  };\n"
+    "  var i <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return total;\n"
+    "    }\n"
+    "    add(i);\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "var later <- (p) -> {\n"
+    "  var get <- () -> p;\n"
+    "  p <- p + 1;\n"
+    "  return get;\n"
+    "};\n"
+    "var scaled <- (k) -> iterate sum i in 0, 10 -> i * k;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "two", 2) || !_test_eval_integer(ctx, "seven", 7)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  // add and twice are only ever called where they are declared, so calling
+  // them makes no closure and total needs no box
+  size_t num_closures = ctx->vm.num_closures;
+  size_t num_boxes = ctx->vm.num_boxes;
+  size_t allocated = ctx->mem.total_alloc;
+  char *calls = "var ninety <- sum(10); var got <- later(41)(); var doubled <- scaled(2);";
+  if (wtjl_eval(ctx, calls, strlen(calls)) != WTJL_OK || !_test_eval_integer(ctx, "ninety", 90) || !_test_eval_integer(ctx, "got", 42) || !_test_eval_integer(ctx, "doubled", 90)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (ctx->vm.num_closures != num_closures + 2 || ctx->vm.num_boxes != num_boxes + 1 || ctx->mem.total_alloc - allocated > 4096) {
+    printf("%d closures, %d boxes\n", (int) (ctx->vm.num_closures - num_closures), (int) (ctx->vm.num_boxes - num_boxes));
+    TEST_FAIL;
+    return;
+  }
+  function_t *sum = ctx->vm.globals[vm.find_global(ctx, "sum")].as.function;
+  if (_test_eval_count_op(sum, OP_CLOSURE) != 0 || _test_eval_count_op(sum, OP_BOX) != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // a lane may read what a closure carries but not assign to it
+  char *racy =
+    "var racy <- () -> {\n"
+    "  var t <- 0;\n"
+    "  var f <- (i) -> {\n"
+    "    t <- i;\n"
+    "    return i;\n"
+    "  };\n"
+    "  return iterate sum i in 0, 10 -> f(i);\n"
+    "};\n"
+    "racy();";
+  if (wtjl_eval(ctx, racy, strlen(racy)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "read only inside a parallel iterate") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_tail_calls () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var loop <- (n, acc) -> {\n"
+    "  if n = 0 {\n"
+    "    return acc;\n"
+    "  }\n"
+    "  return loop(n - 1, acc + n);\n"
+    "};\n"
+    "var even <- (n) -> {\n"
+    "  if n = 0 {\n"
+    "    return true;\n"
+    "  }\n"
+    "  return odd(n - 1);\n"
+    "};\n"
+    "var odd <- (n) -> {\n"
+    "  if n = 0 {\n"
+    "    return false;\n"
+    "  }\n"
+    "  return even(n - 1);\n"
+    "};\n"
+    "var count <- (n) -> iterate_count(n, 0);\n"
+    "var iterate_count <- (n, k) -> {\n"
+    "  if n = 0 {\n"
+    "    return k;\n"
+    "  }\n"
+    "  var step <- (m) -> m - 1;\n"
+    "  return iterate_count(step(n), k + 1);\n"
+    "};\n"
+    "var deep <- (n) -> {\n"
+    "  if n = 0 {\n"
+    "    return 0;\n"
+    "  }\n"
+    "  return 1 + deep(n - 1);\n"
+    "};\n"
+    "var sum <- loop(1000000, 0);\n"
+    "var parity <- even(100001);\n"
+    "var counted <- count(100000);\n"
+    "var grown <- deep(10000);";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "sum", 500000500000) || !_test_eval_integer(ctx, "counted", 100000) || !_test_eval_integer(ctx, "grown", 10000)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  // a million tail calls leave the stack where deep, which is not one, grew it
+  size_t stack_capacity = ctx->vm.stack_capacity;
+  size_t frames_capacity = ctx->vm.frames_capacity;
+  char *again = "var again <- loop(1000000, 0);";
+  if (wtjl_eval(ctx, again, strlen(again)) != WTJL_OK || ctx->vm.stack_capacity != stack_capacity || ctx->vm.frames_capacity != frames_capacity || frames_capacity < 10000) {
+    TEST_FAIL;
+    return;
+  }
+  function_t *loop = ctx->vm.globals[vm.find_global(ctx, "loop")].as.function;
+  function_t *deep = ctx->vm.globals[vm.find_global(ctx, "deep")].as.function;
+  if (_test_eval_count_op(loop, OP_TAIL_CALL) != 1 || _test_eval_count_op(deep, OP_TAIL_CALL) != 0) {
+    TEST_FAIL;
+    return;
+  }
+  char *overflow = "deep(10000000);";
+  if (wtjl_eval(ctx, overflow, strlen(overflow)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "stack overflow") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+bool _test_eval_string (wtjl_context_t *ctx, char *name, char *expected) {
+  wtjl_value_t value;
+  if (wtjl_get(ctx, name, &value) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    return false;
+  }
+  return value.type == WTJL_STRING && value.as.string.length == strlen(expected) && memcmp(value.as.string.chars, expected, strlen(expected)) == 0;
+}
+
+void test_eval_strings () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "// a line comment; \"not a string\n"
+    "var a <- \"plain\"; /* a block\n"
+    "  comment, // with a line comment in it */\n"
+    "var b <- \"tab\\there \\\"quoted\\\" /* not a comment */\";\n"
+    "var c <- `two\n"
+    "lines`;\n"
+    "var d <- a + \", \" + c;\n"
+    "var e <- 'A' + '\\n' + '\\'';\n"
+    "var f <- \"\";\n"
+    "var g <- 2 /* between */ * 3 // after\n;";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  // a large string's escapes are decoded the first time it is read, not when
+  // compiled; a small one needs no string_t at all
+  value_t b = ctx->vm.globals[vm.find_global(ctx, "b")];
+  if (b.type != VALUE_STRING || b.small_length != VALUE_LARGE_STRING || !b.as.string->escaped || ctx->vm.globals[vm.find_global(ctx, "a")].small_length != 5) {
+    TEST_FAIL;
+    return;
+  }
+  if (!_test_eval_string(ctx, "a", "plain") || !_test_eval_string(ctx, "b", "tab\there \"quoted\" /* not a comment */") || b.as.string->escaped) {
+    TEST_FAIL;
+    return;
+  }
+  if (!_test_eval_string(ctx, "d", "plain, two\nlines") || !_test_eval_string(ctx, "f", "") || !_test_eval_integer(ctx, "e", 65 + 10 + 39) || !_test_eval_integer(ctx, "g", 6)) {
+    TEST_FAIL;
+    return;
+  }
+  char *mixed = "var h <- a + 1;";
+  if (wtjl_eval(ctx, mixed, strlen(mixed)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "both be strings") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_ropes () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var range <- (n) -> {\n"
+    "  var i <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return;\n"
+    "    }\n"
+    "    yield i;\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "var appended <- \"\";\n"
+    "var prepended <- \"\";\n"
+    "iterate i over range(1000) {\n"
+    "  appended <- appended + \"ab\";\n"
+    "  prepended <- \"ab\" + prepended;\n"
+    "}\n"
+    "var n <- length(appended);\n"
+    "var head <- substring(appended, 0, 10);\n"
+    "var tail <- substring(appended, 1998, 2000);\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "n", 2000) || !_test_eval_string(ctx, "head", "ababababab") || !_test_eval_string(ctx, "tail", "ab")) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  // neither the length nor the ends needed the whole of it
+  value_t appended = ctx->vm.globals[vm.find_global(ctx, "appended")];
+  value_t head = ctx->vm.globals[vm.find_global(ctx, "head")];
+  if (appended.small_length != VALUE_LARGE_STRING || !appended.as.string->rope || appended.as.string->chars || head.small_length != 10) {
+    TEST_FAIL;
+    return;
+  }
+  char *reads =
+    "var b <- appended[1001];\n"
+    "var same <- appended = prepended;\n"
+    "var different <- appended = prepended + \"a\";\n"
+    "var middle <- substring(prepended, 990, 1030);\n";
+  if (wtjl_eval(ctx, reads, strlen(reads)) != WTJL_OK || !_test_eval_integer(ctx, "b", 'b') || !_test_eval_string(ctx, "middle", "abababababababababababababababababababab")) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t same;
+  wtjl_value_t different;
+  wtjl_get(ctx, "same", &same);
+  wtjl_get(ctx, "different", &different);
+  if (!same.as.boolean || different.as.boolean || !appended.as.string->chars || !appended.as.string->hash) {
+    TEST_FAIL;
+    return;
+  }
+  char *failing [] = {"substring(appended, 5, 3);", "appended[2000];", "head[0] <- 1;"};
+  char *errors [] = {"5 to 3 is out of range for length 2000", "index 2000 is out of range for length 2000", "only arrays can be changed by index"};
+  for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+    if (wtjl_eval(ctx, failing[i], strlen(failing[i])) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), errors[i]) == NULL) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_cache () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var total <- 0;\n"
+    "var run <- (n) -> {\n"
+    "  var i <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return i;\n"
+    "    }\n"
+    "    eval(\"total <- total + 1;\");\n"
+    "    eval(\"total <- total \" + \"+ 100;\");\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "run(100);\n"
+    "eval(\"var inner <- 5; eval(\\\"var nested <- inner * 2;\\\");\");";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "total", 10100) || !_test_eval_integer(ctx, "nested", 10)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  // the literal is one string every time, so it is mostly found without
+  // hashing, short of collisions in the table of strings; the concatenation
+  // is a new string each time, found by its text
+  evals_state_t *state = &ctx->evals;
+  if (state->misses != 4 || state->hits + state->string_hits != 198 || state->string_hits < 90 || state->num_entries != 4 || state->evictions != 0) {
+    evals.report(ctx);
+    TEST_FAIL;
+    return;
+  }
+  // with room for one source, each eval evicts the one before, even the
+  // outer one while it is still running
+  state->budget = state->oldest->size + 64;
+  char *churn = "eval(\"var a <- 1; eval(\\\"var b <- a + 1;\\\");\"); eval(\"var c <- b + 1;\");";
+  if (wtjl_eval(ctx, churn, strlen(churn)) != WTJL_OK || !_test_eval_integer(ctx, "c", 3) || state->num_entries != 1 || state->size > state->budget || state->num_retired != 0) {
+    printf("%s\n", wtjl_error(ctx));
+    evals.report(ctx);
+    TEST_FAIL;
+    return;
+  }
+  // errors inside an eval unwind through it and leave the cache usable
+  state->budget = EVALS_BUDGET;
+  char *broken = "eval(\"var d <- 1 +;\");";
+  char *failing = "eval(\"var e <- total + true;\");";
+  char *after = "eval(\"total <- total + 1;\");";
+  if (wtjl_eval(ctx, broken, strlen(broken)) != WTJL_ERROR_COMPILE || wtjl_eval(ctx, failing, strlen(failing)) != WTJL_ERROR_RUNTIME || state->running != 0) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_eval(ctx, after, strlen(after)) != WTJL_OK || !_test_eval_integer(ctx, "total", 10101)) {
+    TEST_FAIL;
+    return;
+  }
+  // the functions an evicted source made go with it, literals and all, once
+  // nothing reaches them, while one a global still holds keeps working
+  state->budget = EVALS_BUDGET / 64;
+  char *keeping = "eval(\"var kept <- (x) -> () -> x + \\\" and a suffix long enough to be its own\\\";\");";
+  char *making =
+    "var comment <- \"\";\n"
+    "var make <- (n) -> {\n"
+    "  var i <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return;\n"
+    "    }\n"
+    "    comment <- comment + \"x\";\n"
+    "    eval(\"var made <- () -> () -> 1; /*\" + comment + \"*/\");\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "make(1000);\n";
+  char *using = "var used <- kept(\"a string\")();";
+  size_t functions = ctx->vm.num_functions;
+  wtjl_limit_memory(ctx, 1, 0);
+  bool passed = wtjl_eval(ctx, keeping, strlen(keeping)) == WTJL_OK && wtjl_eval(ctx, making, strlen(making)) == WTJL_OK;
+  // collecting again, at using's calls, rather than once the heap has doubled
+  wtjl_limit_memory(ctx, 1, 0);
+  if (!passed || wtjl_eval(ctx, using, strlen(using)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t used;
+  wtjl_get(ctx, "used", &used);
+  // two for each source still cached, and kept, what it returns and make
+  if (strcmp(used.as.string.chars, "a string and a suffix long enough to be its own") != 0 || ctx->vm.num_functions > functions + 2 * state->num_entries + 3 || state->evictions < 900) {
+    printf("%d functions, %d entries\n", (int) ctx->vm.num_functions, (int) state->num_entries);
+    evals.report(ctx);
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+// reads what is waiting in the pipe `fd`, which must not be empty
+size_t _test_eval_drain (int fd, char *text, size_t size) {
+  ssize_t length = read(fd, text, size - 1);
+  text[length > 0 ? length : 0] = '\0';
+  return length > 0 ? length : 0;
+}
+
+void test_eval_output () {
+  wtjl_context_t *ctx = wtjl_new();
+  int fds [2];
+  if (pipe(fds) != 0) {
+    TEST_FAIL;
+    return;
+  }
+  output.redirect(ctx, fds[1]);
+  // a thousand records wait in the buffer until something flushes it
+  char *counting = "var i <- 0; var count <- () -> { repeat { if i = 1000 { return; } print(i); i <- i + 1; } }; count();";
+  if (wtjl_eval(ctx, counting, strlen(counting)) != WTJL_OK || ctx->output.records != 1000 || ctx->output.writes != 0) {
+    TEST_FAIL;
+    return;
+  }
+  output.flush(ctx);
+  char text [8192];
+  size_t length = _test_eval_drain(fds[0], text, sizeof(text));
+  if (ctx->output.writes != 1 || length != ctx->output.bytes || strncmp(text, "0\n1\n2\n", 6) != 0 || strcmp(text + length - 4, "999\n") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // an error flushes what was printed before it
+  char *records = "print(\"a\" + \"b\"); print(-7); print(0.1); print(true); print(9223372036854775807 + 1); print(new);";
+  char *failing = "print(\"before\"); print(1 + true);";
+  if (wtjl_eval(ctx, records, strlen(records)) != WTJL_OK || wtjl_eval(ctx, failing, strlen(failing)) != WTJL_ERROR_RUNTIME || ctx->output.writes != 2) {
+    TEST_FAIL;
+    return;
+  }
+  _test_eval_drain(fds[0], text, sizeof(text));
+  if (strcmp(text, "ab\n-7\n0.1\ntrue\n9223372036854775808\n<an object>\nbefore\n") != 0) {
+    printf("%s", text);
+    TEST_FAIL;
+    return;
+  }
+  // and so does destroying the context
+  char *last = "print(\"last\");";
+  wtjl_eval(ctx, last, strlen(last));
+  wtjl_destroy(ctx);
+  _test_eval_drain(fds[0], text, sizeof(text));
+  close(fds[0]);
+  close(fds[1]);
+  if (strcmp(text, "last\n") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+void _test_eval_loader_run (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  loader.run(ctx, call->file_name);
+}
+
+void _test_eval_loader_write (char *directory, char *name, char *text) {
+  char path [256];
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  FILE *file = fopen(path, "w");
+  fputs(text, file);
+  fclose(file);
+}
+
+void test_eval_loader () {
+  char directory [] = "/tmp/wtjl_loader_XXXXXX";
+  if (!mkdtemp(directory)) {
+    TEST_FAIL;
+    return;
+  }
+  char path [256];
+  snprintf(path, sizeof(path), "%s/lib", directory);
+  mkdir(path, 0700);
+  // main names ten parts, each of which names a file in lib, and the last
+  // two of those name each other
+  char main [1024] = "";
+  for (int i = 0; i < 10; i++) {
+    char name [64];
+    char text [256];
+    snprintf(main + strlen(main), sizeof(main) - strlen(main), "import \"part%d.wtjl\";\n", i);
+    snprintf(name, sizeof(name), "part%d.wtjl", i);
+    snprintf(text, sizeof(text), "import \"lib/%s.wtjl\";\nvar part%d <- %d;\n", i < 8 ? "low" : "high", i, i);
+    _test_eval_loader_write(directory, name, text);
+  }
+  strcat(main, "var total <- part0 + part9 + low(1) + high(1);\n");
+  _test_eval_loader_write(directory, "main.wtjl", main);
+  _test_eval_loader_write(directory, "lib/low.wtjl", "import \"high.wtjl\";\nvar low <- (x) -> x + 100;\n");
+  _test_eval_loader_write(directory, "lib/high.wtjl", "import \"../lib/low.wtjl\";\nvar high <- (x) -> x + 1000;\n");
+  _test_eval_loader_write(directory, "broken.wtjl", "import \"lib/low.wtjl\";\nimport \"lib/missing.wtjl\";\n");
+  _test_eval_loader_write(directory, "lib/bad.wtjl", "var x <- ;\n");
+  _test_eval_loader_write(directory, "uses_bad.wtjl", "import \"lib/bad.wtjl\";\n");
+  char main_path [256];
+  char broken_path [256];
+  char uses_bad_path [256];
+  snprintf(main_path, sizeof(main_path), "%s/main.wtjl", directory);
+  snprintf(broken_path, sizeof(broken_path), "%s/broken.wtjl", directory);
+  snprintf(uses_bad_path, sizeof(uses_bad_path), "%s/uses_bad.wtjl", directory);
+  bool passed = true;
+  loader_mode_t modes [] = {LOADER_BATCHED, LOADER_THREADED, LOADER_SEQUENTIAL};
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]) && passed; i++) {
+    wtjl_context_t *ctx = wtjl_new();
+    ctx->loader.mode = modes[i];
+    _wtjl_call_t call = {0};
+    call.file_name = main_path;
+    // main, then the parts, then the two in lib: three rounds
+    passed = _wtjl_protect(ctx, _test_eval_loader_run, &call) == WTJL_OK && _test_eval_integer(ctx, "total", 9 + 101 + 1001) && ctx->loader.batches == 3;
+    if (!passed) {
+      printf("%s\n", wtjl_error(ctx));
+    }
+    call.file_name = broken_path;
+    passed = passed && _wtjl_protect(ctx, _test_eval_loader_run, &call) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "cannot open \"lib/missing.wtjl\"") != NULL;
+    call.file_name = uses_bad_path;
+    passed = passed && _wtjl_protect(ctx, _test_eval_loader_run, &call) == WTJL_ERROR_COMPILE && strstr(wtjl_error(ctx), "lib/bad.wtjl:1:10") != NULL;
+    wtjl_destroy(ctx);
+  }
+  // imports mean nothing without a file to be relative to
+  wtjl_context_t *ctx = wtjl_new();
+  char *source = "import \"main.wtjl\";";
+  passed = passed && wtjl_eval(ctx, source, strlen(source)) == WTJL_ERROR_COMPILE && strstr(wtjl_error(ctx), "programs run from a file") != NULL;
+  wtjl_destroy(ctx);
+  char *names [] = {"main.wtjl", "broken.wtjl", "uses_bad.wtjl", "lib/low.wtjl", "lib/high.wtjl", "lib/bad.wtjl"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+    unlink(path);
+  }
+  for (int i = 0; i < 10; i++) {
+    snprintf(path, sizeof(path), "%s/part%d.wtjl", directory, i);
+    unlink(path);
+  }
+  snprintf(path, sizeof(path), "%s/lib", directory);
+  rmdir(path);
+  rmdir(directory);
+  if (!passed) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+// a program that makes a megabyte of garbage for every 100 kilobytes it
+// keeps, in strings, objects, arrays, closures, boxes and generators
+char *_test_eval_memory_source =
+  "var kept <- array(1000);\n"
+  "var numbers <- () -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    yield i;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var churn <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    var o <- new;\n"
+  "    o::s <- \"abcdefghijklmnopqrstuvwxyz\" + \"abcdefghijklmnopqrstuvwxyz\" + \"abcdefghijklmnopqrstuvwxyz\";\n"
+  "    o::a <- array(4);\n"
+  "    var count <- i;\n"
+  "    o::f <- () -> {\n"
+  "      count <- count + 1;\n"
+  "      return count;\n"
+  "    };\n"
+  "    o::g <- numbers();\n"
+  "    if i - i / 10 * 10 = 0 {\n"
+  "      kept[i / 10] <- o;\n"
+  "    }\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var first <- (g) -> {\n"
+  "  iterate x over g {\n"
+  "    return x;\n"
+  "  }\n"
+  "};\n"
+  "var check <- () -> {\n"
+  "  var total <- 0;\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = 1000 {\n"
+  "      return total;\n"
+  "    }\n"
+  "    var o <- kept[i];\n"
+  "    total <- total + o::f() + length(o::a) + o::s[77] + first(o::g);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+void test_eval_memory () {
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_memory_t memory;
+  wtjl_memory(ctx, &memory);
+  size_t sum = 0;
+  for (size_t i = 0; i < WTJL_MODULES; i++) {
+    sum += memory.modules[i];
+  }
+  if (sum != memory.live || memory.modules[WTJL_MODULE_VM] == 0 || memory.modules[WTJL_MODULE_OUTPUT] < OUTPUT_BUFFER_SIZE || memory.peak < memory.live) {
+    TEST_FAIL;
+    return;
+  }
+  // compiled code stays charged to the compiler, and the tokens and tree
+  // it came from are gone
+  size_t compiled = memory.modules[WTJL_MODULE_COMPILER];
+  wtjl_eval(ctx, _test_eval_memory_source, strlen(_test_eval_memory_source));
+  wtjl_memory(ctx, &memory);
+  if (memory.modules[WTJL_MODULE_COMPILER] <= compiled || memory.modules[WTJL_MODULE_TOKENIZER] != 0 || memory.modules[WTJL_MODULE_PARSER] != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // past the soft limit the garbage is collected, and what is kept survives
+  wtjl_limit_memory(ctx, 1 << 20, 0);
+  wtjl_value_t n = wtjl_integer(10000);
+  wtjl_value_t total;
+  if (wtjl_call(ctx, "churn", 1, &n, NULL) != WTJL_OK || wtjl_call(ctx, "check", 0, NULL, &total) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_memory(ctx, &memory);
+  // each kept object's count + 1, and the generator's first number, 0
+  int64_t expected = 0;
+  for (int64_t i = 0; i < 10000; i += 10) {
+    expected += i + 1 + 4 + 'z';
+  }
+  if (total.as.integer != expected || memory.collections == 0 || memory.collected < (4 << 20) || memory.peak > (4 << 20)) {
+    printf("%lld, %d collections, %d collected, %d peak\n", (long long) total.as.integer, (int) memory.collections, (int) memory.collected, (int) memory.peak);
+    TEST_FAIL;
+    return;
+  }
+  // what the host was handed stays until its next call, which may pass it
+  // back in and collect while nothing else reaches it
+  char *named =
+    "var name <- \"a string long enough not to fit in a value\";\n"
+    "var short <- \"short\";\n"
+    "var huge <- 1180591620717411303424;\n"
+    "var make <- () -> new;\n"
+    "var drop <- (x) -> {\n"
+    "  name <- 0;\n"
+    "  churn(10000);\n"
+    "  return x;\n"
+    "};\n";
+  wtjl_value_t name;
+  wtjl_eval(ctx, named, strlen(named));
+  wtjl_get(ctx, "name", &name);
+  size_t collections = ctx->heap.collections;
+  if (wtjl_call(ctx, "drop", 1, &name, &name) != WTJL_OK || ctx->heap.collections == collections || strcmp(name.as.string.chars, "a string long enough not to fit in a value") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // reading the same small string or bignum again gives back the same copy
+  wtjl_limit_memory(ctx, 0, 0);
+  wtjl_value_t first;
+  wtjl_value_t again;
+  wtjl_get(ctx, "short", &first);
+  wtjl_get(ctx, "short", &again);
+  bool same = first.as.string.chars == again.as.string.chars;
+  wtjl_get(ctx, "huge", &first);
+  wtjl_get(ctx, "huge", &again);
+  if (!same || first.as.string.chars != again.as.string.chars || strcmp(again.as.string.chars, "1180591620717411303424") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // and a host that only reads and calls, over and over, holds on to nothing
+  wtjl_memory(ctx, &memory);
+  wtjl_limit_memory(ctx, memory.live + (1 << 20), memory.live + (2 << 20));
+  for (int i = 0; i < 100000; i++) {
+    if (wtjl_get(ctx, "short", &first) != WTJL_OK || wtjl_get(ctx, "huge", &first) != WTJL_OK || wtjl_call(ctx, "make", 0, NULL, &first) != WTJL_OK) {
+      printf("%d: %s\n", i, wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  // the literals of a script that has run go, unless the program kept them,
+  // and so do those the optimizer folded together
+  char *literals = "var last <- \"a string literal long enough to be its own\" + \" and one more\"; var large <- 123456789012345678901234567890;";
+  for (int i = 0; i < 30000; i++) {
+    ctx->arguments->optimize = i & 1;
+    if (wtjl_eval(ctx, literals, strlen(literals)) != WTJL_OK) {
+      printf("%d: %s\n", i, wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  ctx->arguments->optimize = false;
+  wtjl_get(ctx, "last", &first);
+  if (strcmp(first.as.string.chars, "a string literal long enough to be its own and one more") != 0 || wtjl_get(ctx, "large", &first) != WTJL_OK || strcmp(first.as.string.chars, "123456789012345678901234567890") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_memory(ctx, &memory);
+  // past the hard limit the call fails, and so does every one after it
+  wtjl_limit_memory(ctx, 0, memory.live + (1 << 20));
+  char *hoard = "var hoard <- (n) -> { var all <- array(n); var i <- 0; repeat { if i = n { return; } all[i] <- array(100); i <- i + 1; } }; hoard(1000000);";
+  if (wtjl_eval(ctx, hoard, strlen(hoard)) != WTJL_ERROR_MEMORY || strncmp(wtjl_error(ctx), "Memory error;", 13) != 0) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_call(ctx, "check", 0, NULL, &total) != WTJL_ERROR_MEMORY || strncmp(wtjl_error(ctx), "Memory error;", 13) != 0) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+char *_test_eval_image_source =
+  "var square <- (x) -> x * x;\n"
+  "var fact <- (n) -> {\n"
+  "  if n < 2 {\n"
+  "    return 1;\n"
+  "  }\n"
+  "  return n * fact(n - 1);\n"
+  "};\n"
+  "var greeting <- \"a string long enough to be its own,\\n\" + \"and made of two\";\n"
+  "var small <- \"tiny\";\n"
+  "var big <- 123456789012345678901234567890;\n"
+  "var twice_big <- () -> big * 2;\n"
+  "var half <- 0.5;\n"
+  "var point <- new;\n"
+  "point::x <- 3;\n"
+  "point::y <- 4;\n"
+  "point::self <- point;\n"
+  "var point_sum <- () -> point::self::y + point::x + half;\n"
+  "var counter <- () -> {\n"
+  "  var n <- 0;\n"
+  "  return () -> {\n"
+  "    n <- n + 1;\n"
+  "    return n;\n"
+  "  };\n"
+  "};\n"
+  "var next <- counter();\n"
+  "next();\n"
+  "var things <- array(3);\n"
+  "things[0] <- point;\n"
+  "things[1] <- things;\n"
+  "things[2] <- \"another string too long for a value\";\n"
+  "var table <- integers(4);\n"
+  "table[2] <- 42;\n"
+  "var measure <- length;\n"
+  "var later_plus <- (x) -> later + x;\n"
+  "var churn <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    var o <- new;\n"
+  "    o::a <- array(10);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+// what the image source leaves behind, in a context that started from it
+bool _test_eval_image_check (wtjl_context_t *ctx) {
+  char *source =
+    "var later <- 100;\n"
+    "var results <- square(7) + fact(10) + measure(table) + table[2] + things[1][0]::y + later_plus(1);\n"
+    "var second <- next();\n";
+  wtjl_value_t value;
+  wtjl_value_t argument = wtjl_integer(100000);
+  // a collection on the way keeps everything the image made
+  wtjl_limit_memory(ctx, 1, 0);
+  bool passed = wtjl_call(ctx, "churn", 1, &argument, NULL) == WTJL_OK && ctx->heap.collections > 0;
+  passed = passed && wtjl_eval(ctx, source, strlen(source)) == WTJL_OK;
+  passed = passed && _test_eval_integer(ctx, "results", 49 + 3628800 + 4 + 42 + 4 + 101) && _test_eval_integer(ctx, "second", 2);
+  passed = passed && wtjl_get(ctx, "greeting", &value) == WTJL_OK && value.type == WTJL_STRING && strcmp(value.as.string.chars, "a string long enough to be its own,\nand made of two") == 0;
+  passed = passed && wtjl_get(ctx, "small", &value) == WTJL_OK && value.type == WTJL_STRING && strcmp(value.as.string.chars, "tiny") == 0;
+  passed = passed && wtjl_call(ctx, "twice_big", 0, NULL, &value) == WTJL_OK && value.type == WTJL_BIG_INTEGER && strcmp(value.as.string.chars, "246913578024691357802469135780") == 0;
+  passed = passed && wtjl_call(ctx, "point_sum", 0, NULL, &value) == WTJL_OK && value.type == WTJL_DOUBLE && value.as.number == 7.5;
+  if (!passed) {
+    printf("%s\n", wtjl_error(ctx));
+  }
+  return passed;
+}
+
+// where `code` is in the image, `length` if it is not
+size_t _test_eval_image_find (const char *bytes, size_t length, const uint8_t *code, size_t code_length) {
+  for (size_t at = sizeof(_image_header_t); at + code_length <= length; at++) {
+    if (memcmp(bytes + at, code, code_length) == 0) {
+      return at;
+    }
+  }
+  return length;
+}
+
+void test_eval_image () {
+  char directory [] = "/tmp/wtjl_image_XXXXXX";
+  if (!mkdtemp(directory)) {
+    TEST_FAIL;
+    return;
+  }
+  char path [256];
+  snprintf(path, sizeof(path), "%s/prelude.image", directory);
+  wtjl_context_t *ctx = wtjl_new();
+  bool passed = wtjl_eval(ctx, _test_eval_image_source, strlen(_test_eval_image_source)) == WTJL_OK && wtjl_save_image(ctx, path) == WTJL_OK;
+  // generators hold a running call, which an image cannot
+  char *generator = "var numbers <- () -> { yield 1; }; var running <- numbers();";
+  passed = passed && wtjl_eval(ctx, generator, strlen(generator)) == WTJL_OK;
+  passed = passed && wtjl_save_image(ctx, path) == WTJL_ERROR_RUNTIME && strstr(wtjl_error(ctx), "generator") != NULL;
+  // fact's code and that of the closure in next, to find in the image and damage below
+  chunk_t *fact = &ctx->vm.globals[vm.find_global(ctx, "fact")].as.function->chunk;
+  size_t fact_length = fact->code_length;
+  uint8_t *fact_code = malloc(fact_length);
+  memcpy(fact_code, fact->code, fact_length);
+  chunk_t *next = &ctx->vm.globals[vm.find_global(ctx, "next")].as.function->chunk;
+  size_t next_length = next->code_length;
+  uint8_t *next_code = malloc(next_length);
+  memcpy(next_code, next->code, next_length);
+  wtjl_destroy(ctx);
+  // mapped from the file
+  ctx = wtjl_new();
+  passed = passed && wtjl_load_image_file(ctx, path) == WTJL_OK && _test_eval_image_check(ctx) && ctx->vm.num_functions > 0;
+  wtjl_destroy(ctx);
+  // from memory, as an embedded image would be
+  struct stat file_stat;
+  stat(path, &file_stat);
+  size_t length = (size_t) file_stat.st_size;
+  char *bytes = malloc(length);
+  FILE *file = fopen(path, "rb");
+  passed = passed && file && fread(bytes, 1, length, file) == length;
+  if (file) {
+    fclose(file);
+  }
+  ctx = wtjl_new();
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_OK && _test_eval_image_check(ctx);
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "only one image") != NULL;
+  wtjl_destroy(ctx);
+  // a context that has made globals of its own is turned away
+  ctx = wtjl_new();
+  char *own = "var mine <- 1;";
+  wtjl_eval(ctx, own, strlen(own));
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "globals of its own") != NULL;
+  wtjl_destroy(ctx);
+  // and damaged images fail instead of loading, however they are cut short
+  for (size_t cut = 0; cut < length && passed; cut += 8) {
+    ctx = wtjl_new();
+    passed = wtjl_load_image(ctx, bytes, cut) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "damaged") != NULL;
+    wtjl_destroy(ctx);
+  }
+  ((_image_header_t *) bytes)->opcodes++;
+  ctx = wtjl_new();
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "another build") != NULL;
+  wtjl_destroy(ctx);
+  ((_image_header_t *) bytes)->opcodes--;
+  // a flipped bit anywhere past the header fails the checksum
+  for (size_t at = sizeof(_image_header_t); at < length && passed; at += 61) {
+    bytes[at] ^= 0x10;
+    ctx = wtjl_new();
+    passed = wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "damaged") != NULL;
+    wtjl_destroy(ctx);
+    bytes[at] ^= 0x10;
+  }
+  // and an image made to pass it still has every operand checked, so none
+  // of fact's can point outside what it indexes
+  _image_header_t *header = (_image_header_t *) bytes;
+  size_t found = _test_eval_image_find(bytes, length, fact_code, fact_length);
+  passed = passed && found < length;
+  for (size_t at = 0; at < fact_length && passed; at += 1 + _compiler_operand_bytes(fact_code[at])) {
+    size_t end = found + at + 1 + _compiler_operand_bytes(fact_code[at]);
+    if (_compiler_operand_bytes(fact_code[at]) < 2) {
+      continue;
+    }
+    bytes[end - 2] = bytes[end - 1] = (char) 0xff;
+    header->checksum = _image_checksum(header, bytes, length);
+    ctx = wtjl_new();
+    passed = wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "damaged") != NULL;
+    wtjl_destroy(ctx);
+    memcpy(bytes + found + at, fact_code + at, end - found - at);
+  }
+  // nor can a call take more than the stack holds
+  for (size_t at = 0; at < fact_length && passed; at += 1 + _compiler_operand_bytes(fact_code[at])) {
+    if (_compiler_unfused(fact_code[at]) != OP_CALL) {
+      continue;
+    }
+    bytes[found + at + 1] = 3;
+    header->checksum = _image_checksum(header, bytes, length);
+    ctx = wtjl_new();
+    passed = wtjl_load_image(ctx, bytes, length) == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "damaged") != NULL;
+    wtjl_destroy(ctx);
+    bytes[found + at + 1] = fact_code[at + 1];
+  }
+  // a capture from further out is only checked once it runs
+  found = _test_eval_image_find(bytes, length, next_code, next_length);
+  passed = passed && found < length && _compiler_unfused(next_code[0]) == OP_GET_CAPTURE;
+  bytes[found + 1] = 5;
+  header->checksum = _image_checksum(header, bytes, length);
+  ctx = wtjl_new();
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_OK;
+  passed = passed && wtjl_call(ctx, "next", 0, NULL, NULL) == WTJL_ERROR_RUNTIME && strstr(wtjl_error(ctx), "outside the frames") != NULL;
+  wtjl_destroy(ctx);
+  bytes[found + 1] = next_code[1];
+  // and whatever a damaged image gets past the checksum with, it fails
+  // cleanly or loads, leaving nothing half made behind
+  for (size_t at = sizeof(_image_header_t); at < length && passed; at++) {
+    bytes[at] ^= 0x80;
+    header->checksum = _image_checksum(header, bytes, length);
+    ctx = wtjl_new();
+    wtjl_status_t status = wtjl_load_image(ctx, bytes, length);
+    passed = status == WTJL_OK || (status == WTJL_ERROR_IO && strstr(wtjl_error(ctx), "Image error") != NULL);
+    wtjl_destroy(ctx);
+    bytes[at] ^= 0x80;
+  }
+  header->checksum = _image_checksum(header, bytes, length);
+  ctx = wtjl_new();
+  passed = passed && wtjl_load_image(ctx, bytes, length) == WTJL_OK && _test_eval_image_check(ctx);
+  wtjl_destroy(ctx);
+  free(fact_code);
+  free(next_code);
+  free(bytes);
+  unlink(path);
+  rmdir(directory);
+  if (!passed) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+void test_eval_numbers () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var a <- 0x7fFF + 0b1011;\n"
+    "var b <- 1234567890123456789 - 9223372036854775807;\n"
+    "var c <- 00000000000000000000000000042;\n"
+    "var d <- 1.5 * 4;\n"
+    "var e <- 2.5e3 + 1e-1 - 5E+2;\n"
+    "var f <- -0.25 + 1;\n"
+    "var g <- 2 ** 0.5;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (!_test_eval_integer(ctx, "a", 0x7fff + 11) || !_test_eval_integer(ctx, "b", 1234567890123456789LL - INT64_MAX) || !_test_eval_integer(ctx, "c", 42)) {
+    TEST_FAIL;
+    return;
+  }
+  char *names [] = {"d", "e", "f", "g"};
+  double expected [] = {6.0, 2000.1, 0.75, sqrt(2)};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    wtjl_value_t value;
+    if (wtjl_get(ctx, names[i], &value) != WTJL_OK || value.type != WTJL_DOUBLE || value.as.number != expected[i]) {
+      TEST_FAIL;
+      return;
+    }
+  }
+  // integers past an int64 are bignums instead, see test_eval_bignums
+  char *too_large [] = {"var h <- 1e309;"};
+  for (size_t i = 0; i < sizeof(too_large) / sizeof(too_large[0]); i++) {
+    if (wtjl_eval(ctx, too_large[i], strlen(too_large[i])) != WTJL_ERROR_COMPILE || strncmp(wtjl_error(ctx), "1:10: Tokenizing error; number literal", 38) != 0) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+bool _test_eval_digits (wtjl_context_t *ctx, char *name, char *expected) {
+  wtjl_value_t value;
+  if (wtjl_get(ctx, name, &value) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    return false;
+  }
+  return value.type == WTJL_BIG_INTEGER && strcmp(value.as.string.chars, expected) == 0;
+}
+
+void test_eval_bignums () {
+  char *source =
+    "var factorial <- (n as integer) -> {\n"
+    "  var result as integer <- 1;\n"
+    "  var i as integer <- 2;\n"
+    "  repeat {\n"
+    "    if i > n {\n"
+    "      return result;\n"
+    "    }\n"
+    "    result <- result * i;\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "var f100 <- factorial(100);\n"
+    "var f30 <- factorial(30);\n"
+    "var back <- f30 / factorial(28);\n"
+    "var shrunk <- f30 - f30 + 5;\n"
+    "var literal <- 123456789012345678901234567890;\n"
+    "var negative <- -literal;\n"
+    "var cube <- 3 ** 200 * 3 ** 200 * 3 ** 200 - 1;\n"
+    "var quotient <- 7 ** 5000 / 7 ** 4990;\n"
+    "var ordered <- literal > 9223372036854775807;\n"
+    "var below <- -literal < -9223372036854775807;\n"
+    "var same <- literal = 123456789012345678901234567890;\n"
+    "var mixed <- literal + 0.5;\n"
+    "var smallest <- -9223372036854775807 - 1;\n"
+    "var negated <- -smallest;\n"
+    "var divided <- smallest / -1;\n"
+    "var checked as integer <- literal;\n"
+    "var hex_top <- 0x7fffffffffffffff;\n"
+    "var hex_past <- 0x8000000000000000;\n"
+    "var hex_long <- 0xFFFFFFFFFFFFFFFFffffffffffffffff;\n"
+    "var hex_negated <- -0x8000000000000000;\n"
+    "var binary_past <- 0b10000000000000000000000000000000000000000000000000000000000000000;\n";
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_value_t value;
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (!_test_eval_digits(ctx, "f100", "93326215443944152681699238856266700490715968264381621468592963895217599993229915608941463976156518286253697920827223758251185210916864000000000000000000000000") ||
+      !_test_eval_integer(ctx, "back", 870) || !_test_eval_integer(ctx, "shrunk", 5) || !_test_eval_integer(ctx, "quotient", 282475249) ||
+      !_test_eval_digits(ctx, "negative", "-123456789012345678901234567890") || !_test_eval_integer(ctx, "smallest", INT64_MIN) ||
+      !_test_eval_digits(ctx, "negated", "9223372036854775808") || !_test_eval_digits(ctx, "divided", "9223372036854775808") ||
+      !_test_eval_integer(ctx, "hex_top", INT64_MAX) || !_test_eval_digits(ctx, "hex_past", "9223372036854775808") ||
+      !_test_eval_digits(ctx, "hex_long", "340282366920938463463374607431768211455") || !_test_eval_integer(ctx, "hex_negated", INT64_MIN) ||
+      !_test_eval_digits(ctx, "binary_past", "18446744073709551616") ||
+      !_test_eval_digits(ctx, "cube", "18739277038847939886754019920358123424308469030992781557966909983211910963157763678726120154469030856807730587971859910379069087693119051085139566217370635083384943613868029545256897117998608156843699465093293765833141309526696357142600866935689483770877815014461194837692223879905132000")) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_get(ctx, "ordered", &value) != WTJL_OK || !value.as.boolean || wtjl_get(ctx, "below", &value) != WTJL_OK || !value.as.boolean || wtjl_get(ctx, "same", &value) != WTJL_OK || !value.as.boolean ||
+      wtjl_get(ctx, "mixed", &value) != WTJL_OK || value.type != WTJL_DOUBLE || value.as.number != 123456789012345678901234567890.0) {
+    TEST_FAIL;
+    return;
+  }
+  // bignums come in through the api too, and go back to int64s when they fit
+  char *half = "var half <- (x) -> x / 2;";
+  wtjl_value_t argument;
+  argument.type = WTJL_BIG_INTEGER;
+  argument.as.string.chars = "-18446744073709551616";
+  argument.as.string.length = strlen(argument.as.string.chars);
+  if (wtjl_eval(ctx, half, strlen(half)) != WTJL_OK || wtjl_call(ctx, "half", 1, &argument, &value) != WTJL_OK || value.type != WTJL_INTEGER || value.as.integer != INT64_MIN) {
+    TEST_FAIL;
+    return;
+  }
+  char *failing [] = {"literal / (literal - literal);", "2 ** literal;", "literal ** -1;"};
+  char *errors [] = {"division by zero", "integer too large", "negative exponent"};
+  for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+    if (wtjl_eval(ctx, failing[i], strlen(failing[i])) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), errors[i]) == NULL) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  // the optimizer leaves bignum literals for the vm rather than folding them
+  char *folded = "var folded <- 100000000000000000000 + 1 - -0x10000000000000000;";
+  ctx->arguments->optimize = true;
+  if (wtjl_eval(ctx, folded, strlen(folded)) != WTJL_OK || !_test_eval_digits(ctx, "folded", "118446744073709551617")) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  // products long enough for Karatsuba divide back exactly, and decimal
+  // conversion goes both ways
+  ctx = wtjl_context_t_new(0, NULL);
+  wtjl_context_t_enter(ctx);
+  uint64_t seed = 88172645463325252ULL;
+  char digits [2001];
+  for (size_t i = 0; i < 2000; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    digits[i] = (char) ('1' + seed % 9);
+  }
+  digits[2000] = '\0';
+  bignum_t *a = bignums.from_decimal(digits, 2000);
+  bignum_t *b = bignums.from_decimal(digits + 700, 1300);
+  bignum_t *product = bignums.multiply(a, b);
+  bignum_t *quotient = bignums.divide(product, b);
+  size_t length;
+  char *decimal = bignums.to_decimal(a, &length);
+  bool passed = a->length > 2 * BIGNUM_KARATSUBA && bignums.compare(quotient, a) == 0 && length == 2000 && strcmp(decimal, digits) == 0;
+  free(a);
+  free(b);
+  free(product);
+  free(quotient);
+  free(decimal);
+  wtjl_context_t_leave(ctx);
+  wtjl_context_t_destroy(ctx);
+  if (!passed) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+// every double literal has to come out exactly as strtod rounds it, whichever
+// path converted it
+void test_eval_double_literals () {
+  wtjl_context_t *ctx = wtjl_context_t_new(0, NULL);
+  wtjl_context_t_enter(ctx);
+  char *fixed [] = {
+    "0.1", "3.141592653589793", "1e23", "8.98846567431158e307", "2.2250738585072014e-308",
+    "4.9e-324", "9007199254740993.0", "123456789012345678901234567890.5", "1e-400", "0.000000000000000000000000001",
+  };
+  char text [64];
+  uint64_t seed = 88172645463325252ULL;
+  for (int i = 0; i < 20000; i++) {
+    if (i < (int) (sizeof(fixed) / sizeof(fixed[0]))) {
+      snprintf(text, sizeof(text), "%s", fixed[i]);
+    } else {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      // mostly short literals that take the fast path, some that cannot
+      int digits = 1 + seed % (i % 4 ? 12 : 24);
+      int point = (seed >> 8) % digits;
+      int exponent = (int) ((seed >> 16) % 80) - 40;
+      int length = 0;
+      for (int j = 0; j < digits; j++) {
+        text[length++] = '0' + (seed >> (j * 2 + 20) % 64) % 10;
+        if (j == point) {
+          text[length++] = '.';
+          text[length++] = '0' + (seed >> 5) % 10;
+        }
+      }
+      snprintf(text + length, sizeof(text) - length, "e%d", exponent);
+    }
+    scanner.scan_buffer(ctx, text, strlen(text));
+    tokenizer.tokenize(ctx);
+    token_t *token = tokenizer.next(ctx);
+    double expected = strtod(text, NULL);
+    bool same = ctx->tokenizer.tokens_size == 1 && token->token_type_secondary == LITERAL_DOUBLE && memcmp(&token->as.number, &expected, sizeof(double)) == 0;
+    tokenizer.cleanup(ctx);
+    scanner.cleanup(ctx);
+    if (!same) {
+      printf("%s\n", text);
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_context_t_leave(ctx);
+  wtjl_context_t_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_if () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var sign <- (x) -> {\n"
+    "  if x - 0 ** 1 {\n"
+    "  }\n"
+    "  return 0;\n"
+    "};\n";
+  // conditions have to be booleans, integers are not truthy
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || wtjl_call(ctx, "sign", 1, (wtjl_value_t []) {wtjl_integer(1)}, NULL) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "condition must be a boolean") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  source =
+    "var pick <- (a, b, c) -> {\n"
+    "  if a {\n"
+    "    return 1;\n"
+    "  } else if b {\n"
+    "    if c {\n"
+    "      return 2;\n"
+    "    }\n"
+    "    return 3;\n"
+    "  } else {\n"
+    "    return 4;\n"
+    "  }\n"
+    "};\n"
+    "var n <- 0;\n"
+    "if true {\n"
+    "  n <- n + 1;\n"
+    "}\n"
+    "if false {\n"
+    "  n <- n + 10;\n"
+    "} else {\n"
+    "  n <- n + 100;\n"
+    "}\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "n", 101)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  int64_t expected [] = {4, 4, 3, 2, 1, 1, 1, 1};
+  for (int i = 0; i < 8; i++) {
+    wtjl_value_t arguments [3] = {wtjl_boolean(i & 4), wtjl_boolean(i & 2), wtjl_boolean(i & 1)};
+    wtjl_value_t result;
+    if (wtjl_call(ctx, "pick", 3, arguments, &result) != WTJL_OK || result.type != WTJL_INTEGER || result.as.integer != expected[i]) {
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_destroy(ctx);
+  // a top level return ends the script, so a top level repeat can stop; the
+  // globals it set stay, and what follows it never runs
+  source =
+    "var i <- 0;\n"
+    "var total <- 0;\n"
+    "repeat {\n"
+    "  if i = 10 {\n"
+    "    return total;\n"
+    "  }\n"
+    "  total <- total + i;\n"
+    "  i <- i + 1;\n"
+    "}\n"
+    "total <- -1;\n";
+  for (int optimize = 0; optimize <= 1; optimize++) {
+    ctx = wtjl_new();
+    ctx->arguments->optimize = optimize;
+    char *after = "var after <- total + 1;";
+    if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "total", 45) || wtjl_eval(ctx, after, strlen(after)) != WTJL_OK || !_test_eval_integer(ctx, "after", 46)) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+    wtjl_destroy(ctx);
+  }
+  TEST_PASS;
+}
+
+void test_eval_comparisons () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var a <- 1 < 2;\n"
+    "var b <- 2.5 > 3;\n"
+    "var c <- \"ab\" = \"a\" + \"b\";\n"
+    "var d <- 1 = 1.0;\n"
+    "var e <- true = 1;\n"
+    "var f <- 1 + 2 * 3 = 7;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  char *names [] = {"a", "b", "c", "d", "e", "f"};
+  int expected [] = {1, 0, 1, 1, 0, 1};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    wtjl_value_t value;
+    if (wtjl_get(ctx, names[i], &value) != WTJL_OK || value.type != WTJL_BOOLEAN || value.as.boolean != expected[i]) {
+      printf("%s\n", names[i]);
+      TEST_FAIL;
+      return;
+    }
+  }
+  char *wrong = "var g <- \"a\" < 1;";
+  if (wtjl_eval(ctx, wrong, strlen(wrong)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "operands must be numbers") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_generators () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var naturals <- () -> {\n"
+    "  var n <- 0;\n"
+    "  repeat {\n"
+    "    yield n;\n"
+    "    n <- n + 1;\n"
+    "  }\n"
+    "};\n"
+    "var squares <- (source) -> {\n"
+    "  iterate n over source {\n"
+    "    yield n * n;\n"
+    "  }\n"
+    "};\n"
+    "var sum_of_squares_below <- (limit) -> {\n"
+    "  var total <- 0;\n"
+    "  iterate n over squares(naturals()) {\n"
+    "    if n > limit {\n"
+    "      return total;\n"
+    "    }\n"
+    "    total <- total + n;\n"
+    "  }\n"
+    "};\n"
+    "var three <- (a) -> {\n"
+    "  yield a;\n"
+    "  yield a + 1;\n"
+    "  yield a + 2;\n"
+    "};\n"
+    "var joined <- \"\";\n"
+    "iterate word over three(\"a\") {\n"
+    "}\n"
+    "var total <- 0;\n"
+    "var g <- three(10);\n"
+    "iterate x over g {\n"
+    "  iterate y over three(x) {\n"
+    "    total <- total + y;\n"
+    "  }\n"
+    "}\n"
+    "iterate x over g {\n"
+    "  total <- 0;\n"
+    "}\n";
+  // a string can't have 1 added, but the generator is never resumed past its first yield
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "operands must both be strings") == NULL) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  source = "var total <- 0;\nvar g <- three(10);\niterate x over g {\n  iterate y over three(x) {\n    total <- total + y;\n  }\n}\niterate x over g {\n  total <- 0;\n}\n";
+  // three(10) yields 10, 11, 12 and each of those three more; a finished generator yields nothing
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "total", 3 * 33 + 9)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t result;
+  if (wtjl_call(ctx, "sum_of_squares_below", 1, (wtjl_value_t []) {wtjl_integer(100)}, &result) != WTJL_OK || result.as.integer != 0 + 1 + 4 + 9 + 16 + 25 + 36 + 49 + 64 + 81 + 100) {
+    TEST_FAIL;
+    return;
+  }
+  // the pipeline runs in constant memory, however far it is pulled
+  size_t num_generators = ctx->vm.num_generators;
+  size_t allocated = ctx->mem.total_alloc;
+  if (wtjl_call(ctx, "sum_of_squares_below", 1, (wtjl_value_t []) {wtjl_integer(1000000000000)}, &result) != WTJL_OK || result.as.integer != 333333833333500000) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  if (ctx->vm.num_generators != num_generators + 2 || ctx->mem.total_alloc - allocated > 4096 || ctx->vm.stack_top != ctx->vm.stack) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_call(ctx, "three", 1, (wtjl_value_t []) {wtjl_integer(1)}, &result) != WTJL_OK || result.type != WTJL_GENERATOR) {
+    TEST_FAIL;
+    return;
+  }
+  // a generator iterating over itself, and one failing part way, are finished
+  char *failing [] = {
+    "var again <- () -> {\n  iterate x over self {\n    yield x;\n  }\n};\nvar self <- again();\niterate x over self {\n}\n",
+    "iterate x over self {\n  total <- 1;\n}\n",
+    "iterate x over 3 {\n}\n",
+    "yield 1;\n",
+  };
+  wtjl_status_t statuses [] = {WTJL_ERROR_RUNTIME, WTJL_OK, WTJL_ERROR_RUNTIME, WTJL_ERROR_COMPILE};
+  char *errors [] = {"the generator is already running", "", "only generators can be iterated over", "yield outside of a function"};
+  for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+    if (wtjl_eval(ctx, failing[i], strlen(failing[i])) != statuses[i] || strstr(wtjl_error(ctx), errors[i]) == NULL) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  if (!_test_eval_integer(ctx, "total", 3 * 33 + 9)) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+bool _test_eval_same_value (wtjl_value_t a, wtjl_value_t b) {
+  if (a.type != b.type) {
+    return false;
+  }
+  switch (a.type) {
+    case (WTJL_INTEGER):
+      return a.as.integer == b.as.integer;
+    case (WTJL_DOUBLE):
+      return memcmp(&a.as.number, &b.as.number, sizeof(double)) == 0;
+    case (WTJL_BOOLEAN):
+      return a.as.boolean == b.as.boolean;
+    case (WTJL_STRING):
+      return a.as.string.length == b.as.string.length && memcmp(a.as.string.chars, b.as.string.chars, a.as.string.length) == 0;
+    default:
+      return true;
+  }
+}
+
+// how often `op` appears in `function`'s code, counting the superinstructions
+// that start with it
+size_t _test_eval_count_op (function_t *function, opcode_t op) {
+  size_t count = 0;
+  chunk_t *chunk = &function->chunk;
+  for (size_t i = 0; i < chunk->code_length; ) {
+    opcode_t at = chunk->code[i++];
+    count += at == op || _compiler_unfused(at) == op;
+    i += _compiler_operand_bytes(at);
+  }
+  return count;
+}
+
+void test_eval_types () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var hypotenuse_squared <- (a as integer, b as integer) -> {\n"
+    "  var aa <- a * a;\n"
+    "  var total as integer <- aa;\n"
+    "  total <- total + b * b;\n"
+    "  return total;\n"
+    "};\n"
+    "var scale <- (x as double, by) -> -x * 2.0 + x / by - x * by;\n"
+    "var greet <- (name as string) -> \"hello, \" + name;\n"
+    "var untyped <- (a, b) -> a + b;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t result;
+  if (wtjl_call(ctx, "hypotenuse_squared", 2, (wtjl_value_t []) {wtjl_integer(3), wtjl_integer(4)}, &result) != WTJL_OK || result.as.integer != 25) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_call(ctx, "scale", 2, (wtjl_value_t []) {wtjl_double(1.5), wtjl_integer(2)}, &result) != WTJL_OK || result.type != WTJL_DOUBLE || result.as.number != -5.25) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_call(ctx, "greet", 1, (wtjl_value_t []) {wtjl_string("you", 3)}, &result) != WTJL_OK || strcmp(result.as.string.chars, "hello, you") != 0) {
+    TEST_FAIL;
+    return;
+  }
+  // the types proven are the ones the specialised instructions were chosen for
+  wtjl_value_t function;
+  size_t expected [][4] = {
+    // add, multiply, add integer, multiply integer
+    {0, 0, 1, 2},
+    {1, 1, 0, 0},
+    {0, 0, 0, 0},
+    {1, 0, 0, 0},
+  };
+  char *names [] = {"hypotenuse_squared", "scale", "greet", "untyped"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    wtjl_get(ctx, names[i], &function);
+    function_t *compiled = function.as.function;
+    if (_test_eval_count_op(compiled, OP_ADD) != expected[i][0] || _test_eval_count_op(compiled, OP_MULTIPLY) != expected[i][1] ||
+        _test_eval_count_op(compiled, OP_ADD_INTEGER) != expected[i][2] || _test_eval_count_op(compiled, OP_MULTIPLY_INTEGER) != expected[i][3]) {
+      printf("%s\n", names[i]);
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_get(ctx, "scale", &function);
+  if (_test_eval_count_op(function.as.function, OP_NEGATE_DOUBLE) != 1 || _test_eval_count_op(function.as.function, OP_MULTIPLY_DOUBLE) != 1) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_get(ctx, "greet", &function);
+  if (_test_eval_count_op(function.as.function, OP_CONCATENATE) != 1) {
+    TEST_FAIL;
+    return;
+  }
+  // annotations are checked where the types are not known until run time
+  if (wtjl_call(ctx, "hypotenuse_squared", 2, (wtjl_value_t []) {wtjl_integer(3), wtjl_double(4)}, NULL) != WTJL_ERROR_RUNTIME || strcmp(wtjl_error(ctx), "Runtime error in hypotenuse_squared; expected an integer, got a double.") != 0) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  char *sources [] = {
+    "var f <- () -> {\n  var x as integer <- \"one\";\n};",
+    "var f <- () -> {\n  var x as string <- \"one\";\n  x <- 1.5;\n};",
+    "var f <- (x as byte) -> x;",
+  };
+  char *errors [] = {
+    "2:7: Compiling error; \"x\" holds an integer, not a string.",
+    "3:3: Compiling error; \"x\" holds a string, not a double.",
+    "1:16: Compiling error; unknown type \"byte\".",
+  };
+  for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+    if (wtjl_eval(ctx, sources[i], strlen(sources[i])) != WTJL_ERROR_COMPILE || strcmp(wtjl_error(ctx), errors[i]) != 0) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+// every program has to leave the same globals, or fail the same way, whether
+// or not it was optimized
+void test_eval_optimizer () {
+  char *programs [] = {
+    "var a <- 1 + 2 * 3 - 8 / 2 ** 2;\nvar b <- -(a - 10) * 2.5;\nvar c <- 2 ** -1;\n",
+    "var a <- \"con\" + \"cat\\n\" + \"enated\";\nvar b <- 0x7fffffffffffffff - -1;\n",
+    "var a <- 9223372036854775807 + 1;\n",
+    "var a <- 1 / 0;\n",
+    "var a <- 1 / 0.0;\nvar b <- -(-9223372036854775807 - 1);\n",
+    "var a <- 1;\nif true {\n  a <- 2;\n} else {\n  a <- 3;\n}\nif 1 + 1 {\n  a <- 4;\n}\n",
+    "var f <- (x) -> {\n  var unused <- 40 + 2;\n  var kept <- x * 2;\n  unused <- f;\n  x;\n  1 + 2;\n  return kept;\n  return 0;\n};\nvar a <- f(21);\n",
+    "var f <- (x) -> {\n  if false {\n    return 1;\n  } else if true {\n    return x;\n  } else {\n    return 3;\n  }\n  return 4;\n};\nvar a <- f(5);\n",
+    "var f <- (x) -> {\n  var y <- x;\n  var g <- (y) -> y;\n  return g(y + 1);\n};\nvar a <- f(1);\n",
+    "var f <- (x) -> {\n  var y <- undefined_global;\n  return x;\n};\nvar a <- f(1);\n",
+    "var f <- (x) -> {\n  var y <- 1;\n  if true {\n    var y <- 2;\n    return y;\n  }\n};\nvar a <- f(1);\n",
+    // static errors in the code the optimizer removes
+    "var a <- 1;\nif false {\n  var x as integer <- \"one\";\n}\n",
+    "var f <- (x) -> {\n  return x;\n  var y as string <- 1.5;\n};\nvar a <- f(1);\n",
+    "var f <- (x) -> {\n  var g <- () -> {\n    var y as byte <- 1;\n  };\n  return x;\n};\nvar a <- f(1);\n",
+  };
+  char *names [] = {"a", "b", "c"};
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+    wtjl_context_t *plain = wtjl_new();
+    wtjl_context_t *optimized = wtjl_new();
+    optimized->arguments->optimize = true;
+    wtjl_status_t status = wtjl_eval(plain, programs[i], strlen(programs[i]));
+    if (wtjl_eval(optimized, programs[i], strlen(programs[i])) != status || strcmp(wtjl_error(plain), wtjl_error(optimized)) != 0) {
+      printf("%s\n%s\n%s\n", programs[i], wtjl_error(plain), wtjl_error(optimized));
+      TEST_FAIL;
+      return;
+    }
+    for (size_t j = 0; j < sizeof(names) / sizeof(names[0]); j++) {
+      wtjl_value_t a;
+      wtjl_value_t b;
+      wtjl_status_t found = wtjl_get(plain, names[j], &a);
+      if (wtjl_get(optimized, names[j], &b) != found || (found == WTJL_OK && !_test_eval_same_value(a, b))) {
+        printf("%s\n", programs[i]);
+        TEST_FAIL;
+        return;
+      }
+    }
+    wtjl_destroy(plain);
+    wtjl_destroy(optimized);
+  }
+  wtjl_context_t *ctx = wtjl_new();
+  ctx->arguments->optimize = true;
+  // the if with its condition and branch, the unused local, the pure
+  // statement, the return after the first one and the operands of 1 + 2
+  char *source =
+    "var f <- (x) -> {\n"
+    "  if false {\n"
+    "    return 1;\n"
+    "  }\n"
+    "  var unused <- 2;\n"
+    "  x;\n"
+    "  return x;\n"
+    "  return 3;\n"
+    "};\n"
+    "var a <- 1 + 2;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || ctx->optimizer.eliminated != 13 || !_test_eval_integer(ctx, "a", 3)) {
+    printf("%d\n", (int) ctx->optimizer.eliminated);
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_superinstructions () {
+  char *programs [] = {
+    "var sum_squares <- (n) -> {\n  var i <- 0;\n  var total <- 0;\n  repeat {\n    if i = n {\n      return total;\n    }\n    total <- total + i * i;\n    i <- i + 1;\n  }\n};\nvar a <- sum_squares(1000);\n",
+    "var f <- (s) -> {\n  var t <- s;\n  t <- t + \"!\";\n  return t;\n};\nvar a <- f(\"hi\");\n",
+    "var f <- (x) -> {\n  var y <- x;\n  y <- y + 1;\n  return y;\n};\nvar a <- f(0x7fffffffffffffff);\nvar b <- f(1.5);\n",
+    "var f <- (x) -> x * 2.5 + x;\nvar a <- f(2);\nvar b <- f(2.0);\n",
+    "var f <- (x) -> {\n  var y <- x;\n  return y + \"s\";\n};\nvar a <- f(1);\n",
+    "var f <- (x) -> g(x);\nvar a <- f(1);\n",
+    "var f <- (x) -> {\n  var y <- 0;\n  if x = 1 {\n    y <- 2;\n  } else {\n    y <- 3;\n  }\n  return y * y;\n};\nvar a <- f(1);\nvar b <- f(2);\n",
+  };
+  char *names [] = {"a", "b"};
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+    wtjl_context_t *plain = wtjl_new();
+    wtjl_context_t *fused = wtjl_new();
+    plain->arguments->superinstructions = false;
+    fused->arguments->superinstructions = true;
+    wtjl_status_t status = wtjl_eval(plain, programs[i], strlen(programs[i]));
+    if (wtjl_eval(fused, programs[i], strlen(programs[i])) != status || strcmp(wtjl_error(plain), wtjl_error(fused)) != 0) {
+      printf("%s\n%s\n%s\n", programs[i], wtjl_error(plain), wtjl_error(fused));
+      TEST_FAIL;
+      return;
+    }
+    for (size_t j = 0; j < sizeof(names) / sizeof(names[0]); j++) {
+      wtjl_value_t a;
+      wtjl_value_t b;
+      wtjl_status_t found = wtjl_get(plain, names[j], &a);
+      if (wtjl_get(fused, names[j], &b) != found || (found == WTJL_OK && !_test_eval_same_value(a, b))) {
+        printf("%s\n", programs[i]);
+        TEST_FAIL;
+        return;
+      }
+    }
+    wtjl_destroy(plain);
+    wtjl_destroy(fused);
+  }
+  // the loop's condition and increment are fused, and the jump over the
+  // else lands in the middle of the run its last assignment starts; asked
+  // for, as a VM_PROFILE build fuses nothing by default
+  wtjl_context_t *ctx = wtjl_new();
+  ctx->arguments->superinstructions = true;
+  if (wtjl_eval(ctx, programs[0], strlen(programs[0])) != WTJL_OK || wtjl_eval(ctx, programs[6], strlen(programs[6])) != WTJL_OK || !_test_eval_integer(ctx, "a", 4) || !_test_eval_integer(ctx, "b", 9)) {
+    TEST_FAIL;
+    return;
+  }
+  function_t *sum_squares = ctx->vm.globals[vm.find_global(ctx, "sum_squares")].as.function;
+  function_t *f = ctx->vm.globals[vm.find_global(ctx, "f")].as.function;
+  if (_test_eval_count_op(sum_squares, OP_EQUAL_JUMP_IF_FALSE) != 1 || _test_eval_count_op(sum_squares, OP_GET_LOCAL_CONSTANT_ADD) != 1 || _test_eval_count_op(f, OP_SET_LOCAL_GET_LOCAL) != 1) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_buffer_length () {
+  wtjl_context_t *ctx = wtjl_new();
+  // only the first `length` bytes belong to the program
+  char *source = "var x <- 12;var y <- oops";
+  if (wtjl_eval(ctx, source, strlen("var x <- 12;")) != WTJL_OK || !_test_eval_integer(ctx, "x", 12)) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_errors () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *syntax = "var x <- ;";
+  char *undefined = "var y <- z + 1;";
+  char *division = "var f <- (a) -> 1 / a;\nf(0);";
+  char *arity = "f(1, 2);";
+  if (wtjl_eval(ctx, syntax, strlen(syntax)) != WTJL_ERROR_COMPILE) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_eval(ctx, undefined, strlen(undefined)) != WTJL_ERROR_RUNTIME) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_eval(ctx, division, strlen(division)) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), "division by zero") == NULL) {
+    TEST_FAIL;
+    return;
+  }
+  if (wtjl_eval(ctx, arity, strlen(arity)) != WTJL_ERROR_RUNTIME) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t result;
+  if (wtjl_call(ctx, "missing", 0, NULL, &result) != WTJL_ERROR_UNDEFINED) {
+    TEST_FAIL;
+    return;
+  }
+  // the context is still usable after failures
+  wtjl_value_t argument = wtjl_integer(4);
+  if (wtjl_call(ctx, "f", 1, &argument, &result) != WTJL_OK || result.as.integer != 0 || ctx->vm.stack_top != ctx->vm.stack) {
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+void test_eval_error_locations () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *sources [] = {
+    "var a <- 1;\nvar b <- ;\n",
+    "var f <- (x) -> {\n  var y;\n  var y;\n};",
+    "var c <- 1 $ 2;",
+    "var d <- (1 + 2;\n\n",
+    "var e <- \"abc;\nvar f <- 1;\"",
+    "var g <- 1; /* var h <- 2;",
+    "var i <- `a\\qb`;",
+    "var j <- 'ab';",
+  };
+  char *expected [] = {
+    "2:10: Parsing error",
+    "3:7: Compiling error",
+    "1:12: Tokenizing error",
+    "1:16: Parsing error",
+    "1:10: Tokenizing error; unterminated literal.",
+    "1:13: Tokenizing error; unterminated comment.",
+    "1:12: Tokenizing error; unknown escape.",
+    "1:10: Tokenizing error; character literals",
+  };
+  for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+    if (wtjl_eval(ctx, sources[i], strlen(sources[i])) != WTJL_ERROR_COMPILE || strncmp(wtjl_error(ctx), expected[i], strlen(expected[i])) != 0) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+// the member cache of the `index`th `::` site in global function `name`
+member_cache_t *_test_eval_cache (wtjl_context_t *ctx, char *name, size_t index) {
+  return &ctx->vm.globals[vm.find_global(ctx, name)].as.function->chunk.caches[index];
+}
+
+void test_eval_objects () {
+  wtjl_context_t *ctx = wtjl_new();
+  char *source =
+    "var point <- (x, y) -> {\n"
+    "  var p <- new;\n"
+    "  p::x <- x;\n"
+    "  p::y <- y;\n"
+    "  return p;\n"
+    "};\n"
+    "var norm <- (p) -> p::x * p::x + p::y * p::y;\n"
+    "var a <- point(3, 4);\n"
+    "var b <- point(6, 8);\n"
+    "var n <- norm(a) + norm(b);\n"
+    "a::x <- 0;\n"
+    "var m <- norm(a);\n"
+    "var c <- new;\n"
+    "c::y <- 1;\n"
+    "c::x <- 2;\n"
+    "c::next <- a;\n"
+    "var k <- norm(c) + c::next::y;\n"
+    "var same <- a = a;\n"
+    "var different <- a = b;\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "n", 125) || !_test_eval_integer(ctx, "m", 16) || !_test_eval_integer(ctx, "k", 9)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_value_t same;
+  wtjl_value_t different;
+  wtjl_get(ctx, "same", &same);
+  wtjl_get(ctx, "different", &different);
+  if (!same.as.boolean || different.as.boolean) {
+    TEST_FAIL;
+    return;
+  }
+  // points share one shape, so norm's sites saw two shapes: the points' and c's
+  shape_t *root = ctx->vm.root_shape;
+  member_cache_t *cache = _test_eval_cache(ctx, "norm", 0);
+  if (root->num_children != 2 || cache->num_shapes != 2 || cache->entries[0].shape != ctx->vm.objects[0]->shape || cache->entries[0].slot != 0 || cache->entries[1].slot != 1) {
+    TEST_FAIL;
+    return;
+  }
+  // adding a member moves an object along the tree, and the cache remembers where to
+  cache = _test_eval_cache(ctx, "point", 0);
+  if (cache->num_shapes != 1 || cache->entries[0].shape != root || cache->entries[0].next != root->children[0]) {
+    TEST_FAIL;
+    return;
+  }
+  // a site that has seen more shapes than it holds still finds members
+  source =
+    "var x_of <- (o) -> o::x;\n"
+    "var shaped <- (i) -> {\n"
+    "  var o <- new;\n"
+    "  if i > 0 {\n"
+    "    o::b <- 0;\n"
+    "  }\n"
+    "  if i > 1 {\n"
+    "    o::c <- 0;\n"
+    "  }\n"
+    "  if i > 2 {\n"
+    "    o::d <- 0;\n"
+    "  }\n"
+    "  if i > 3 {\n"
+    "    o::e <- 0;\n"
+    "  }\n"
+    "  if i > 4 {\n"
+    "    o::f <- 0;\n"
+    "  }\n"
+    "  o::x <- i;\n"
+    "  return x_of(o);\n"
+    "};\n"
+    "var sum_shaped <- (n) -> {\n"
+    "  var i <- 0;\n"
+    "  var total <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return total;\n"
+    "    }\n"
+    "    total <- total + shaped(i) + x_of(a);\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "var mega <- sum_shaped(6);\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "mega", 15) || _test_eval_cache(ctx, "x_of", 0)->num_shapes != MEMBER_CACHE_SHAPES) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  char *failing [] = {
+    "a::z;",
+    "var q <- 3;\nq::x <- 1;\n",
+    "var move <- (i) -> {\n  a::x <- i;\n  return i;\n};\niterate sum i in 0, 3 -> move(i);\n",
+    "var p as object <- 3;\n",
+  };
+  wtjl_status_t statuses [] = {WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_COMPILE};
+  char *errors [] = {"has no member \"z\"", "only objects have members", "objects are read only inside a parallel iterate", "holds an object, not an integer"};
+  for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+    if (wtjl_eval(ctx, failing[i], strlen(failing[i])) != statuses[i] || strstr(wtjl_error(ctx), errors[i]) == NULL) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+  }
+  // lanes may build objects of their own
+  source = "var built <- iterate sum i in 0, 1000 -> norm(point(i, 1));\n";
+  if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || !_test_eval_integer(ctx, "built", 332833500 + 1000)) {
+    printf("%s\n", wtjl_error(ctx));
+    TEST_FAIL;
+    return;
+  }
+  wtjl_destroy(ctx);
+  TEST_PASS;
+}
+
+// the same reductions on pools of several sizes; a sum of doubles depends on
+// the order of its additions, so it only matches if chunks are combined in order
+void test_eval_parallel () {
+  char *source =
+    "var square <- (x) -> x * x;\n"
+    "var squares <- iterate sum i in 0, 100000 -> square(i);\n"
+    "var harmonic <- iterate sum i in 0, 100000 -> 1 / (i + 1.0);\n"
+    "var lowest <- iterate min i in -5, 100 -> (i - 7) * (i - 7);\n"
+    "var highest <- iterate max i in 0, 10 -> i / 2.0;\n"
+    "var nested <- iterate sum i in 0, 100 -> iterate sum j in 0, i -> j;\n"
+    "var empty <- iterate sum i in 5, 5 -> i;\n"
+    "var large <- iterate sum i in 0, 100000 -> square(4000000000);\n"
+    "var larger <- iterate max i in 0, 100000 -> square(4000000000 * i);\n"
+    "var count <- 0;\n"
+    "var check <- (i) -> {\n"
+    "  if i = 30000 {\n"
+    "    return first;\n"
+    "  }\n"
+    "  if i = 70000 {\n"
+    "    return second;\n"
+    "  }\n"
+    "  return i;\n"
+    "};\n"
+    "var counted <- (i) -> {\n"
+    "  count <- count + 1;\n"
+    "  return i;\n"
+    "};\n";
+  char *failing [] = {
+    "iterate sum i in 0, 100000 -> check(i);",
+    "iterate sum i in 0, 10 -> counted(i);",
+    "iterate min i in 0, 0 -> i;",
+    "iterate sum i in 0, 10 -> \"i\";",
+    "iterate sum i in 0, 100000 -> 1 / (i - 50000);",
+    "iterate sum i in 0, 3.0 -> i;",
+    "iterate product i in 0, 10 -> i;",
+  };
+  wtjl_status_t statuses [] = {WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_RUNTIME, WTJL_ERROR_COMPILE};
+  // of two failing chunks the first is reported, whichever failed first
+  char *errors [] = {"\"first\" is not defined", "globals are read only inside a parallel iterate", "min of an empty range", "only numbers can be reduced", "division by zero", "range bounds must be integers", "unknown reduction \"product\""};
+  size_t threads = parallel_threads();
+  size_t counts [] = {1, 3, 8};
+  double harmonic = 0;
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    parallel_set_threads(counts[i]);
+    wtjl_context_t *ctx = wtjl_new();
+    wtjl_value_t value;
+    if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || wtjl_get(ctx, "harmonic", &value) != WTJL_OK || (i && value.as.number != harmonic)) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      return;
+    }
+    harmonic = value.as.number;
+    wtjl_get(ctx, "highest", &value);
+    if (!_test_eval_integer(ctx, "squares", 333328333350000) || !_test_eval_integer(ctx, "lowest", 0) || value.type != WTJL_DOUBLE || value.as.number != 4.5 || !_test_eval_integer(ctx, "nested", 161700) || !_test_eval_integer(ctx, "empty", 0)) {
+      TEST_FAIL;
+      return;
+    }
+    // sums past an int64, and bignums made on other threads, come back whole
+    wtjl_value_t large;
+    if (wtjl_get(ctx, "large", &large) != WTJL_OK || large.type != WTJL_BIG_INTEGER || strcmp(large.as.string.chars, "1600000000000000000000000") != 0 ||
+        wtjl_get(ctx, "larger", &value) != WTJL_OK || value.type != WTJL_BIG_INTEGER || strcmp(value.as.string.chars, "159996800016000000000000000000") != 0) {
+      TEST_FAIL;
+      return;
+    }
+    for (size_t j = 0; j < sizeof(failing) / sizeof(failing[0]); j++) {
+      if (wtjl_eval(ctx, failing[j], strlen(failing[j])) != statuses[j] || strstr(wtjl_error(ctx), errors[j]) == NULL) {
+        printf("%s\n", wtjl_error(ctx));
+        TEST_FAIL;
+        return;
+      }
+    }
+    if (!_test_eval_integer(ctx, "count", 0) || ctx->vm.stack_top != ctx->vm.stack) {
+      TEST_FAIL;
+      return;
+    }
+    wtjl_destroy(ctx);
+  }
+  parallel_set_threads(threads);
+  TEST_PASS;
+}
+
+void test_eval_arrays () {
+  char *source =
+    "var range <- (n) -> {\n"
+    "  var i <- 0;\n"
+    "  repeat {\n"
+    "    if i = n {\n"
+    "      return;\n"
+    "    }\n"
+    "    yield i;\n"
+    "    i <- i + 1;\n"
+    "  }\n"
+    "};\n"
+    "var a <- integers(1003);\n"
+    "var b <- bytes(1003);\n"
+    "var v <- array(1003);\n"
+    "iterate i over range(1003) {\n"
+    "  a[i] <- i * i - 5000;\n"
+    "  b[i] <- i - i / 256 * 256;\n"
+    "  v[i] <- i * i - 5000;\n"
+    "}\n"
+    "var sums <- sum(a) - sum(v) + sum(b);\n"
+    "var lows <- min(a) + max(a) + min(b) * 1000 + max(b);\n"
+    "var same <- equal(a, v);\n"
+    "var different <- equal(a, b);\n"
+    "var found <- find(a, 991004) + find(v, 991004) + find(b, 255) * 10000 + find(a, 1.5);\n"
+    "var counted <- count(b, 7) + count(a, -4999.0) * 100 + count(v, \"x\");\n"
+    "multiply(add(a, 3), -2);\n"
+    "var mapped <- a[1002] + a[0] + sum(b);\n"
+    "fill(b, 200);\n"
+    "var reduced <- iterate sum x in b -> x;\n"
+    "var big <- integers(8);\n"
+    "fill(big, 4611686018427387904);\n"
+    "iterate i over range(4) {\n"
+    "  big[i + 4] <- 1 - 4611686018427387904;\n"
+    "}\n"
+    "var total <- sum(big);\n"
+    "var overflowed <- sum(fill(big, 4611686018427387904));\n";
+  char *failing [] = {
+    "a[1003];",
+    "b[0] <- 256;",
+    "a[0] <- 1.5;",
+    "add(big, 4611686018427387904);",
+    "add(b, 100);",
+    "iterate sum x in b -> iterate sum y in 0, 1 -> fill(b, 1);",
+    "min(bytes(0));",
+    "sum(5);",
+    "iterate sum x in 5 -> x;",
+  };
+  char *errors [] = {"index 1003 is out of range for length 1003", "bytes hold integers from 0 to 255", "the array holds only integers", "the integer does not fit in 64 bits", "bytes hold integers from 0 to 255", "arrays are read only inside a parallel iterate unless it made them", "min of an empty array", "expects an array", "only arrays and ranges can be reduced"};
+  // every result must be the same with and without AVX2
+  bool avx2 = _arrays_avx2;
+  for (int run = 0; run < 2; run++) {
+    _arrays_avx2 = run ? false : avx2;
+    wtjl_context_t *ctx = wtjl_new();
+    wtjl_value_t same;
+    wtjl_value_t different;
+    if (wtjl_eval(ctx, source, strlen(source)) != WTJL_OK || wtjl_get(ctx, "same", &same) != WTJL_OK || wtjl_get(ctx, "different", &different) != WTJL_OK || !same.as.boolean || different.as.boolean) {
+      printf("%s\n", wtjl_error(ctx));
+      TEST_FAIL;
+      _arrays_avx2 = avx2;
+      return;
+    }
+    if (!_test_eval_integer(ctx, "sums", 125415) || !_test_eval_integer(ctx, "lows", 994259) || !_test_eval_integer(ctx, "found", 2551995) || !_test_eval_integer(ctx, "counted", 104) || !_test_eval_integer(ctx, "mapped", -1862605) || !_test_eval_integer(ctx, "reduced", 200 * 1003) || !_test_eval_integer(ctx, "total", 4) ||
+        wtjl_get(ctx, "overflowed", &same) != WTJL_OK || same.type != WTJL_BIG_INTEGER || strcmp(same.as.string.chars, "36893488147419103232") != 0) {
+      TEST_FAIL;
+      _arrays_avx2 = avx2;
+      return;
+    }
+    for (size_t j = 0; j < sizeof(failing) / sizeof(failing[0]); j++) {
+      if (wtjl_eval(ctx, failing[j], strlen(failing[j])) != WTJL_ERROR_RUNTIME || strstr(wtjl_error(ctx), errors[j]) == NULL) {
+        printf("%s\n", wtjl_error(ctx));
+        TEST_FAIL;
+        _arrays_avx2 = avx2;
+        return;
+      }
+    }
+    // failed fills and maps leave every element as it was
+    if (!_test_eval_integer(ctx, "reduced", 200 * 1003) || ctx->vm.arrays[1]->as.bytes[1002] != 200) {
+      TEST_FAIL;
+      _arrays_avx2 = avx2;
+      return;
+    }
+    wtjl_destroy(ctx);
+  }
+  _arrays_avx2 = avx2;
+  TEST_PASS;
+}
+
+void test_eval () {
+  TEST_SUITE;
+  test_eval_arithmetic();
+  test_eval_functions();
+  test_eval_closures();
+  test_eval_tail_calls();
+  test_eval_strings();
+  test_eval_ropes();
+  test_eval_cache();
+  test_eval_output();
+  test_eval_loader();
+  test_eval_memory();
+  test_eval_image();
+  test_eval_numbers();
+  test_eval_bignums();
+  test_eval_double_literals();
+  test_eval_if();
+  test_eval_comparisons();
+  test_eval_generators();
+  test_eval_parallel();
+  test_eval_objects();
+  test_eval_arrays();
+  test_eval_types();
+  test_eval_optimizer();
+  test_eval_superinstructions();
+  test_eval_buffer_length();
+  test_eval_errors();
+  test_eval_error_locations();
+}
+
+/* end test eval */
+
+/* ``begin test serve */
+
+void *_test_serve_poll (void *arg) {
+  _serve_poll(arg);
+  return NULL;
+}
+
+void test_serve_requests () {
+  char socket_name [64];
+  snprintf(socket_name, sizeof(socket_name), "/tmp/wtjl_test_%d.sock", (int) getpid());
+  _serve_t *serve = _serve_new(socket_name, 2, 0);
+  if (!serve) {
+    TEST_FAIL;
+    return;
+  }
+  pthread_t poller;
+  pthread_create(&poller, NULL, _test_serve_poll, serve);
+  int fd = _load_connect(socket_name);
+  // pipelined in one write: the same script twice, a broken one, a long
+  // result, an error quoting newlines, a missing file; each answer is
+  // still one line
+  char *requests =
+    "eval 33\nvar a <- 6;\nvar result <- a * 7;\n"
+    "eval 33\nvar a <- 6;\nvar result <- a * 7;\n"
+    "eval 10\nvar a <- ;"
+    "eval 26\nvar result <- 10 ** 1000;\n"
+    "eval 32\nvar a <- `one\ntwo` `three\nfour`;"
+    "run /nonexistent/wtjl\n";
+  char big [1005] = "ok 1";
+  memset(big + 4, '0', 1000);
+  big[1004] = '\0';
+  char *expected [] = { "ok 42", "ok 42", "error", big, "error", "error Failed to open file." };
+  bool passed = fd >= 0 && _serve_write(fd, requests, strlen(requests));
+  char line [SERVE_LINE_SIZE];
+  for (size_t i = 0; passed && i < sizeof(expected) / sizeof(expected[0]); i++) {
+    passed = _load_read_line(fd, line, sizeof(line)) && strncmp(line, expected[i], strlen(expected[i])) == 0;
+    passed = passed && (expected[i] != big || strcmp(line, big) == 0);
+    passed = passed && (i != 4 || strstr(line, "`three\\nfour`") != NULL);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  _serve_stop(serve);
+  pthread_join(poller, NULL);
+  size_t hits = serve->workers[0].hits + serve->workers[1].hits;
+  _serve_destroy(serve);
+  unlink(socket_name);
+  if (!passed || hits != 1) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
+void test_serve () {
+  TEST_SUITE;
+  test_serve_requests();
+}
+
+/* end test serve */
+
+/* ``begin test document */
+
+bool _test_document_token_same (token_t *a, token_t *b) {
+  if (!a || !b) {
+    return a == b;
+  }
+  return a->offset == b->offset && a->length == b->length && strcmp(a->representation, b->representation) == 0;
+}
+
+bool _test_document_node_same (node_t *a, node_t *b) {
+  if (!a || !b) {
+    return a == b;
+  }
+  if (a->type != b->type || a->num_children != b->num_children || !_test_document_token_same(a->token, b->token) || !_test_document_token_same(a->annotation, b->annotation)) {
+    return false;
+  }
+  for (size_t i = 0; i < a->num_children; i++) {
+    if (!_test_document_node_same(a->children[i], b->children[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// an incrementally edited document has to match one parsed from scratch
+bool _test_document_same (document_t *document) {
+  document_t *fresh = document_t_new();
+  document_t_edit(fresh, 0, 0, document->text, document->length);
+  document_t_settle(document);
+  document_t_settle(fresh);
+  tokenizer_state_t *a = &document->ctx->tokenizer;
+  tokenizer_state_t *b = &fresh->ctx->tokenizer;
+  bool same = a->tokens_size == b->tokens_size && document->num_statements == fresh->num_statements && document->num_errors == fresh->num_errors;
+  for (size_t i = 0; same && i < a->tokens_size; i++) {
+    same = _test_document_token_same(a->tokens[i], b->tokens[i]);
+  }
+  same = same && document->num_lines == fresh->num_lines && memcmp(document->line_starts, fresh->line_starts, document->num_lines * sizeof(uint32_t)) == 0;
+  for (size_t i = 0; same && i < document->num_statements; i++) {
+    document_statement_t *x = &document->statements[i];
+    document_statement_t *y = &fresh->statements[i];
+    same = x->first_token == y->first_token && x->num_tokens == y->num_tokens && x->error_offset == y->error_offset && (x->error ? y->error && strcmp(x->error, y->error) == 0 : !y->error) && _test_document_node_same(x->node, y->node);
+  }
+  document_t_destroy(fresh);
+  return same;
+}
+
+void _test_document_edit (document_t *document, size_t offset, size_t deleted, char *inserted) {
+  document_t_edit(document, offset, deleted, inserted, strlen(inserted));
+}
+
+void test_document_incremental () {
+  document_t *document = document_t_new();
+  _test_document_edit(document, 0, 0,
+    "var square <- (x) -> x * x;\n"
+    "var a <- square(3);\n"
+    "var b <- a + 1;\n");
+  if (document->num_statements != 3 || document->num_errors) {
+    TEST_FAIL;
+    return;
+  }
+  // inside one statement: only it is parsed again, and only the literal and
+  // the `(` it touches are lexed again
+  _test_document_edit(document, 44, 1, "12");
+  if (document->reparsed != 1 || document->relexed != 2 || !_test_document_same(document)) {
+    TEST_FAIL;
+    return;
+  }
+  struct { size_t offset; size_t deleted; char *inserted; } edits [] = {
+    {4, 0, "x"},                // grows an identifier
+    {0, 0, "var c <- 1;\n"},    // new statement before the rest
+    {12, 3, "va"},              // breaks a keyword
+    {12, 2, "var"},             // and restores it
+    {20, 0, "{ "},              // opens a block that swallows the rest
+    {20, 2, ""},                // and closes it again
+    {44, 1, "/"},               // changes an operator
+    {0, 12, ""},                // drops the first statement
+    {0, 0, "var d"},            // joins two statements
+    {0, 0, "/* "},              // opens a comment that swallows the rest
+    {3, 0, "*/ "},              // and closes it again
+    {0, 6, ""},
+    {0, 0, "var s <- \"/*\";\n"}, // a string holding a comment opener
+    {9, 1, ""},                 // which opens once its quote is gone
+    {9, 0, "`"},                // a backtick string running on to the next `
+    {0, 0, "// "},              // comments out a line
+  };
+  for (size_t i = 0; i < sizeof(edits) / sizeof(edits[0]); i++) {
+    _test_document_edit(document, edits[i].offset, edits[i].deleted, edits[i].inserted);
+    if (!_test_document_same(document)) {
+      printf("edit %d: \"%s\"\n", (int) i, document->text);
+      TEST_FAIL;
+      return;
+    }
+  }
+  document_t_destroy(document);
   TEST_PASS;
 }
 
-void test_ll_new_delete () {
-  ll_t *list = ll.new();
-  if (!list) {
+void test_document_diagnostics () {
+  document_t *document = document_t_new();
+  _test_document_edit(document, 0, 0,
+    "var a <- 1;\n"
+    "var b <- ;\n"
+    "var c <- a $ 2;\n"
+    "var d <- (1 + 2;\n");
+  size_t line;
+  size_t column;
+  document_t_position(document, document->statements[1].error_offset, &line, &column);
+  if (document->num_errors != 3 || document->num_statements != 4 || line != 2 || column != 10) {
     TEST_FAIL;
     return;
   }
-  ll.delete(list);
-  list = NULL;
+  // fixing the middle error leaves the others alone
+  _test_document_edit(document, 34, 1, "+");
+  if (document->num_errors != 2 || document->reparsed != 1 || !_test_document_same(document)) {
+    TEST_FAIL;
+    return;
+  }
+  document_t_destroy(document);
+  // the error for an unterminated comment quotes its lines, which stay on
+  // the diagnostic's one line
+  document = document_t_new();
+  _test_document_edit(document, 0, 0, "var a <- 1;\n/* x\\y\ny\n");
+  char *published;
+  size_t length;
+  FILE *out = open_memstream(&published, &length);
+  _lsp_publish(out, document, 0);
+  fclose(out);
+  size_t num_lines = 0;
+  for (size_t i = 0; i < length; i++) {
+    num_lines += published[i] == '\n';
+  }
+  if (document->num_errors != 1 || num_lines != 2 || strstr(published, "/* x\\\\y\\ny\\n") == NULL) {
+    printf("%s", published);
+    TEST_FAIL;
+    return;
+  }
+  (free)(published);
+  document_t_destroy(document);
   TEST_PASS;
 }
 
-void test_ll () {
+void test_document () {
   TEST_SUITE;
-  test_ll_new_delete();
-  test_ll_basic();
-  test_ll_iterate();
+  test_document_incremental();
+  test_document_diagnostics();
 }
 
-/* end test ll */
+/* end test document */
 
 /* ``begin test memory */
 
+// a tracker of its own, so the pools start empty and the thread's tracker
+// is left as it was
+void test_memory_pools () {
+  static j_mem_t mem;
+  j_mem_t *previous = j_mem_bind(&mem);
+  char *a = malloc(sizeof(_ll_item_t));
+  free(a);
+  char *b = malloc(sizeof(_ll_item_t) - 4);
+  if (b != a || mem.pools[_j_mem_class(sizeof(_ll_item_t))].carved != 1) {
+    printf("block not reused\n");
+    j_mem_bind(previous);
+    TEST_FAIL;
+    return;
+  }
+  // growing out of the pools and back keeps the bytes and the place in the list
+  char *c = malloc(8);
+  memcpy(c, "pooled!", 8);
+  c = realloc(c, 4 * J_MEM_POOL_MAX);
+  c = realloc(c, 8);
+  if (strcmp(c, "pooled!") != 0 || mem.list_head->ptr != b || mem.list_tail->ptr != c) {
+    printf("realloc lost its record\n");
+    j_mem_bind(previous);
+    TEST_FAIL;
+    return;
+  }
+  _mem_node_t *mark = j_mem_mark(&mem);
+  for (int i = 0; i < 10000; i++) {
+    malloc(16 * (i % J_MEM_POOL_CLASSES));
+  }
+  j_mem_release_since(&mem, mark);
+  size_t in_use = 0;
+  for (size_t class = 0; class < J_MEM_POOL_CLASSES; class++) {
+    in_use += mem.pools[class].in_use;
+  }
+  if (in_use != 2 || j_mem_size(&mem) != sizeof(_ll_item_t) - 4 + 8 || mem.num_slabs < 2) {
+    printf("%d blocks in use\n", (int) in_use);
+    j_mem_bind(previous);
+    TEST_FAIL;
+    return;
+  }
+  // sizes no record can be made for fail, counting nothing and moving nothing
+  char *d = malloc(4 * J_MEM_POOL_MAX);
+  size_t allocated = mem.total_alloc;
+  size_t freed = mem.total_free;
+  if (malloc(SIZE_MAX - 8) || realloc(c, SIZE_MAX - 8) || realloc(d, SIZE_MAX - 8) || mem.total_alloc != allocated || mem.total_free != freed || strcmp(c, "pooled!") != 0 || mem.list_tail->ptr != d) {
+    printf("impossible size allocated\n");
+    j_mem_bind(previous);
+    TEST_FAIL;
+    return;
+  }
+  j_mem_reset(&mem);
+  j_mem_bind(previous);
+  if (mem.slabs || mem.list_head || mem.pools[_j_mem_class(8)].in_use || mem.total_alloc != mem.total_free) {
+    TEST_FAIL;
+    return;
+  }
+  TEST_PASS;
+}
+
 void test_memory () {
   TEST_SUITE;
+  j_mem_t *mem = j_mem_current();
   if (J_MEM_DEBUG) {
-    printf("%d bytes not free'd\n", (int) (j_mem_size() - glbl_tests_mem_start));
+    printf("%d bytes not free'd\n", (int) (j_mem_size(mem) - glbl_tests_mem_start));
   }
-  printf("%d bytes malloc'd\n", (int) j_mem_total_alloc);
-  printf("%d bytes free'd\n", (int) j_mem_total_free);
-  if (j_mem_size() - glbl_tests_mem_start) {
+  printf("%d bytes malloc'd\n", (int) mem->total_alloc);
+  printf("%d bytes free'd\n", (int) mem->total_free);
+  if (j_mem_size(mem) - glbl_tests_mem_start) {
     TEST_FAIL;
   } else {
     TEST_PASS;
@@ -1333,45 +14374,1492 @@ void test_memory () {
 /* ``begin run_tests */
 
 void run_tests () {
-  glbl_tests_mem_start = j_mem_size();
-  j_mem_total_alloc = 0;
-  j_mem_total_free = 0;
+  j_mem_t *mem = j_mem_current();
+  glbl_tests_mem_start = j_mem_size(mem);
+  mem->total_alloc = 0;
+  mem->total_free = 0;
   TESTS_PRELUDE;
   test_ll();
+  test_context();
+  test_eval();
+  test_serve();
+  test_document();
+  test_memory_pools();
   test_memory();
   TESTS_RESULTS;
 }
 
 /* end run_tests */
 
+/* ``begin bench embed */
+
+#define BENCH_EMBED_ITERATIONS 20000
+#define BENCH_PROCESS_ITERATIONS 200
+
+char *_bench_embed_source =
+  "var square <- (x) -> x * x;\n"
+  "var hypotenuse_squared <- (a, b) -> square(a) + square(b);\n"
+  "var result <- hypotenuse_squared(3, 4) * 2 - 1;\n";
+
+double bench_now () {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+void bench_embed () {
+  BENCH_SUITE;
+  size_t length = strlen(_bench_embed_source);
+
+  double start = bench_now();
+  for (int i = 0; i < BENCH_EMBED_ITERATIONS; i++) {
+    wtjl_context_t *ctx = wtjl_new();
+    wtjl_eval(ctx, _bench_embed_source, length);
+    wtjl_destroy(ctx);
+  }
+  double embedded_cold = (bench_now() - start) / BENCH_EMBED_ITERATIONS;
+  BENCH_RESULT("embedded, new context per script", embedded_cold);
+
+  wtjl_context_t *ctx = wtjl_new();
+  start = bench_now();
+  for (int i = 0; i < BENCH_EMBED_ITERATIONS; i++) {
+    wtjl_eval(ctx, _bench_embed_source, length);
+  }
+  double embedded_warm = (bench_now() - start) / BENCH_EMBED_ITERATIONS;
+  wtjl_destroy(ctx);
+  BENCH_RESULT("embedded, reused context", embedded_warm);
+
+  // what a service pays today: write the script out, then spawn the interpreter on it
+  char file_name [] = "/tmp/wtjl_bench_XXXXXX";
+  int fd = mkstemp(file_name);
+  close(fd);
+  int null_fd = open("/dev/null", O_WRONLY);
+  start = bench_now();
+  for (int i = 0; i < BENCH_PROCESS_ITERATIONS; i++) {
+    fd = open(file_name, O_WRONLY | O_TRUNC);
+    if (write(fd, _bench_embed_source, length) != (ssize_t) length) {
+      printf(CLR(RED, "write failed\n"));
+    }
+    close(fd);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      dup2(null_fd, STDOUT_FILENO);
+      execl("/proc/self/exe", "wtjl", file_name, (char *) NULL);
+      _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+  }
+  double process = (bench_now() - start) / BENCH_PROCESS_ITERATIONS;
+  close(null_fd);
+  unlink(file_name);
+  BENCH_RESULT("process per script", process);
+  printf("embedded is %.0fx faster than process per script\n", process / embedded_cold);
+}
+
+/* end bench embed */
+
+/* ``begin bench document */
+
+#define BENCH_DOCUMENT_BYTES (4 << 20)
+#define BENCH_DOCUMENT_SITES 20
+#define BENCH_DOCUMENT_TYPED 10
+
+void bench_document () {
+  BENCH_SUITE;
+  size_t capacity = BENCH_DOCUMENT_BYTES + 256;
+  char *text = malloc(capacity);
+  size_t length = 0;
+  for (int i = 0; length < BENCH_DOCUMENT_BYTES; i++) {
+    length += snprintf(text + length, capacity - length,
+      "var f%d <- (a, b) -> {\n  var c <- a * b + %d;\n  return c - a;\n};\nvar r%d <- f%d(%d, 2) ** 2;\n", i, i, i, i, i);
+  }
+
+  document_t *document = document_t_new();
+  double start = bench_now();
+  document_t_edit(document, 0, 0, text, length);
+  double full = bench_now() - start;
+  printf("%.1f MB, %d tokens, %d statements\n", length / 1048576.0, (int) document->ctx->tokenizer.tokens_size, (int) document->num_statements);
+  BENCH_RESULT("document, open (full lex and parse)", full);
+
+  // typing a few characters somewhere in the file and deleting them again,
+  // then moving on to somewhere else
+  uint64_t seed = 88172645463325252ULL;
+  double total = 0;
+  double slowest = 0;
+  size_t relexed = 0;
+  size_t reparsed = 0;
+  size_t keystrokes = 0;
+  for (int i = 0; i < BENCH_DOCUMENT_SITES; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    size_t offset = seed % length;
+    for (int j = 0; j < BENCH_DOCUMENT_TYPED * 2; j++) {
+      start = bench_now();
+      if (j < BENCH_DOCUMENT_TYPED) {
+        document_t_edit(document, offset + j, 0, "1", 1);
+      } else {
+        document_t_edit(document, offset + BENCH_DOCUMENT_TYPED * 2 - j - 1, 1, "", 0);
+      }
+      double seconds = bench_now() - start;
+      total += seconds;
+      slowest = MAX(slowest, seconds);
+      relexed += document->relexed;
+      reparsed += document->reparsed;
+      keystrokes++;
+    }
+  }
+  BENCH_RESULT("document, keystroke (incremental)", total / keystrokes);
+  BENCH_RESULT("document, slowest keystroke", slowest);
+  printf("%.1f tokens lexed and %.1f statements parsed per keystroke\n", relexed / (double) keystrokes, reparsed / (double) keystrokes);
+  printf("a keystroke is %.0fx faster than a full parse\n", full / (total / keystrokes));
+  document_t_destroy(document);
+  free(text);
+}
+
+/* end bench document */
+
+/* ``begin bench lexing */
+
+#define BENCH_LEXING_BYTES (4 << 20)
+#define BENCH_LEXING_RUNS 5
+
+// best of a few runs over `text`, tokenized the way a program is
+void _bench_lexing_input (char *label, char *text, size_t length) {
+  wtjl_context_t *ctx = wtjl_context_t_new(0, NULL);
+  wtjl_context_t_enter(ctx);
+  double best = 0;
+  size_t num_tokens = 0;
+  for (int i = 0; i < BENCH_LEXING_RUNS; i++) {
+    double start = bench_now();
+    scanner.scan_buffer(ctx, text, length);
+    tokenizer.tokenize(ctx);
+    double seconds = bench_now() - start;
+    num_tokens = ctx->tokenizer.tokens_size;
+    tokenizer.cleanup(ctx);
+    scanner.cleanup(ctx);
+    best = i ? MIN(best, seconds) : seconds;
+  }
+  wtjl_context_t_leave(ctx);
+  wtjl_context_t_destroy(ctx);
+  char line [64];
+  snprintf(line, sizeof(line), "%s, per MB", label);
+  BENCH_RESULT(line, best / (length / 1048576.0));
+  printf("%.0f MB/s, %.2f ns per character, %d tokens\n", length / 1048576.0 / best, best * 1e9 / length, (int) num_tokens);
+}
+
+void bench_lexing () {
+  BENCH_SUITE;
+#ifdef STATIC_DISPATCH
+  printf("module members called directly\n");
+#else
+  printf("module members called through their tables\n");
+#endif
+  size_t capacity = BENCH_LEXING_BYTES + 512;
+  char *text = malloc(capacity);
+  size_t length = 0;
+  for (int i = 0; length < BENCH_LEXING_BYTES; i++) {
+    length += snprintf(text + length, capacity - length,
+      "var f%d <- (a, b) -> {\n  var c <- a * b + %d;\n  return c - a;\n};\nvar r%d <- f%d(%d, 2) ** 2;\n", i, i, i, i, i);
+  }
+  _bench_lexing_input("tokenize, code", text, length);
+
+  length = 0;
+  for (int i = 0; length < BENCH_LEXING_BYTES; i++) {
+    length += snprintf(text + length, capacity - length,
+      "var s%d <- \"the quick brown fox jumps over the lazy dog, again and again %d\" + `and a longer\nstring that runs across lines before it ends`;\n"
+      "var t%d <- \"one escape\\there\";\n", i, i, i);
+  }
+  _bench_lexing_input("tokenize, string heavy", text, length);
+
+  length = 0;
+  for (int i = 0; length < BENCH_LEXING_BYTES; i++) {
+    length += snprintf(text + length, capacity - length,
+      "// f%d multiplies its arguments; kept around for the comparisons below\n"
+      "/* the block comment goes on for a while, describing what the\n   function does and why it exists at all, %d */\n"
+      "var f%d <- (a, b) -> a * b; // trailing\n", i, i, i);
+  }
+  _bench_lexing_input("tokenize, comment heavy", text, length);
+
+  length = 0;
+  for (int i = 0; length < BENCH_LEXING_BYTES; i++) {
+    length += snprintf(text + length, capacity - length,
+      "var n%d <- 1234567890123456 + %d * 0x7fffffff - 0.001953125 * 31415926535.89793 + %de-3;\n", i, i * 7919, i);
+  }
+  _bench_lexing_input("tokenize, number heavy", text, length);
+  free(text);
+}
+
+/* end bench lexing */
+
+/* ``begin bench types */
+
+#define BENCH_TYPES_LINES 64
+#define BENCH_TYPES_OPERATIONS_PER_LINE 5
+#define BENCH_TYPES_CALLS 20000
+
+// a counter of the instructions the cpu retires in this thread, -1 where the
+// kernel does not allow one
+int _bench_types_counter_open () {
+  struct perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+int64_t _bench_types_counter_read (int counter) {
+  int64_t count = 0;
+  if (counter < 0 || read(counter, &count, sizeof(count)) != sizeof(count)) {
+    return -1;
+  }
+  return count;
+}
+
+// the same arithmetic with and without annotations; only the annotated one
+// compiles to the specialised instructions
+void _bench_types_input (char *label, char *annotation, char *three, wtjl_value_t x) {
+  size_t capacity = BENCH_TYPES_LINES * 64 + 256;
+  char *source = malloc(capacity);
+  size_t length = snprintf(source, capacity, "var step <- (x%s) -> {\n  var a%s <- x;\n", annotation, annotation);
+  for (int i = 0; i < BENCH_TYPES_LINES; i++) {
+    length += snprintf(source + length, capacity - length, "  a <- a * %s - a - a - a + x;\n", three);
+  }
+  snprintf(source + length, capacity - length, "  return a;\n};\n");
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, source, strlen(source));
+  free(source);
+  int counter = _bench_types_counter_open();
+  int64_t instructions = _bench_types_counter_read(counter);
+  double start = bench_now();
+  for (int i = 0; i < BENCH_TYPES_CALLS; i++) {
+    wtjl_call(ctx, "step", 1, &x, NULL);
+  }
+  double seconds = bench_now() - start;
+  instructions = _bench_types_counter_read(counter) - instructions;
+  if (counter >= 0) {
+    close(counter);
+  }
+  wtjl_destroy(ctx);
+  double operations = (double) BENCH_TYPES_CALLS * BENCH_TYPES_LINES * BENCH_TYPES_OPERATIONS_PER_LINE;
+  char line [64];
+  snprintf(line, sizeof(line), "%s, per operation", label);
+  BENCH_RESULT(line, seconds / operations);
+  if (counter >= 0) {
+    printf("%.2f ns, %.1f cpu instructions per operation\n", seconds * 1e9 / operations, instructions / operations);
+  } else {
+    printf("%.2f ns per operation, no cpu instruction counter available\n", seconds * 1e9 / operations);
+  }
+}
+
+void bench_types () {
+  BENCH_SUITE;
+  _bench_types_input("integers, untyped", "", "3", wtjl_integer(7));
+  _bench_types_input("integers, annotated", " as integer", "3", wtjl_integer(7));
+  _bench_types_input("doubles, untyped", "", "3.0", wtjl_double(7.5));
+  _bench_types_input("doubles, annotated", " as double", "3.0", wtjl_double(7.5));
+}
+
+/* end bench types */
+
+/* ``begin bench superinstructions */
+
+#define BENCH_SUPERINSTRUCTIONS_CALLS 10
+
+char *_bench_superinstructions_source =
+  "var sum_squares <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  var total <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + i * i;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var polynomial <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  var x <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return x;\n"
+  "    }\n"
+  "    x <- x * 3 - x - x - x + i;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var fibonacci <- (n) -> {\n"
+  "  if n < 2 {\n"
+  "    return n;\n"
+  "  }\n"
+  "  return fibonacci(n - 1) + fibonacci(n - 2);\n"
+  "};\n";
+
+// the same function compiled without and with superinstructions; a `make
+// profile-dispatch` build counts the instructions dispatched too
+void _bench_superinstructions_run (char *label, char *name, int64_t argument) {
+  for (int fused = 0; fused <= 1; fused++) {
+    wtjl_context_t *ctx = wtjl_new();
+    ctx->arguments->superinstructions = fused;
+    wtjl_eval(ctx, _bench_superinstructions_source, strlen(_bench_superinstructions_source));
+    wtjl_value_t n = wtjl_integer(argument);
+    int counter = _bench_types_counter_open();
+#ifdef VM_PROFILE
+    uint64_t dispatches = _vm_profile_dispatches;
+#endif
+    int64_t instructions = _bench_types_counter_read(counter);
+    double start = bench_now();
+    for (int i = 0; i < BENCH_SUPERINSTRUCTIONS_CALLS; i++) {
+      wtjl_call(ctx, name, 1, &n, NULL);
+    }
+    double seconds = bench_now() - start;
+    instructions = _bench_types_counter_read(counter) - instructions;
+    if (counter >= 0) {
+      close(counter);
+    }
+    wtjl_destroy(ctx);
+    char line [64];
+    snprintf(line, sizeof(line), "%s, %s, per call", label, fused ? "fused" : "unfused");
+    BENCH_RESULT(line, seconds / BENCH_SUPERINSTRUCTIONS_CALLS);
+    if (counter >= 0) {
+      printf("%.0f cpu instructions per call\n", (double) instructions / BENCH_SUPERINSTRUCTIONS_CALLS);
+    }
+#ifdef VM_PROFILE
+    printf("%.0f dispatches per call\n", (double) (_vm_profile_dispatches - dispatches) / BENCH_SUPERINSTRUCTIONS_CALLS);
+#endif
+  }
+}
+
+// a counting loop, untyped arithmetic like bench_types', and calls
+void bench_superinstructions () {
+  BENCH_SUITE;
+  _bench_superinstructions_run("sum of squares", "sum_squares", 100000);
+  _bench_superinstructions_run("polynomial", "polynomial", 100000);
+  _bench_superinstructions_run("fibonacci", "fibonacci", 20);
+}
+
+/* end bench superinstructions */
+
+/* ``begin bench generators */
+
+#define BENCH_GENERATORS_ELEMENTS 1000000
+
+char *_bench_generators_source =
+  "var identity <- (x) -> x;\n"
+  "var calls <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  var total <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + identity(i);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var count <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return;\n"
+  "    }\n"
+  "    yield i;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var yields <- (n) -> {\n"
+  "  var total <- 0;\n"
+  "  iterate x over count(n) {\n"
+  "    total <- total + x;\n"
+  "  }\n"
+  "  return total;\n"
+  "};\n"
+  "var doubled <- (source) -> {\n"
+  "  iterate x over source {\n"
+  "    yield x + x;\n"
+  "  }\n"
+  "};\n"
+  "var pipeline <- (n) -> {\n"
+  "  var total <- 0;\n"
+  "  iterate x over doubled(doubled(doubled(count(n)))) {\n"
+  "    total <- total + x;\n"
+  "  }\n"
+  "  return total;\n"
+  "};\n";
+
+// the same loop, once calling a function per element and once resuming a
+// generator per element
+void _bench_generators_run (wtjl_context_t *ctx, char *label, char *name) {
+  wtjl_value_t n = wtjl_integer(BENCH_GENERATORS_ELEMENTS);
+  size_t allocated = ctx->mem.total_alloc;
+  double start = bench_now();
+  wtjl_call(ctx, name, 1, &n, NULL);
+  double seconds = bench_now() - start;
+  BENCH_RESULT(label, seconds / BENCH_GENERATORS_ELEMENTS);
+  printf("%.1f ns per element, %d bytes allocated for %d elements\n", seconds * 1e9 / BENCH_GENERATORS_ELEMENTS, (int) (ctx->mem.total_alloc - allocated), BENCH_GENERATORS_ELEMENTS);
+}
+
+void bench_generators () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_generators_source, strlen(_bench_generators_source));
+  _bench_generators_run(ctx, "call per element", "calls");
+  _bench_generators_run(ctx, "resume per element", "yields");
+  _bench_generators_run(ctx, "four stage pipeline, per element", "pipeline");
+  wtjl_destroy(ctx);
+}
+
+/* end bench generators */
+
+/* ``begin bench closures */
+
+#define BENCH_CLOSURES_CALLS 1000000
+
+// the same running total kept four ways: in a local a direct function
+// assigns to, in a box an escaping closure carries, in a closure made for
+// every call, and, as it had to be before functions could capture, in an
+// object passed to a global function
+char *_bench_closures_source =
+  "var direct <- (n) -> {\n"
+  "  var total <- 0;\n"
+  "  var add <- (x) -> {\n"
+  "    total <- total + x;\n"
+  "  };\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    add(i);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var counter <- () -> {\n"
+  "  var total <- 0;\n"
+  "  return (x) -> {\n"
+  "    total <- total + x;\n"
+  "    return total;\n"
+  "  };\n"
+  "};\n"
+  "var escaping <- (n) -> {\n"
+  "  var add <- counter();\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return add(0);\n"
+  "    }\n"
+  "    add(i);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var adder <- (k) -> (x) -> x + k;\n"
+  "var made <- (n) -> {\n"
+  "  var total <- 0;\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- adder(i)(total);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var add_to <- (state, x) -> {\n"
+  "  state::total <- state::total + x;\n"
+  "};\n"
+  "var object <- (n) -> {\n"
+  "  var state <- new;\n"
+  "  state::total <- 0;\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return state::total;\n"
+  "    }\n"
+  "    add_to(state, i);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+void bench_closures () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_closures_source, strlen(_bench_closures_source));
+  char *names [] = {"direct", "escaping", "made", "object"};
+  char *labels [] = {"direct function, per call", "escaping closure, per call", "closure made per call, per call", "object and global, per call"};
+  wtjl_value_t n = wtjl_integer(BENCH_CLOSURES_CALLS);
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    size_t allocated = ctx->mem.total_alloc;
+    double start = bench_now();
+    wtjl_call(ctx, names[i], 1, &n, NULL);
+    BENCH_RESULT(labels[i], (bench_now() - start) / BENCH_CLOSURES_CALLS);
+    printf("%.1f bytes allocated per call\n", (double) (ctx->mem.total_alloc - allocated) / BENCH_CLOSURES_CALLS);
+  }
+  wtjl_destroy(ctx);
+}
+
+/* end bench closures */
+
+/* ``begin bench calls */
+
+#define BENCH_CALLS_CALLS 1000000
+
+// a call and its return, made from a loop; the same count of calls made as
+// tail calls, each replacing the frame before it; and as many calls nested
+// in each other, which grows the stack to hold them
+char *_bench_calls_source =
+  "var id <- (x) -> x;\n"
+  "var calls <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    i <- id(i) + 1;\n"
+  "  }\n"
+  "};\n"
+  "var tail <- (n) -> {\n"
+  "  if n = 0 {\n"
+  "    return 0;\n"
+  "  }\n"
+  "  return tail(n - 1);\n"
+  "};\n"
+  "var nested <- (n) -> {\n"
+  "  if n = 0 {\n"
+  "    return 0;\n"
+  "  }\n"
+  "  return nested(n - 1) + 1;\n"
+  "};\n";
+
+void bench_calls () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_calls_source, strlen(_bench_calls_source));
+  char *names [] = {"calls", "tail", "nested"};
+  char *labels [] = {"call and return, per call", "tail call, per call", "nested call, per call"};
+  wtjl_value_t n = wtjl_integer(BENCH_CALLS_CALLS);
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    size_t allocated = ctx->mem.total_alloc;
+    double start = bench_now();
+    wtjl_call(ctx, names[i], 1, &n, NULL);
+    BENCH_RESULT(labels[i], (bench_now() - start) / BENCH_CALLS_CALLS);
+    printf("room for %d frames, %d bytes allocated\n", (int) ctx->vm.frames_capacity, (int) (ctx->mem.total_alloc - allocated));
+  }
+  wtjl_destroy(ctx);
+}
+
+/* end bench calls */
+
+/* ``begin bench evals */
+
+#define BENCH_EVALS_EVALS 100000
+
+// a template evaluated over and over: the same string each time, found
+// without hashing; a string built each time with the same text, found by
+// its hash; and the same string with a budget of nothing, compiled every time
+char *_bench_evals_source =
+  "var total <- 0;\n"
+  "var same <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    eval(\"var row <- total * 2; total <- total + row - total - total + 1;\");\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var built <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    eval(\"var row <- total * 2; \" + \"total <- total + row - total - total + 1;\");\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+void bench_evals () {
+  BENCH_SUITE;
+  char *names [] = {"same", "built", "same"};
+  char *labels [] = {"cached, same string, per eval", "cached, built string, per eval", "compiled every time, per eval"};
+  size_t budgets [] = {EVALS_BUDGET, EVALS_BUDGET, 0};
+  wtjl_value_t n = wtjl_integer(BENCH_EVALS_EVALS);
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    wtjl_context_t *ctx = wtjl_new();
+    wtjl_eval(ctx, _bench_evals_source, strlen(_bench_evals_source));
+    ctx->evals.budget = budgets[i];
+    double start = bench_now();
+    wtjl_call(ctx, names[i], 1, &n, NULL);
+    BENCH_RESULT(labels[i], (bench_now() - start) / BENCH_EVALS_EVALS);
+    evals.report(ctx);
+    wtjl_destroy(ctx);
+  }
+}
+
+/* end bench evals */
+
+/* ``begin bench output */
+
+#define BENCH_OUTPUT_RECORDS 1000000
+
+char *_bench_output_source =
+  "var records <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return i;\n"
+  "    }\n"
+  "    print(i);\n"
+  "    print(\"record, twenty bytes\");\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+// reads the pipe dry until it is closed
+void *_bench_output_drain (void *fd) {
+  char buffer [1 << 16];
+  while (read(*(int *) fd, buffer, sizeof(buffer)) > 0) {
+  }
+  return NULL;
+}
+
+// `records` records printed to `fd`, interpreted and buffered, and the same
+// formatted and written one write per record, which is what an unbuffered
+// or line buffered print would cost
+void _bench_output_run (char *name, int fd) {
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_output_source, strlen(_bench_output_source));
+  output.redirect(ctx, fd);
+  wtjl_value_t n = wtjl_integer(BENCH_OUTPUT_RECORDS / 2);
+  double start = bench_now();
+  wtjl_call(ctx, "records", 1, &n, NULL);
+  output.flush(ctx);
+  double seconds = bench_now() - start;
+  char label [64];
+  snprintf(label, sizeof(label), "print to %s, per record", name);
+  BENCH_RESULT(label, seconds / BENCH_OUTPUT_RECORDS);
+  printf("%.1f million records a second in %d writes\n", BENCH_OUTPUT_RECORDS / seconds / 1e6, (int) ctx->output.writes);
+  wtjl_destroy(ctx);
+  start = bench_now();
+  for (int i = 0; i < BENCH_OUTPUT_RECORDS / 2; i++) {
+    char record [32];
+    int length = snprintf(record, sizeof(record), "%d\n", i);
+    write(fd, record, length);
+    write(fd, "record, twenty bytes\n", 21);
+  }
+  seconds = bench_now() - start;
+  snprintf(label, sizeof(label), "write per record to %s", name);
+  BENCH_RESULT(label, seconds / BENCH_OUTPUT_RECORDS);
+  printf("%.1f million records a second\n", BENCH_OUTPUT_RECORDS / seconds / 1e6);
+}
+
+void bench_output () {
+  BENCH_SUITE;
+  int null = open("/dev/null", O_WRONLY);
+  _bench_output_run("/dev/null", null);
+  close(null);
+  int fds [2];
+  if (pipe(fds) != 0) {
+    return;
+  }
+  pthread_t reader;
+  pthread_create(&reader, NULL, _bench_output_drain, &fds[0]);
+  _bench_output_run("a pipe", fds[1]);
+  close(fds[1]);
+  pthread_join(reader, NULL);
+  close(fds[0]);
+}
+
+/* end bench output */
+
+/* ``begin bench loader */
+
+#define BENCH_LOADER_FILES 1000
+#define BENCH_LOADER_FAN_OUT 10
+
+void _bench_loader_run (wtjl_context_t *ctx, _wtjl_call_t *call) {
+  loader.run(ctx, call->file_name);
+}
+
+void _bench_loader_path (char *path, size_t size, char *directory, int i) {
+  snprintf(path, size, "%s/m%d.wtjl", directory, i);
+}
+
+// a cold load drops every file from the page cache first, so the reads go to
+// the device; a warm one finds them all cached
+void _bench_loader_load (char *label, char *directory, loader_mode_t mode, bool cold) {
+  char path [256];
+  if (cold) {
+    for (int i = 0; i < BENCH_LOADER_FILES; i++) {
+      _bench_loader_path(path, sizeof(path), directory, i);
+      int fd = open(path, O_RDONLY);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+  }
+  wtjl_context_t *ctx = wtjl_new();
+  ctx->loader.mode = mode;
+  _bench_loader_path(path, sizeof(path), directory, 0);
+  _wtjl_call_t call = {0};
+  call.file_name = path;
+  double start = bench_now();
+  wtjl_status_t status = _wtjl_protect(ctx, _bench_loader_run, &call);
+  BENCH_RESULT(label, bench_now() - start);
+  if (status != WTJL_OK) {
+    printf("%s\n", wtjl_error(ctx));
+  }
+  printf("%d batches, %d submissions\n", (int) ctx->loader.batches, (int) ctx->loader.submissions);
+  wtjl_destroy(ctx);
+}
+
+// startup of a program of a thousand files, each importing the next ten, read
+// one at a time, by a pool of reader threads, and in io_uring batches
+void bench_loader () {
+  BENCH_SUITE;
+  char directory [] = "/tmp/wtjl_bench_loader_XXXXXX";
+  if (!mkdtemp(directory)) {
+    return;
+  }
+  char path [256];
+  for (int i = 0; i < BENCH_LOADER_FILES; i++) {
+    _bench_loader_path(path, sizeof(path), directory, i);
+    FILE *file = fopen(path, "w");
+    for (int j = i * BENCH_LOADER_FAN_OUT + 1; j <= (i + 1) * BENCH_LOADER_FAN_OUT && j < BENCH_LOADER_FILES; j++) {
+      fprintf(file, "import \"m%d.wtjl\";\n", j);
+    }
+    fprintf(file, "var f%d <- (x) -> {\n  var y <- x * %d;\n  if y > 1000 {\n    return y - 1000;\n  }\n  return y + 1;\n};\n", i, i);
+    fflush(file);
+    fsync(fileno(file));
+    fclose(file);
+  }
+  _bench_loader_load("sequential, cold", directory, LOADER_SEQUENTIAL, true);
+  _bench_loader_load("threaded, cold", directory, LOADER_THREADED, true);
+  _bench_loader_load("batched, cold", directory, LOADER_BATCHED, true);
+  _bench_loader_load("sequential, warm", directory, LOADER_SEQUENTIAL, false);
+  _bench_loader_load("threaded, warm", directory, LOADER_THREADED, false);
+  _bench_loader_load("batched, warm", directory, LOADER_BATCHED, false);
+  for (int i = 0; i < BENCH_LOADER_FILES; i++) {
+    _bench_loader_path(path, sizeof(path), directory, i);
+    unlink(path);
+  }
+  rmdir(directory);
+}
+
+/* end bench loader */
+
+/* ``begin bench image */
+
+#define BENCH_IMAGE_FUNCTIONS 2000
+#define BENCH_IMAGE_RUNS 10
+
+// a new context made ready to run, from the prelude's source or from its
+// image, and a call into it
+void _bench_image_start (char *label, char *source, char *bytes, size_t length, char *path) {
+  double seconds = 0;
+  for (int run = 0; run < BENCH_IMAGE_RUNS; run++) {
+    double start = bench_now();
+    wtjl_context_t *ctx = wtjl_new();
+    wtjl_status_t status = source ? wtjl_eval(ctx, source, strlen(source)) : bytes ? wtjl_load_image(ctx, bytes, length) : wtjl_load_image_file(ctx, path);
+    wtjl_value_t argument = wtjl_integer(3);
+    wtjl_value_t result;
+    if (status == WTJL_OK) {
+      status = wtjl_call(ctx, "f1999", 1, &argument, &result);
+    }
+    seconds += bench_now() - start;
+    if (status != WTJL_OK || result.as.integer != 3 * 1999 - 1000) {
+      printf("%s\n", wtjl_error(ctx));
+    }
+    wtjl_destroy(ctx);
+  }
+  BENCH_RESULT(label, seconds / BENCH_IMAGE_RUNS);
+}
+
+// starting from a prelude of two thousand functions, each with a string of
+// its own, and a table of them, compiled every time and loaded from an image
+void bench_image () {
+  BENCH_SUITE;
+  size_t capacity = BENCH_IMAGE_FUNCTIONS * 192;
+  char *source = malloc(capacity);
+  size_t length = 0;
+  for (int i = 0; i < BENCH_IMAGE_FUNCTIONS; i++) {
+    length += snprintf(source + length, capacity - length, "var f%d <- (x) -> {\n  var y <- x * %d;\n  if y > 1000 {\n    return y - 1000;\n  }\n  return length(\"function number %d of the prelude\") + y;\n};\n", i, i, i);
+  }
+  length += snprintf(source + length, capacity - length, "var table <- array(%d);\n", BENCH_IMAGE_FUNCTIONS);
+  for (int i = 0; i < BENCH_IMAGE_FUNCTIONS; i++) {
+    length += snprintf(source + length, capacity - length, "table[%d] <- f%d;\n", i, i);
+  }
+  char directory [] = "/tmp/wtjl_bench_image_XXXXXX";
+  if (!mkdtemp(directory)) {
+    free(source);
+    return;
+  }
+  char path [256];
+  snprintf(path, sizeof(path), "%s/prelude.image", directory);
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, source, length);
+  wtjl_save_image(ctx, path);
+  wtjl_destroy(ctx);
+  struct stat file_stat;
+  stat(path, &file_stat);
+  char *bytes = malloc(file_stat.st_size);
+  FILE *file = fopen(path, "rb");
+  size_t bytes_length = fread(bytes, 1, file_stat.st_size, file);
+  fclose(file);
+  printf("%d bytes of source, %d bytes of image\n", (int) length, (int) bytes_length);
+  _bench_image_start("compiling the prelude", source, NULL, 0, NULL);
+  _bench_image_start("loading its image from memory", NULL, bytes, bytes_length, NULL);
+  _bench_image_start("mapping its image", NULL, NULL, 0, path);
+  free(bytes);
+  free(source);
+  unlink(path);
+  rmdir(directory);
+}
+
+/* end bench image */
+
+/* ``begin bench memory */
+
+#define BENCH_MEMORY_OBJECTS 200000
+
+// objects made and dropped, each with a 78 byte string and an array
+char *_bench_memory_source =
+  "var churn <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  var total <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    var o <- new;\n"
+  "    o::s <- \"abcdefghijklmnopqrstuvwxyz\" + \"abcdefghijklmnopqrstuvwxyz\" + \"abcdefghijklmnopqrstuvwxyz\";\n"
+  "    o::a <- array(10);\n"
+  "    total <- total + length(o::a);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+void _bench_memory_churn (char *label, size_t soft_limit) {
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_memory_source, strlen(_bench_memory_source));
+  wtjl_limit_memory(ctx, soft_limit, 0);
+  wtjl_value_t n = wtjl_integer(BENCH_MEMORY_OBJECTS);
+  double start = bench_now();
+  wtjl_call(ctx, "churn", 1, &n, NULL);
+  BENCH_RESULT(label, (bench_now() - start) / BENCH_MEMORY_OBJECTS);
+  wtjl_memory_t memory;
+  wtjl_memory(ctx, &memory);
+  printf("%d bytes at peak, %d collections freeing %d bytes\n", (int) memory.peak, (int) memory.collections, (int) memory.collected);
+  wtjl_destroy(ctx);
+}
+
+// a loop making garbage with everything kept until the context goes, and
+// with soft limits that have it collected as it runs
+void bench_memory () {
+  BENCH_SUITE;
+  _bench_memory_churn("unlimited, per object", 0);
+  _bench_memory_churn("soft limit 16 MB, per object", 16 << 20);
+  _bench_memory_churn("soft limit 1 MB, per object", 1 << 20);
+}
+
+/* end bench memory */
+
+/* ``begin bench strings */
+
+#define BENCH_STRINGS_APPENDS 20000
+#define BENCH_STRINGS_SUBSTRINGS 1000000
+
+// append reads its result once at the end, so a rope is flattened inside the
+// timing; cut takes eight byte substrings at every offset
+char *_bench_strings_source =
+  "var append <- (n) -> {\n"
+  "  var s <- \"\";\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return s[0];\n"
+  "    }\n"
+  "    s <- s + \"ab\";\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var text <- \"\";\n"
+  "var cut <- (n) -> {\n"
+  "  var total <- 0;\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + substring(text, i, i + 8)[0];\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+void _bench_strings_report (char *label, double seconds, size_t allocated, size_t count) {
+  BENCH_RESULT(label, seconds / count);
+  printf("%d bytes allocated for %d\n", (int) allocated, (int) count);
+}
+
+// loop appends and substrings, interpreted, against what they cost with a
+// fresh copy per operation, which is how + worked before ropes and how
+// strcat and strndup would do it
+void bench_strings () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_strings_source, strlen(_bench_strings_source));
+  wtjl_value_t n = wtjl_integer(BENCH_STRINGS_APPENDS);
+  size_t allocated = ctx->mem.total_alloc;
+  double start = bench_now();
+  wtjl_call(ctx, "append", 1, &n, NULL);
+  _bench_strings_report("append, interpreted, per append", bench_now() - start, ctx->mem.total_alloc - allocated, BENCH_STRINGS_APPENDS);
+  char *s = (calloc)(1, 1);
+  size_t length = 0;
+  allocated = 0;
+  start = bench_now();
+  for (size_t i = 0; i < BENCH_STRINGS_APPENDS; i++) {
+    char *next = (malloc)(length + 3);
+    strcpy(next, s);
+    strcat(next, "ab");
+    (free)(s);
+    s = next;
+    length += 2;
+    allocated += length + 1;
+  }
+  _bench_strings_report("append, copying, per append", bench_now() - start, allocated, BENCH_STRINGS_APPENDS);
+  // the text to cut, set as a flat string
+  char *text = (malloc)(BENCH_STRINGS_SUBSTRINGS + 8);
+  memset(text, 'a', BENCH_STRINGS_SUBSTRINGS + 8);
+  wtjl_context_t_enter(ctx);
+  ctx->vm.globals[vm.find_global(ctx, "text")] = vm.string(ctx, text, BENCH_STRINGS_SUBSTRINGS + 8);
+  wtjl_context_t_leave(ctx);
+  n = wtjl_integer(BENCH_STRINGS_SUBSTRINGS);
+  allocated = ctx->mem.total_alloc;
+  start = bench_now();
+  wtjl_call(ctx, "cut", 1, &n, NULL);
+  _bench_strings_report("substring, interpreted, per substring", bench_now() - start, ctx->mem.total_alloc - allocated, BENCH_STRINGS_SUBSTRINGS);
+  value_t whole = ctx->vm.globals[vm.find_global(ctx, "text")];
+  volatile int64_t total = 0;
+  wtjl_context_t_enter(ctx);
+  allocated = ctx->mem.total_alloc;
+  start = bench_now();
+  for (size_t i = 0; i < BENCH_STRINGS_SUBSTRINGS; i++) {
+    value_t part = vm.substring(ctx, &whole, i, i + 8);
+    total += part.small[0];
+  }
+  wtjl_context_t_leave(ctx);
+  _bench_strings_report("substring, small string, per substring", bench_now() - start, ctx->mem.total_alloc - allocated, BENCH_STRINGS_SUBSTRINGS);
+  allocated = 0;
+  start = bench_now();
+  for (size_t i = 0; i < BENCH_STRINGS_SUBSTRINGS; i++) {
+    char *part = strndup(text + i, 8);
+    total += part[0];
+    (free)(part);
+    allocated += 9;
+  }
+  _bench_strings_report("substring, strndup, per substring", bench_now() - start, allocated, BENCH_STRINGS_SUBSTRINGS);
+  (free)(s);
+  (free)(text);
+  wtjl_destroy(ctx);
+}
+
+/* end bench strings */
+
+/* ``begin bench bignums */
+
+#define BENCH_BIGNUMS_ITERATIONS 3000000
+#define BENCH_BIGNUMS_DIGITS 10000
+
+// the loops' integers never leave an int64, so they time what checking for
+// overflow and bignum operands costs the common case
+char *_bench_bignums_source =
+  "var typed <- (n as integer) -> {\n"
+  "  var i as integer <- 0;\n"
+  "  var total as integer <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + i * 3 - 1;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var untyped <- (n) -> {\n"
+  "  var i <- 0;\n"
+  "  var total <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + i * 3 - 1;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n"
+  "var factorial <- (n as integer) -> {\n"
+  "  var result as integer <- 1;\n"
+  "  var i as integer <- 2;\n"
+  "  repeat {\n"
+  "    if i > n {\n"
+  "      return result;\n"
+  "    }\n"
+  "    result <- result * i;\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+// small integer loops, interpreted; Karatsuba against schoolbook products
+// of equal sized operands; and decimal conversion 19 digits per pass over
+// the limbs against one digit per pass
+void bench_bignums () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_bignums_source, strlen(_bench_bignums_source));
+  char *loops [] = {"typed", "untyped"};
+  char *labels [] = {"small integers, annotated, per iteration", "small integers, untyped, per iteration"};
+  wtjl_value_t n = wtjl_integer(BENCH_BIGNUMS_ITERATIONS);
+  for (int i = 0; i < 2; i++) {
+    double start = bench_now();
+    wtjl_call(ctx, loops[i], 1, &n, NULL);
+    BENCH_RESULT(labels[i], (bench_now() - start) / BENCH_BIGNUMS_ITERATIONS);
+  }
+  n = wtjl_integer(3000);
+  double start = bench_now();
+  wtjl_call(ctx, "factorial", 1, &n, NULL);
+  BENCH_RESULT("factorial(3000), interpreted", bench_now() - start);
+  wtjl_context_t_enter(ctx);
+  size_t sizes [] = {64, 256, 1024, 4096};
+  uint64_t seed = 88172645463325252ULL;
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    size_t limbs = sizes[i];
+    size_t repeats = MAX(1, ((size_t) 1 << 22) / (limbs * limbs));
+    uint64_t *a = malloc(4 * limbs * sizeof(uint64_t));
+    uint64_t *b = a + limbs;
+    uint64_t *out = b + limbs;
+    for (size_t j = 0; j < 2 * limbs; j++) {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      a[j] = seed;
+    }
+    char label [64];
+    start = bench_now();
+    for (size_t j = 0; j < repeats; j++) {
+      _bignums_multiply_limbs(a, limbs, b, limbs, out);
+    }
+    snprintf(label, sizeof(label), "multiply, %d limbs, Karatsuba", (int) limbs);
+    BENCH_RESULT(label, (bench_now() - start) / repeats);
+    start = bench_now();
+    for (size_t j = 0; j < repeats; j++) {
+      _bignums_multiply_schoolbook(a, limbs, b, limbs, out);
+    }
+    snprintf(label, sizeof(label), "multiply, %d limbs, schoolbook", (int) limbs);
+    BENCH_RESULT(label, (bench_now() - start) / repeats);
+    free(a);
+  }
+  char *digits = malloc(BENCH_BIGNUMS_DIGITS + 1);
+  for (size_t i = 0; i < BENCH_BIGNUMS_DIGITS; i++) {
+    digits[i] = (char) ('1' + i % 9);
+  }
+  start = bench_now();
+  bignum_t *x = bignums.from_decimal(digits, (size_t) BENCH_BIGNUMS_DIGITS);
+  BENCH_RESULT("from decimal, 10000 digits", bench_now() - start);
+  size_t length;
+  start = bench_now();
+  char *decimal = bignums.to_decimal(x, &length);
+  BENCH_RESULT("to decimal, 10000 digits, 19 per pass", bench_now() - start);
+  uint64_t *rest = malloc(x->length * sizeof(uint64_t));
+  memcpy(rest, x->limbs, x->length * sizeof(uint64_t));
+  start = bench_now();
+  for (size_t n = x->length, i = BENCH_BIGNUMS_DIGITS; n; n = _bignums_significant(rest, n)) {
+    unsigned __int128 remainder = 0;
+    for (size_t j = n; j > 0; j--) {
+      unsigned __int128 numerator = (remainder << 64) | rest[j - 1];
+      rest[j - 1] = (uint64_t) (numerator / 10);
+      remainder = numerator % 10;
+    }
+    digits[--i] = (char) ('0' + remainder);
+  }
+  BENCH_RESULT("to decimal, 10000 digits, 1 per pass", bench_now() - start);
+  free(rest);
+  free(decimal);
+  free(digits);
+  free(x);
+  wtjl_context_t_leave(ctx);
+  wtjl_destroy(ctx);
+}
+
+/* end bench bignums */
+
+/* ``begin bench objects */
+
+#define BENCH_OBJECTS_ACCESSES 1000000
+#define BENCH_OBJECTS_SHAPES 8
+
+// eight objects, each with a different member ahead of x and y so no two
+// share a shape; the one `::` site in x_of sees whichever are passed in
+char *_bench_objects_source =
+  "var make <- (k) -> {\n"
+  "  var o <- new;\n"
+  "  if k = 0 {\n    o::a <- 0;\n  }\n"
+  "  if k = 1 {\n    o::b <- 0;\n  }\n"
+  "  if k = 2 {\n    o::c <- 0;\n  }\n"
+  "  if k = 3 {\n    o::d <- 0;\n  }\n"
+  "  if k = 4 {\n    o::e <- 0;\n  }\n"
+  "  if k = 5 {\n    o::f <- 0;\n  }\n"
+  "  if k = 6 {\n    o::g <- 0;\n  }\n"
+  "  if k = 7 {\n    o::h <- 0;\n  }\n"
+  "  o::x <- k;\n"
+  "  o::y <- 0;\n"
+  "  return o;\n"
+  "};\n"
+  "var o0 <- make(0);\nvar o1 <- make(1);\nvar o2 <- make(2);\nvar o3 <- make(3);\n"
+  "var o4 <- make(4);\nvar o5 <- make(5);\nvar o6 <- make(6);\nvar o7 <- make(7);\n"
+  "var x_of <- (o) -> o::x;\n"
+  "var sum_x <- (a, b, c, d, e, f, g, h, n) -> {\n"
+  "  var total <- 0;\n"
+  "  var i <- 0;\n"
+  "  repeat {\n"
+  "    if i = n {\n"
+  "      return total;\n"
+  "    }\n"
+  "    total <- total + x_of(a) + x_of(b) + x_of(c) + x_of(d) + x_of(e) + x_of(f) + x_of(g) + x_of(h);\n"
+  "    i <- i + 1;\n"
+  "  }\n"
+  "};\n";
+
+// the obvious object model, to compare with: each object a table of its own
+// from names to values, open addressed and probed from the name's hash
+typedef struct _bench_objects_map_t {
+  const char *names [16];
+  value_t values [16];
+} _bench_objects_map_t;
+
+value_t *_bench_objects_map_find (_bench_objects_map_t *map, const char *name, bool add) {
+  uint32_t hash = 2166136261u;
+  for (const char *c = name; *c; c++) {
+    hash = (hash ^ (unsigned char) *c) * 16777619u;
+  }
+  size_t i = hash % 16;
+  while (map->names[i] && strcmp(map->names[i], name) != 0) {
+    i = (i + 1) % 16;
+  }
+  if (!map->names[i] && add) {
+    map->names[i] = name;
+  }
+  return map->names[i] ? &map->values[i] : NULL;
+}
+
+// each run compiles afresh, so x_of starts with an empty cache
+void _bench_objects_run (wtjl_context_t *ctx, char *label, char **names) {
+  wtjl_eval(ctx, _bench_objects_source, strlen(_bench_objects_source));
+  wtjl_value_t arguments [BENCH_OBJECTS_SHAPES + 1];
+  for (size_t i = 0; i < BENCH_OBJECTS_SHAPES; i++) {
+    wtjl_get(ctx, names[i], &arguments[i]);
+  }
+  arguments[BENCH_OBJECTS_SHAPES] = wtjl_integer(BENCH_OBJECTS_ACCESSES / BENCH_OBJECTS_SHAPES);
+  double start = bench_now();
+  wtjl_call(ctx, "sum_x", BENCH_OBJECTS_SHAPES + 1, arguments, NULL);
+  BENCH_RESULT(label, (bench_now() - start) / BENCH_OBJECTS_ACCESSES);
+}
+
+// `::` in the interpreter as sites see more shapes, then the lookup alone: a
+// cache hit, the walk up the shape tree a miss takes, and a hash map
+void bench_objects () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  char *one [] = {"o0", "o0", "o0", "o0", "o0", "o0", "o0", "o0"};
+  char *four [] = {"o0", "o1", "o2", "o3", "o0", "o1", "o2", "o3"};
+  char *eight [] = {"o0", "o1", "o2", "o3", "o4", "o5", "o6", "o7"};
+  _bench_objects_run(ctx, "interpreted, 1 shape at the site", one);
+  _bench_objects_run(ctx, "interpreted, 4 shapes at the site", four);
+  _bench_objects_run(ctx, "interpreted, 8 shapes at the site", eight);
+  object_t *objects [BENCH_OBJECTS_SHAPES];
+  _bench_objects_map_t maps [BENCH_OBJECTS_SHAPES];
+  memset(maps, 0, sizeof(maps));
+  char *members [] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+  for (size_t i = 0; i < BENCH_OBJECTS_SHAPES; i++) {
+    objects[i] = ctx->vm.globals[vm.find_global(ctx, eight[i])].as.object;
+    _bench_objects_map_find(&maps[i], members[i], true)->type = VALUE_INTEGER;
+    *_bench_objects_map_find(&maps[i], "x", true) = objects[i]->slots[_vm_shape_slot(objects[i]->shape, "x")];
+    _bench_objects_map_find(&maps[i], "y", true)->type = VALUE_INTEGER;
+  }
+  member_cache_t cache = {"x", 0};
+  for (size_t i = 0; i < BENCH_OBJECTS_SHAPES / 2; i++) {
+    _vm_cache_add(ctx, &cache, objects[i]->shape, objects[i]->shape, _vm_shape_slot(objects[i]->shape, "x"));
+  }
+  volatile int64_t total = 0;
+  double start = bench_now();
+  for (size_t i = 0; i < BENCH_OBJECTS_ACCESSES; i++) {
+    object_t *object = objects[i % (BENCH_OBJECTS_SHAPES / 2)];
+    size_t j = 0;
+    while (cache.entries[j].shape != object->shape) {
+      j++;
+    }
+    total += object->slots[cache.entries[j].slot].as.integer;
+  }
+  BENCH_RESULT("lookup, cache hit among 4 shapes", (bench_now() - start) / BENCH_OBJECTS_ACCESSES);
+  start = bench_now();
+  for (size_t i = 0; i < BENCH_OBJECTS_ACCESSES; i++) {
+    object_t *object = objects[i % BENCH_OBJECTS_SHAPES];
+    total += object->slots[_vm_shape_slot(object->shape, "x")].as.integer;
+  }
+  BENCH_RESULT("lookup, shape walk", (bench_now() - start) / BENCH_OBJECTS_ACCESSES);
+  start = bench_now();
+  for (size_t i = 0; i < BENCH_OBJECTS_ACCESSES; i++) {
+    total += _bench_objects_map_find(&maps[i % BENCH_OBJECTS_SHAPES], "x", false)->as.integer;
+  }
+  BENCH_RESULT("lookup, hash map", (bench_now() - start) / BENCH_OBJECTS_ACCESSES);
+  wtjl_destroy(ctx);
+}
+
+/* end bench objects */
+
+/* ``begin bench arrays */
+
+#define BENCH_ARRAYS_ELEMENTS 1000000
+#define BENCH_ARRAYS_CALLS 20
+
+char *_bench_arrays_source =
+  "var a <- fill(integers(1000000), 1);\n"
+  "var b <- fill(bytes(1000000), 1);\n"
+  "var v <- fill(array(1000000), 1);\n";
+
+// the builtins over packed arrays with and without AVX2, and over an array of
+// values, which is what a program without packed arrays would be left with;
+// every search misses, so each call sees every element
+void bench_arrays () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_arrays_source, strlen(_bench_arrays_source));
+  char *builtins [] = {"sum", "max", "find", "count", "add"};
+  char *arrays [] = {"a", "b", "v"};
+  char *kinds [] = {"integers", "bytes", "values"};
+  bool avx2 = _arrays_avx2;
+  for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+    for (size_t j = 0; j < 5; j++) {
+      // integers and bytes with AVX2, then without, then values
+      if (j < 2 && !avx2) {
+        continue;
+      }
+      _arrays_avx2 = j < 2;
+      wtjl_value_t arguments [2];
+      wtjl_get(ctx, arrays[j == 4 ? 2 : j % 2], &arguments[0]);
+      arguments[1] = wtjl_integer(strcmp(builtins[i], "add") == 0 ? 0 : 2);
+      double start = bench_now();
+      for (size_t k = 0; k < BENCH_ARRAYS_CALLS; k++) {
+        wtjl_call(ctx, builtins[i], strcmp(builtins[i], "sum") == 0 || strcmp(builtins[i], "max") == 0 ? 1 : 2, arguments, NULL);
+      }
+      char label [64];
+      snprintf(label, sizeof(label), "%s, %s%s, per 1000", builtins[i], kinds[j == 4 ? 2 : j % 2], j < 2 ? ", AVX2" : "");
+      BENCH_RESULT(label, (bench_now() - start) / BENCH_ARRAYS_CALLS / BENCH_ARRAYS_ELEMENTS * 1000);
+    }
+  }
+  _arrays_avx2 = avx2;
+  wtjl_destroy(ctx);
+}
+
+/* end bench arrays */
+
+/* ``begin bench parallel */
+
+#define BENCH_PARALLEL_ELEMENTS 2000000
+
+char *_bench_parallel_source =
+  "var f <- (x) -> x * x - 3 * x + 1;\n"
+  "var total <- (n) -> iterate sum i in 0, n -> f(i);\n";
+
+// one reduction on pools of 1 to 64 threads; the time per element only
+// falls while there are cores to run the extra threads
+void bench_parallel () {
+  BENCH_SUITE;
+  wtjl_context_t *ctx = wtjl_new();
+  wtjl_eval(ctx, _bench_parallel_source, strlen(_bench_parallel_source));
+  size_t threads = parallel_threads();
+  double single = 0;
+  for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    parallel_set_threads(num_threads);
+    wtjl_value_t n = wtjl_integer(BENCH_PARALLEL_ELEMENTS);
+    double start = bench_now();
+    wtjl_call(ctx, "total", 1, &n, NULL);
+    double seconds = bench_now() - start;
+    single = num_threads == 1 ? seconds : single;
+    char label [64];
+    snprintf(label, sizeof(label), "%d threads, per element", (int) num_threads);
+    BENCH_RESULT(label, seconds / BENCH_PARALLEL_ELEMENTS);
+    printf("%.2fx the speed of one thread, %d cores online\n", single / seconds, (int) sysconf(_SC_NPROCESSORS_ONLN));
+  }
+  parallel_set_threads(threads);
+  wtjl_destroy(ctx);
+}
+
+/* end bench parallel */
+
+/* ``begin bench pools */
+
+#define BENCH_POOLS_LIVE 4096
+#define BENCH_POOLS_CHURN 4000000
+
+// replaces allocations at random in a window of live ones, with the sizes of
+// list items, tokens and other small runtime objects; the system allocator
+// runs the same churn, with and without room for a record
+double _bench_pools_churn (bool tracked, size_t extra) {
+  static void *live [BENCH_POOLS_LIVE];
+  size_t sizes [] = {sizeof(_ll_item_t), sizeof(token_t), 32, 64, 120, 200};
+  uint32_t seed = 1;
+  double start = bench_now();
+  for (size_t i = 0; i < BENCH_POOLS_CHURN + BENCH_POOLS_LIVE; i++) {
+    seed = seed * 1664525 + 1013904223;
+    size_t slot = i < BENCH_POOLS_LIVE ? i : (seed >> 8) % BENCH_POOLS_LIVE;
+    size_t size = sizes[(seed >> 24) % (sizeof(sizes) / sizeof(sizes[0]))];
+    if (i >= BENCH_POOLS_LIVE) {
+      tracked ? free(live[slot]) : (free)(live[slot]);
+    }
+    live[slot] = tracked ? malloc(size) : (malloc)(size + extra);
+  }
+  for (size_t slot = 0; slot < BENCH_POOLS_LIVE; slot++) {
+    tracked ? free(live[slot]) : (free)(live[slot]);
+  }
+  return bench_now() - start;
+}
+
+void bench_pools () {
+  BENCH_SUITE;
+  static j_mem_t mem;
+  j_mem_t *previous = j_mem_bind(&mem);
+  BENCH_RESULT("pools, per malloc and free", _bench_pools_churn(true, 0) / BENCH_POOLS_CHURN);
+  // limits that are never reached cost one compare
+  j_mem_limit(&mem, SIZE_MAX / 2, SIZE_MAX / 2);
+  BENCH_RESULT("pools, limited, per malloc and free", _bench_pools_churn(true, 0) / BENCH_POOLS_CHURN);
+  j_mem_limit(&mem, 0, 0);
+  BENCH_RESULT("glibc with a record, per malloc and free", _bench_pools_churn(false, sizeof(_mem_node_t)) / BENCH_POOLS_CHURN);
+  BENCH_RESULT("glibc, per malloc and free", _bench_pools_churn(false, 0) / BENCH_POOLS_CHURN);
+  j_mem_report(&mem);
+  j_mem_reset(&mem);
+  j_mem_bind(previous);
+}
+
+/* end bench pools */
+
+/* ``begin run_benches */
+
+void run_benches () {
+  BENCHES_PRELUDE;
+  bench_embed();
+  bench_document();
+  bench_lexing();
+  bench_types();
+  bench_superinstructions();
+  bench_generators();
+  bench_closures();
+  bench_calls();
+  bench_evals();
+  bench_output();
+  bench_loader();
+  bench_memory();
+  bench_image();
+  bench_strings();
+  bench_bignums();
+  bench_objects();
+  bench_arrays();
+  bench_parallel();
+  bench_pools();
+#ifdef VM_PROFILE
+  printf("\n");
+  vm_profile_report(VM_PROFILE_PAIRS, VM_PROFILE_TRIPLES);
+#endif
+}
+
+/* end run_benches */
+
 /* ``begin main */
 
+#ifndef WTJL_LIBRARY
+
+// `make embed IMAGE=<file>` builds the image into the binary, which starts
+// every program from it unless given --image
+#ifdef WTJL_EMBED_IMAGE
+__asm__(
+  ".section .rodata\n"
+  ".balign 16\n"
+  "_wtjl_embedded_image:\n"
+  ".incbin \"" WTJL_EMBED_IMAGE "\"\n"
+  "_wtjl_embedded_image_end:\n"
+  ".previous\n"
+);
+extern const char _wtjl_embedded_image [];
+extern const char _wtjl_embedded_image_end [];
+#endif
+
 int main (int argc, char **argv) {
-  SETUP_MODULE(ll);
-  glbl_arguments = arguments_t_parse_arguments(argc, argv);
-  if (!glbl_arguments->valid) {
-    if (glbl_arguments->difference_from_correct < 0) {
+  wtjl_context_t *ctx = wtjl_context_t_new(argc, argv);
+  if (!ctx->arguments->valid) {
+    if (ctx->arguments->difference_from_correct < 0) {
       fprintf(stderr, "Too few arguments\n");
     }
-    if (glbl_arguments->difference_from_correct > 0) {
+    if (ctx->arguments->difference_from_correct > 0) {
       fprintf(stderr, "Too many arguments\n");
     }
-    printf("usage: ./wtjl <filename> OR ./wtjl --test\n");
+    printf("usage: ./wtjl [-O] [--output-fd <fd>] [--memory-limit <bytes>] [--image <file>] [--save-image <file>] <filename> OR ./wtjl --test OR ./wtjl --bench OR ./wtjl [--memory-limit <bytes>] --serve <socket> OR ./wtjl --load <socket> OR ./wtjl --lsp\n");
     exit(1);
   }
-  if (glbl_arguments->test) {
+  if (ctx->arguments->test) {
+    wtjl_context_t_destroy(ctx);
     run_tests();
     exit(0);
   }
-  SETUP_MODULE(scanner)
-  SETUP_MODULE(tokenizer)
-  SETUP_MODULE(parser)
-  begin();
-  cleanup();
-  printf(CLR_YEL "%d bytes still allocated\n" CLR_NRM, (int) j_mem_size());
+  if (ctx->arguments->bench) {
+    wtjl_context_t_destroy(ctx);
+    run_benches();
+    exit(0);
+  }
+  if (ctx->arguments->lsp) {
+    wtjl_context_t_destroy(ctx);
+    lsp();
+    exit(0);
+  }
+  if (ctx->arguments->serve || ctx->arguments->load) {
+    char *socket_name = strdup(ctx->arguments->socket_name);
+    bool is_serve = ctx->arguments->serve;
+    size_t memory_limit = ctx->arguments->memory_limit;
+    wtjl_context_t_destroy(ctx);
+    if (is_serve) {
+      serve(socket_name, memory_limit);
+    } else {
+      load(socket_name);
+    }
+    free(socket_name);
+    exit(0);
+  }
+  wtjl_context_t_enter(ctx);
+  if (ctx->arguments->image_name) {
+    image.load_file(ctx, ctx->arguments->image_name);
+  }
+#ifdef WTJL_EMBED_IMAGE
+  else {
+    image.load(ctx, _wtjl_embedded_image, (size_t) (_wtjl_embedded_image_end - _wtjl_embedded_image));
+  }
+#endif
+  begin(ctx);
+#ifdef VM_PROFILE
+  vm_profile_report(VM_PROFILE_PAIRS, VM_PROFILE_TRIPLES);
+#endif
+  if (ctx->arguments->save_image_name) {
+    image.save(ctx, ctx->arguments->save_image_name);
+  }
+  wtjl_context_t_cleanup_modules(ctx);
+  printf(CLR_YEL "%d bytes still allocated\n" CLR_NRM, (int) j_mem_size(&ctx->mem));
+  wtjl_context_t_leave(ctx);
+  wtjl_context_t_destroy(ctx);
   return 0;
 }
 
+#endif
+
 /* end main */
 
 /********************/
@@ -4,11 +4,12 @@ if exists ("b:current_syntax")
   finish
 endif
 
-syn keyword keywords iterate repeat while for as in over unless until if value of then else else var var new new eval eval;
+syn keyword keywords iterate repeat while for as in over unless until if value of then else else var var new new eval eval yield import;
 syn keyword types type expression function array boolean void scope integer string byte tuple tuple;
 syn keyword booleans true false false;
 
 syn match comments "\/\/.*$"
+syn region comments start="\/\*" end="\*\/"
 syn match operators /+/
 syn match operators /-/
 syn match operators /<\~/
@@ -25,9 +26,9 @@ syn match paren_l /(/
 syn match paren_r /)/
 
 
-syn region strings_d start=/\"/ skip=/\\./ end=/\"/
+syn region strings_d start=/\"/ skip=/\\./ end=/\"/ oneline
 syn region strings_b start=/\`/ skip=/\\./ end=/\`/
-syn region strings_s start=/\'/ skip=/\\./ end=/\'/
+syn region strings_s start=/\'/ skip=/\\./ end=/\'/ oneline
 " syn region blocks start="{" end="}" fold transparent
 
 hi def link keywords Keyword
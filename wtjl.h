@@ -0,0 +1,178 @@
+/********************/
+/********************/
+/*   wtjl library   */
+/********************/
+/********************/
+/**(C)2018AlexKizer**/
+/********************/
+/********************/
+
+/*
+ * Embedding interface for libwtjl.
+ *
+ * A context is a complete, independent interpreter. Contexts share no state,
+ * so separate contexts may be used from separate threads; a single context
+ * must only be used by one thread at a time.
+ *
+ * Source buffers passed to wtjl_eval are read in place and never copied; they
+ * only need to stay valid for the duration of the call.
+ *
+ * Values a call hands back, the strings they point to included, are only
+ * kept until the next call on the same context, though that call may take
+ * them as arguments; anything needed for longer belongs in a global.
+ */
+
+#ifndef WTJL_H
+#define WTJL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+  #define WTJL_API __attribute__((visibility("default")))
+#else
+  #define WTJL_API
+#endif
+
+typedef struct wtjl_context_t wtjl_context_t;
+
+typedef enum wtjl_status_t {
+  WTJL_OK = 0,
+  WTJL_ERROR_IO,
+  WTJL_ERROR_COMPILE,
+  WTJL_ERROR_RUNTIME,
+  WTJL_ERROR_UNDEFINED,
+  WTJL_ERROR_MEMORY // past the hard limit; the context fails every call after it and should be destroyed
+} wtjl_status_t;
+
+typedef enum wtjl_type_t {
+  WTJL_VOID,
+  WTJL_INTEGER,
+  WTJL_FUNCTION,
+  WTJL_STRING,
+  WTJL_DOUBLE,
+  WTJL_BOOLEAN,
+  WTJL_GENERATOR,
+  WTJL_OBJECT,
+  WTJL_ARRAY,
+  WTJL_BIG_INTEGER // too large for int64_t; as.string holds its decimal digits, after a - when negative
+} wtjl_type_t;
+
+typedef struct wtjl_value_t {
+  wtjl_type_t type;
+  union {
+    int64_t integer;
+    double number;
+    int boolean;
+    void *function; // opaque, only meaningful to the context it came from
+    void *generator; // opaque, like function
+    void *object; // opaque, like function
+    void *array; // opaque, like function
+    struct {
+      const char *chars; // NUL terminated, owned by the context and valid until its next call
+      size_t length;
+    } string;
+  } as;
+} wtjl_value_t;
+
+// what a context's memory is charged to, by the part of it that allocated it
+typedef enum wtjl_module_t {
+  WTJL_MODULE_CONTEXT, // anything not charged to one of the others
+  WTJL_MODULE_SCANNER, // source files
+  WTJL_MODULE_TOKENIZER,
+  WTJL_MODULE_PARSER,
+  WTJL_MODULE_OPTIMIZER,
+  WTJL_MODULE_COMPILER, // compiled code and its constants
+  WTJL_MODULE_VM, // the stacks, globals, and every value a program makes
+  WTJL_MODULE_EVALS, // the eval cache, apart from the code in it
+  WTJL_MODULE_OUTPUT,
+  WTJL_MODULE_LOADER,
+  WTJL_MODULES
+} wtjl_module_t;
+
+typedef struct wtjl_memory_t {
+  size_t live; // bytes allocated and not yet freed
+  size_t peak;
+  size_t soft_limit;
+  size_t hard_limit;
+  size_t collections;
+  size_t collected; // bytes the collections freed
+  size_t modules [WTJL_MODULES]; // live bytes, by wtjl_module_t
+} wtjl_memory_t;
+
+WTJL_API wtjl_context_t *wtjl_new (void);
+WTJL_API void wtjl_destroy (wtjl_context_t *ctx);
+
+// compiles and runs `length` bytes of `source`; globals persist between calls
+WTJL_API wtjl_status_t wtjl_eval (wtjl_context_t *ctx, const char *source, size_t length);
+
+// calls the global function `name` with `argc` arguments; `result` may be NULL
+WTJL_API wtjl_status_t wtjl_call (wtjl_context_t *ctx, const char *name, size_t argc, const wtjl_value_t *argv, wtjl_value_t *result);
+
+// reads the global `name`
+WTJL_API wtjl_status_t wtjl_get (wtjl_context_t *ctx, const char *name, wtjl_value_t *value);
+
+// message for the last failed call, empty after a successful one
+WTJL_API const char *wtjl_error (wtjl_context_t *ctx);
+
+// limits the bytes `ctx` may hold, 0 for no limit. Past `soft_limit` the
+// program stops at its next loop or call, or the host at its next call into
+// `ctx`, to free whatever it can no longer reach; allocating past
+// `hard_limit` fails with WTJL_ERROR_MEMORY
+WTJL_API void wtjl_limit_memory (wtjl_context_t *ctx, size_t soft_limit, size_t hard_limit);
+
+// what `ctx` holds now and has held at most; cheap enough to call often
+WTJL_API void wtjl_memory (wtjl_context_t *ctx, wtjl_memory_t *memory);
+
+// writes the globals of `ctx`, and everything they reach, to an image file
+// another context can start from without compiling anything; a generator
+// cannot be saved
+WTJL_API wtjl_status_t wtjl_save_image (wtjl_context_t *ctx, const char *path);
+
+// starts `ctx`, which must not have run anything yet, from an image made by
+// this build. Strings are read from the image where they lie, so `image`
+// must stay valid until the context is destroyed
+WTJL_API wtjl_status_t wtjl_load_image (wtjl_context_t *ctx, const void *image, size_t length);
+
+// as wtjl_load_image, from a file the context maps and keeps mapped
+WTJL_API wtjl_status_t wtjl_load_image_file (wtjl_context_t *ctx, const char *path);
+
+static inline wtjl_value_t wtjl_integer (int64_t integer) {
+  wtjl_value_t value;
+  value.type = WTJL_INTEGER;
+  value.as.integer = integer;
+  return value;
+}
+
+static inline wtjl_value_t wtjl_double (double number) {
+  wtjl_value_t value;
+  value.type = WTJL_DOUBLE;
+  value.as.number = number;
+  return value;
+}
+
+static inline wtjl_value_t wtjl_boolean (int boolean) {
+  wtjl_value_t value;
+  value.type = WTJL_BOOLEAN;
+  value.as.boolean = boolean != 0;
+  return value;
+}
+
+// `chars` is copied into the context when the value is passed to it
+static inline wtjl_value_t wtjl_string (const char *chars, size_t length) {
+  wtjl_value_t value;
+  value.type = WTJL_STRING;
+  value.as.string.chars = chars;
+  value.as.string.length = length;
+  return value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif